@@ -48,6 +48,19 @@ string LineScanner::nextToken(){
 
 } 
 
+string LineScanner::rest(){
+
+  skipSeparators();
+
+  unsigned int startpos = index;
+
+  while ( isDelimitor(line[index]) == false )
+    index++;
+
+  return string(&line[startpos],index-startpos);
+
+}
+
 bool LineScanner::isDelimitor(char c){
 
   for ( unsigned int i = 0; i<(sizeof(delimitors)/sizeof(char)); i++)
@@ -44,6 +44,9 @@ public:
 
   std::string nextToken();
 
+  // returns the rest of the line without leading separators
+  std::string rest();
+
 private:
 
   bool isDelimitor(char c);
@@ -33,6 +33,7 @@ const char *version = "1.04";
 
 const static string formula = "formula";
 const static string commands = "commands";
+const static string streaming = "stream";
 const static string prompt = "> ";
 const static string exit_confirmation_text = "Variables or functions have been modified! Do you really want to quit without saving? (y,n) ";
 
@@ -44,6 +45,10 @@ int main(int argc, char **argv, char **envp){
   string fullprompt = "";
   VariableList *varlist = 0;
   FunctionList *functionlist = 0;
+  ExpressionCache *cache = 0;
+  bool caching = true;
+  Spreadsheet *sheet = 0;
+  bool sheeting = false;
   bool bflag = false;
   bool interactive = true;
   MemPointer<char> input;
@@ -83,7 +88,7 @@ int main(int argc, char **argv, char **envp){
       precision = (streamsize)atoi(cmdlparser.checkParameter("precision").second.c_str());
     
     // interactive-mode?
-    if ( cmdlparser.checkParameter(formula).first == true )
+    if ( cmdlparser.checkParameter(formula).first == true || cmdlparser.checkParameter(streaming).first == true )
       interactive = false;
     
     // info-output in interactive-mode
@@ -98,20 +103,39 @@ int main(int argc, char **argv, char **envp){
 
     // setup a functionlist for self-defined functions
     functionlist = new FunctionList();
+
+    // parsed expressions are reused when the same input is evaluated again
+    cache = new ExpressionCache(varlist,functionlist);
+
+    // in sheet-mode assignments are kept as formulas and recomputed
+    sheet = new Spreadsheet(varlist,functionlist);
     
     // load functions from file if given
     if ( cmdlparser.checkParameter(commands).first == true )
-      load(varlist,functionlist,cmdlparser.checkParameter(commands).second,interactive);
+      load(varlist,functionlist,cache,cmdlparser.checkParameter(commands).second,interactive);
     
+    // streaming-mode
+    if ( cmdlparser.checkParameter(streaming).first == true ){
+
+      bool streamed = stream(varlist,functionlist,cache,cmdlparser.checkParameter(streaming).second,precision);
+
+      delete sheet;
+      delete cache;
+      delete functionlist;
+      delete varlist;
+      return( streamed ? 0 : 1 );
+
+    }
+
     // run-once-mode
     if ( interactive == false ){
 
-      MathExpression mathexpression(cmdlparser.checkParameter(formula).second.c_str(),varlist,functionlist);
-      
-      Value *value = mathexpression.eval();
+      Value *value = cache->get(cmdlparser.checkParameter(formula).second.c_str())->eval();
 
       cout <<  value->toString(precision) << endl;
       
+      delete sheet;
+      delete cache;
       delete functionlist;
       delete varlist;
       return(0);
@@ -196,12 +220,12 @@ int main(int argc, char **argv, char **envp){
 
 	} else if ( firstword == REMVAR ){
 
-	  removeVariables(varlist,lscanner);
+	  removeVariables(varlist,lscanner,sheet);
 	  continue;
 
 	} else if ( firstword == UNDEF ){
 
-	  undefineFunctions(functionlist,lscanner);
+	  undefineFunctions(functionlist,lscanner,sheet);
 	  continue;
 
 	} else if ( firstword == SAVE ){
@@ -211,7 +235,7 @@ int main(int argc, char **argv, char **envp){
 
 	} else if ( firstword == LOAD ){
 
-	  load(varlist,functionlist,lscanner.nextToken(),interactive);
+	  load(varlist,functionlist,( caching ? cache : 0 ),lscanner.nextToken(),interactive);
 	  continue;
 
 	} else if ( firstword == SETPRECISION ){
@@ -228,6 +252,31 @@ int main(int argc, char **argv, char **envp){
 	  clog << precision << endl;
 	  continue;
 
+	} else if ( firstword == MEMO ){
+
+	  memoize(functionlist,lscanner);
+	  continue;
+
+	} else if ( firstword == CACHE ){
+
+	  configureCache(cache,caching,lscanner);
+	  continue;
+
+	} else if ( firstword == SHEET ){
+
+	  configureSheet(sheet,sheeting,lscanner);
+	  continue;
+
+	} else if ( firstword == PROFILE ){
+
+	  profile(lscanner);
+	  continue;
+
+	} else if ( firstword == TABULATE ){
+
+	  tabulate(varlist,functionlist,precision,lscanner);
+	  continue;
+
 	} else if (!strcmp(input.get(),FUNCS)){
 
 	  clog << functionlist->toString(precision);
@@ -240,12 +289,32 @@ int main(int argc, char **argv, char **envp){
 
 	}
 
-	MathExpression mathexpression(input.get(),varlist,functionlist);
+	if ( sheeting == true ){
+
+	  Value *value = sheet->evaluate(input.get());
+	  cout << value->toString(precision) << endl;
+
+	  if ( interactive == true && !sheet->getRecomputed().empty() ){
+
+	    clog << "recomputed:";
+	    for ( vector<string>::const_iterator it = sheet->getRecomputed().begin(); it != sheet->getRecomputed().end(); it++ )
+	      clog << " " << *it;
+	    clog << endl;
+
+	  }
+
+	  input.clear(true);
+	  continue;
+
+	}
+
+	auto_ptr<MathExpression> uncached;
+	MathExpression *mathexpression = parse(input.get(),varlist,functionlist,( caching ? cache : 0 ),uncached);
 	
 	if ( bflag == true )
-	  clog << mathexpression.toString(precision) << endl;
+	  clog << mathexpression->toString(precision) << endl;
 	
-	Value *value = mathexpression.eval();
+	Value *value = mathexpression->eval();
 	cout << value->toString(precision) << endl;
 
       } catch (FunctionDefinition &fd){
@@ -276,6 +345,8 @@ int main(int argc, char **argv, char **envp){
 
     }
     
+    delete sheet;
+    delete cache;
     delete functionlist;
     delete varlist;
     return 0;
@@ -326,13 +397,16 @@ string setupParser(CmdlParser& parser){
   parser.addParameter(commands,commands,"commands that should be loaded before execution");
   parser.synonym(commands) << "c" << "Commands" << "C";
 
+  parser.addParameter(streaming,"file","evaluate the lines of a file (- for stdin), one line of output per expression");
+  parser.synonym(streaming) << "s" << "Stream" << "S";
+
   parser.allowRelaxedSyntax();
 
   return parser.usage();
 
 }
 
-void undefineFunctions(FunctionList *fl, LineScanner & lscanner){
+void undefineFunctions(FunctionList *fl, LineScanner & lscanner, Spreadsheet *sheet){
   
   string fun;
   bool removed = false;
@@ -347,6 +421,23 @@ void undefineFunctions(FunctionList *fl, LineScanner & lscanner){
 
     } catch (Exception<FunctionList> &fle){
       clog << fle.getMsg() << ": " << fun << endl;
+      continue;
+    }
+
+    // the formulas calling the function can't keep their values
+    try{
+
+      sheet->update(fun);
+
+    } catch (EvalException &ee){
+
+      clog << "evaluation-error: '" << ee.getMsg() << "'";
+
+      if ( ee.getObjName() != "")
+	clog << ": '" << ee.getObjName() << "'";
+
+      clog << endl;
+
     }
   }
   
@@ -355,7 +446,7 @@ void undefineFunctions(FunctionList *fl, LineScanner & lscanner){
 
 }
 
-void removeVariables(VariableList *vl, LineScanner & lscanner){
+void removeVariables(VariableList *vl, LineScanner & lscanner, Spreadsheet *sheet){
 
   string var;
   bool removed = false;
@@ -365,6 +456,7 @@ void removeVariables(VariableList *vl, LineScanner & lscanner){
     try{
 
       vl->remove(var.c_str());
+      sheet->remove(var);
       clog << var << " removed" << endl;
       removed = true;
 
@@ -377,9 +469,131 @@ void removeVariables(VariableList *vl, LineScanner & lscanner){
     clog << "nothing removed" << endl;
 
 }
+
+void memoize(FunctionList *fl, LineScanner & lscanner){
+
+  string arg = lscanner.nextToken();
+
+  if ( arg == "" )
+    clog << fl->memoStatisticsToString();
+  else if ( arg == "on" )
+    fl->setMemoization(true);
+  else if ( arg == "off" )
+    fl->setMemoization(false);
+  else if ( arg == "reset" )
+    fl->resetMemoStatistics();
+  else if ( atol(arg.c_str()) > 0 )
+    fl->setMemoLimit((unsigned long)atol(arg.c_str()));
+  else
+    clog << "expecting on, off, reset or a positive limit!" << endl;
+
+}
+
+void configureCache(ExpressionCache *cache, bool & caching, LineScanner & lscanner){
+
+  string arg = lscanner.nextToken();
+
+  if ( arg == "" ){
+
+    clog << "cache: " << ( caching ? "on" : "off" ) << ", limit: " << cache->getLimit()
+	 << ", expressions: " << cache->getSize() << endl;
+    clog << cache->statisticsToString() << endl;
+
+  } else if ( arg == "on" )
+    caching = true;
+  else if ( arg == "off" ){
+
+    caching = false;
+    cache->clear();
+
+  } else if ( arg == "reset" )
+    cache->resetStatistics();
+  else if ( atol(arg.c_str()) > 0 )
+    cache->setLimit((unsigned long)atol(arg.c_str()));
+  else
+    clog << "expecting on, off, reset or a positive limit!" << endl;
+
+}
+
+void configureSheet(Spreadsheet *sheet, bool & sheeting, LineScanner & lscanner){
+
+  string arg = lscanner.nextToken();
+
+  if ( arg == "" ){
+
+    clog << "sheet: " << ( sheeting ? "on" : "off" ) << ", formulas: " << sheet->getSize() << endl;
+    clog << sheet->toString();
+
+  } else if ( arg == "on" )
+    sheeting = true;
+  else if ( arg == "off" ){
+
+    sheeting = false;
+    sheet->clear();
+
+  } else if ( arg == "clear" )
+    sheet->clear();
+  else
+    clog << "expecting on, off or clear!" << endl;
+
+}
+
+void profile(LineScanner & lscanner){
+
+  string arg = lscanner.nextToken();
+
+  if ( arg == "" )
+    clog << Profiler::toString();
+  else if ( arg == "on" )
+    Profiler::setEnabled(true);
+  else if ( arg == "off" )
+    Profiler::setEnabled(false);
+  else if ( arg == "reset" )
+    Profiler::reset();
+  else if ( arg == "fold" ){
+
+    string filename = lscanner.nextToken();
+
+    if ( filename == "" ){
+
+      clog << "no filename!" << endl;
+      return;
+
+    }
+
+    ofstream file(filename.c_str());
+
+    if ( !file ){
+
+      clog << "could not open file " << filename << "!" << endl;
+      return;
+
+    }
+
+    Profiler::writeFolded(file);
+    clog << "folded stacks written to file \"" << filename << "\"" << endl;
+
+  } else
+    clog << "expecting on, off, reset or fold <filename>!" << endl;
+
+}
+
+MathExpression *parse(const char *expression, VariableList *vl, FunctionList *fl,
+		      ExpressionCache *cache, auto_ptr<MathExpression> & uncached){
+
+  if ( cache )
+    return cache->get(expression);
+
+  uncached.reset(new MathExpression(expression,vl,fl));
+
+  return uncached.get();
+
+}
+
 void save(VariableList *vl, FunctionList *fl, streamsize precision, string filename, LineScanner & lscanner){
 
   bool write = true;
+  bool binary = ( lscanner.nextToken() == "bin" );
 
   if ( filename == "" ){
 
@@ -406,6 +620,27 @@ void save(VariableList *vl, FunctionList *fl, streamsize precision, string filen
   if ( write == false )
     return;
 
+  if ( binary == true ){
+
+    try{
+
+      Snapshot::save(filename.c_str(),vl,fl);
+
+    } catch (ExceptionBase &e){
+
+      clog << e.getMsg() << ": " << filename << endl;
+      return;
+
+    }
+
+    clog << "snapshot saved to file \"" << filename << "\"" << endl;
+
+    vl->setModified(false);
+    fl->setModified(false);
+    return;
+
+  }
+
   ofstream file(filename.c_str());
 
   if ( file == NULL ){
@@ -425,7 +660,7 @@ void save(VariableList *vl, FunctionList *fl, streamsize precision, string filen
   
 }
 
-void load(VariableList *vl, FunctionList *fl,  string filename, bool interactive){
+void load(VariableList *vl, FunctionList *fl, ExpressionCache *cache, string filename, bool interactive){
 
   // save initial state
   bool vl_modified = vl->isModified();
@@ -447,6 +682,29 @@ void load(VariableList *vl, FunctionList *fl,  string filename, bool interactive
 
   }
 
+  // snapshots are loaded without parsing
+  if ( Snapshot::isSnapshot(filename.c_str()) ){
+
+    try{
+
+      if ( interactive == true )
+	clog << "loading snapshot " << filename << endl;
+
+      vector<string> skipped = Snapshot::load(filename.c_str(),vl,fl);
+
+      for ( vector<string>::iterator it = skipped.begin(); it != skipped.end(); it++ )
+	clog << *it << " already defined or protected, not loaded" << endl;
+
+    } catch (ExceptionBase &e){
+      clog << e.getMsg() << ": " << filename << endl;
+    }
+
+    vl->setModified(vl_modified);
+    fl->setModified(fl_modified);
+    return;
+
+  }
+
   FileScanner fscanner(file);
   string line;
 
@@ -457,8 +715,9 @@ void load(VariableList *vl, FunctionList *fl,  string filename, bool interactive
       if ( interactive == true )
 	clog << "loading " << line.c_str() << endl;
 
-      MathExpression mathexpression(line.c_str(),vl,fl);
-      mathexpression.eval();
+      auto_ptr<MathExpression> uncached;
+
+      parse(line.c_str(),vl,fl,cache,uncached)->eval();
       
     } catch (FunctionDefinition &fd){ 
 
@@ -488,6 +747,160 @@ void load(VariableList *vl, FunctionList *fl,  string filename, bool interactive
 
 }
 
+// syntax: <var> <from> <to> <step> [<im-from> <im-to> <im-step>] [csv|bin <file>] : <expression>
+void tabulate(VariableList *vl, FunctionList *fl, streamsize precision, LineScanner & lscanner){
+
+  string name = lscanner.nextToken();
+  vector<cmplx_tp> bounds;
+  string format, filename, token;
+
+  while ( (token = lscanner.nextToken()) != "" && token != ":" ){
+
+    if ( token == "csv" || token == "bin" ){
+
+      format = token;
+      filename = lscanner.nextToken();
+      continue;
+
+    }
+
+    // the bounds may be expressions like 2*pi
+    bool real = false;
+
+    try{
+
+      MathExpression boundexpression(token.c_str(),vl,fl);
+      const Complex *bound = dynamic_cast<const Complex *>(boundexpression.eval());
+
+      if ( (real = ( bound && bound->isReal() )) )
+	bounds.push_back(bound->getRe());
+
+    } catch (ParseException &pe){}
+
+    if ( !real ){
+
+      clog << "expecting real bounds and steps: '" << token << "'" << endl;
+      return;
+
+    }
+
+  }
+
+  string expression = lscanner.rest();
+
+  if ( name == "" || token != ":" || expression == "" || (bounds.size() != 3 && bounds.size() != 6)
+       || (format != "" && filename == "") ){
+
+    clog << "expecting " << TABULATE << " <var> <from> <to> <step> [<im-from> <im-to> <im-step>] [csv|bin <file>] : <expression>"
+	 << endl;
+    return;
+
+  }
+
+  auto_ptr<Grid> grid(bounds.size() == 3
+		      ? new Grid(bounds[0],bounds[1],bounds[2])
+		      : new Grid(bounds[0],bounds[1],bounds[2],bounds[3],bounds[4],bounds[5]));
+  ofstream file;
+
+  if ( filename != "" ){
+
+    file.open(filename.c_str(),( format == "bin" ? ios::out | ios::binary : ios::out ));
+
+    if ( !file ){
+
+      clog << "can't write to file " << filename << endl;
+      return;
+
+    }
+
+  }
+
+  auto_ptr<TableWriter> writer(format == "bin"
+			       ? (TableWriter *)new BinaryWriter(file)
+			       : (TableWriter *)new CsvWriter(( filename != "" ? (ostream &)file : cout ),precision));
+
+  auto_ptr<MathExpression> mathexpression;
+
+  try{
+    mathexpression.reset(new MathExpression(expression.c_str(),vl,fl));
+  } catch (ParseException &pe){
+
+    clog << "parse-error: '" << pe.getMsg() << "' at position " << pe.getPos() << " of the expression" << endl;
+    return;
+
+  }
+
+  unsigned long failures = mathexpression->tabulate(name.c_str(),*grid,*writer);
+
+  clog << grid->getSize() << " points";
+  if ( failures )
+    clog << ", " << failures << " not evaluable (nan)";
+  clog << endl;
+
+}
+
+bool stream(VariableList *vl, FunctionList *fl, ExpressionCache *cache, string filename, streamsize precision){
+
+  int input = 0;
+
+  if ( filename != "-" && (input = open(filename.c_str(),O_RDONLY)) < 0 ){
+
+    clog << "file " << filename << " doesn't exist!" << endl;
+    return false;
+
+  }
+
+  // the output is buffered by cout alone and flushed at the end
+  ios::sync_with_stdio(false);
+
+  StreamScanner sscanner(input);
+  char *line;
+
+  while ( (line = sscanner.nextLine()) ){
+
+    // skip empty lines
+    if ( !line[strspn(line," \t")] )
+      continue;
+
+    try{
+
+      cout << cache->get(line)->eval()->toString(precision) << '\n';
+
+    } catch (FunctionDefinition &fd){
+
+      cout << "function defined: '" << fd.getName() << "'" << '\n';
+
+    } catch (ParseException &pe){
+
+      cout << "parse-error: '" << pe.getMsg() << "' at position " << pe.getPos() << '\n';
+
+    } catch (EvalException &ee){
+
+      cout << "evaluation-error: '" << ee.getMsg() << "'";
+
+      if ( ee.getObjName() != "")
+	cout << ": '" << ee.getObjName() << "'";
+
+      cout << '\n';
+
+    } catch (ExceptionBase &e){
+
+      // one line of output per line of input
+      cout << "error: '" << e.getMsg() << "'" << '\n';
+
+    }
+
+  }
+
+  cout.flush();
+
+  if ( input > 0 )
+    close(input);
+
+  return true;
+
+}
+
 bool checkAnswer(const string & text){
 
   char *answer;
@@ -592,10 +1005,30 @@ void printHelp(const char *pname){
        << UNDEF << " [fun1 [...]]" << "\t\tundefines the functions" << endl
        << FUNCS << "\t\tdisplays all user-defined functions\n"
        << BUILTINS << "\tdisplays all builtin-functions and -operators" << endl
-       << SAVE << " <filename>" << "\t\tsaves all user-defined variables and commands to file <filename>" << endl
-       << LOAD << " <filename>" << "\t\tloads all user-defined variables and commands from file <filename>" << endl
+       << SAVE << " <filename> [bin]" << "\tsaves all user-defined variables and commands to file <filename>,\n"
+       << "\t\t\twith \"bin\" as binary snapshot with exact values and parsed functions\n"
+       << "\t\t\t(only readable on machines of the same kind)" << endl
+       << LOAD << " <filename>" << "\t\tloads all user-defined variables and commands from file <filename>\n"
+       << "\t\t\t(text or snapshot)" << endl
        << SETPRECISION << " <value>" << "\tsets the display-precision for the post decimal position for floating-points" << endl
        << SHOWPRECISION << "\t\tdisplays the display-precision for the post decimal position for floatong-points" << endl
+       << PROFILE << " [on|off|reset|fold <file>]" << "\tswitches the profiler on/off, resets it, shows the calls,\n"
+       << "\t\t\ttimes and allocations per function and operator or writes\n"
+       << "\t\t\tthe folded stacks to <file> (input of flamegraph.pl)" << endl
+       << MEMO << " [on|off|reset|<limit>]" << "\tswitches the memoization of function-results on/off, resets its\n"
+       << "\t\t\tstatistics or sets the maximal number of results per function;\n"
+       << "\t\t\twithout argument the hit-rates are displayed" << endl
+       << TABULATE << " <var> <from> <to> <step> [<im-from> <im-to> <im-step>] [csv|bin <file>] : <expression>\n"
+       << "\t\t\tevaluates the expression for var in the range or, with the imaginary\n"
+       << "\t\t\tbounds, in the rectangle of the complex plane using all processors;\n"
+       << "\t\t\tthe table is displayed or written to file as csv or binary doubles" << endl
+       << CACHE << " [on|off|reset|<limit>]" << "\tswitches the cache of parsed expressions on/off, resets its\n"
+       << "\t\t\tstatistics or sets the maximal number of cached expressions;\n"
+       << "\t\t\twithout argument the hit-rate is displayed" << endl
+       << SHEET << " [on|off|clear]" << "\tswitches the spreadsheet-mode on/off or removes its formulas: an\n"
+       << "\t\t\tassignment \"var=expression\" is kept and evaluated again whenever\n"
+       << "\t\t\ta variable or function it depends on changes; cyclic dependencies\n"
+       << "\t\t\tare rejected; without argument the formulas are displayed" << endl
        << FON << "\t\tdisplays the formula" << endl
        << FOFF << "\t\thides the formula" << endl
        << "\n\n"
@@ -634,7 +1067,11 @@ void printHelp(const char *pname){
        << "+\taddition\n-\tsubtraction\n*\tmultiplication\n/\t"
        << "division\n\\\tnon-broken division\n%\tmodulo\n!\tfaculty\n"
        << "@\tthe operator for binomial coefficient (e.g. a@b means a choose "
-       << "b, i.e.\n\ta!/(b!(a-b)!) )\n=\tassignment to variables\n\n"
+       << "b, i.e.\n\ta!/(b!(a-b)!) )\n=\tassignment to variables\n"
+       << "\tFaculties and binomial coefficients are exact integers,\n"
+       << "\tas are +, -, *, \\, % and the comparisons of such integers.\n"
+       << "< <= > >= == !=\tcomparisons of real numbers (== and != also of complex\n"
+       << "\tnumbers), the result is 1 or 0\n\n"
        << "The following functions are predefined (\"var\" means local variable, "
        << "\"exp\" means\nmath.-expression):\n\n"
        << "Sum[<var>=<exp1>;<exp2>](<exp3>)\tsum from <var>=<exp1> to "
@@ -642,6 +1079,13 @@ void printHelp(const char *pname){
        << "Prod[<var>=<exp1>;<exp2>](<exp3>)\tsame with Produkt\n"
        << "log[<exp1>](<exp2>)\t\t\tthe logarithm of <exp2> to the "
        << "base\n\t\t\t\t\tof <exp1>\n"
+       << "cond(<exp1>,<exp2>,<exp3>)\t\t<exp2> if <exp1> is unequal to zero,\n"
+       << "\t\t\t\t\telse <exp3>; only the chosen one\n"
+       << "\t\t\t\t\tis evaluated, so functions may call\n"
+       << "\t\t\t\t\tthemselves, e.g.\n"
+       << "\t\t\t\t\tfac(n)=cond(n<2,1,n*fac(n-1))\n"
+       << "solve(<exp1>,<exp2>)\t\t\tthe solution X of the linear system\n"
+       << "\t\t\t\t\t<exp1>*X=<exp2>\n"
        << "\nThe following functions need all a mathematical "
        << "expression as argument:\n\n"
        << "ln\t\t\t\tthe logarithm to the base of e\n"
@@ -661,6 +1105,12 @@ void printHelp(const char *pname){
        << "atanh\t\t\t\tthe inverse hyperbolic tangent\n"
        << "sgn\t\t\t\tthe signum\n"
        << "tst\t\t\t\ttests if value is unequal to zero\n"
+       << "matrix\t\t\t\tthe matrix of a tuple of rows, e.g.\n"
+       << "\t\t\t\tmatrix((1,2),(3,4)), or the column of a\n"
+       << "\t\t\t\ttuple of numbers; + - * also apply to\n"
+       << "\t\t\t\tmatrices, which are printed as tuples\n"
+       << "transp\t\t\t\tthe transposed matrix\n"
+       << "det\t\t\t\tthe determinant of a square matrix\n"
        << "\n"
        << "Remark: not all the functions are applicable to really complex resp.\n"
        << "tuple values\n\n"
@@ -674,6 +1124,7 @@ void printHelp(const char *pname){
        << "   |\t^\n"
        << "   |\t* / \\ %\n"
        << "   |\t+ -\n"
+       << "   |\t< <= > >= == !=\n"
        << "   |\t,\n"
        << "   |\t=\n"
        << "   |\t;\n"
@@ -34,13 +34,21 @@
 #include <unistd.h>
 #include <sys/types.h>
 #include <sys/wait.h>
+#include <fcntl.h>
 #include <string>
+#include <memory>
 #include <fztooltempl/exception.hpp>
 #include <fztooltempl/mathexpression.hpp>
+#include <fztooltempl/mathcache.hpp>
+#include <fztooltempl/mathtable.hpp>
+#include <fztooltempl/mathsheet.hpp>
+#include <fztooltempl/mathsnapshot.hpp>
+#include <fztooltempl/mathprofile.hpp>
 #include <fztooltempl/cmdlparser.hpp>
 #include <fztooltempl/datastructures.hpp>
 #include "linescanner.hpp"
 #include "filescanner.hpp"
+#include "streamscanner.hpp"
 
 #define I_SIZE 1000
 #define QUIT "exit"
@@ -54,10 +62,15 @@
 #define UNDEF "undeffun"  // undefine functions
 #define FUNCS "funs"  // show functiondefinitions
 #define BUILTINS "builtins" // show builtin-functions
-#define SAVE "save" // save the variables and commands to file
+#define SAVE "save" // save the variables and commands to file (as text or as binary snapshot)
 #define LOAD "load" // load variables and commands from file
 #define SETPRECISION "setprecision" // set precision for post decimal position for float-values
 #define SHOWPRECISION "showprecision" // show pd-precision for float-values
+#define MEMO "memo" // switch memoization of functions on/off, set its limit or show its statistics
+#define CACHE "cache" // switch the cache of parsed expressions on/off, set its limit or show its statistics
+#define TABULATE "tabulate" // evaluate an expression over a range or a rectangle of the complex plane
+#define SHEET "sheet" // switch the recomputation of dependent variables on/off or show the formulas
+#define PROFILE "profile" // switch the profiler on/off, reset it, show its report or write the folded stacks
 #define SHOWHELP "less" // program to show help
 #define SHOWHELP2 "more" // program to show help
 
@@ -66,10 +79,18 @@ void info(const char *appname);
 void show(const char *pname, void (*what)(const char *));
 void printHelp(const char *pname);
 void gpl(const char *nix);
-void undefineFunctions(mexp::FunctionList *fl, LineScanner & lscanner);
-void removeVariables(mexp::VariableList *vl, LineScanner & lscanner);
+void undefineFunctions(mexp::FunctionList *fl, LineScanner & lscanner, mexp::Spreadsheet *sheet);
+void removeVariables(mexp::VariableList *vl, LineScanner & lscanner, mexp::Spreadsheet *sheet);
+void memoize(mexp::FunctionList *fl, LineScanner & lscanner);
+void configureCache(mexp::ExpressionCache *cache, bool & caching, LineScanner & lscanner);
+void configureSheet(mexp::Spreadsheet *sheet, bool & sheeting, LineScanner & lscanner);
+void profile(LineScanner & lscanner);
+mexp::MathExpression *parse(const char *expression, mexp::VariableList *vl, mexp::FunctionList *fl,
+			    mexp::ExpressionCache *cache, std::auto_ptr<mexp::MathExpression> & uncached);
 void save(mexp::VariableList *vl, mexp::FunctionList *fl, std::streamsize precision, std::string filename, LineScanner & lscanner);
-void load(mexp::VariableList *vl, mexp::FunctionList *fl, std::string filename, bool interactive);
+void load(mexp::VariableList *vl, mexp::FunctionList *fl, mexp::ExpressionCache *cache, std::string filename, bool interactive);
+void tabulate(mexp::VariableList *vl, mexp::FunctionList *fl, std::streamsize precision, LineScanner & lscanner);
+bool stream(mexp::VariableList *vl, mexp::FunctionList *fl, mexp::ExpressionCache *cache, std::string filename, std::streamsize precision);
 bool checkAnswer(const std::string & text);
 void printErrorArrow(int pos);
 
@@ -0,0 +1,135 @@
+/*
+  this sourcefile belongs to the programm fizzcal,
+  a calculator/evaluator for arithmetic expresions.
+  Copyright (C) 1999-2008 Friedemann Zintel
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+  For any questions, contact me at
+  friezi@cs.tu-berlin.de
+*/
+
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include "streamscanner.hpp"
+
+StreamScanner::StreamScanner(int fd) : fd(fd), buffer(0), size(BLOCKSIZE), begin(0), end(0), eof(false){
+
+  buffer = (char *)malloc(size+1);
+
+}
+
+StreamScanner::~StreamScanner(){
+
+  free(buffer);
+
+}
+
+// reads the next block behind the unreturned content, moves the content to the front or enlarges the buffer if
+// necessary; returns false if nothing could be read
+bool StreamScanner::fill(){
+
+  if ( eof == true || buffer == 0 )
+    return false;
+
+  if ( begin > 0 ){
+
+    memmove(buffer,buffer+begin,end-begin);
+    end -= begin;
+    begin = 0;
+
+  }
+
+  if ( end == size ){
+
+    char *larger = (char *)realloc(buffer,2*size+1);
+
+    if ( larger == 0 )
+      return false;
+
+    buffer = larger;
+    size *= 2;
+
+  }
+
+  ssize_t bytes;
+
+  do
+    bytes = read(fd,buffer+end,size-end);
+  while ( bytes < 0 && errno == EINTR );
+
+  if ( bytes <= 0 ){
+
+    eof = true;
+    return false;
+
+  }
+
+  end += (size_t)bytes;
+
+  return true;
+
+}
+
+char *StreamScanner::nextLine(){
+
+  if ( buffer == 0 )
+    return 0;
+
+  size_t searched = begin;
+
+  for (;;){
+
+    char *linefeed = (char *)memchr(buffer+searched,'\n',end-searched);
+
+    if ( linefeed ){
+
+      char *line = buffer+begin;
+
+      *linefeed = '\0';
+      begin = (size_t)(linefeed-buffer)+1;
+
+      if ( linefeed > line && linefeed[-1] == '\r' )
+	linefeed[-1] = '\0';
+
+      return line;
+
+    }
+
+    searched = end-begin;
+
+    if ( fill() == false )
+      break;
+
+  }
+
+  // last line without line-feed
+  if ( begin == end )
+    return 0;
+
+  char *line = buffer+begin;
+
+  buffer[end] = '\0';
+
+  if ( buffer[end-1] == '\r' )
+    buffer[end-1] = '\0';
+
+  begin = end;
+
+  return line;
+
+}
@@ -0,0 +1,71 @@
+/*
+  this sourcefile belongs to the programm fizzcal,
+  a calculator/evaluator for arithmetic expresions.
+  Copyright (C) 1999-2008 Friedemann Zintel
+
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  This program is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+  GNU General Public License for more details.
+
+  You should have received a copy of the GNU General Public License
+  along with this program; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA  02111-1307  USA
+
+  For any questions, contact me at
+  friezi@cs.tu-berlin.de
+*/
+
+#ifndef STREAMSCANNER_HPP
+#define STREAMSCANNER_HPP
+
+#include <cstddef>
+
+/**
+   Reads the lines of a file-descriptor through a large buffer. The lines are terminated in place, no string is
+   copied.
+*/
+class StreamScanner{
+
+private:
+
+  static const size_t BLOCKSIZE = 1 << 16;
+
+  int fd;
+
+  char *buffer;
+
+  size_t size;
+
+  // [begin,end) is the read but not yet returned content
+  size_t begin;
+
+  size_t end;
+
+  bool eof;
+
+  // copyconstructor: not for use
+  StreamScanner(const StreamScanner &){}
+
+  bool fill();
+
+public:
+
+  StreamScanner(int fd);
+
+  ~StreamScanner();
+
+  /**
+     @brief returns the next line without line-feed
+     @return the line, valid until the next call, or 0 at the end of input
+  */
+  char *nextLine();
+
+};
+
+#endif
@@ -592,6 +592,111 @@ namespace ds{
   };
 
 
+  /**
+     Memory is taken from blocks of chunks, released chunks are kept in a free-list and handed out again.
+     The blocks are only given back on destruction of the pool.
+     @brief A pool for memory-chunks of a fixed size
+     @since V2.1
+  */
+  class FixedSizePool{
+
+  private:
+
+    union Chunk{
+
+      Chunk *next;
+      double alignment;
+
+    };
+
+    size_t chunksize;
+    size_t chunks_per_block;
+    Chunk *freelist;
+    std::list<char *> blocks;
+
+    // copyconstructor: not for use
+    FixedSizePool(const FixedSizePool &){}
+
+  public:
+
+    /**
+       @param chunksize the size of a chunk in bytes
+       @param chunks_per_block the number of chunks allocated at once
+    */
+    FixedSizePool(size_t chunksize, size_t chunks_per_block = 256)
+      : chunksize(chunksize < sizeof(Chunk) ? sizeof(Chunk) : chunksize), chunks_per_block(chunks_per_block), freelist(0){}
+
+    ~FixedSizePool(){
+
+      for ( std::list<char *>::iterator it = blocks.begin(); it != blocks.end(); it++ )
+	::operator delete(*it);
+
+    }
+
+    /**
+       @brief returns a chunk, allocates a new block if the free-list is empty
+       @return the chunk
+    */
+    void *allocate(){
+
+      if ( !freelist ){
+
+	char *block = static_cast<char *>(::operator new(chunksize*chunks_per_block));
+
+	blocks.push_back(block);
+
+	for ( size_t i = chunks_per_block; i > 0; i-- )
+	  release(block + (i-1)*chunksize);
+
+      }
+
+      Chunk *chunk = freelist;
+      freelist = chunk->next;
+
+      return chunk;
+
+    }
+
+    /**
+       @brief gives a chunk back to the pool
+       @param chunk the chunk, any memory of at least chunksize bytes is accepted
+    */
+    void release(void *chunk){
+
+      static_cast<Chunk *>(chunk)->next = freelist;
+      freelist = static_cast<Chunk *>(chunk);
+
+    }
+
+    /**
+       @brief checks whether the next allocate() has to allocate a new block
+       @return true, if no chunk is available
+    */
+    bool isExhausted() const { return ( freelist == 0 ); }
+
+    /**
+       @brief checks whether a chunk belongs to one of the blocks of the pool
+       @param chunk the chunk
+       @return true, if the chunk belongs to the pool
+    */
+    bool owns(const void *chunk) const {
+
+      for ( std::list<char *>::const_iterator it = blocks.begin(); it != blocks.end(); it++ )
+	if ( chunk >= *it && chunk < *it + chunksize*chunks_per_block )
+	  return true;
+
+      return false;
+
+    }
+
+    /**
+       @brief returns the number of allocated blocks
+       @return the number of blocks
+    */
+    unsigned long getBlocks() const { return blocks.size(); }
+
+  };
+
   /**
      @brief A bit-matrix
   **/
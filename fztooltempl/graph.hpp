@@ -287,8 +287,8 @@ namespace graph{
     
   private:
 
-    // basically Tarjan's algorithm
-    unsigned int scc_visit(const TNode node, unsigned int id) throw(exc::ExceptionBase);
+    // basically Tarjan's algorithm, <id> counts the visited nodes over all calls
+    unsigned int scc_visit(const TNode node, unsigned int &id) throw(exc::ExceptionBase);
     
   };
 
@@ -322,7 +322,7 @@ namespace graph{
   }
 
   template<typename TNode>
-  unsigned int SCCProcessor<TNode>::scc_visit(const TNode node, unsigned int id) throw(exc::ExceptionBase){
+  unsigned int SCCProcessor<TNode>::scc_visit(const TNode node, unsigned int &id) throw(exc::ExceptionBase){
   
     unsigned int m = 0, min, value;
 
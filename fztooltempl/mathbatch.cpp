@@ -0,0 +1,431 @@
+/*
+  Copyright (C) 1999-2008 Friedemann Zintel
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  For any questions, contact me at
+  friezi@cs.tu-berlin.de
+*/
+
+
+#include <cstring>
+#include <fztooltempl/mathbatch.hpp>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+using namespace std;
+using namespace exc;
+using namespace mexp;
+
+// The kernels compute the same formulas as MathExpression::realOperation(), the vectorized loops process the
+// elements up to a multiple of the vector-length, the rest is done by the scalar loops.
+
+#if defined(__AVX__)
+
+#define MEXP_VECTORIZED
+typedef __m256d vector_tp;
+static const unsigned long LANES = 4;
+
+static inline vector_tp load(const cmplx_tp *p){ return _mm256_loadu_pd(p); }
+static inline void store(cmplx_tp *p, vector_tp v){ _mm256_storeu_pd(p,v); }
+static inline vector_tp add(vector_tp a, vector_tp b){ return _mm256_add_pd(a,b); }
+static inline vector_tp sub(vector_tp a, vector_tp b){ return _mm256_sub_pd(a,b); }
+static inline vector_tp mul(vector_tp a, vector_tp b){ return _mm256_mul_pd(a,b); }
+static inline vector_tp div(vector_tp a, vector_tp b){ return _mm256_div_pd(a,b); }
+
+#elif defined(__SSE2__)
+
+#define MEXP_VECTORIZED
+typedef __m128d vector_tp;
+static const unsigned long LANES = 2;
+
+static inline vector_tp load(const cmplx_tp *p){ return _mm_loadu_pd(p); }
+static inline void store(cmplx_tp *p, vector_tp v){ _mm_storeu_pd(p,v); }
+static inline vector_tp add(vector_tp a, vector_tp b){ return _mm_add_pd(a,b); }
+static inline vector_tp sub(vector_tp a, vector_tp b){ return _mm_sub_pd(a,b); }
+static inline vector_tp mul(vector_tp a, vector_tp b){ return _mm_mul_pd(a,b); }
+static inline vector_tp div(vector_tp a, vector_tp b){ return _mm_div_pd(a,b); }
+
+#endif
+
+static void addKernel(const cmplx_tp *a, const cmplx_tp *b, cmplx_tp *c, unsigned long n){
+
+  unsigned long i = 0;
+
+#ifdef MEXP_VECTORIZED
+  for ( ; i + LANES <= n; i += LANES )
+    store(c+i,add(load(a+i),load(b+i)));
+#endif
+
+  for ( ; i < n; i++ )
+    c[i] = a[i] + b[i];
+
+}
+
+static void subKernel(const cmplx_tp *a, const cmplx_tp *b, cmplx_tp *c, unsigned long n){
+
+  unsigned long i = 0;
+
+#ifdef MEXP_VECTORIZED
+  for ( ; i + LANES <= n; i += LANES )
+    store(c+i,sub(load(a+i),load(b+i)));
+#endif
+
+  for ( ; i < n; i++ )
+    c[i] = a[i] - b[i];
+
+}
+
+// (lre + i*lim)*(rre + i*rim)
+static void mulKernel(const cmplx_tp *lre, const cmplx_tp *lim, const cmplx_tp *rre, const cmplx_tp *rim,
+		      cmplx_tp *re, cmplx_tp *im, unsigned long n){
+
+  unsigned long i = 0;
+
+#ifdef MEXP_VECTORIZED
+  for ( ; i + LANES <= n; i += LANES ){
+
+    vector_tp a = load(lre+i), b = load(lim+i), c = load(rre+i), d = load(rim+i);
+
+    store(re+i,sub(mul(a,c),mul(b,d)));
+    store(im+i,add(mul(a,d),mul(b,c)));
+
+  }
+#endif
+
+  for ( ; i < n; i++ ){
+
+    cmplx_tp a = lre[i], b = lim[i], c = rre[i], d = rim[i];
+
+    re[i] = a*c - b*d;
+    im[i] = a*d + b*c;
+
+  }
+
+}
+
+// (lre + i*lim)/(rre + i*rim), divisor receives rre^2 + rim^2
+static void divKernel(const cmplx_tp *lre, const cmplx_tp *lim, const cmplx_tp *rre, const cmplx_tp *rim,
+		      cmplx_tp *re, cmplx_tp *im, cmplx_tp *divisor, unsigned long n){
+
+  unsigned long i = 0;
+
+#ifdef MEXP_VECTORIZED
+  for ( ; i + LANES <= n; i += LANES ){
+
+    vector_tp a = load(lre+i), b = load(lim+i), c = load(rre+i), d = load(rim+i);
+    vector_tp q = add(mul(c,c),mul(d,d));
+
+    store(divisor+i,q);
+    store(re+i,div(add(mul(a,c),mul(b,d)),q));
+    store(im+i,div(sub(mul(b,c),mul(a,d)),q));
+
+  }
+#endif
+
+  for ( ; i < n; i++ ){
+
+    cmplx_tp a = lre[i], b = lim[i], c = rre[i], d = rim[i];
+    cmplx_tp q = c*c + d*d;
+
+    divisor[i] = q;
+    re[i] = (a*c + b*d)/q;
+    im[i] = (b*c - a*d)/q;
+
+  }
+
+}
+
+Batch::Batch(MathExpression *me, const vector<string> &names, const vector<const cmplx_tp *> &columns)
+  throw (ExceptionBase) : me(me), names(names), bindings(columns), assigns(me->containsAssignment()), offset(0), length(0){
+
+  if ( names.size() != columns.size() )
+    throw EvalException("number of names and columns differ!");
+
+  for ( unsigned long i = 0; i < names.size(); i++ ){
+
+    const Variable *ve = ( me->varlist ? me->varlist->isMember(names[i].c_str()) : 0 );
+
+    if ( ve && ve->getProtect() )
+      throw EvalException("redefinition not possible!",names[i].c_str());
+
+    if ( this->columns.find(names[i]) != this->columns.end() )
+      throw EvalException("variable occurs more than once:",names[i].c_str());
+
+    this->columns[names[i]] = columns[i];
+
+  }
+
+}
+
+Batch::~Batch(){
+
+  for ( vector<Column *>::iterator it = spare.begin(); it != spare.end(); it++ )
+    delete *it;
+
+}
+
+Batch::Column *Batch::acquire(){
+
+  if ( spare.empty() )
+    return new Column();
+
+  Column *column = spare.back();
+  spare.pop_back();
+
+  return column;
+
+}
+
+bool Batch::dependsOnColumns(const MathExpression *node) const {
+
+  if ( node->isVariable() )
+    return ( columns.find(node->getVariable()) != columns.end() );
+
+  // user-defined functions may read the variables of the calling scope, assignments (apart from the index of a
+  // Sum/Prod) have side-effects
+  if ( node->isOperator() ){
+
+    if ( node->operator_id == MathExpression::OI_ASSIGN && !MathExpression::isSumProdIndex(node->getLeft()) )
+      return true;
+
+    if ( node->functionlist && node->functionlist->isMember(node->getOperator()) )
+      return true;
+
+  }
+
+  for ( list<MathExpression *>::const_iterator it = node->elements.begin(); it != node->elements.end(); it++ )
+    if ( dependsOnColumns(*it) )
+      return true;
+
+  return false;
+
+}
+
+const Batch::Scalar &Batch::scalarOf(MathExpression *node){
+
+  map<const MathExpression *,Scalar>::iterator entry = scalars.find(node);
+
+  if ( entry != scalars.end() )
+    return entry->second;
+
+  Scalar &scalar = scalars[node];
+  const Complex *cmplx = 0;
+
+  if ( node->isValue() || node->cache == MathExpression::CS_CONSTANT ){
+
+    cmplx = node->getConstant();
+
+  } else if ( node->isVariable() ){
+
+    const Variable *ve = ( node->varlist ? node->varlist->isMember(node->getVariable()) : 0 );
+
+    cmplx = ( ve ? dynamic_cast<const Complex *>(ve->getValue()) : 0 );
+
+  } else if ( !dependsOnColumns(node) ){
+
+    // errors are raised by the evaluation of the single elements
+    try{
+      cmplx = dynamic_cast<const Complex *>(node->eval());
+    } catch (ExceptionBase &e){
+    } catch (FunctionDefinition &fd){
+    }
+
+  }
+
+  if ( cmplx && cmplx->isReal() ){
+
+    scalar.re = cmplx->getRe();
+    scalar.im = cmplx->getIm();
+    scalar.ok = true;
+
+  }
+
+  return scalar;
+
+}
+
+void Batch::evalNode(MathExpression *node, Column *result){
+
+  if ( node->isVariable() ){
+
+    map<string,const cmplx_tp *>::const_iterator column = columns.find(node->getVariable());
+
+    if ( column != columns.end() ){
+
+      memcpy(result->re,column->second + offset,length*sizeof(cmplx_tp));
+
+      for ( unsigned long i = 0; i < length; i++ ){
+	result->im[i] = 0;
+	result->ok[i] = 1;
+      }
+
+      return;
+
+    }
+
+  } else if ( node->cache != MathExpression::CS_CONSTANT && node->isRealOperation() ){
+
+    Column *left = 0;
+    Column *right = acquire();
+
+    if ( node->getLeft() ){
+      left = acquire();
+      evalNode(node->getLeft(),left);
+    }
+
+    evalNode(node->getRight(),right);
+    evalOperation(node->operator_id,left,right,result);
+
+    if ( left )
+      release(left);
+    release(right);
+
+    return;
+
+  }
+
+  const Scalar &scalar = scalarOf(node);
+
+  for ( unsigned long i = 0; i < length; i++ ){
+
+    result->re[i] = scalar.re;
+    result->im[i] = scalar.im;
+    result->ok[i] = scalar.ok;
+
+  }
+
+}
+
+void Batch::evalOperation(unsigned char id, const Column *left, const Column *right, Column *result){
+
+  switch ( id ){
+
+  case MathExpression::OI_ADD:
+
+    addKernel(left->re,right->re,result->re,length);
+    addKernel(left->im,right->im,result->im,length);
+    break;
+
+  case MathExpression::OI_SUB:
+
+    subKernel(left->re,right->re,result->re,length);
+    subKernel(left->im,right->im,result->im,length);
+    break;
+
+  case MathExpression::OI_MUL:
+
+    mulKernel(left->re,left->im,right->re,right->im,result->re,result->im,length);
+    break;
+
+  case MathExpression::OI_DIV:{
+
+    Column *divisor = acquire();
+
+    divKernel(left->re,left->im,right->re,right->im,result->re,result->im,divisor->re,length);
+
+    // division by zero
+    for ( unsigned long i = 0; i < length; i++ )
+      result->ok[i] = ( left->ok[i] & right->ok[i] & ( divisor->re[i] != 0 ) & ( result->im[i] == 0 ) );
+
+    release(divisor);
+    return;
+
+  }
+
+  default:
+
+    // all other operations elementwise
+    for ( unsigned long i = 0; i < length; i++ )
+      result->ok[i] = ( ( left ? left->ok[i] : 1 ) & right->ok[i]
+			& MathExpression::realOperation(id,( left ? left->re[i] : 0 ),( left ? left->im[i] : 0 ),
+							right->re[i],right->im[i],result->re[i],result->im[i]) );
+
+    return;
+
+  }
+
+  for ( unsigned long i = 0; i < length; i++ )
+    result->ok[i] = ( left->ok[i] & right->ok[i] & ( result->im[i] == 0 ) );
+
+}
+
+unsigned long Batch::run(unsigned long count, cmplx_tp *re, cmplx_tp *im) throw (ExceptionBase,FunctionDefinition){
+
+  unsigned long fallbacks = 0;
+  auto_ptr<Column> result(new Column());
+
+  // for the elements evaluated one by one: the variables are bound in a local scope of a copy of the expression
+  auto_ptr<VariableList> scope;
+  auto_ptr<MathExpression> single;
+
+  for ( offset = 0; offset < count; offset += length ){
+
+    length = ( count - offset < BLOCKSIZE ? count - offset : BLOCKSIZE );
+
+    evalNode(me,result.get());
+
+    for ( unsigned long i = 0; i < length; i++ ){
+
+      if ( result->ok[i] ){
+
+	re[offset+i] = result->re[i];
+	if ( im )
+	  im[offset+i] = result->im[i];
+	continue;
+
+      }
+
+      // assignments must not be visible to the following elements
+      if ( !single.get() || assigns ){
+
+	single.reset();
+	scope.reset(new VariableList(me->varlist,false));
+	single.reset(new MathExpression(me,scope.get(),me->functionlist,me->abs_pos));
+
+      }
+
+      for ( unsigned long j = 0; j < names.size(); j++ )
+	scope->insert(names[j].c_str(),new Complex(bindings[j][offset+i]));
+
+      const Complex *cmplx = dynamic_cast<const Complex *>(single->eval());
+
+      if ( !cmplx )
+	throw EvalException("batch-evaluation of tuples not supported!");
+
+      if ( !im && !cmplx->isReal() )
+	throw EvalException("result is not real!");
+
+      re[offset+i] = cmplx->getRe();
+      if ( im )
+	im[offset+i] = cmplx->getIm();
+
+      fallbacks++;
+
+    }
+
+  }
+
+  return fallbacks;
+
+}
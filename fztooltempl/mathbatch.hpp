@@ -0,0 +1,144 @@
+/*
+  Copyright (C) 1999-2008 Friedemann Zintel
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  For any questions, contact me at
+  friezi@cs.tu-berlin.de
+*/
+
+
+/**
+   @file mathbatch.hpp
+   @author Friedemann Zintel
+*/
+
+#ifndef FZTOOLTEMPL_MATHBATCH_HPP
+#define FZTOOLTEMPL_MATHBATCH_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fztooltempl/exception.hpp>
+#include <fztooltempl/mathexpression.hpp>
+
+namespace mexp{
+
+  /**
+     A Batch evaluates a MathExpression for many values of some of its variables. The values are processed in
+     blocks: the tree is walked once per block and every arithmetic operator or builtin function is applied to
+     the whole block (addition, subtraction, multiplication and division by SSE2/AVX-instructions if available).
+     Subtrees not depending on the variables are evaluated only once. Elements which are not real-valued on
+     the way, or which would raise an exception, are evaluated one by one with MathExpression::eval(), so the
+     results are the same as the results of eval().
+     @brief vectorized evaluation of a MathExpression
+     @see MathExpression::evalBatch()
+     @internal
+  */
+  class Batch{
+
+  public:
+
+    // number of elements processed per walk of the tree
+    static const unsigned long BLOCKSIZE = 256;
+
+  private:
+
+    /**
+       @brief a block of values of a node, ok is 0 for elements which have to be evaluated one by one
+       @internal
+    */
+    class Column{
+
+    public:
+
+      cmplx_tp re[BLOCKSIZE];
+      cmplx_tp im[BLOCKSIZE];
+      char ok[BLOCKSIZE];
+
+    };
+
+    /**
+       @brief the value of a subtree not depending on the columns
+       @internal
+    */
+    class Scalar{
+
+    public:
+
+      cmplx_tp re;
+      cmplx_tp im;
+      bool ok;
+
+      Scalar() : re(0), im(0), ok(false){}
+
+    };
+
+    MathExpression *me;
+    std::vector<std::string> names;
+    std::vector<const cmplx_tp *> bindings;
+    std::map<std::string,const cmplx_tp *> columns;
+    std::map<const MathExpression *,Scalar> scalars;
+    std::vector<Column *> spare;
+    bool assigns;
+
+    // current block
+    unsigned long offset;
+    unsigned long length;
+
+    // copyconstructor: not for use
+    Batch(const Batch &){}
+
+    Column *acquire();
+    void release(Column *column){ spare.push_back(column); }
+
+    bool dependsOnColumns(const MathExpression *node) const;
+    const Scalar &scalarOf(MathExpression *node);
+    void evalNode(MathExpression *node, Column *result);
+    void evalOperation(unsigned char id, const Column *left, const Column *right, Column *result);
+
+  public:
+
+    /**
+       @brief prepares the evaluation
+       @param me the expression
+       @param names the names of the variables
+       @param columns the values of the variables, one array per name
+       @exception EvalException if a name is protected, occurs twice or the number of columns doesn't match
+    */
+    Batch(MathExpression *me, const std::vector<std::string> &names, const std::vector<const cmplx_tp *> &columns)
+      throw (exc::ExceptionBase);
+
+    ~Batch();
+
+    /**
+       @brief evaluates the expression for the first <count> values of the columns
+       @param count the number of values
+       @param re the real parts of the results
+       @param im the imaginary parts of the results, may be 0 if all results are real
+       @return the number of elements evaluated one by one
+       @exception EvalException
+    */
+    unsigned long run(unsigned long count, cmplx_tp *re, cmplx_tp *im) throw (exc::ExceptionBase,FunctionDefinition);
+
+  };
+
+}
+
+#endif
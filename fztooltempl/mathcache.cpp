@@ -0,0 +1,206 @@
+/*
+  Copyright (C) 1999-2008 Friedemann Zintel
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  For any questions, contact me at
+  friezi@cs.tu-berlin.de
+*/
+
+#include <set>
+#include <sstream>
+#include <fztooltempl/mathcache.hpp>
+
+using namespace std;
+using namespace exc;
+using namespace mexp;
+
+static inline bool isLetter(char x){
+  return ( (x >= 'A' && x <= 'Z') || (x >= 'a' && x <= 'z') || x == '_' );
+}
+
+static inline bool isDigit(char x){
+  return ( (x >= '0' && x <= '9') || x == '.' );
+}
+
+ExpressionCache::ExpressionCache(VariableList *vl, FunctionList *fl, unsigned long limit)
+  : varlist(vl), functionlist(fl), limit(limit ? limit : 1), hits(0), misses(0), invalidations(0){}
+
+ExpressionCache::~ExpressionCache(){
+  clear();
+}
+
+// collects the names like MathExpression::skipOperatorContent() separates them; any further name only
+// costs a lookup
+void ExpressionCache::scan(Entry *entry) const{
+
+  const string &text = entry->key;
+  set<string> functions, variables;
+  string::size_type i = 0, len = text.length();
+
+  while ( i < len ){
+
+    if ( !isLetter(text[i]) ){
+      i++;
+      continue;
+    }
+
+    string::size_type begin = i;
+    bool concat_mode = false;
+
+    for ( ; i < len; i++ ){
+
+      if ( text[i] == '_' )
+	concat_mode = true;
+
+      if ( !(isLetter(text[i]) || (concat_mode && isDigit(text[i]))) )
+	break;
+
+    }
+
+    string name = text.substr(begin,i-begin);
+
+    if ( functions.insert(name).second )
+      entry->functions.push_back(name);
+
+    string::size_type next = i;
+
+    while ( next < len && (text[next] == ' ' || text[next] == '\t') )
+      next++;
+
+    if ( next < len && text[next] == '(' && variables.insert(name).second )
+      entry->variables.push_back(name);
+
+  }
+
+}
+
+vector<bool> ExpressionCache::stateOf(const Entry *entry) const{
+
+  vector<bool> state;
+
+  state.reserve(entry->functions.size()+entry->variables.size());
+
+  for ( vector<string>::const_iterator it = entry->functions.begin(); it != entry->functions.end(); it++ )
+    state.push_back(functionlist ? functionlist->isMember(it->c_str()) : false);
+
+  for ( vector<string>::const_iterator it = entry->variables.begin(); it != entry->variables.end(); it++ )
+    state.push_back(varlist ? varlist->isMember(it->c_str()) != 0 : false);
+
+  return state;
+
+}
+
+MathExpression *ExpressionCache::get(const char *expression) throw (ParseException,ExceptionBase){
+
+  string key(expression ? expression : "");
+  string::size_type last = key.find_last_not_of(" \t");
+
+  key.erase(last == string::npos ? 0 : last+1);
+
+  map< string,list<Entry *>::iterator >::iterator found = index.find(key);
+
+  if ( found != index.end() ){
+
+    Entry *entry = *found->second;
+
+    entries.splice(entries.begin(),entries,found->second);
+
+    if ( stateOf(entry) == entry->state ){
+
+      hits++;
+      return entry->expression;
+
+    }
+
+    // a name changed its meaning: parse again
+    invalidations++;
+    misses++;
+
+    MathExpression *parsed = new MathExpression(key.c_str(),varlist,functionlist);
+
+    delete entry->expression;
+    entry->expression = parsed;
+    entry->state = stateOf(entry);
+
+    return parsed;
+
+  }
+
+  misses++;
+
+  // parse first: failing expressions are not cached
+  MathExpression *parsed = new MathExpression(key.c_str(),varlist,functionlist);
+  Entry *entry = new Entry(key);
+
+  entry->expression = parsed;
+  scan(entry);
+  entry->state = stateOf(entry);
+
+  entries.push_front(entry);
+  index[key] = entries.begin();
+
+  evict();
+
+  return parsed;
+
+}
+
+void ExpressionCache::evict(){
+
+  while ( entries.size() > limit ){
+
+    Entry *entry = entries.back();
+
+    index.erase(entry->key);
+    entries.pop_back();
+    delete entry;
+
+  }
+
+}
+
+void ExpressionCache::setLimit(unsigned long limit){
+
+  this->limit = ( limit ? limit : 1 );
+  evict();
+
+}
+
+void ExpressionCache::clear(){
+
+  for ( list<Entry *>::iterator it = entries.begin(); it != entries.end(); it++ )
+    delete *it;
+
+  entries.clear();
+  index.clear();
+
+}
+
+string ExpressionCache::statisticsToString() const{
+
+  ostringstream out;
+  unsigned long total = hits + misses;
+
+  out << hits << " hits, " << misses << " misses (" << invalidations << " invalidated), hit-rate ";
+  out << ( total ? (100.0*(double)hits)/(double)total : 0.0 ) << "%";
+
+  return out.str();
+
+}
@@ -0,0 +1,176 @@
+/*
+  Copyright (C) 1999-2008 Friedemann Zintel
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  For any questions, contact me at
+  friezi@cs.tu-berlin.de
+*/
+
+/**
+   @file mathcache.hpp
+   @author Friedemann Zintel
+*/
+
+#ifndef FZTOOLTEMPL_MATHCACHE_HPP
+#define FZTOOLTEMPL_MATHCACHE_HPP
+
+#include <string>
+#include <vector>
+#include <list>
+#include <map>
+#include <fztooltempl/exception.hpp>
+#include <fztooltempl/mathexpression.hpp>
+
+namespace mexp{
+
+  /**
+     An ExpressionCache keeps the parsed trees of the most recently used expressions of a VariableList and a
+     FunctionList. The key is the expression-string without trailing blanks (all other blanks matter for the
+     parse and for the positions of errors). Whether a name is parsed as a function or as a variable depends
+     on the FunctionList and, in front of a bracket, on the VariableList: a cached tree is parsed again if
+     one of its names has been defined or undefined as function or variable since. Redefined functions are
+     bound again on evaluation.
+     @brief LRU-cache of parsed expressions
+  */
+  class ExpressionCache{
+
+  public:
+
+    static const unsigned long DFLT_LIMIT = 256;
+
+  private:
+
+    /**
+       @brief a parsed expression and the state of its names at parse-time
+       @internal
+    */
+    class Entry{
+
+    public:
+
+      std::string key;
+      MathExpression *expression;
+
+      // the names which might be functions and the names in front of a bracket which might be variables
+      std::vector<std::string> functions;
+      std::vector<std::string> variables;
+      std::vector<bool> state;
+
+      Entry(const std::string &key) : key(key), expression(0){}
+      ~Entry(){ delete expression; }
+
+    };
+
+    VariableList *varlist;
+    FunctionList *functionlist;
+
+    std::list<Entry *> entries;
+    std::map< std::string,std::list<Entry *>::iterator > index;
+    unsigned long limit;
+
+    unsigned long hits;
+    unsigned long misses;
+    unsigned long invalidations;
+
+    // copyconstructor: not for use
+    ExpressionCache(const ExpressionCache &){}
+
+    void scan(Entry *entry) const;
+    std::vector<bool> stateOf(const Entry *entry) const;
+    void evict();
+
+  public:
+
+    /**
+       @param vl the VariableList the expressions are parsed for
+       @param fl the FunctionList the expressions are parsed for
+       @param limit the maximal number of cached expressions
+    */
+    ExpressionCache(VariableList *vl, FunctionList *fl, unsigned long limit = DFLT_LIMIT);
+
+    ~ExpressionCache();
+
+    /**
+       The expression is owned by the cache and valid until the next call of get() or clear().
+       @brief returns the parsed expression, parses it if not cached
+       @param expression the expression-string
+       @return the parsed expression
+       @exception ParseException
+    */
+    MathExpression *get(const char *expression) throw (ParseException,exc::ExceptionBase);
+
+    /**
+       The least recently used expressions are evicted if there are more.
+       @brief sets the maximal number of cached expressions
+       @param limit the maximal number, at least 1
+    */
+    void setLimit(unsigned long limit);
+
+    /**
+       @brief returns the maximal number of cached expressions
+       @return the limit
+    */
+    unsigned long getLimit() const { return limit; }
+
+    /**
+       @brief removes all expressions
+    */
+    void clear();
+
+    /**
+       @brief returns the number of cached expressions
+       @return the number of expressions
+    */
+    unsigned long getSize() const { return entries.size(); }
+
+    /**
+       @brief returns the number of calls of get() answered from the cache
+       @return the number of hits
+    */
+    unsigned long getHits() const { return hits; }
+
+    /**
+       @brief returns the number of calls of get() which had to parse
+       @return the number of misses
+    */
+    unsigned long getMisses() const { return misses; }
+
+    /**
+       @brief returns the number of misses due to names defined or undefined since parsing
+       @return the number of invalidations
+    */
+    unsigned long getInvalidations() const { return invalidations; }
+
+    /**
+       @brief resets the counters
+    */
+    void resetStatistics(){ hits = 0; misses = 0; invalidations = 0; }
+
+    /**
+       @brief returns the hits, misses and the hit-rate represented as a string
+       @return the string representing the statistics
+    */
+    std::string statisticsToString() const;
+
+  };
+
+}
+
+#endif
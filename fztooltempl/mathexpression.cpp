@@ -24,29 +24,192 @@
 */
 
 #include <fztooltempl/mathexpression.hpp>
+#include <fztooltempl/mathprogram.hpp>
+#include <fztooltempl/mathbatch.hpp>
+#include <fztooltempl/mathparallel.hpp>
+#include <fztooltempl/mathtable.hpp>
+#include <fztooltempl/mathprofile.hpp>
 
 #define SUM "Sum"
 #define PROD "Prod"
 #define FLIST "sin","cos","tan","asin","acos","atan","sinh","cosh","tanh", \
-    "asinh","acosh","atanh","ln","ld","log","exp","sgn","tst",SUM,PROD
+    "asinh","acosh","atanh","ln","ld","log","exp","sgn","tst",SUM,PROD,"cond", \
+    "matrix","transp","det","solve"
 #define OPLIST '+','-','*','/','\\','%','^','!','@','=','(',')','[',']',',',';'
+#define COMPLIST "<","<=",">",">=","==","!="
    
   using namespace std;
 using namespace exc;
 using namespace mexp;
 using namespace ds;
 
+bool Pool::enabled = true;
+__thread unsigned long Pool::requests = 0;
+__thread unsigned long Pool::heap_allocations = 0;
+__thread FixedSizePool *Pool::pools[Pool::CLASSES];
+pthread_mutex_t Pool::registry_lock = PTHREAD_MUTEX_INITIALIZER;
+vector<FixedSizePool *> *Pool::registry = 0;
+vector<FixedSizePool *> *Pool::orphans = 0;
+pthread_once_t Pool::exit_once = PTHREAD_ONCE_INIT;
+pthread_key_t Pool::exit_key;
+
+void Pool::createExitKey(){
+
+  pthread_key_create(&exit_key,orphan);
+
+}
+
+void Pool::orphan(void *threadpools){
+
+  FixedSizePool **exiting = static_cast<FixedSizePool **>(threadpools);
+
+  pthread_mutex_lock(&registry_lock);
+
+  for ( size_t i = 0; i < CLASSES; i++ )
+    if ( exiting[i] ){
+
+      orphans[i].push_back(exiting[i]);
+      exiting[i] = 0;
+
+    }
+
+  pthread_mutex_unlock(&registry_lock);
+
+}
+
+FixedSizePool *Pool::create(size_t sizeclass){
+
+  FixedSizePool *pool = 0;
+
+  pthread_once(&exit_once,createExitKey);
+
+  pthread_mutex_lock(&registry_lock);
+
+  if ( !registry ){
+
+    registry = new vector<FixedSizePool *>[CLASSES];
+    orphans = new vector<FixedSizePool *>[CLASSES];
+
+  }
+
+  // the pools are never destroyed: values might be deleted during static destruction or by another thread,
+  // the pool of an exited thread is handed on with its free chunks
+  if ( !orphans[sizeclass-1].empty() ){
+
+    pool = orphans[sizeclass-1].back();
+    orphans[sizeclass-1].pop_back();
+
+  } else {
+
+    pool = new FixedSizePool(sizeclass*GRANULARITY);
+    registry[sizeclass-1].push_back(pool);
+
+  }
+
+  pthread_mutex_unlock(&registry_lock);
+
+  // on exit of the thread orphan() gets its pools
+  pthread_setspecific(exit_key,pools);
+
+  return pools[sizeclass-1] = pool;
+
+}
+
+FixedSizePool *Pool::owner(void *memory, size_t sizeclass){
+
+  FixedSizePool *pool = pools[sizeclass-1];
+
+  if ( pool && pool->owns(memory) )
+    return pool;
+
+  pool = 0;
+
+  pthread_mutex_lock(&registry_lock);
+
+  if ( registry )
+    for ( vector<FixedSizePool *>::iterator it = registry[sizeclass-1].begin(); !pool && it != registry[sizeclass-1].end(); it++ )
+      if ( (*it)->owns(memory) )
+	pool = *it;
+
+  pthread_mutex_unlock(&registry_lock);
+
+  return pool;
+
+}
+
+void *Pool::allocate(size_t size){
+
+  size_t sizeclass = (size + GRANULARITY - 1)/GRANULARITY;
+
+  requests++;
+
+  if ( sizeclass == 0 || sizeclass > CLASSES ){
+
+    heap_allocations++;
+    return ::operator new(size);
+
+  }
+
+  // the full size of the class: the memory may be released into the pool after re-enabling
+  if ( !enabled ){
+
+    heap_allocations++;
+    return ::operator new(sizeclass*GRANULARITY);
+
+  }
+
+  FixedSizePool *pool = pools[sizeclass-1];
+
+  if ( !pool )
+    pool = create(sizeclass);
+
+  if ( pool->isExhausted() )
+    heap_allocations++;
+
+  return pool->allocate();
+
+}
+
+void Pool::release(void *memory, size_t size){
+
+  size_t sizeclass = (size + GRANULARITY - 1)/GRANULARITY;
+
+  if ( !memory )
+    return;
+
+  if ( sizeclass == 0 || sizeclass > CLASSES ){
+
+    ::operator delete(memory);
+    return;
+
+  }
+
+  // the chunk goes into the pool of the releasing thread, while disabled only memory of some pool is kept
+  if ( enabled || owner(memory,sizeclass) ){
+
+    FixedSizePool *pool = pools[sizeclass-1];
+
+    if ( !pool )
+      pool = create(sizeclass);
+
+    pool->release(memory);
+
+  } else
+    ::operator delete(memory);
+
+}
+
 Variable::Variable(const char *name, Value *value, char protect)
-  throw (ExceptionBase) : value(value), protect(protect), next(0){
+  throw (ExceptionBase) : value(value), protect(protect), next(0), hash(hashName(name)){
   
-  if (!(this->name = new char[strlen(name)+1]))
+  if (!(this->name = static_cast<char *>(Pool::allocate(strlen(name)+1))))
     throw OutOfMemException();
   strcpy(this->name,name);
 }
 
 Variable::~Variable(){
 
-  delete [] this->name;
+  Pool::release(this->name,strlen(this->name)+1);
   delete value;
 
 }
@@ -60,16 +223,73 @@ void Variable::setValue(Value *value){
   
 }
 
-VariableList::VariableList(const VariableList& vl) throw (ExceptionBase) : first(0), last(0), modified(false){
+unsigned long Variable::hashName(const char *name){
+
+  // FNV-1a
+  unsigned long hash = 2166136261UL;
+
+  while ( *name ){
+    hash ^= (unsigned char)*name++;
+    hash *= 16777619UL;
+  }
+
+  return hash;
+
+}
+
+__thread unsigned long VariableList::allocations = 0;
+__thread unsigned long VariableList::max_depth = 0;
+
+VariableList::VariableList(const VariableList *parent, bool unprotect)
+  : first(0), last(0), modified(false), index(0), capacity(0), count(0),
+    parent(parent), unprotecting(unprotect), depth(parent->depth + 1){
+
+  if ( depth > max_depth )
+    max_depth = depth;
+}
+
+VariableList::VariableList(const VariableList& vl) throw (ExceptionBase)
+  : first(0), last(0), modified(false), index(0), capacity(0), count(0),
+    parent(0), unprotecting(false), depth(0){
   
   const Variable *curr;
 
-  curr = vl.first;
-  while (curr){
+  if ( !vl.parent ){
 
-    this->insert(curr->getName(),curr->getValue()->clone(),curr->getProtect());
-    curr = curr->getNext();
+    // the names are unique already, so no membership-test is needed
+    curr = vl.first;
+    while (curr){
+
+      this->append(curr->getName(),curr->getValue()->clone(),curr->getProtect());
+      curr = curr->getNext();
+
+    }
+
+    return;
+  }
+
+  // a local scope: flatten all visible variables, beginning with the outermost scope
+  vector<const VariableList *> scopes;
+
+  for ( const VariableList *scope = &vl; scope; scope = scope->parent )
+    scopes.push_back(scope);
+
+  for ( vector<const VariableList *>::reverse_iterator it = scopes.rbegin(); it != scopes.rend(); it++ ){
+
+    if ( (*it)->unprotecting )
+      this->unprotect();
 
+    for ( curr = (*it)->first; curr; curr = curr->getNext() ){
+
+      Variable *ve = this->find(curr->getName());
+
+      if ( ve ){
+	ve->setValue(curr->getValue()->clone());
+	ve->setProtect(curr->getProtect());
+      } else
+	this->append(curr->getName(),curr->getValue()->clone(),curr->getProtect());
+
+    }
   }
 }
 
@@ -83,6 +303,8 @@ VariableList::~VariableList(){
     delete curr;
     curr = next;
   }
+
+  delete [] index;
 }
 
 void VariableList::insert(const char *name, Value *value, char protect)
@@ -90,7 +312,7 @@ void VariableList::insert(const char *name, Value *value, char protect)
 
   Variable *ve;
 
-  if ((ve = isMember(name))){
+  if ((ve = find(name))){
     if (!ve->getProtect()){
 
       ve->setValue(value);
@@ -98,16 +320,63 @@ void VariableList::insert(const char *name, Value *value, char protect)
     }else
       throw EvalException("redefinition not possible!",
 			  ve->getName());
-  } else {
-    if (!(ve = new Variable(name,value,protect)))
-      throw OutOfMemException();
+  } else if ( parent && !unprotecting && parent->visibleProtection(name) )
+    // a protected variable of an enclosing scope can't be redefined locally
+    throw EvalException("redefinition not possible!",name);
+  else
+    append(name,value,protect);
+}
+
+void VariableList::append(const char *name, Value *value, char protect) throw (ExceptionBase){
+
+  Variable *ve;
+
+  if (!(ve = new Variable(name,value,protect)))
+    throw OutOfMemException();
       
-    if (!first)
-      first = ve;
-    if (last)
-      last->setNext(ve);
-    last = ve;
-  }
+  if (!first)
+    first = ve;
+  if (last)
+    last->setNext(ve);
+  last = ve;
+
+  count++;
+  allocations++;
+
+  // keep the load-factor of the index at most 1/2
+  if ( index && 2*count <= capacity )
+    addToIndex(ve);
+  else if ( index || count > INDEX_THRESHOLD )
+    rebuildIndex(capacity ? 2*capacity : 4*INDEX_THRESHOLD);
+}
+
+void VariableList::addToIndex(Variable *ve){
+
+  unsigned long slot;
+
+  for ( slot = ve->getHash() & (capacity-1); index[slot]; slot = (slot+1) & (capacity-1) )
+    ;
+
+  index[slot] = ve;
+}
+
+void VariableList::rebuildIndex(unsigned long capacity){
+
+  delete [] index;
+  index = 0;
+  this->capacity = 0;
+
+  if ( count <= INDEX_THRESHOLD )
+    return;
+
+  index = new Variable *[capacity];
+  this->capacity = capacity;
+
+  for ( unsigned long slot = 0; slot < capacity; slot++ )
+    index[slot] = 0;
+
+  for ( Variable *curr = first; curr; curr = curr->getNext() )
+    addToIndex(curr);
 }
 
 void VariableList::remove(const char *name) throw (Exception<VariableList>){
@@ -124,6 +393,10 @@ void VariableList::remove(const char *name) throw (Exception<VariableList>){
       if (prev)
 	prev->setNext(curr->getNext());
       delete curr;
+      count--;
+      // removing is rare: simply rebuild the index instead of rearranging the probe-sequences
+      if ( index )
+	rebuildIndex(capacity);
       return;
     }
     prev = curr;
@@ -134,24 +407,60 @@ void VariableList::remove(const char *name) throw (Exception<VariableList>){
 
 Value *VariableList::getValue(const char *name) const throw (ExceptionBase){
 
-  const Variable *ve;
+  const Variable *ve = isMember(name);
+
+  if ( ve )
+    return ve->getValue()->clone();
 
-  ve = first;
-  while (ve){
-    if (!strcmp(ve->getName(),name))
-      return ve->getValue()->clone();
-    ve = ve->getNext();
-  }
   throw EvalException("unknown variable!",name);
 }
 
 Variable *VariableList::isMember(const char *name) const{
 
+  Variable *ve;
+
+  for ( const VariableList *scope = this; scope; scope = scope->parent )
+    if ( (ve = scope->find(name)) )
+      return ve;
+
+  return 0;
+}
+
+char VariableList::visibleProtection(const char *name) const{
+
+  const Variable *ve;
+
+  for ( const VariableList *scope = this; scope; scope = scope->parent ){
+
+    if ( (ve = scope->find(name)) )
+      return ve->getProtect();
+
+    if ( scope->unprotecting )
+      return 0;
+
+  }
+
+  return 0;
+}
+
+Variable *VariableList::find(const char *name) const{
+
+  unsigned long hash = Variable::hashName(name);
   const Variable *ve;
+
+  if ( index ){
+
+    for ( unsigned long slot = hash & (capacity-1); (ve = index[slot]); slot = (slot+1) & (capacity-1) )
+      if ( ve->getHash() == hash && !strcmp(ve->getName(),name) )
+	return const_cast<Variable *>(ve);
+
+    return 0;
+
+  }
   
   ve=first;
   while (ve){
-    if (!strcmp(ve->getName(),name))
+    if (ve->getHash() == hash && !strcmp(ve->getName(),name))
       return const_cast<Variable *>(ve);
     ve=ve->getNext();
   }
@@ -163,7 +472,7 @@ void VariableList::unprotect(const char *name){
   Variable *curr=0;
 
   if (name)
-    this->isMember(name)->setProtect(0);
+    this->find(name)->setProtect(0);
   else{
     curr=this->first;
     while (curr){
@@ -201,7 +510,7 @@ string VariableList::toString(bool include_protected, streamsize precision) cons
 
 Function::Function(const char *name, MathExpression *paramlist,
 		   MathExpression *body)
-  : paramlist(paramlist), body(body), next(0){
+  : paramlist(paramlist), body(body), next(0), program(0), pure(true), free_known(false), collecting(false), hits(0), misses(0){
 
   this->name = new char[strlen(name)+1];
   strcpy(this->name,name);
@@ -209,11 +518,65 @@ Function::Function(const char *name, MathExpression *paramlist,
 
 Function::~Function(){
 
+  forget();
+  delete program;
   delete [] this->name;
   delete this->paramlist;
   delete this->body;
 }
 
+Value *Function::lookup(const string &key){
+
+  map< string,list< pair<string,Value *> >::iterator >::iterator entry = memo.find(key);
+
+  if ( entry == memo.end() ){
+    misses++;
+    return 0;
+  }
+
+  // the result becomes the most recently used one
+  results.splice(results.begin(),results,entry->second);
+  hits++;
+
+  return entry->second->second;
+
+}
+
+void Function::store(const string &key, Value *result, unsigned long limit){
+
+  if ( memo.find(key) != memo.end() ){
+    delete result;
+    return;
+  }
+
+  results.push_front(pair<string,Value *>(key,result));
+  memo[key] = results.begin();
+
+  // evict the least recently used results
+  while ( results.size() > limit ){
+
+    memo.erase(results.back().first);
+    delete results.back().second;
+    results.pop_back();
+
+  }
+
+}
+
+void Function::forget(){
+
+  for ( list< pair<string,Value *> >::iterator it = results.begin(); it != results.end(); it++ )
+    delete it->second;
+
+  results.clear();
+  memo.clear();
+
+  // the free variables depend on the called functions
+  freevariables.clear();
+  free_known = false;
+
+}
+
 FunctionList::~FunctionList(){
 
   Function *curr, *next;
@@ -233,15 +596,9 @@ bool FunctionList::isMember(const char *name) const{
 
 Function *FunctionList::get(const char *name) const{
 
-  const Function *fe;
-  
-  fe=first;
-  while (fe){
-    if (!strcmp(fe->getName(),name))
-      return const_cast<Function *>(fe);
-    fe=fe->next;
-  }
-  return 0;
+  map<string,Function *>::const_iterator it = byname.find(name);
+
+  return ( it == byname.end() ? 0 : it->second );
 }
 
 
@@ -255,6 +612,10 @@ void FunctionList::insert(Function *fe) throw(Exception<FunctionList>){
   if (last)
     last->next=fe;
   last=fe;
+  byname[fe->getName()]=fe;
+
+  version++;
+  forget();
 }
 
 void FunctionList::remove(const char *name) throw(Exception<FunctionList>){
@@ -270,7 +631,10 @@ void FunctionList::remove(const char *name) throw(Exception<FunctionList>){
 	last=prev;
       if (prev)
 	prev->next=curr->next;
+      byname.erase(curr->getName());
       delete curr;
+      version++;
+      forget();
       return;
     }
     prev=curr;
@@ -279,6 +643,93 @@ void FunctionList::remove(const char *name) throw(Exception<FunctionList>){
   throw Exception<FunctionList>("not defined!");
 }
 
+void FunctionList::append(const vector<Function *> &functions){
+
+  for ( vector<Function *>::const_iterator it = functions.begin(); it != functions.end(); it++ ){
+
+    if (!first)
+      first=*it;
+    if (last)
+      last->next=*it;
+    last=*it;
+    byname[(*it)->getName()]=*it;
+
+  }
+
+  version++;
+  forget();
+
+}
+
+void FunctionList::forget(){
+
+  for ( Function *curr = first; curr; curr = curr->next )
+    curr->forget();
+
+}
+
+void FunctionList::setMemoization(bool value){
+
+  memoization = value;
+
+  if ( !memoization )
+    forget();
+
+}
+
+void FunctionList::setMemoLimit(unsigned long limit){
+
+  memo_limit = ( limit ? limit : 1 );
+  forget();
+
+}
+
+void FunctionList::resetMemoStatistics(){
+
+  for ( Function *curr = first; curr; curr = curr->next )
+    curr->hits = curr->misses = 0;
+
+}
+
+string FunctionList::memoStatisticsToString() const{
+
+  ostringstream stats;
+  unsigned long hits = 0, misses = 0;
+
+  stats << "memoization: " << ( memoization ? "on" : "off" ) << ", limit: " << memo_limit << endl;
+
+  for ( Function *curr = first; curr; curr = curr->next ){
+
+    stats << curr->getName() << ": ";
+
+    if ( !curr->isPure() ){
+      stats << "not memoized (assigns global variables)" << endl;
+      continue;
+    }
+
+    stats << curr->hits << " hits, " << curr->misses << " misses";
+
+    if ( curr->hits + curr->misses )
+      stats << ", hit-rate " << (100.0*(double)curr->hits)/(double)(curr->hits + curr->misses) << "%";
+
+    stats << ", " << curr->results.size() << " results" << endl;
+
+    hits += curr->hits;
+    misses += curr->misses;
+
+  }
+
+  stats << "total: " << hits << " hits, " << misses << " misses";
+
+  if ( hits + misses )
+    stats << ", hit-rate " << (100.0*(double)hits)/(double)(hits + misses) << "%";
+
+  stats << endl;
+
+  return stats.str();
+
+}
+
 void FunctionList::print(streamsize precision, const char *name){
 
   Function *curr;
@@ -351,7 +802,7 @@ string FunctionList::toString(streamsize precision) const{
 
 Tuple::~Tuple(){
 
-  for ( list<Value *>::iterator it = elements.begin(); it != elements.end(); it++ )
+  for ( vector<Value *>::iterator it = elements.begin(); it != elements.end(); it++ )
     delete (*it);
 
 }
@@ -362,7 +813,7 @@ string Tuple::toString(std::streamsize precision) const {
 
   value << "(";
 
-  for ( list<Value *>::const_iterator it = elements.begin(); it != elements.end(); it++ )
+  for ( vector<Value *>::const_iterator it = elements.begin(); it != elements.end(); it++ )
     value << ( it == elements.begin() ? (*it)->toString(precision) : string(",") + (*it)->toString(precision) );
 
   value << ")";
@@ -373,27 +824,47 @@ string Tuple::toString(std::streamsize precision) const {
 
 Value *Tuple::clone() const {
 
-  Tuple *value = new Tuple();
+  Tuple *value = new Tuple(elements.size());
 
-  for ( list<Value *>::const_iterator it = elements.begin(); it != elements.end(); it++ )
+  for ( vector<Value *>::const_iterator it = elements.begin(); it != elements.end(); it++ )
     value->addElement((*it)->clone());
 
   return value;
 
 }
 
-Tuple *Tuple::assertTuple(Value *value) throw(EvalException){
+void Value::accumulate(Value *&accumulator, Value *value, bool product) throw (ExceptionBase){
 
-  if ( Tuple * tuple = dynamic_cast<Tuple *>(value) )
-    return tuple;
+  if ( typeid(*accumulator) == typeid(*value) ){
 
-  throw EvalException(string("operand to tuple is no tuple-type: ") + value->toString() + string(" !"));
+    if ( product )
+      accumulator->operator*=(value);
+    else
+      accumulator->operator+=(value);
 
-}
-void Tuple::assertKind(const Tuple *t1, const Tuple *t2) throw(EvalException){
+    return;
 
-  if ( t1->elements.size() != t2->elements.size() )
-    throw EvalException(string("tuples are not of same kind: ") + t1->Value::toString() + string(" <-> ") + t2->Value::toString() + string(" !"));
+  }
+
+  Value *result = ( product ? accumulator->operator*(value) : accumulator->operator+(value) );
+
+  delete accumulator;
+  accumulator = result;
+
+}
+
+Tuple *Tuple::assertTuple(Value *value) throw(EvalException){
+
+  if ( Tuple * tuple = dynamic_cast<Tuple *>(value) )
+    return tuple;
+
+  throw EvalException(string("operand to tuple is no tuple-type: ") + value->toString() + string(" !"));
+
+}
+void Tuple::assertKind(const Tuple *t1, const Tuple *t2) throw(EvalException){
+
+  if ( t1->elements.size() != t2->elements.size() )
+    throw EvalException(string("tuples are not of same kind: ") + t1->Value::toString() + string(" <-> ") + t2->Value::toString() + string(" !"));
 
 }
 
@@ -403,9 +874,9 @@ Value *Tuple::operator+(Value *right) throw (ExceptionBase){
 
   assertKind(this,rt);
 
-  Tuple *value = new Tuple();
+  Tuple *value = new Tuple(elements.size());
 
-  for ( list<Value *>::iterator lit = elements.begin(), rit = rt->elements.begin(); lit != elements.end(); lit++, rit++ )
+  for ( vector<Value *>::iterator lit = elements.begin(), rit = rt->elements.begin(); lit != elements.end(); lit++, rit++ )
     value->addElement((*lit)->operator+((*rit)));
 
   return value;
@@ -487,7 +958,8 @@ Complex *Complex::assertInteger(Value *value) throw(EvalException,ExceptionBase)
 
     Complex *cmplx = assertReal(value);
 
-    if ( cmplx->getRe() != (double)((int)(cmplx->getRe())) )
+    // the callers work with the approximation of an Integer
+    if ( cmplx->isExact() || cmplx->getRe() != (double)((int)(cmplx->getRe())) )
       throw EvalException("");
 
     return cmplx;
@@ -536,6 +1008,10 @@ Value *Complex::neutralMultiplikation() const {
 Value *Complex::operator+(Value *right) throw (ExceptionBase){
 
   Complex *rc = assertComplex(right);
+
+  if ( isExactWith(rc) )
+    return Integer(getRe()).operator+(right);
+
   return new Complex(this->getRe()+rc->getRe(),this->getIm()+rc->getIm());
       
 }
@@ -543,6 +1019,10 @@ Value *Complex::operator+(Value *right) throw (ExceptionBase){
 Value *Complex::operator-(Value *right) throw (ExceptionBase){
 
   Complex *rc = assertComplex(right);
+
+  if ( isExactWith(rc) )
+    return Integer(getRe()).operator-(right);
+
   return new Complex(getRe()-rc->getRe(),getIm()-rc->getIm());
 
 }
@@ -551,13 +1031,23 @@ Value *Complex::operator*(Value *right) throw (ExceptionBase){
       
   if ( Complex *rc = dynamic_cast<Complex *>(right) ){
 
+    if ( isExactWith(rc) )
+      return Integer(getRe()).operator*(right);
+
+    if ( isExact() || rc->isExact() )
+      return scaledOperation(this,rc,false);
+
     return new Complex(getRe()*rc->getRe()-getIm()*rc->getIm(),getRe()*rc->getIm()+getIm()*rc->getRe());
 
+  } else if ( Matrix *rm = dynamic_cast<Matrix *>(right) ){
+
+    return rm->operator*(this);
+
   } else if ( Tuple *rt = dynamic_cast<Tuple *>(right) ){
 
-    Tuple *value = new Tuple();
+    Tuple *value = new Tuple(rt->elements.size());
 
-    for ( list<Value *>::iterator it = rt->elements.begin(); it != rt->elements.end(); it++ )
+    for ( vector<Value *>::iterator it = rt->elements.begin(); it != rt->elements.end(); it++ )
       value->addElement(this->operator*(*it));
 
     return value;
@@ -571,6 +1061,12 @@ Value *Complex::operator/(Value *right) throw (ExceptionBase){
 
   Complex *rc = assertComplex(right);
 
+  if ( isExactWith(rc) )
+    return Integer(getRe()).operator/(right);
+
+  if ( isExact() || rc->isExact() )
+    return scaledOperation(this,rc,true);
+
   double divisor = (::pow(rc->getRe(),2)+::pow(rc->getIm(),2));
   
   if ( divisor == 0 )
@@ -581,6 +1077,32 @@ Value *Complex::operator/(Value *right) throw (ExceptionBase){
       
 }
 
+Value *Complex::scaledOperation(const Complex *left, const Complex *right, bool divide) throw (EvalException){
+
+  int lexponent, rexponent;
+  complex<cmplx_tp> l = left->getScaled(lexponent), r = right->getScaled(rexponent), result;
+
+  if ( divide ){
+
+    double divisor = (::pow(r.real(),2)+::pow(r.imag(),2));
+
+    if ( divisor == 0 )
+      throw EvalException("division by zero!");
+
+    result = complex<cmplx_tp>((l.real()*r.real()+l.imag()*r.imag())/divisor,(l.imag()*r.real()-l.real()*r.imag())/divisor);
+    lexponent -= rexponent;
+
+  } else {
+
+    result = complex<cmplx_tp>(l.real()*r.real()-l.imag()*r.imag(),l.real()*r.imag()+l.imag()*r.real());
+    lexponent += rexponent;
+
+  }
+
+  return new Complex(::ldexp(result.real(),lexponent),::ldexp(result.imag(),lexponent));
+
+}
+
 void Complex::operator+=(Value *right) throw (ExceptionBase){
 
   Complex *rc = assertComplex(right);
@@ -601,6 +1123,9 @@ Value *Complex::integerDivision(Value *right) throw (ExceptionBase){
   
   Complex *rc = assertComplex(right);
 
+  if ( isExactWith(rc) )
+    return Integer(getRe()).integerDivision(right);
+
   double divisor = (::pow(rc->getRe(),2)+::pow(rc->getIm(),2));
   
   if ( divisor == 0 )
@@ -614,6 +1139,9 @@ Value *Complex::integerDivision(Value *right) throw (ExceptionBase){
 Value *Complex::operator%(Value *right) throw (ExceptionBase){
 
   Complex *rc = assertComplex(right);
+
+  if ( isExactWith(rc) )
+    return Integer(getRe()).operator%(right);
     
   Complex *div = (Complex *)integerDivision(rc);
   Complex * prod = (Complex *)right->operator*(div);
@@ -628,6 +1156,10 @@ Value *Complex::operator%(Value *right) throw (ExceptionBase){
 
 Value *Complex::faculty() throw (ExceptionBase){
   
+  // beyond the precision of a double
+  if ( isIntegral() && this->getRe() > Integer::MAX_DOUBLE_FACULTY )
+    return Integer::factorial(this->getRe() > Integer::MAX_FACULTY ? Integer::MAX_FACULTY + 1 : (unsigned long)this->getRe());
+
   assertNatural(this);
 
   if ( this->getRe() == 0 )
@@ -644,16 +1176,67 @@ Value *Complex::faculty() throw (ExceptionBase){
 
 Value *Complex::choose(Value *right) throw (ExceptionBase){
 
-  assertNatural(this);
-  Complex *cr = assertNatural(right);
+  Complex *cr = dynamic_cast<Complex *>(right);
+
+  // not restricted to the range of int like assertNatural()
+  if ( !cr || !isIntegral() || !cr->isIntegral() || getRe() < 0 || cr->getRe() < 0 )
+    throw EvalException("operation only allowed for natural-numbers! ");
+
+  if ( isExactWith(cr) )
+    return Integer(getRe()).choose(right);
+
+  return Integer::binomial((unsigned long)getRe(),(unsigned long)cr->getRe());
+
+}
+
+bool Complex::multiplyPower(const complex<cmplx_tp> &base, const complex<cmplx_tp> &exponent, complex<cmplx_tp> &result){
+
+  if ( exponent.imag() != 0 || exponent.real() < 1 || exponent.real() > MAX_MULTIPLIED_EXPONENT )
+    return false;
+
+  int n = (int)exponent.real();
+
+  if ( n != exponent.real() )
+    return false;
+
+  // binary exponentiation, with the same formula as operator*()
+  complex<cmplx_tp> square = base;
+  cmplx_tp re, im;
+  bool first = true;
+
+  for ( ; n > 0; n >>= 1 ){
+
+    if ( n & 1 ){
+
+      if ( first ){
+	result = square;
+	first = false;
+      } else {
+	re = result.real()*square.real() - result.imag()*square.imag();
+	im = result.real()*square.imag() + result.imag()*square.real();
+	result = complex<cmplx_tp>(re,im);
+      }
+    }
+
+    if ( n > 1 ){
+      re = square.real()*square.real() - square.imag()*square.imag();
+      im = square.real()*square.imag() + square.imag()*square.real();
+      square = complex<cmplx_tp>(re,im);
+    }
+  }
 
-  return new Complex( MathExpression::faculty(getRe()) / ( MathExpression::faculty(cr->getRe()) * MathExpression::faculty(getRe() - cr->getRe())));
+  return true;
 
 }
 
 Value *Complex::pow(Value *right) throw (ExceptionBase){
   
   Complex *rc = assertComplex(right);
+  complex<cmplx_tp> result;
+
+  // small integer powers are more accurate and faster by multiplication
+  if ( multiplyPower(*this,*rc,result) )
+    return new Complex(result);
 
   return new Complex(std::pow(static_cast< complex<cmplx_tp> >(*this),static_cast< complex<cmplx_tp> >(*rc)));
       
@@ -777,1864 +1360,4636 @@ Value *Complex::tst() throw (ExceptionBase){
 
 }
 
-MathExpression::MathExpression(int abs_pos, VariableList *vl, FunctionList *fl) :
-  varlist(vl),functionlist(fl),left(0), right(0), pred(0),
-  value(0), type(ET_EMPTY), operator_type(OT_EMPTY), abs_pos(abs_pos), imaginary_unit('i'), delete_flat(false){
-  
-  oprtr = string("");
-  variable = string("");
+bool Complex::isTrue(Value *value) throw(EvalException,ExceptionBase){
 
-}
+  if ( Complex *cmplx = dynamic_cast<Complex *>(value) )
+    return ( cmplx->getRe() != 0 or cmplx->getIm() != 0 );
 
-MathExpression::MathExpression(const char *expression, VariableList *vl,
-			       FunctionList *fl)
-  throw (ParseException,ExceptionBase)
-  : varlist(vl), functionlist(fl), left(0), right(0), pred(0),
-    value(0), type(ET_EMPTY), operator_type(OT_EMPTY), abs_pos(1), imaginary_unit('i'), delete_flat(false){
-  
-  oprtr = string("");
-  variable = string("");
+  throw EvalException(string("condition is not complex-type: ") + value->toString() + string(" !"));
 
-  MathExpression *top;
-  VariableList locals;
-  
-  top = this->parse(expression,locals);
+}
 
+Value *Complex::lessThan(Value *right) throw (ExceptionBase){
 
-  if ( top ){
+  if ( isExactWith(assertReal(right)) )
+    return Integer(getRe()).lessThan(right);
 
-    this->setLeft(top->getLeft());
-    this->setRight(top->getRight());
-    this->elements = top->elements;
-    this->pred=top->pred;
+  assertReal(this);
+  return new Complex(this->getRe() < assertReal(right)->getRe());
 
-    switch (top->getEType()){
+}
 
-    case ET_OP:
-      this->setETOperator(top->getOperator());
-      this->setOType(top->getOType());
-      break;
+Value *Complex::lessEqual(Value *right) throw (ExceptionBase){
 
-    case ET_VAR:
-      this->setETVariable(top->getVariable());
-      break;
+  if ( isExactWith(assertReal(right)) )
+    return Integer(getRe()).lessEqual(right);
 
-    case ET_VAL:
-      // must be a flat copy because 'top' will only be freed and not deleted
-      this->setETValue(top->getValue());
-      break;
+  assertReal(this);
+  return new Complex(this->getRe() <= assertReal(right)->getRe());
 
-    case ET_EMPTY:
-    default:
-      this->setEType(top->getEType());
-      break;
+}
 
-    }
+Value *Complex::greaterThan(Value *right) throw (ExceptionBase){
 
-  }
-  
-  try{
+  if ( isExactWith(assertReal(right)) )
+    return Integer(getRe()).greaterThan(right);
 
-    this->checkSyntaxAndOptimize();
+  assertReal(this);
+  return new Complex(this->getRe() > assertReal(right)->getRe());
 
-  }catch (ParseException &pe){
+}
 
-    delete top;
-    throw pe;
+Value *Complex::greaterEqual(Value *right) throw (ExceptionBase){
 
-  }
+  if ( isExactWith(assertReal(right)) )
+    return Integer(getRe()).greaterEqual(right);
 
-  // must be only flat-destruction because the referred objects have been stored in this
-  top->delete_flat = true;
-  delete top;
+  assertReal(this);
+  return new Complex(this->getRe() >= assertReal(right)->getRe());
 
 }
 
-MathExpression::MathExpression(MathExpression *me, VariableList *vl, FunctionList *fl, int abs_pos)
-  throw (ParseException,ExceptionBase)
-  : varlist(vl), functionlist(fl), left(0), right(0), pred(0),
-    value(0), type(ET_EMPTY), operator_type(OT_EMPTY), abs_pos(abs_pos), imaginary_unit('i'), delete_flat(false){
-
-  oprtr = string("");
-  variable = string("");
+Value *Complex::equal(Value *right) throw (ExceptionBase){
 
-  if ( !me )
-    return;
+  Complex *rc = assertComplex(right);
 
-  setImaginaryUnit(me->getImaginaryUnit());
-  
-  switch (me->getEType()){
-  case ET_OP:
-    this->setETOperator(me->getOperator());
-    this->setOType(me->getOType());
-    break;
-  case ET_VAR:
-    this->setETVariable(me->getVariable());
-    break;
-  case ET_VAL:
-    this->setETValue(me->getValue()->clone());
-    break;
-  case ET_EMPTY:
-  default:
-    this->setEType(ET_EMPTY);
-    break;
-  }
-  
-  // functions mostly don't have a left parameter. In this case we must not add the elements to the
-  // element-list otherwise the left-pointer will be set which will result in a malformed tree.
-  if ( me->getLeft() ){
-    // a left-argument exists: we can safely add all arguments to element-list
-    
-    for ( list<MathExpression *>::iterator it = me->elements.begin(); it != me->elements.end(); it++ ){
-      
-      addElement(new MathExpression(*it,vl,fl,abs_pos));
-      elements.back()->pred = this;
-      
-    }
-    
-  } else if ( me->getRight() )
-    // a left-argument doesn't exist: we must only set the right-pointer
-    this->setRight(new MathExpression(me->getRight(),vl,fl,abs_pos));
+  if ( isExactWith(rc) )
+    return Integer(getRe()).equal(right);
+  return new Complex(this->getRe() == rc->getRe() and this->getIm() == rc->getIm());
 
 }
 
-MathExpression::~MathExpression(){
+Value *Complex::notEqual(Value *right) throw (ExceptionBase){
 
-  if ( delete_flat == false){
-    
-    eraseElements();
-    if ( this->value )
-      delete this->value;
-    
-  }
-  
-}
+  Complex *rc = assertComplex(right);
+
+  if ( isExactWith(rc) )
+    return Integer(getRe()).notEqual(right);
+  return new Complex(this->getRe() != rc->getRe() or this->getIm() != rc->getIm());
 
-void MathExpression::addElement(MathExpression *element){
-  
-  if ( elements.empty() )
-    left = element;
-  else
-    right = element;
-  
-  elements.push_back(element);
-  
 }
 
-void MathExpression::setRight(MathExpression *right){
+Value *Complex::toMatrix() throw (ExceptionBase){
 
-  if ( getRight() )
-    elements.pop_back();
+  Matrix *matrix = new Matrix(1,1);
 
-  if ( right )
-    elements.push_back(right);
+  matrix->set(0,0,*this);
 
-  this->right = right;
+  return matrix;
 
 }
 
-void MathExpression::setLeft(MathExpression *left){
+Value *Tuple::toMatrix() throw (ExceptionBase){
 
-  if ( getLeft() )
-    elements.pop_front();
+  return Matrix::fromTuple(this);
 
-  if ( left )
-    elements.push_front(left);
+}
 
-  this->left = left;
+Value *Tuple::transpose() throw (ExceptionBase){
+
+  auto_ptr<Matrix> matrix(Matrix::fromTuple(this));
+
+  return matrix->transpose();
 
 }
 
-void MathExpression::eraseElements(){
+Value *Tuple::det() throw (ExceptionBase){
 
-  for( list<MathExpression *>::iterator it = elements.begin(); it != elements.end(); it++ )
-    delete *it;
-  elements.clear();
+  auto_ptr<Matrix> matrix(Matrix::fromTuple(this));
+
+  return matrix->det();
 
 }
 
-MathExpression *MathExpression::parse(const char *expr, VariableList& locals)
-  throw (ParseException,ExceptionBase){
+Value *Tuple::solve(Value *right) throw (ExceptionBase){
 
-  int e_indx, offset;
-  char *exprstring=0, *bracketstring=0;
-  MathExpression *TopNode=0, *ActualNode=0, *PrevNode=0, *actn=0, *prevn;
+  auto_ptr<Matrix> matrix(Matrix::fromTuple(this));
 
-  if ( !expr[0] )
-    return 0;
+  return matrix->solve(right);
 
-  for ( e_indx = 0; expr[e_indx]; ){
+}
 
-    // check for blanks
-    if ( isABlank(expr[e_indx]) == true ){
+/**
+   @brief a range of rows of a product, computed by a thread of its own
+   @internal
+*/
+class Matrix::Stripe{
 
-      offset = skipBlanks(expr,e_indx);
+public:
 
-      e_indx+=offset;
-      abs_pos+=offset;
+  const Matrix *left;
+  const Matrix *right;
+  Matrix *product;
+  size_t from;
+  size_t to;
+  bool real;
 
-      // leave loop in case of end of string
-      if ( expr[e_indx] == '\0' )
-	break;
+  Stripe() : left(0), right(0), product(0), from(0), to(0), real(false){}
 
-    }
+};
 
-    if ( expr[e_indx] == ')' ){
+Matrix *Matrix::assertMatrix(Value *value) throw (EvalException){
 
-      delete TopNode;
-      throw ParseException(abs_pos, "invalid syntax!");
+  if ( Matrix *matrix = dynamic_cast<Matrix *>(value) )
+    return matrix;
 
-    }
+  throw EvalException(string("operand to matrix is not matrix-type: ") + value->toString() + string(" !"));
 
-    if ( expr[e_indx] == '(' ){
+}
 
-      if ( PrevNode ){
-	if ( PrevNode->isOperator() ){
-	  if ( PrevNode->pred ){
-	    if ( PrevNode->getRight() ){
-	      /* hier handelt es sich um Ausdruecke der Form
-		 "1+sin2(...), also um eine implizite Multipikation,
-		 es muss also ein "*" in den Baum eingefuegt werden*/
+Matrix *Matrix::fromTuple(const Tuple *tuple) throw (EvalException){
 
-	      if ( !(ActualNode = new MathExpression(abs_pos,varlist,functionlist)) ){
+  if ( tuple->elements.empty() )
+    throw EvalException("matrix without rows!");
 
-		delete TopNode;
-		throw OutOfMemException();
+  const Tuple *row = dynamic_cast<const Tuple *>(tuple->elements.front());
+  size_t rows = tuple->elements.size(), columns = ( row ? row->elements.size() : 1 );
 
-	      }
+  auto_ptr<Matrix> matrix(new Matrix(rows,columns));
 
-	      ActualNode->setETOperator("*");
-	      ActualNode->setOTOperation();
+  for ( size_t r = 0; r < rows; r++ ){
 
-	    } else{      /* Prev hat kein ->right */
-	      
-	      if ( (offset = this->copyBracketContent(bracketstring,
-						      &expr[e_indx],'(',')')) == -1 ){
-		
-		delete TopNode;
-		throw ParseException(abs_pos, "missing bracket!");
+    row = dynamic_cast<const Tuple *>(tuple->elements[r]);
 
-	      }	      
+    for ( size_t c = 0; c < columns; c++ ){
 
-	      e_indx+=offset;
-	      abs_pos-=offset-1;
+      const Complex *entry;
 
-	      // if nothing's in the brackets, we connect an empty element
-	      if ( !(ActualNode = this->parse(bracketstring,locals)) )
-		ActualNode = new MathExpression(abs_pos,varlist,functionlist);
+      if ( columns == 1 && !row )
+	entry = dynamic_cast<const Complex *>(tuple->elements[r]);
+      else
+	entry = ( row && row->elements.size() == columns ? dynamic_cast<const Complex *>(row->elements[c]) : 0 );
 
-	      abs_pos++;
+      if ( !entry )
+	throw EvalException(string("no tuple of rows of equal length: ") + tuple->Value::toString() + string(" !"));
 
-	      if ( bracketstring )
-		free(bracketstring);
+      matrix->set(r,c,*entry);
 
-	    }
-	  } else{          /* PrevNode has no predecessor */
+    }
 
-	    if ( PrevNode->getRight() ){
+  }
 
-	      if ( !(ActualNode = new MathExpression(abs_pos,varlist,functionlist)) ){
+  return matrix.release();
 
-		delete TopNode;
-		throw OutOfMemException();
+}
 
-	      }
+string Matrix::toString(std::streamsize precision) const {
 
-	      ActualNode->setETOperator("*");
-	      ActualNode->setOTOperation();
+  ostringstream value;
 
-	    } else{      /* Prev hat kein ->right */
+  value << "(";
 
-	      if ( (offset = this->copyBracketContent(bracketstring,
-						      &expr[e_indx],'(',')')) == -1 ){
+  for ( size_t r = 0; r < rows; r++ ){
 
-		delete TopNode;
-		throw ParseException(abs_pos, "missing bracket!");
+    value << ( r ? ",(" : "(" );
 
-	      }
+    for ( size_t c = 0; c < columns; c++ )
+      value << ( c ? "," : "" ) << Complex(get(r,c)).toString(precision);
 
-	      e_indx+=offset;
-	      abs_pos-=offset-1;
+    value << ")";
 
-	      if ( !(ActualNode=this->parse(bracketstring,locals)) )
-		ActualNode = new MathExpression(abs_pos,varlist,functionlist);
+  }
 
-	      abs_pos++;
+  value << ")";
 
-	      if ( bracketstring )
-		free(bracketstring);
+  return value.str();
 
-	    }
-	  }
-	} else{  /* Prev no operator -> digit or variable */
-	  if ( PrevNode->isVariable() ){
+}
 
-	    if ( !varlist->isMember(PrevNode->getVariable() )
-		 && !locals.isMember(PrevNode->getVariable())){
-	      // a functioncall/-definition is following, thus variable
-	      // must be operator
+bool Matrix::isReal() const {
 
-	      PrevNode->setETOperator(PrevNode->getVariable());
-	      PrevNode->setOTFunction();
-	      continue;
+  for ( vector<cmplx_tp>::const_iterator it = im.begin(); it != im.end(); it++ )
+    if ( *it != 0 )
+      return false;
 
-	    }
+  return true;
 
-	  }
+}
 
-	  if (!(ActualNode = new MathExpression(abs_pos,varlist,functionlist))){
+void Matrix::assertSize(const Matrix *right, const char *operation) const throw (EvalException){
 
-	    delete TopNode;
-	    throw OutOfMemException();
+  if ( rows != right->rows || columns != right->columns )
+    throw EvalException(string("matrices are not of same size for '") + operation + "': " + Value::toString()
+			+ string(" <-> ") + right->Value::toString() + string(" !"));
 
-	  }
+}
 
-	  ActualNode->setETOperator("*");
-	  ActualNode->setOTOperation();
+void Matrix::assertSquare(const char *operation) const throw (EvalException){
 
-	}
-      } else{ /* kein Prev vorhanden */
+  if ( rows != columns )
+    throw EvalException(string("matrix is not square for ") + operation + ": " + Value::toString() + string(" !"));
 
-	if ( (offset = this->copyBracketContent(bracketstring,&expr[e_indx],'(',')')) == -1 ){
+}
 
-	  delete TopNode;
-	  throw ParseException(abs_pos, "missing bracket!");
-	  
-	}
-	
-	e_indx+=offset;
-	abs_pos-=offset-1;
+Value *Matrix::neutralAddition() const {
 
-	if ( !(ActualNode=this->parse(bracketstring,locals)) )
-	  ActualNode = new MathExpression(abs_pos,varlist,functionlist);
+  return new Matrix(rows,columns);
 
-	abs_pos++;
+}
 
-	if ( bracketstring )
-	  free(bracketstring);
+Value *Matrix::neutralMultiplikation() const {
 
-      }
+  assertSquare("Prod");
 
-      // if a parameterlist is contained within braces, it is a tuple normally ->
-      // but only, if it is not preceeded by a functionname ( in f(x,y) x,y does not
-      // define a tuple but a parameterlist )
-      if ( ActualNode and ActualNode->isOperator() and ActualNode->isOTParameter() )
-	if ( !PrevNode or !PrevNode->isOperator() or !PrevNode->isOTFunction() )
-	  ActualNode->setOTTuple();
-      
-    } else if( expr[e_indx]=='[' ){
+  Matrix *identity = new Matrix(rows,columns);
 
-      if ( !PrevNode ){
+  for ( size_t i = 0; i < rows; i++ )
+    identity->re[i*columns+i] = 1;
 
-	delete TopNode;
-	throw ParseException(abs_pos, "invalid operator \"[\"!");
+  return identity;
 
-      }
-      if ( !PrevNode->isOperator() ){
+}
 
-	delete TopNode;
-	throw ParseException(abs_pos, "invalid operator \"[\"!");
+Value *Matrix::operator+(Value *right) throw (ExceptionBase){
 
-      }
-      
-      if ( !strcmp(PrevNode->getOperator(),"log")
-	   || !strcmp(PrevNode->getOperator(),SUM)
-	   || !strcmp(PrevNode->getOperator(),PROD) ){
+  Matrix *sum = static_cast<Matrix *>(clone());
 
-	if ( PrevNode->getLeft() ){
+  try{
+    (*sum) += right;
+  } catch (ExceptionBase &e){
+    delete sum;
+    throw;
+  }
 
-	  delete TopNode;
-	  throw ParseException(abs_pos, "invalid syntax!");
+  return sum;
 
-	}
+}
 
-	if ( (offset = this->copyBracketContent(bracketstring,&expr[e_indx],'[',']')) == -1 ){
+Value *Matrix::operator-(Value *right) throw (ExceptionBase){
 
-	  delete TopNode;
-	  throw ParseException(abs_pos, "missing bracket!");
+  Matrix *rm = assertMatrix(right);
 
-	}
+  assertSize(rm,"-");
 
-	e_indx+=offset;
-	abs_pos-=offset-1;
+  Matrix *difference = new Matrix(rows,columns);
 
-	if ( !(ActualNode=this->parse(bracketstring,locals)) )
-	  ActualNode = new MathExpression(abs_pos,varlist,functionlist);
+  for ( size_t i = 0; i < re.size(); i++ ){
 
-	abs_pos++;
+    difference->re[i] = re[i] - rm->re[i];
+    difference->im[i] = im[i] - rm->im[i];
 
-	// variables defined in Sum or Prod must be added to local Scope
-	ActualNode->addVariablesToList(&locals);
+  }
 
-	PrevNode->setLeft(ActualNode);
-	ActualNode->pred=PrevNode;
+  return difference;
 
-	if ( bracketstring )
-	  free(bracketstring);
+}
 
-	continue;
+void Matrix::operator+=(Value *right) throw (ExceptionBase){
 
-      } else{
+  Matrix *rm = assertMatrix(right);
 
-	delete TopNode;
-	throw ParseException(abs_pos, "invalid operator \"[\"!");
+  assertSize(rm,"+");
 
-      }
-    } else{        /* kein Bracket */
+  for ( size_t i = 0; i < re.size(); i++ ){
 
-      if ( !(ActualNode = new MathExpression(abs_pos,varlist,functionlist)) ){
+    re[i] += rm->re[i];
+    im[i] += rm->im[i];
 
-	delete TopNode;
-	throw OutOfMemException();
+  }
 
-      }
+}
 
-      if ( checkDigit(expr[e_indx]) ){
-	if ( PrevNode ){
-	  if ( PrevNode->isOperator() ){
-	    if ( PrevNode->getRight() ){
+Value *Matrix::operator*(Value *right) throw (ExceptionBase){
 
-	      ActualNode->setETOperator("*");
-	      ActualNode->setOTOperation();
+  if ( Complex *rc = dynamic_cast<Complex *>(right) )
+    return scale(*rc);
 
-	    } else{ /* Prev hat kein right */
+  return multiply(assertMatrix(right));
 
-	      offset = this->copyFloatContent(exprstring,&expr[e_indx]);
-	      e_indx+=offset;
+}
 
-	      ActualNode->setETValue(new Complex(atof(exprstring)));
+void Matrix::operator*=(Value *right) throw (ExceptionBase){
 
-	      if ( exprstring )
-		free(exprstring);
+  auto_ptr<Value> product(operator*(right));
+  Matrix *pm = static_cast<Matrix *>(product.get());
 
-	    }
-	  } else{  /* Prev kein operator
-		      ( Actual=Zahl, Prev=Zahl => Prev->pred=ln o.a") */
-	    ActualNode->setETOperator("*");
-	    ActualNode->setOTOperation();
+  rows = pm->rows;
+  columns = pm->columns;
+  re.swap(pm->re);
+  im.swap(pm->im);
 
-	  }
+}
 
-	} else{ /* kein Prev */
+Matrix *Matrix::scale(const complex<cmplx_tp> &factor) const {
 
-	  offset = this->copyFloatContent(exprstring,&expr[e_indx]);
-	  e_indx+=offset;
+  Matrix *scaled = new Matrix(rows,columns);
+  cmplx_tp fre = factor.real(), fim = factor.imag();
 
-	  ActualNode->setETValue(new Complex(atof(exprstring)));
-	  
-	  if ( exprstring )
-	    free(exprstring);
+  for ( size_t i = 0; i < re.size(); i++ ){
 
-	}
+    scaled->re[i] = re[i]*fre - im[i]*fim;
+    scaled->im[i] = re[i]*fim + im[i]*fre;
 
-      } else{               /* keine Zahl */
-	if ( PrevNode ){
-	  if ( checkLetter(expr[e_indx]) ){
-	    if ( PrevNode->isOperator() ){
-	      if ( PrevNode->pred ){
-		if ( PrevNode->getRight() ){
+  }
 
-		  ActualNode->setETOperator("*");
-		  ActualNode->setOTOperation();
+  return scaled;
 
-		} else{      /* Prev hat kein ->right */
+}
 
-		  e_indx = determineAndSetOperatorOrVariable(expr,e_indx,ActualNode,functionlist);
+void *Matrix::multiplyStripe(void *data){
 
-		}
-	      } else{          /* Prev hat kein ->pred */ // TODO!!! same as if-branch!!!
+  const Stripe *stripe = static_cast<const Stripe *>(data);
+  size_t inner = stripe->left->columns, columns = stripe->right->columns;
 
-		if ( PrevNode->getRight() ){
+  // blocks of BLOCK x BLOCK entries of the right matrix are reused by all rows of the stripe; the innermost loop
+  // runs over a row of the block, the arrays don't overlap
+  for ( size_t kk = 0; kk < inner; kk += BLOCK ){
 
-		  ActualNode->setETOperator("*");
-		  ActualNode->setOTOperation();
+    size_t kend = std::min(kk + BLOCK,inner);
 
-		} else{      /* Prev hat kein ->right */
+    for ( size_t jj = 0; jj < columns; jj += BLOCK ){
 
-		  e_indx = determineAndSetOperatorOrVariable(expr,e_indx,ActualNode,functionlist);
+      size_t jend = std::min(jj + BLOCK,columns);
 
-		}
-	      }
-	    } else{  /* Prev kein operator also Zahl */
+      for ( size_t i = stripe->from; i < stripe->to; i++ ){
 
-	      ActualNode->setETOperator("*");
-	      ActualNode->setOTOperation();
+	cmplx_tp *__restrict__ cre = &stripe->product->re[i*columns];
+	cmplx_tp *__restrict__ cim = &stripe->product->im[i*columns];
 
+	for ( size_t k = kk; k < kend; k++ ){
+
+	  cmplx_tp are = stripe->left->re[i*inner+k], aim = stripe->left->im[i*inner+k];
+	  const cmplx_tp *__restrict__ bre = &stripe->right->re[k*columns];
+	  const cmplx_tp *__restrict__ bim = &stripe->right->im[k*columns];
+
+	  if ( stripe->real )
+	    for ( size_t j = jj; j < jend; j++ )
+	      cre[j] += are*bre[j];
+	  else
+	    for ( size_t j = jj; j < jend; j++ ){
+	      cre[j] += are*bre[j] - aim*bim[j];
+	      cim[j] += are*bim[j] + aim*bre[j];
 	    }
 
-	  } else{ /* Arithmetischer Operator */
+	}
 
-	    if ( PrevNode->isOperator() ){
-	      /* behandelt werden sollen Ausdruecke der Form: "sin^2(...)": */
-	      /* ist das  aktuelle Zeichen ein "^" und der PrevNode ein
-		 Operator, handelt es sich um die Form wie z.B. "sin^2",
-		 allerdings nur, wenn der PrevNode noch keinen rechten
-		 Unterast hat, denn dann muss es sich um eine Form wie
-		 "(sin2)^3" handeln */
-	      if ( expr[e_indx]=='^'
-		   && ( priCompare(&expr[e_indx],PrevNode->getOperator()) == POT_PRI-SIN_PRI )
-		   && !PrevNode->getRight() ){
-		ActualNode->setETOperator("^");
-		ActualNode->setOTOperation();
-		/* im Folgenden wird geprueft, ob eine fehlerhafte Eingabe
-		   der Form "sin^^ ..." gemacht wurde. Dann ist der PrevNode
-		   (immer noch der sin) schon der linke Unterast eines
-		   "^"-Operators. Nun wird absichtlich ein fehlerhafter Baum
-		   aufgebaut, indem der ActualNode einfach als linker Unterast
-		   an den "sin"-Node gehaengt wird. Dies wird beim checken
-		   automatisch zu einem Syntaxfehler fuehren. */
-		if ( PrevNode->pred ){
-		  if ( PrevNode == PrevNode->pred->getLeft() ){
+      }
 
-		    prevn=PrevNode;
+    }
 
-		    while ( prevn->getLeft() )
-		      prevn=prevn->getLeft();
+  }
 
-		    prevn->setLeft(ActualNode);
-		    ActualNode->pred=prevn;
-		    e_indx++;
-		    abs_pos++;
+  return 0;
 
-		    continue;
+}
 
-		  }
-		}
-		/* hier ist alles ok (es handelt sich also um das erste "^"),
-		   der "sin"-Node muss also zum linken Unterast des ActualNode
-		   werden */
-		ActualNode->setLeft(PrevNode);
-		/* hat der "sin"-Node einen Vorgaenger, muss diese Verbindung
-		   auch verbogen werden */
-		if ( PrevNode->pred){
+Matrix *Matrix::multiply(const Matrix *right) const {
 
-		  ActualNode->pred=PrevNode->pred;
-		  PrevNode->pred->setRight(ActualNode);
+  if ( columns != right->rows )
+    throw EvalException(string("matrices can't be multiplied: ") + Value::toString() + string(" <-> ")
+			+ right->Value::toString() + string(" !"));
 
-		} else
-		  TopNode=ActualNode;
+  auto_ptr<Matrix> product(new Matrix(rows,right->columns));
 
-		PrevNode->pred=ActualNode;
-		e_indx++;
-		abs_pos++;
+  unsigned int threads = 1;
 
-		/* Auswertung der Potenz: handelt es sich um einen
-		   Klammerausdruck? ... */
-		if ( !expr[e_indx] )
-		  continue;
+  // not by the ThreadPool of MathExpression: the same program may be run by several threads at the same time
+  if ( rows*columns*right->columns >= PARALLEL_WORK && !ThreadPool::isActive() )
+    threads = (unsigned int)std::min((size_t)MathExpression::getParallelThreads(),rows);
 
-		else if ( expr[e_indx]=='(' ){
+  if ( threads < 1 )
+    threads = 1;
 
-		  if ( (offset = this->copyBracketContent(bracketstring,&expr[e_indx],
-							  '(',')')) == -1 ){
+  vector<Stripe> stripes(threads);
+  vector<pthread_t> workers;
+  bool real = ( isReal() && right->isReal() );
 
-		    delete TopNode;
-		    throw ParseException(abs_pos, "missing bracket!");
+  for ( unsigned int t = 0; t < threads; t++ ){
 
-		  }
-		  
-		  e_indx+=offset;
-		  abs_pos-=offset-1;
-		  
-		  if ( !(actn = this->parse(bracketstring,locals)) )
-		    actn = new MathExpression(abs_pos,varlist,functionlist);
+    stripes[t].left = this;
+    stripes[t].right = right;
+    stripes[t].product = product.get();
+    stripes[t].from = rows*t/threads;
+    stripes[t].to = rows*(t+1)/threads;
+    stripes[t].real = real;
 
-		  abs_pos++;
+  }
 
-		  if ( bracketstring )
-		    free(bracketstring);
+  // the first stripe is computed by the calling thread, a stripe without thread as well
+  for ( unsigned int t = 1; t < threads; t++ ){
 
-		  if ( actn->isOperator() and actn->isOTParameter() )
-		    actn->setOTTuple();
+    pthread_t worker;
 
-		} else if ( checkDigit(expr[e_indx]) ){ /* zahl? */
+    if ( pthread_create(&worker,0,multiplyStripe,&stripes[t]) == 0 )
+      workers.push_back(worker);
+    else
+      multiplyStripe(&stripes[t]);
 
-		  if ( !(actn = new MathExpression(abs_pos,varlist,functionlist)) ){
+  }
 
-		    delete TopNode;
-		    throw OutOfMemException();
+  multiplyStripe(&stripes[0]);
 
-		  }
+  for ( vector<pthread_t>::iterator it = workers.begin(); it != workers.end(); it++ )
+    pthread_join(*it,0);
 
-		  offset = this->copyFloatContent(exprstring,&expr[e_indx]);
-		  e_indx+=offset;
+  return product.release();
 
-		  actn->setETValue(new Complex(atof(exprstring)));
+}
 
-		  if ( exprstring )
-		    free(exprstring);
+Value *Matrix::transpose() throw (ExceptionBase){
 
-		} else if ( checkLetter(expr[e_indx]) ){ /* identifier? */
-		  // only variable makes sense
+  Matrix *transposed = new Matrix(columns,rows);
 
-		  if ( !(actn = new MathExpression(abs_pos,varlist,functionlist)) ){
+  for ( size_t r = 0; r < rows; r++ )
+    for ( size_t c = 0; c < columns; c++ ){
+      transposed->re[c*rows+r] = re[r*columns+c];
+      transposed->im[c*rows+r] = im[r*columns+c];
+    }
 
-		    delete TopNode;
-		    throw OutOfMemException();
+  return transposed;
 
-		  }
+}
 
-		  offset = this->copyOperatorContent(exprstring,&expr[e_indx]);
-		  e_indx+=offset;
+int Matrix::decompose(vector< complex<cmplx_tp> > &lu, vector<size_t> &permutation, size_t n){
 
-		  actn->setETVariable(exprstring);
+  int sign = 1;
 
-		  if ( exprstring )
-		    free(exprstring);
+  permutation.resize(n);
 
-		}
+  for ( size_t i = 0; i < n; i++ )
+    permutation[i] = i;
 
-		actn->pred=ActualNode;
-		ActualNode->setRight(actn);
-		actn=PrevNode->pred;
-		continue;
+  for ( size_t k = 0; k < n; k++ ){
 
-	      } else {
-		
-		if ( expr[e_indx]=='!' ){
-		  
-		  if ( !(actn = new MathExpression(abs_pos,varlist,functionlist)) ){
-		    
-		    delete TopNode;
-		    throw OutOfMemException();
-		    
-		  }
-		  
-		  actn->setETOperator("!");
-		  actn->setOTOperation();
-		  e_indx++;
-		  abs_pos++;
-		  
-		  if ( PrevNode->pred ){
-		    
-		    PrevNode->pred->setRight(actn);
-		    actn->pred=PrevNode->pred;
-		    
-		  }  else
-		    TopNode=actn;
-		  
-		  actn->setRight(PrevNode);
-		  PrevNode->pred=actn;
-		  continue;
-		  
-		} else if ( expr[e_indx] == ',' ){
-		  // Tuple-Operator
-
-		  e_indx = parseCommaOperator(expr,e_indx,ActualNode,PrevNode,TopNode,locals);
-		  
-		  continue;
-		  
-		} else if ( expr[e_indx] == '=' ){
-		  
-		  // it's a functiondefinition
-		  // to build a correct tree, the local vars must be remembered
-		  if ( PrevNode )
-		    PrevNode->addVariablesToList(&locals);
-		  
-		}
+    size_t pivot = k;
 
-		e_indx = determineAndSetOperatorOrVariable(expr,e_indx,ActualNode,functionlist);
-		
-	      }
-	    } else{ /* der Vorgaenger ist kein Operator, also "normale"
-		       Verhaeltnisse */
-	      if ( expr[e_indx] == '!' ){
-		
-		if ( !(actn = new MathExpression(abs_pos,varlist,functionlist)) ){
-		  
-		  delete TopNode;
-		  throw OutOfMemException();
-		  
-		}
+    for ( size_t i = k + 1; i < n; i++ )
+      if ( std::abs(lu[i*n+k]) > std::abs(lu[pivot*n+k]) )
+	pivot = i;
 
-		actn->setETOperator("!");
-		actn->setOTOperation();
-		e_indx++;
-		abs_pos++;
-		
-		if ( PrevNode->pred ){
+    if ( lu[pivot*n+k] == complex<cmplx_tp>(0) )
+      return 0;
 
-		  PrevNode->pred->setRight(actn);
-		  actn->pred=PrevNode->pred;
+    if ( pivot != k ){
 
-		} else
-		  TopNode=actn;
+      std::swap_ranges(lu.begin() + k*n,lu.begin() + (k+1)*n,lu.begin() + pivot*n);
+      std::swap(permutation[k],permutation[pivot]);
+      sign = -sign;
 
-		actn->setRight(PrevNode);
-		PrevNode->pred=actn;
-		continue;
-		  
-	      } else if ( expr[e_indx] == ',' ){
-		// Tuple-Operator
+    }
 
-		e_indx = parseCommaOperator(expr,e_indx,ActualNode,PrevNode,TopNode,locals);
-		
-		continue;
-		
-	      } else if ( expr[e_indx] == '=' ){
+    for ( size_t i = k + 1; i < n; i++ ){
 
-		// it's a functiondefinition
-		// to build a correct tree, the local vars must be remembered
-		if ( PrevNode )
-		  PrevNode->addVariablesToList(&locals);
+      complex<cmplx_tp> factor = ( lu[i*n+k] /= lu[k*n+k] );
 
-	      }
+      for ( size_t j = k + 1; j < n; j++ )
+	lu[i*n+j] -= factor*lu[k*n+j];
 
-	      e_indx = determineAndSetOperatorOrVariable(expr,e_indx,ActualNode,functionlist);
+    }
 
-	    }
-	  }
-	} else{ /* kein PrevNode */
+  }
 
-	  e_indx = determineAndSetOperatorOrVariable(expr,e_indx,ActualNode,functionlist);
+  return sign;
 
-	}
-      }
-    }
+}
 
-    if ( PrevNode ){
-      if ( ActualNode->isOperator() ){
-	if ( PrevNode->isOperator() ){
+Value *Matrix::det() throw (ExceptionBase){
 
-	  if ( (ActualNode->oprtr[0] == '-' || ActualNode->oprtr[0] == '+')
-	       && !ActualNode->getLeft() && !PrevNode->getRight() ){
+  assertSquare("det");
 
-	    /* falls unaerer minus- oder plusoperator */
-	    /* wird eine Mult. mit - bzw. +1 in den Baum eingefuegt */
-	    if ( ActualNode->oprtr[0] == '-' )         
-	      ActualNode->setETValue(new Complex(-1));
-	    else                                   
-	      ActualNode->setETValue(new Complex(1));
+  vector< complex<cmplx_tp> > lu(rows*columns);
+  vector<size_t> permutation;
 
-	    prevn=ActualNode;
+  for ( size_t i = 0; i < lu.size(); i++ )
+    lu[i] = complex<cmplx_tp>(re[i],im[i]);
 
-	    if ( !(ActualNode = new MathExpression(abs_pos,varlist,functionlist)) ){
+  complex<cmplx_tp> determinant = (cmplx_tp)decompose(lu,permutation,rows);
 
-	      delete TopNode;
-	      throw OutOfMemException();
+  for ( size_t i = 0; i < rows && determinant != complex<cmplx_tp>(0); i++ )
+    determinant *= lu[i*rows+i];
 
-	    }
+  return new Complex(determinant);
 
-	    ActualNode->setETOperator("*");
-	    ActualNode->setOTOperation();
-	    ActualNode->setLeft(prevn);
-	    prevn->pred=ActualNode;
+}
 
-	    PrevNode->setRight(ActualNode);
-	    ActualNode->pred = PrevNode;
+Value *Matrix::solve(Value *right) throw (ExceptionBase){
 
-	  } else if ( PrevNode->getRight() ){
+  assertSquare("solve");
 
-	    searchAndSetLowerPriNode(ActualNode,PrevNode,TopNode);
+  auto_ptr<Value> converted;
+  Matrix *rm = dynamic_cast<Matrix *>(right);
 
-	  } else{   /* Prev hat keinen rechten Unterbaum, also wird hier neuer
-		       Ast angefuegt */
-	    // z.B "3+sin2"
-	    // 	    if (priCompare(ActualNode->oprtr,PrevNode->oprtr)){
-	    PrevNode->setRight(ActualNode);
-	    ActualNode->pred = PrevNode;
-	    // 	    }
-	  }
-	} else{      /* Prev ist Zahl */
+  // the right side may also be given as tuple
+  if ( !rm ){
 
-	  searchAndSetLowerPriNode(ActualNode,PrevNode,TopNode);
+    converted.reset(right->toMatrix());
+    rm = assertMatrix(converted.get());
 
-	}
-      } else{        /* Act ist Zahl */
+  }
 
-	PrevNode->setRight(ActualNode);
-	ActualNode->pred=PrevNode;
+  if ( rm->rows != rows )
+    throw EvalException(string("matrix and right side are not of same height: ") + Value::toString() + string(" <-> ")
+			+ rm->Value::toString() + string(" !"));
 
-      }
+  vector< complex<cmplx_tp> > lu(rows*columns);
+  vector<size_t> permutation;
 
-      PrevNode=ActualNode;
+  for ( size_t i = 0; i < lu.size(); i++ )
+    lu[i] = complex<cmplx_tp>(re[i],im[i]);
 
-    } else{               /* erstes Zeichen */
+  if ( !decompose(lu,permutation,rows) )
+    throw EvalException("matrix is singular!");
 
-      if ( (ActualNode->oprtr[0] == '-' || ActualNode->oprtr[0] == '+')
-	   && !ActualNode->getLeft() ){
+  Matrix *solution = new Matrix(rows,rm->columns);
+  vector< complex<cmplx_tp> > x(rows);
 
-	/* falls unaerer minus- oder plusoperator */
-	/* wird eine Mult. mit - bzw. +1 in den Baum eingefuegt */
-	if ( ActualNode->oprtr[0] == '-' )         
-	  ActualNode->setETValue(new Complex(-1));
-	else                                   
-	  ActualNode->setETValue(new Complex(1));
+  for ( size_t c = 0; c < rm->columns; c++ ){
 
-	prevn=ActualNode;
+    // forward substitution with the unit lower triangle, backward substitution with the upper triangle
+    for ( size_t i = 0; i < rows; i++ ){
 
-	if ( !(ActualNode = new MathExpression(abs_pos,varlist,functionlist)) ){
+      x[i] = rm->get(permutation[i],c);
 
-	  delete TopNode;
-	  throw OutOfMemException();
+      for ( size_t j = 0; j < i; j++ )
+	x[i] -= lu[i*rows+j]*x[j];
 
-	}
+    }
 
-	ActualNode->setETOperator("*");
-	ActualNode->setOTOperation();
-	ActualNode->setLeft(prevn);
-	prevn->pred=ActualNode;
+    for ( size_t i = rows; i-- > 0; ){
 
-      }
+      for ( size_t j = i + 1; j < rows; j++ )
+	x[i] -= lu[i*rows+j]*x[j];
 
-      PrevNode=ActualNode;
-      TopNode=ActualNode;
+      x[i] /= lu[i*rows+i];
+      solution->set(i,c,x[i]);
 
     }
+
   }
 
-  return TopNode;
+  return solution;
+
 }
 
-int MathExpression::parseCommaOperator(const char *expr, int e_indx, MathExpression * & ActualNode, MathExpression * & PrevNode,
-				       MathExpression * & TopNode, VariableList & locals) throw (ParseException, ExceptionBase){
+// the number of limbs from which on products are computed by Karatsuba-multiplication
+static const size_t KARATSUBA_LIMBS = 32;
 
-  int offset;
-  char *commastring=0;
-		  
-  ActualNode->setETOperator(",");
-  ActualNode->setOTParameter();
+// the largest number of limbs of a power computed exactly
+static const uint64_t MAX_POWER_LIMBS = 1 << 20;
 
-  searchAndSetLowerPriNode(ActualNode,PrevNode,TopNode);
-  
-  // add all further elements of comma to its list
-  while ( expr[e_indx] == ',' ){
-    
-    ++e_indx,++abs_pos;
-    offset = copyCommaContent(commastring,&expr[e_indx]);
-    
-    if ( offset == 0 )
-      throw ParseException(abs_pos,"missing operand for comma-operator!");
-    
-    abs_pos-=offset;
-    e_indx+=offset;
-    
-    ActualNode->addElement(parse(commastring,locals));
-    ActualNode->elements.back()->pred = ActualNode;
-    
-    if ( commastring )
-      free(commastring);
-    
-  }
-  
-  return e_indx;
-  
-}
+// the largest magnitude an Integer is converted to a Complex at: 2^53
+static const uint64_t MAX_DOUBLE_INTEGER = (uint64_t)1 << 53;
 
-void MathExpression::searchAndSetLowerPriNode(MathExpression * & ActualNode, MathExpression * & PrevNode, MathExpression * & TopNode){
+static void trim(Integer::Digits &digits){
+
+  while ( !digits.empty() && digits.back() == 0 )
+    digits.pop_back();
 
-  MathExpression *actn=0, *prevn=0;
-  int priority;
-  
-  if (PrevNode->pred  ){
-  
-    actn = ActualNode, prevn=PrevNode->pred;
-    
-    // search for node with lower priority in hierarchy
-    while ( (priority = priCompare(actn->getOperator(),prevn->getOperator())) <= 0
-	    && prevn->pred )
-      prevn = prevn->pred;
-    
-    if ( priority <= 0 ){  /* hier muss prevn Top sein */
-      
-      actn->setLeft(prevn);
-      prevn->pred = actn;
-      TopNode = actn;
-      
-    } else{               /* actn hat hoehere Prioritaet */
-      
-      actn->setLeft(prevn->getRight());
-      actn->pred = prevn;
-      prevn->setRight(actn);
-      
-    }
-  } else{    /* Prev ist Top */
-    
-    ActualNode->setLeft(PrevNode);
-    PrevNode->pred = ActualNode;
-    TopNode = ActualNode;
-  }
-  
 }
 
-int MathExpression::determineAndSetOperatorOrVariable(const char *expr, int e_indx, MathExpression * & ActualNode, const FunctionList *functionlist){
+static void toDigits(uint64_t number, Integer::Digits &digits){
 
-  int offset;
-  char *exprstring = 0;
+  digits.clear();
 
-  offset = this->copyOperatorContent(exprstring,&expr[e_indx]);
-  e_indx+=offset;
-  
-  bool is_builtin = false;
-  if ( (is_builtin = isBuiltinFunction(exprstring)) || checkOperator(exprstring[0]) ){
-    
-    ActualNode->setETOperator(exprstring);
-    
-    if ( is_builtin == true )
-      ActualNode->setOTFunction();
-    else
-      ActualNode->setOTOperation();
-    
-  } else if ( functionlist ){
-    
-    if ( functionlist->isMember(exprstring) ){
-      
-      ActualNode->setETOperator(exprstring);
-      ActualNode->setOTFunction();
-      
-    } else
-      ActualNode->setETVariable(exprstring);
-    
-  } else
-    ActualNode->setETVariable(exprstring);
-  
-  if ( exprstring )
-    free(exprstring);
-  
-  return e_indx;
+  for ( ; number > 0; number /= Integer::BASE )
+    digits.push_back((uint32_t)(number % Integer::BASE));
 
 }
 
-inline bool MathExpression::checkOperator(char x){ 
-  return (((unsigned char)(x) >= 1 && (unsigned char)(x) <= '/')
-	  || ((unsigned char)(x) >= ':' && (unsigned char)(x) <= '@')
-	  || ((unsigned char)(x) >= '[' && (unsigned char)(x) <= '^')
-	  || ((unsigned char)(x) == '`')
-	  || ((unsigned char)(x) >= '{') );
-}
+static int compareDigits(const Integer::Digits &left, const Integer::Digits &right){
 
-inline bool MathExpression::checkDigit(char x){
-  return (((unsigned char)(x) >= '0' && (unsigned char)(x) <= '9')
-	  || (unsigned char)(x) == '.');
-}
- 
-inline bool MathExpression::checkLetter(char x){
-  return (((unsigned char)(x) >= 'A' && (unsigned char)(x) <= 'Z')
-	  || ((unsigned char)(x) >= 'a' && (unsigned char)(x) <= 'z')
-	  || ((unsigned char)(x) == '_'));
-}
+  if ( left.size() != right.size() )
+    return ( left.size() < right.size() ? -1 : 1 );
 
-bool MathExpression::isBuiltinFunction(const char *strname){
+  for ( size_t i = left.size(); i-- > 0; )
+    if ( left[i] != right[i] )
+      return ( left[i] < right[i] ? -1 : 1 );
 
-  const char *flist[]={FLIST};
+  return 0;
 
-  for (unsigned int i=0;i<sizeof(flist)/sizeof(char *);i++)
-    if (!strcmp(strname,flist[i]))
-      return true;
-  return false;
 }
 
-void MathExpression::setETOperator(const char *name){
+// result = left + right
+static void addDigits(const Integer::Digits &left, const Integer::Digits &right, Integer::Digits &result){
 
-  oprtr = string(name);
+  const Integer::Digits &longer = ( left.size() >= right.size() ? left : right );
+  const Integer::Digits &shorter = ( left.size() >= right.size() ? right : left );
+  uint32_t carry = 0;
 
-  if ( value )
-    delete value;
-  value=0;
-  variable = string("");
-  type=ET_OP;
+  result.resize(longer.size());
+
+  for ( size_t i = 0; i < longer.size(); i++ ){
+
+    uint32_t sum = longer[i] + ( i < shorter.size() ? shorter[i] : 0 ) + carry;
+
+    carry = ( sum >= Integer::BASE );
+    result[i] = ( carry ? sum - Integer::BASE : sum );
+
+  }
+
+  if ( carry )
+    result.push_back(carry);
 
 }
 
-void MathExpression::setETVariable(const char *name){
+// digits -= subtrahend, the difference must not be negative
+static void subtractDigits(uint32_t *digits, size_t size, const uint32_t *subtrahend, size_t length){
 
-  variable = string(name);
+  int32_t borrow = 0;
+  size_t i = 0;
 
-  oprtr = string("");
-  setOType(OT_EMPTY);
+  for ( ; i < length; i++ ){
 
-  if ( value )
-    delete value;
-  value = 0;
+    int32_t difference = (int32_t)digits[i] - (int32_t)subtrahend[i] - borrow;
 
-  type = ET_VAR;
+    borrow = ( difference < 0 );
+    digits[i] = (uint32_t)( borrow ? difference + (int32_t)Integer::BASE : difference );
 
-}
-  
-void MathExpression::setETValue(Value *value){
-    
-  if ( this->value )
-    delete this->value;
+  }
 
-  this->value = value;
+  for ( ; borrow && i < size; i++ ){
 
-  oprtr = string("");
-  setOType(OT_EMPTY);
+    borrow = ( digits[i] == 0 );
+    digits[i] = ( borrow ? Integer::BASE - 1 : digits[i] - 1 );
 
-  variable = string("");
+  }
 
-  type=ET_VAL;
-    
 }
 
-void MathExpression::setValue(Value *value){
-    
-  if ( this->value )
-    delete this->value;
+// digits += summand, limbs beyond <size> would be zero
+static void addToDigits(uint32_t *digits, size_t size, const uint32_t *summand, size_t length){
 
-  this->value = value;
+  uint32_t carry = 0;
+  size_t i = 0;
 
-}
+  for ( length = std::min(length,size); i < length; i++ ){
 
-bool MathExpression::isABlank(char c){
+    uint32_t sum = digits[i] + summand[i] + carry;
 
-  return ( c == ' ' || c == '\t' );
+    carry = ( sum >= Integer::BASE );
+    digits[i] = ( carry ? sum - Integer::BASE : sum );
+
+  }
+
+  for ( ; carry && i < size; i++ ){
+
+    carry = ( digits[i] == Integer::BASE - 1 );
+    digits[i] = ( carry ? 0 : digits[i] + 1 );
+
+  }
 
 }
 
-int MathExpression::skipBlanks(const char *expr, int indx){
+static void multiplySmall(Integer::Digits &digits, uint32_t factor){
 
-  int offset = 0;
+  uint64_t carry = 0;
 
-  while ( isABlank(expr[indx++]) == true )
-    offset++;
+  for ( size_t i = 0; i < digits.size(); i++ ){
 
-  return offset;
+    uint64_t product = (uint64_t)digits[i]*factor + carry;
 
-}
+    digits[i] = (uint32_t)(product % Integer::BASE);
+    carry = product / Integer::BASE;
 
-void MathExpression::addVariablesToList(VariableList *varlist){
+  }
 
-  if ( isVariable() )
-    varlist->insert(getVariable(),new Complex(0));
+  if ( carry )
+    digits.push_back((uint32_t)carry);
 
-  if ( getRight() )
-    getRight()->addVariablesToList(varlist);
-  if ( getLeft() )
-    getLeft()->addVariablesToList(varlist);
 }
- 
-bool MathExpression::isBuiltinOperator(char op){
 
-  char oplist[]={OPLIST};
+// returns the remainder
+static uint32_t divideSmall(Integer::Digits &digits, uint32_t divisor){
 
-  for (unsigned int i=0;i<sizeof(oplist)/sizeof(char);i++)
-    if (op==oplist[i])
-      return true;
-  return false;
-}
+  uint64_t remainder = 0;
 
-bool MathExpression::isOpenBrace(char c){
-  return ( c == '(' || c == '[' );
-}
+  for ( size_t i = digits.size(); i-- > 0; ){
+
+    uint64_t current = remainder*Integer::BASE + digits[i];
+
+    digits[i] = (uint32_t)(current / divisor);
+    remainder = current % divisor;
+
+  }
+
+  trim(digits);
+
+  return (uint32_t)remainder;
 
-bool MathExpression::isCloseBrace(char c){
-  return ( c == ')' || c == ']' );
 }
 
-int MathExpression::copyCommaContent(char * & exprstring, const char *arg){
+// result[0..left+right) = left*right
+static void multiplyDigits(const uint32_t *left, size_t llength, const uint32_t *right, size_t rlength, uint32_t *result){
 
-  int br_cnt = 0, indx=0;
-  DynamicBuffer<char> buffer(BUFSIZE);
+  if ( llength < rlength ){
+    std::swap(left,right);
+    std::swap(llength,rlength);
+  }
 
-  exprstring = 0;
+  if ( rlength < KARATSUBA_LIMBS ){
 
-  while ( (br_cnt || (arg[indx] != ',' && !isCloseBrace(arg[indx]))) && arg[indx] ){
+    // column by column: the sum of up to 16 products of limbs fits into 64 bits
+    uint64_t carry = 0;
 
-    if ( isOpenBrace(arg[indx]) )
-      br_cnt++;
-    else if ( isCloseBrace(arg[indx]) )
-      br_cnt--;
+    for ( size_t k = 0; k + 1 < llength + rlength; k++ ){
 
-    buffer.put(arg[indx++]);
-    abs_pos++;
+      uint64_t sum = carry % Integer::BASE, high = carry / Integer::BASE;
+      size_t last = std::min(k,rlength-1);
+      unsigned int count = 0;
 
-  } 
+      for ( size_t i = ( k >= llength ? k - llength + 1 : 0 ); i <= last; i++ ){
 
-  buffer.put('\0');
+	sum += (uint64_t)right[i]*left[k-i];
 
-  exprstring = buffer.merge();
+	if ( ++count == 16 ){
+	  high += sum / Integer::BASE;
+	  sum %= Integer::BASE;
+	  count = 0;
+	}
 
-  return indx;
+      }
 
-}
+      result[k] = (uint32_t)(sum % Integer::BASE);
+      carry = high + sum / Integer::BASE;
 
-int MathExpression::copyBracketContent( char * & exprstring, const char *arg, char open,
-					char close){
+    }
 
-  int br_cnt=0, indx=0;
-  DynamicBuffer<char> buffer(BUFSIZE);
+    result[llength+rlength-1] = (uint32_t)carry;
 
-  exprstring = 0;
+    return;
 
-  if ( open && (arg[indx] != open) )
-    return (-1);
+  }
 
-  do{
+  // unbalanced: by slices of the longer factor as long as the shorter one
+  if ( 2*rlength <= llength ){
 
-    if ( arg[indx] == open || ( !open && !indx) ){  // auch moeglich: alles bis ...
+    std::vector<uint32_t> product(2*rlength);
 
-      if ( br_cnt )
-	buffer.put(arg[indx]);
-      else if ( !open && !indx )
-	buffer.put(arg[0]);
+    std::fill(result,result+llength+rlength,0);
 
-      br_cnt++;
+    for ( size_t i = 0; i < llength; i += rlength ){
 
-    } else if (arg[indx] == close ){
+      size_t length = std::min(rlength,llength-i);
 
-      br_cnt--; 
+      multiplyDigits(left+i,length,right,rlength,&product[0]);
+      addToDigits(result+i,llength+rlength-i,&product[0],length+rlength);
 
-      if ( br_cnt )
-	buffer.put(arg[indx]);
+    }
 
-    } else
-      buffer.put(arg[indx]);
+    return;
 
-    indx++;
-    abs_pos++;
+  }
 
-  } while ( br_cnt && arg[indx] );
+  // left = l1*B^half + l0, right = r1*B^half + r0, with r1 not empty
+  size_t half = llength/2;
+  size_t lhigh = llength - half, rhigh = rlength - half;
 
-  buffer.put('\0');
+  Integer::Digits l0(left,left+half), l1(left+half,left+llength), r0(right,right+half), r1(right+half,right+rlength);
+  Integer::Digits lsum, rsum;
 
-  if ( br_cnt )
-    return (-1);
+  addDigits(l0,l1,lsum);
+  addDigits(r0,r1,rsum);
 
-  exprstring = buffer.merge();
+  // l0*r0 and l1*r1 are placed into the result directly
+  multiplyDigits(left,half,right,half,result);
+  multiplyDigits(left+half,lhigh,right+half,rhigh,result+2*half);
 
-  return(indx);
+  // (l0+l1)*(r0+r1) - l0*r0 - l1*r1
+  std::vector<uint32_t> middle(lsum.size()+rsum.size());
+
+  multiplyDigits(&lsum[0],lsum.size(),&rsum[0],rsum.size(),&middle[0]);
+  subtractDigits(&middle[0],middle.size(),result,2*half);
+  subtractDigits(&middle[0],middle.size(),result+2*half,lhigh+rhigh);
+
+  addToDigits(result+half,llength+rlength-half,&middle[0],middle.size());
 
 }
-  
-int MathExpression::copyFloatContent(char * & exprstring, const char *arg){
 
-  DynamicBuffer<char> buffer(BUFSIZE);
+static void multiply(const Integer::Digits &left, const Integer::Digits &right, Integer::Digits &result){
 
-  int indx=0;
-  while (checkDigit(arg[indx])){ 
+  if ( left.empty() || right.empty() ){
+    result.clear();
+    return;
+  }
 
-    buffer.put(arg[indx]);
-    indx++;
-    abs_pos++;
+  result.resize(left.size()+right.size());
+  multiplyDigits(&left[0],left.size(),&right[0],right.size(),&result[0]);
+  trim(result);
+
+}
 
+// the product of factors[begin..end) by binary splitting, the factors are consumed
+static void multiplyAll(std::vector<Integer::Digits> &factors, size_t begin, size_t end, Integer::Digits &result){
+
+  if ( begin == end ){
+    toDigits(1,result);
+    return;
   }
 
-  buffer.put('\0');
+  if ( end - begin == 1 ){
+    result.swap(factors[begin]);
+    return;
+  }
 
-  exprstring = buffer.merge();
+  size_t middle = begin + (end-begin)/2;
+  Integer::Digits left, right;
+
+  multiplyAll(factors,begin,middle,left);
+  multiplyAll(factors,middle,end,right);
+  multiply(left,right,result);
 
-  return(indx);
 }
 
-int MathExpression::copyOperatorContent(char * & exprstring, const char *arg){
+// Knuth's algorithm D for divisors of at least two limbs, the dividend must not be smaller than the divisor
+static void divideDigits(const Integer::Digits &dividend, const Integer::Digits &divisor,
+			 Integer::Digits &quotient, Integer::Digits &remainder){
 
-  DynamicBuffer<char> buffer(BUFSIZE);
-  bool concat_mode = false;
+  // normalized so that the leading limb of the divisor is at least BASE/2
+  uint32_t factor = Integer::BASE / (divisor.back() + 1);
+  Integer::Digits u(dividend), v(divisor);
 
-  int indx=0;
+  multiplySmall(u,factor);
+  multiplySmall(v,factor);
 
-  exprstring = 0;
+  if ( u.size() == dividend.size() )
+    u.push_back(0);
 
-  switch (arg[indx]){
-  case '(':
-  case ')':
-    break;
-  default:
-    if ( checkOperator(arg[indx]) ){
+  size_t n = v.size(), m = u.size() - n;
+  uint64_t vtop = v[n-1], vnext = v[n-2];
 
-      buffer.put(arg[indx]);
-      indx++;
-      abs_pos++;
+  quotient.assign(m,0);
 
-    } else{
- 
-      while ( arg[indx] ){ 
+  for ( size_t j = m; j-- > 0; ){
 
-	if ( arg[indx] == '_' )
-	  concat_mode = true;
+    uint64_t numerator = (uint64_t)u[j+n]*Integer::BASE + u[j+n-1];
+    uint64_t qhat = numerator / vtop, rhat = numerator % vtop;
 
-	if ( !(checkLetter(arg[indx]) || (concat_mode && checkDigit(arg[indx]))) )
-	  break;
+    while ( qhat >= Integer::BASE || qhat*vnext > rhat*Integer::BASE + u[j+n-2] ){
 
-	buffer.put(arg[indx]);
-	indx++;
-	abs_pos++;
+      qhat--;
+      rhat += vtop;
+
+      if ( rhat >= Integer::BASE )
+	break;
 
-      }
     }
 
-    break;
-  }
+    // u -= qhat*v
+    uint64_t carry = 0;
+    int64_t borrow = 0;
 
-  buffer.put('\0');
+    for ( size_t i = 0; i < n; i++ ){
 
-  exprstring = buffer.merge();
+      uint64_t product = qhat*v[i] + carry;
+      int64_t difference = (int64_t)u[i+j] - (int64_t)(product % Integer::BASE) - borrow;
 
-  return(indx);
-}
+      carry = product / Integer::BASE;
+      borrow = ( difference < 0 );
+      u[i+j] = (uint32_t)( borrow ? difference + Integer::BASE : difference );
 
-void MathExpression::clearString(char *exprstring){
-  while (*exprstring)
-    *exprstring++=0;
-}
+    }
 
-int MathExpression::priCompare(const char *c0, const char *c1){
+    int64_t difference = (int64_t)u[j+n] - (int64_t)carry - borrow;
 
-  int p[2],i;
-  const char *c[2]={ &c0[0], &c1[0] };
+    borrow = ( difference < 0 );
+    u[j+n] = (uint32_t)( borrow ? difference + Integer::BASE : difference );
+
+    // qhat was one too large: add back
+    if ( borrow ){
+
+      qhat--;
+      addToDigits(&u[j],n+1,&v[0],n);
 
-  for ( i = 0; i < 2; i++ ){
-    switch( *c[i] ){
-    case ';':
-      p[i] = SEMICOLON_PRI;
-      break;
-    case ',':
-      p[i] = KOMMA_PRI;
-      break;
-    case '=':
-      p[i] = EQUAL_PRI;
-      break;
-    case '+':
-    case '-':
-      p[i] = ADDSUB_PRI;
-      break;
-    case '*':
-    case '/':
-    case '\\':
-    case '%':
-      p[i] = MULTDIV_PRI;
-      break;
-    case '^':
-      p[i] = POT_PRI;
-      break;
-    case '!':
-      p[i] = FAC_PRI;
-      break;
-    case '@':
-      p[i] = BINOM_PRI;
-      break;
-    default :
-      if ( !strcmp(c[i],SUM) ){
-	p[i] = ADDSUB_PRI;
-	break;
-      } else if ( !strcmp(c[i],PROD) ){
-	p[i] = MULTDIV_PRI;
-	break;
-      } else{
-	p[i] = SIN_PRI;
-	break;
-      }
     }
+
+    quotient[j] = (uint32_t)qhat;
+
   }
-  return ( p[0] - p[1] );
+
+  remainder.assign(u.begin(),u.begin()+n);
+  divideSmall(remainder,factor);
+  trim(quotient);
+
 }
 
-bool MathExpression::checkSyntaxAndOptimize(void) throw (ParseException){
+static void sieve(unsigned long n, std::vector<unsigned long> &primes){
 
-  if (this->isOperator()){
-    if (checkOperator(this->oprtr[0])){
-      if (this->oprtr[0] == '='){
-	
-	if (this->getLeft() && this->getRight())
-	  if (!this->getLeft()->isEmpty() && !this->getRight()->isEmpty()){
-	    if (this->getLeft()->isVariable()){
-	      if (!this->getLeft()->getLeft() && !this->getLeft()->getRight())
-		if (this->getRight()->checkSyntaxAndOptimize())
-		  return(true);
-	    } else if (this->getLeft()->isOperator()){
-	      if (!this->getLeft()->getLeft() && this->getLeft()->getRight()){
-		
-		// 		// we have a function-defintion and we have to set the operator-type of the
-		// 		// parameter-list as  "OT_PARAMETER"
-		// 		this->getLeft()->getRight()->setOTParameter();
+  std::vector<bool> composite(n+1,false);
 
-		if (this->getRight()->checkSyntaxAndOptimize())
-		  return true;
-	      
-	      }
-	    }
-	    throw ParseException(abs_pos, "invalid syntax for assignment!");
-	  }
-      
-      } else if (this->oprtr[0] == '!'){
-	if (!this->getLeft() && this->getRight())
-	  if (!this->getRight()->isEmpty())
-	    return (true);
-      } else if ( this->oprtr[0] == ',' ){
+  for ( unsigned long i = 2; i <= n; i++ ){
 
-	if ( !this->elements.size() )
-	  throw ParseException(abs_pos, "invalid syntax: comma-operator has no arguments!");
-	for ( list<MathExpression *>::iterator it = this->elements.begin(); it != this->elements.end(); it++ )
-	  if ( (*it)->checkSyntaxAndOptimize() == false )
-	    throw ParseException(abs_pos,"invalid syntax in parameter-list!");
+    if ( composite[i] )
+      continue;
 
-	return true;
-	  
-      } else if (this->getLeft() && this->getRight()){
-	
-	if (!this->getLeft()->isEmpty() && !this->getRight()->isEmpty())
-	  if (this->getLeft()->checkSyntaxAndOptimize() && this->getRight()->checkSyntaxAndOptimize()){
-	    
-	    // optimization: reduction  of "({-,+}1)*({-,+}1)" to "{-,+}1"
-	    if ( this->oprtr[0] == '*' )
-	      if ( this->getLeft()->isValue() == true && this->getRight()->isValue() == true )
-		if ( Complex *left = dynamic_cast<Complex *>(this->getLeft()->getValue()) ){
-		  if ( Complex *right = dynamic_cast<Complex *>(this->getRight()->getValue()) ){
-		  
-		    if ( left->getIm() == 0 && right->getIm() == 0 ){
-		    
-		      if ( abs(left->getRe()) == 1 && abs(right->getRe()) == 1 ){
-		      
-			this->setETValue(new Complex(sgn(left->getRe()) * right->getRe()));
-		      
-			delete this->getLeft();
-			delete this->getRight();
-			this->setLeft(0);
-			this->setRight(0);
-			
-		      }
-		    }
-		  }
-		  
-		}
-	    
-	    return(true);
-	    
-	  }
-      }
-      
-      throw ParseException(abs_pos, "invalid syntax for binary operator!");
+    primes.push_back(i);
 
-    } else{
+    for ( unsigned long j = i*i; j <= n && i <= n/i; j += i )
+      composite[j] = true;
 
-      // so far, it was difficult to determine if a (...)-expression is a tuple or a parameterlist;
-      // that's why we decide and set it here properly
-      //       if ( this->getRight() )
-      // 	this->getRight()->setOTParameter();
+  }
 
-      if (!strcmp(this->getOperator(),"log")){
-	if (this->getLeft() && this->getRight())
-	  if (!this->getLeft()->isEmpty() && !this->getRight()->isEmpty())
-	    if (this->getLeft()->checkSyntaxAndOptimize() && this->getRight()->checkSyntaxAndOptimize())
-	      return true;
-	throw ParseException(abs_pos, "invalid syntax in function log!");
-      } else if (!strcmp(this->getOperator(),SUM)
-		 || !strcmp(this->getOperator(),PROD)){
-	if (this->getLeft() && this->getRight())
-	  if (!this->getLeft()->isEmpty() && !this->getRight()->isEmpty())
-	    if (this->getLeft()->oprtr[0] == ';')
-	      if (this->getLeft()->getLeft() && this->getLeft()->getRight())
-		if (!this->getLeft()->getLeft()->isEmpty() && !this->getLeft()->getRight()->isEmpty())
-		  if (this->getLeft()->getLeft()->oprtr[0] == '='){
-		    try{
-		      if (this->getLeft()->getLeft()->checkSyntaxAndOptimize())
-			if (this->getLeft()->getRight()->checkSyntaxAndOptimize())
-			  if (this->getRight()->checkSyntaxAndOptimize())
-			    return true;
-		    } catch (ParseException &pe){
-		      throw ParseException(abs_pos, pe.getMsg() + "invalid syntax in function Sum/Prod!");
-		    }
-		  }
-	throw ParseException(abs_pos, "invalid syntax in function Sum/Prod!");
-      } else if ( isBuiltinFunction(this->getOperator()) ){
-	if ( !this->getLeft() && this->getRight() )
-	  if ( this->getRight()->isEmpty() == false )
-	    if ( this->getRight()->checkSyntaxAndOptimize() )
-	      return(true);
-	throw ParseException(abs_pos, "invalid syntax for builtin-function!");
-      } else if ( functionlist->isMember(this->getOperator()) ){
-	if ( !this->getLeft() && this->getRight() ){
-	  if ( this->getRight()->checkSyntaxAndOptimize() ){
-	    return true;
+}
 
-	  } else
+// the exponent of the prime in n!
+static unsigned long legendre(unsigned long n, unsigned long prime){
 
-	    throw ParseException(abs_pos,"invalid syntax for user-defined function: checkSyntax for right operand failed!");
+  unsigned long exponent = 0;
 
-	} else
-	  throw ParseException(abs_pos,"invalid syntax for user-defined function: left or no right operand!");
+  for ( ; n > 0; n /= prime )
+    exponent += n/prime;
 
-	throw ParseException(abs_pos, "invalid syntax for user-defined function!");
+  return exponent;
+
+}
+
+/*
+  The product of prime^exponent: the primes with bit b set in their exponent are multiplied by binary splitting,
+  the partial products are combined like in a binary exponentiation, so only a few large squares are computed.
+*/
+static void multiplyPowers(const std::vector<unsigned long> &primes, const std::vector<unsigned long> &exponents,
+			   Integer::Digits &result){
+
+  unsigned long highest = 0;
+
+  for ( size_t i = 0; i < exponents.size(); i++ )
+    highest = std::max(highest,exponents[i]);
+
+  toDigits(1,result);
+
+  for ( unsigned long bit = ( highest ? 1UL << ( sizeof(unsigned long)*8 - 1 ) : 0 ); bit > 0; bit >>= 1 ){
+
+    if ( bit > highest )
+      continue;
+
+    Integer::Digits square;
+
+    multiply(result,result,square);
+
+    // the primes are packed into limbs
+    std::vector<Integer::Digits> factors;
+    uint64_t limb = 1;
+
+    for ( size_t i = 0; i < primes.size(); i++ ){
+
+      if ( !( exponents[i] & bit ) )
+	continue;
+
+      if ( limb*primes[i] >= Integer::BASE ){
+	factors.push_back(Integer::Digits(1,(uint32_t)limb));
+	limb = 1;
+      }
+
+      limb *= primes[i];
 
-      } else
-	return true;
     }
+
+    if ( limb > 1 )
+      factors.push_back(Integer::Digits(1,(uint32_t)limb));
+
+    Integer::Digits product;
+
+    multiplyAll(factors,0,factors.size(),product);
+    multiply(square,product,result);
+
   }
-  return true;
+
 }
 
-void MathExpression::print(streamsize precision) const{
-  cout << toString(precision);
+static void factorialDigits(unsigned long n, Integer::Digits &result){
+
+  std::vector<unsigned long> primes, exponents;
+
+  sieve(n,primes);
+
+  for ( size_t i = 0; i < primes.size(); i++ )
+    exponents.push_back(legendre(n,primes[i]));
+
+  multiplyPowers(primes,exponents,result);
+
 }
 
-string MathExpression::toString(streamsize precision) const throw (Exception<MathExpression>,ExceptionBase){
+// (n-begin)*(n-begin-1)*...*(n-end+1) by binary splitting
+static void fallingProduct(const Integer::Digits &n, unsigned long begin, unsigned long end, Integer::Digits &result){
 
-  ostringstream exp;
+  if ( begin == end ){
+    toDigits(1,result);
+    return;
+  }
 
-  exp << "(";
-  if ( !this->isEmpty() ){
-    if ( this->isOperator() ){
-      if ( this->oprtr[0] == '!' ){
+  if ( end - begin == 1 ){
 
-	if (this->getRight())
-	  exp << this->getRight()->toString(precision);
+    Integer::Digits offset;
 
-	exp << this->getOperator();
+    toDigits(begin,offset);
+    result = n;
+    subtractDigits(&result[0],result.size(),offset.empty() ? 0 : &offset[0],offset.size());
+    trim(result);
+    return;
 
-      } else if ( this->oprtr[0] == ',' ){
+  }
 
-	for ( list<MathExpression *>::const_iterator it = elements.begin(); it != elements.end(); it++ )
-	  exp << ( it == elements.begin() ? "" : this->getOperator() ) << (*it)->toString(precision);
+  unsigned long middle = begin + (end-begin)/2;
+  Integer::Digits left, right;
 
-      } else if (!strcmp(this->getOperator(),"log")
-		 || !strcmp(this->getOperator(),SUM)
-		 || !strcmp(this->getOperator(),PROD)){
+  fallingProduct(n,begin,middle,left);
+  fallingProduct(n,middle,end,right);
+  multiply(left,right,result);
 
-	exp << this->getOperator();
-	exp << "[" << this->getLeft()->toString(precision) << "]";
-	exp << this->getRight()->toString(precision);
+}
 
-      } else{
+// n*(n-1)*...*(n-k+1)/k!
+static void fallingBinomial(const Integer::Digits &n, unsigned long k, Integer::Digits &result){
 
-	if (this->getLeft())
-	  exp << this->getLeft()->toString(precision);
+  Integer::Digits faculty, product, remainder;
 
-	exp << this->getOperator();
+  fallingProduct(n,0,k,product);
+  factorialDigits(k,faculty);
 
-	if (this->getRight())
-	  exp << this->getRight()->toString(precision);
+  if ( faculty.size() == 1 ){
 
-      }
-    } else if (this->isVariable())
-      exp << this->getVariable();
-    else if ( this->isValue() ){
+    divideSmall(product,faculty[0]);
+    result.swap(product);
 
-      exp << this->getValue()->toString(precision);
+  } else
+    divideDigits(product,faculty,result,remainder);
+
+}
+
+Integer::Integer(cmplx_tp number) : Complex(number), negative(number < 0){
+
+  int exponent;
+  cmplx_tp mantissa = ::frexp(::fabs(number),&exponent);
+
+  if ( exponent <= 53 ){
+
+    toDigits((uint64_t)::fabs(number),digits);
+    return;
 
-    } else
-      throw Exception<MathExpression>("internal error in MathExpression::toString()!");
   }
-  exp << ")";
 
-  return exp.str();
+  // the 53 bits of the mantissa, shifted by factors of 2^29 < BASE
+  toDigits((uint64_t)::ldexp(mantissa,53),digits);
+
+  for ( exponent -= 53; exponent > 0; exponent -= 29 )
+    multiplySmall(digits,1U << std::min(exponent,29));
 
 }
 
-string MathExpression::builtinsToString(){
+Integer::Integer(bool negative, const Digits &digits) : negative(negative), digits(digits){
 
-  ostringstream builtins;
-  
-  const char oplist[]={OPLIST};
-  const char *flist[]={FLIST};
+  trim(this->digits);
+  update();
 
-  for (unsigned int i=0;i<sizeof(oplist)/sizeof(char);i++)
-    builtins << oplist[i] << endl;
+}
 
-  for (unsigned int i=0;i<sizeof(flist)/sizeof(char *);i++)
-    builtins << flist[i] << endl;
+void Integer::update(){
 
-  return builtins.str();
+  cmplx_tp approximation = 0;
+  size_t lowest = ( digits.size() > 3 ? digits.size() - 3 : 0 );
+
+  for ( size_t i = digits.size(); i-- > lowest; )
+    approximation = approximation*BASE + digits[i];
+
+  if ( lowest )
+    approximation *= ::pow((cmplx_tp)BASE,(cmplx_tp)lowest);
+
+  *static_cast< complex<cmplx_tp> *>(this) = complex<cmplx_tp>(negative ? -approximation : approximation);
 
 }
 
+complex<cmplx_tp> Integer::getScaled(int &exponent) const{
 
-Value *MathExpression::eval() throw (ExceptionBase,FunctionDefinition){
+  cmplx_tp mantissa = 0;
+  int shift;
 
-  //   double result;
-  if ( isOperator() ){
+  exponent = 0;
 
-    switch ( oprtr[0] ){
+  // normalized after each limb, so it doesn't overflow
+  for ( size_t i = digits.size(); i-- > 0; ){
 
-    case '+':
+    mantissa = ::frexp(mantissa*BASE + ::ldexp((cmplx_tp)digits[i],-exponent),&shift);
+    exponent += shift;
 
-      this->setValue(getLeft()->eval()->operator+(getRight()->eval()));
-      break;
+  }
 
-    case '-':
+  return complex<cmplx_tp>(negative ? -mantissa : mantissa);
 
-      this->setValue(getLeft()->eval()->operator-(getRight()->eval()));
-      break;
+}
 
-    case '*':
+const Integer *Integer::operand(Value *value, Integer &buffer){
 
-      this->setValue(getLeft()->eval()->operator*(getRight()->eval()));
-      break;
+  if ( const Integer *integer = dynamic_cast<const Integer *>(value) )
+    return integer;
 
-    case '/':
+  const Complex *cmplx = dynamic_cast<const Complex *>(value);
 
-      this->setValue(getLeft()->eval()->operator/(getRight()->eval()));
-      break;
+  if ( !cmplx || !cmplx->isIntegral() )
+    return 0;
 
-    case '\\':
+  buffer = Integer(cmplx->getRe());
 
-      this->setValue(getLeft()->eval()->integerDivision(getRight()->eval()));
-      break;
+  return &buffer;
+
+}
+
+Value *Integer::create(bool negative, Digits &digits){
+
+  trim(digits);
+
+  if ( digits.size() <= 2 ){
+
+    uint64_t magnitude = ( digits.empty() ? 0 : digits[0] ) + ( digits.size() == 2 ? (uint64_t)digits[1]*BASE : 0 );
+
+    if ( magnitude <= MAX_DOUBLE_INTEGER )
+      return new Complex(negative && magnitude ? -(cmplx_tp)magnitude : (cmplx_tp)magnitude);
+
+  }
+
+  Integer *integer = new Integer();
+
+  integer->negative = negative;
+  integer->digits.swap(digits);
+  integer->update();
+
+  return integer;
+
+}
+
+int Integer::compare(const Integer *left, const Integer *right){
+
+  bool lnegative = ( left->negative && !left->digits.empty() ), rnegative = ( right->negative && !right->digits.empty() );
+
+  if ( lnegative != rnegative )
+    return ( lnegative ? -1 : 1 );
+
+  int result = compareDigits(left->digits,right->digits);
+
+  return ( lnegative ? -result : result );
+
+}
+
+Value *Integer::add(const Integer *left, const Integer *right, bool subtract){
+
+  bool rnegative = ( right->negative != subtract );
+  Digits result;
+
+  if ( left->negative == rnegative ){
+
+    addDigits(left->digits,right->digits,result);
+    return create(left->negative,result);
+
+  }
+
+  if ( compareDigits(left->digits,right->digits) >= 0 ){
+
+    result = left->digits;
+    subtractDigits(&result[0],result.size(),&right->digits[0],right->digits.size());
+    return create(left->negative,result);
+
+  }
+
+  result = right->digits;
+  subtractDigits(&result[0],result.size(),&left->digits[0],left->digits.size());
+  return create(rnegative,result);
+
+}
+
+void Integer::divide(const Integer *left, const Integer *right, Integer &quotient, Integer &remainder) throw (EvalException){
+
+  if ( right->digits.empty() )
+    throw EvalException("division by zero!");
+
+  if ( compareDigits(left->digits,right->digits) < 0 ){
+
+    quotient.digits.clear();
+    remainder.digits = left->digits;
+
+  } else if ( right->digits.size() == 1 ){
+
+    quotient.digits = left->digits;
+    toDigits(divideSmall(quotient.digits,right->digits[0]),remainder.digits);
+
+  } else
+    divideDigits(left->digits,right->digits,quotient.digits,remainder.digits);
+
+  trim(remainder.digits);
+
+  // rounded towards minus infinity, the remainder gets the sign of the divisor
+  quotient.negative = ( left->negative != right->negative );
+  remainder.negative = right->negative;
+
+  if ( quotient.negative && !remainder.digits.empty() ){
+
+    Digits one, difference(right->digits);
+
+    toDigits(1,one);
+    addDigits(Digits(quotient.digits),one,quotient.digits);
+    subtractDigits(&difference[0],difference.size(),&remainder.digits[0],remainder.digits.size());
+    trim(difference);
+    remainder.digits.swap(difference);
+
+  }
+
+}
+
+Value *Integer::factorial(unsigned long n) throw (EvalException){
+
+  if ( n > MAX_FACULTY )
+    throw EvalException("Argument of Faculty too large!");
+
+  Digits digits;
+
+  factorialDigits(n,digits);
+
+  return create(false,digits);
+
+}
+
+Value *Integer::binomial(unsigned long n, unsigned long k) throw (EvalException){
+
+  if ( k > n )
+    throw EvalException("Argument of Faculty not a natural number or negative!");
+
+  k = std::min(k,n-k);
+
+  Digits digits;
+
+  if ( n <= MAX_FACULTY ){
+
+    // the exponent of a prime is the one of n! reduced by the ones of k! and (n-k)!
+    std::vector<unsigned long> primes, exponents;
+
+    sieve(n,primes);
+
+    for ( size_t i = 0; i < primes.size(); i++ )
+      exponents.push_back(legendre(n,primes[i]) - legendre(k,primes[i]) - legendre(n-k,primes[i]));
+
+    multiplyPowers(primes,exponents,digits);
+
+  } else {
+
+    if ( k > MAX_FACULTY )
+      throw EvalException("Argument of Faculty too large!");
+
+    Digits upper;
+
+    toDigits(n,upper);
+    fallingBinomial(upper,k,digits);
+
+  }
+
+  return create(false,digits);
+
+}
+
+string Integer::toString(std::streamsize precision) const {
+
+  if ( digits.empty() )
+    return "0";
+
+  ostringstream value;
+
+  if ( negative )
+    value << '-';
+
+  value << digits.back();
+  value.fill('0');
+
+  for ( size_t i = digits.size() - 1; i-- > 0; ){
+    value.width(9);
+    value << digits[i];
+  }
+
+  return value.str();
+
+}
+
+Value *Integer::operator+(Value *right) throw (ExceptionBase){
+
+  Integer buffer;
+
+  if ( const Integer *ri = operand(right,buffer) )
+    return add(this,ri,false);
+
+  return Complex::operator+(right);
+
+}
+
+Value *Integer::operator-(Value *right) throw (ExceptionBase){
+
+  Integer buffer;
+
+  if ( const Integer *ri = operand(right,buffer) )
+    return add(this,ri,true);
+
+  return Complex::operator-(right);
+
+}
+
+Value *Integer::operator*(Value *right) throw (ExceptionBase){
+
+  Integer buffer;
+
+  if ( const Integer *ri = operand(right,buffer) ){
+
+    Digits product;
+
+    multiply(digits,ri->digits,product);
+
+    return create(negative != ri->negative,product);
+
+  }
+
+  return Complex::operator*(right);
+
+}
+
+Value *Integer::operator/(Value *right) throw (ExceptionBase){
+
+  Integer buffer, quotient, remainder;
+
+  // exact if the divisor divides
+  if ( const Integer *ri = operand(right,buffer) ){
+
+    divide(this,ri,quotient,remainder);
+
+    if ( remainder.digits.empty() )
+      return create(quotient.negative,quotient.digits);
+
+  }
+
+  return Complex::operator/(right);
+
+}
+
+void Integer::operator+=(Value *right) throw (ExceptionBase){
+
+  Integer buffer;
+  const Integer *ri = operand(right,buffer);
+
+  if ( !ri )
+    throw EvalException("operation only allowed for integer-numbers! ");
+
+  auto_ptr<Value> sum(add(this,ri,false));
+
+  // the sum stays an Integer even if it becomes small
+  if ( Integer *integer = dynamic_cast<Integer *>(sum.get()) ){
+    digits.swap(integer->digits);
+    negative = integer->negative;
+  } else
+    *this = Integer(static_cast<Complex *>(sum.get())->getRe());
+
+  update();
+
+}
+
+void Integer::operator*=(Value *right) throw (ExceptionBase){
+
+  Integer buffer;
+  const Integer *ri = operand(right,buffer);
+
+  if ( !ri )
+    throw EvalException("operation only allowed for integer-numbers! ");
+
+  Digits product;
+
+  multiply(digits,ri->digits,product);
+  digits.swap(product);
+  negative = ( negative != ri->negative && !digits.empty() );
+  update();
+
+}
+
+Value *Integer::integerDivision(Value *right) throw (ExceptionBase){
+
+  Integer buffer, quotient, remainder;
+
+  if ( const Integer *ri = operand(right,buffer) ){
+
+    divide(this,ri,quotient,remainder);
+    return create(quotient.negative,quotient.digits);
+
+  }
+
+  return Complex::integerDivision(right);
+
+}
+
+Value *Integer::operator%(Value *right) throw (ExceptionBase){
+
+  Integer buffer, quotient, remainder;
+
+  if ( const Integer *ri = operand(right,buffer) ){
+
+    divide(this,ri,quotient,remainder);
+    return create(remainder.negative,remainder.digits);
+
+  }
+
+  return Complex::operator%(right);
+
+}
+
+Value *Integer::pow(Value *right) throw (ExceptionBase){
+
+  Integer buffer;
+  const Integer *ri = operand(right,buffer);
+
+  // natural exponents by binary exponentiation, larger powers are approximated
+  if ( !ri || ri->negative || ri->digits.size() > 1 )
+    return Complex::pow(right);
+
+  uint32_t exponent = ( ri->digits.empty() ? 0 : ri->digits[0] );
+
+  if ( (uint64_t)exponent*digits.size() > MAX_POWER_LIMBS )
+    return Complex::pow(right);
+
+  Digits result, square(digits), product;
+  bool odd = ( exponent % 2 == 1 );
+
+  toDigits(1,result);
+
+  for ( ; exponent > 0; exponent >>= 1 ){
+
+    if ( exponent & 1 ){
+      multiply(result,square,product);
+      result.swap(product);
+    }
+
+    if ( exponent > 1 ){
+      multiply(square,square,product);
+      square.swap(product);
+    }
+
+  }
+
+  return create(negative && odd,result);
+
+}
+
+Value *Integer::faculty() throw (ExceptionBase){
+
+  if ( negative )
+    throw EvalException("operation only allowed for natural-numbers! ");
+
+  throw EvalException("Argument of Faculty too large!");
+
+}
+
+Value *Integer::choose(Value *right) throw (ExceptionBase){
+
+  Integer buffer;
+  const Integer *ri = operand(right,buffer);
+
+  if ( negative || !ri || ri->negative )
+    throw EvalException("operation only allowed for natural-numbers! ");
+
+  if ( compare(ri,this) > 0 )
+    throw EvalException("Argument of Faculty not a natural number or negative!");
+
+  // the smaller one of k and n-k
+  auto_ptr<Value> complement(add(this,ri,true));
+  Integer cbuffer;
+  const Integer *k = operand(complement.get(),cbuffer);
+
+  if ( compare(ri,k) < 0 )
+    k = ri;
+
+  Integer limit((cmplx_tp)MAX_FACULTY);
+
+  if ( compare(k,&limit) > 0 )
+    throw EvalException("Argument of Faculty too large!");
+
+  Digits result;
+
+  fallingBinomial(digits,(unsigned long)k->getRe(),result);
+
+  return create(false,result);
+
+}
+
+Value *Integer::sgn() throw (ExceptionBase){
+
+  return new Complex(negative ? -1 : 1);
+
+}
+
+Value *Integer::lessThan(Value *right) throw (ExceptionBase){
+
+  Integer buffer;
+
+  if ( const Integer *ri = operand(right,buffer) )
+    return new Complex(compare(this,ri) < 0);
+
+  return Complex::lessThan(right);
+
+}
+
+Value *Integer::lessEqual(Value *right) throw (ExceptionBase){
+
+  Integer buffer;
+
+  if ( const Integer *ri = operand(right,buffer) )
+    return new Complex(compare(this,ri) <= 0);
+
+  return Complex::lessEqual(right);
+
+}
+
+Value *Integer::greaterThan(Value *right) throw (ExceptionBase){
+
+  Integer buffer;
+
+  if ( const Integer *ri = operand(right,buffer) )
+    return new Complex(compare(this,ri) > 0);
+
+  return Complex::greaterThan(right);
+
+}
+
+Value *Integer::greaterEqual(Value *right) throw (ExceptionBase){
+
+  Integer buffer;
+
+  if ( const Integer *ri = operand(right,buffer) )
+    return new Complex(compare(this,ri) >= 0);
+
+  return Complex::greaterEqual(right);
+
+}
+
+Value *Integer::equal(Value *right) throw (ExceptionBase){
+
+  Integer buffer;
+
+  if ( const Integer *ri = operand(right,buffer) )
+    return new Complex(compare(this,ri) == 0);
+
+  return Complex::equal(right);
+
+}
+
+Value *Integer::notEqual(Value *right) throw (ExceptionBase){
+
+  Integer buffer;
+
+  if ( const Integer *ri = operand(right,buffer) )
+    return new Complex(compare(this,ri) != 0);
+
+  return Complex::notEqual(right);
+
+}
+
+/**
+   The parser works on a copy of the expression-string. Instead of copying the contents of brackets and the
+   elements of tuples into new strings, the part being parsed is terminated in place (see Part). The positions
+   of the matching brackets are determined once in advance.
+   @brief the expression-string during parsing
+   @internal
+*/
+class MathExpression::Source{
+
+public:
+
+  std::vector<char> buffer;
+  char *text;
+  int length;
+
+  // the end of the part being parsed
+  int end;
+
+  // the matching bracket of the same kind ("(" -> ")", "[" -> "]"), -1 if missing
+  std::vector<int> partner;
+
+  // the bracket closing a bracket if brackets of both kinds are counted, -1 if missing
+  std::vector<int> closer;
+
+  Source(const char *expression);
+
+  // the value of the number at <indx>
+  double number(int indx, int length);
+
+};
+
+/**
+   @brief terminates the Source at <end> as long as it exists
+   @internal
+*/
+class MathExpression::Part{
+
+private:
+
+  Source &source;
+  int end;
+  int previous;
+  char terminated;
+
+  // copyconstructor: not for use
+  Part(const Part &part) : source(part.source){}
+
+public:
+
+  Part(Source &source, int end) : source(source), end(end), previous(source.end), terminated(source.text[end]){
+
+    source.text[end] = '\0';
+    source.end = end;
+
+  }
+
+  ~Part(){
+
+    source.text[end] = terminated;
+    source.end = previous;
+
+  }
+
+};
+
+MathExpression::Source::Source(const char *expression)
+  : buffer(expression,expression + strlen(expression) + 1), text(&buffer[0]), length((int)strlen(expression)), end(length),
+    partner(length,-1), closer(length,-1){
+
+  vector<int> parentheses, brackets, braces;
+
+  for ( int i = 0; i < length; i++ ){
+
+    switch ( text[i] ){
+
+    case '(':
+      parentheses.push_back(i);
+      break;
+
+    case '[':
+      brackets.push_back(i);
+      break;
+
+    case ')':
+      if ( !parentheses.empty() ){
+	partner[parentheses.back()] = i;
+	parentheses.pop_back();
+      }
+      break;
+
+    case ']':
+      if ( !brackets.empty() ){
+	partner[brackets.back()] = i;
+	brackets.pop_back();
+      }
+      break;
+
+    }
+
+    if ( isOpenBrace(text[i]) )
+      braces.push_back(i);
+    else if ( isCloseBrace(text[i]) && !braces.empty() ){
+      closer[braces.back()] = i;
+      braces.pop_back();
+    }
+
+  }
+
+}
+
+double MathExpression::Source::number(int indx, int length){
+
+  Part part(*this,indx + length);
+
+  return atof(&text[indx]);
+
+}
+
+MathExpression::MathExpression(int abs_pos, VariableList *vl, FunctionList *fl) :
+  varlist(vl),functionlist(fl),left(0), right(0), pred(0),
+  value(0), type(ET_EMPTY), operator_type(OT_EMPTY), operator_id(OI_USER), function(0), function_version(0), abs_pos(abs_pos), imaginary_unit('i'), delete_flat(false), program(0), real_path(RP_UNKNOWN), cache(CS_NONE), cached(false){
+  
+  oprtr = string("");
+  variable = string("");
+
+}
+
+MathExpression::MathExpression(const char *expression, VariableList *vl,
+			       FunctionList *fl)
+  throw (ParseException,ExceptionBase)
+  : varlist(vl), functionlist(fl), left(0), right(0), pred(0),
+    value(0), type(ET_EMPTY), operator_type(OT_EMPTY), operator_id(OI_USER), function(0), function_version(0), abs_pos(1), imaginary_unit('i'), delete_flat(false), program(0), real_path(RP_UNKNOWN), cache(CS_NONE), cached(false){
+  
+  oprtr = string("");
+  variable = string("");
+
+  MathExpression *top;
+  VariableList locals;
+  Source source(expression);
+  
+  top = this->parse(source,0,source.length,locals);
+
+
+  if ( top ){
+
+    this->setLeft(top->getLeft());
+    this->setRight(top->getRight());
+    this->elements = top->elements;
+    this->pred=top->pred;
+
+    // the children are adopted
+    for ( list<MathExpression *>::iterator it = elements.begin(); it != elements.end(); it++ )
+      (*it)->pred = this;
+
+    switch (top->getEType()){
+
+    case ET_OP:
+      this->setETOperator(top->getOperator());
+      this->setOType(top->getOType());
+      break;
+
+    case ET_VAR:
+      this->setETVariable(top->getVariable());
+      break;
+
+    case ET_VAL:
+      // must be a flat copy because 'top' will only be freed and not deleted
+      this->setETValue(top->getValue());
+      break;
+
+    case ET_EMPTY:
+    default:
+      this->setEType(top->getEType());
+      break;
+
+    }
+
+  }
+  
+  try{
+
+    this->checkSyntaxAndOptimize();
+
+  }catch (ParseException &pe){
+
+    delete top;
+    throw pe;
+
+  }
+
+  // must be only flat-destruction because the referred objects have been stored in this
+  top->delete_flat = true;
+  delete top;
+
+}
+
+MathExpression::MathExpression(MathExpression *me, VariableList *vl, FunctionList *fl, int abs_pos)
+  throw (ParseException,ExceptionBase)
+  : varlist(vl), functionlist(fl), left(0), right(0), pred(0),
+    value(0), type(ET_EMPTY), operator_type(OT_EMPTY), operator_id(OI_USER), function(0), function_version(0), abs_pos(abs_pos), imaginary_unit('i'), delete_flat(false), program(0), real_path(RP_UNKNOWN), cache(CS_NONE), cached(false){
+
+  oprtr = string("");
+  variable = string("");
+
+  if ( !me )
+    return;
+
+  setImaginaryUnit(me->getImaginaryUnit());
+  
+  this->real_path = me->real_path;
+  this->cache = me->cache;
+
+  switch (me->getEType()){
+  case ET_OP:
+    this->setETOperator(me->getOperator(),me->getOperatorId());
+    this->setOType(me->getOType());
+    if ( cache == CS_CONSTANT )
+      this->value = me->getValue()->clone();
+    break;
+  case ET_VAR:
+    this->setETVariable(me->getVariable());
+    break;
+  case ET_VAL:
+    this->setETValue(me->getValue()->clone());
+    break;
+  case ET_EMPTY:
+  default:
+    this->setEType(ET_EMPTY);
+    break;
+  }
+  
+  // functions mostly don't have a left parameter. In this case we must not add the elements to the
+  // element-list otherwise the left-pointer will be set which will result in a malformed tree.
+  if ( me->getLeft() ){
+    // a left-argument exists: we can safely add all arguments to element-list
+    
+    for ( list<MathExpression *>::iterator it = me->elements.begin(); it != me->elements.end(); it++ ){
+      
+      addElement(new MathExpression(*it,vl,fl,abs_pos));
+      elements.back()->pred = this;
+      
+    }
+    
+  } else if ( me->getRight() )
+    // a left-argument doesn't exist: we must only set the right-pointer
+    this->setRight(new MathExpression(me->getRight(),vl,fl,abs_pos));
+
+}
+
+MathExpression::~MathExpression(){
+
+  if ( delete_flat == false){
+    
+    eraseElements();
+    if ( this->value )
+      delete this->value;
+    delete this->program;
+    
+  }
+  
+}
+
+void MathExpression::addElement(MathExpression *element){
+  
+  if ( elements.empty() )
+    left = element;
+  else
+    right = element;
+  
+  elements.push_back(element);
+  
+}
+
+void MathExpression::setRight(MathExpression *right){
+
+  if ( getRight() )
+    elements.pop_back();
+
+  if ( right )
+    elements.push_back(right);
+
+  this->right = right;
+
+}
+
+void MathExpression::setLeft(MathExpression *left){
+
+  if ( getLeft() )
+    elements.pop_front();
+
+  if ( left )
+    elements.push_front(left);
+
+  this->left = left;
+
+}
+
+void MathExpression::eraseElements(){
+
+  for( list<MathExpression *>::iterator it = elements.begin(); it != elements.end(); it++ )
+    delete *it;
+  elements.clear();
+
+}
+
+int MathExpression::skipBracketContent(const Source &source, int indx, char open){
+
+  if ( source.text[indx] != open )
+    return -1;
+
+  int close = source.partner[indx];
+
+  // the bracket must be closed within the part being parsed
+  if ( close == -1 || close >= source.end ){
+
+    abs_pos += source.end - indx;
+    return -1;
+
+  }
+
+  abs_pos += close + 1 - indx;
+
+  return close + 1 - indx;
+
+}
+
+int MathExpression::skipCommaContent(const Source &source, int indx){
+
+  int i = indx;
+
+  while ( i < source.end && source.text[i] != ',' && !isCloseBrace(source.text[i]) ){
+
+    if ( isOpenBrace(source.text[i]) ){
+
+      if ( source.closer[i] == -1 || source.closer[i] >= source.end ){
+
+	i = source.end;
+	break;
+
+      }
+
+      i = source.closer[i];
+
+    }
+
+    i++;
+
+  }
+
+  abs_pos += i - indx;
+
+  return i - indx;
+
+}
+
+int MathExpression::skipFloatContent(const char *expr, int indx){
+
+  int offset = 0;
+
+  while ( checkDigit(expr[indx+offset]) )
+    offset++;
+
+  abs_pos += offset;
+
+  return offset;
+
+}
+
+int MathExpression::skipOperatorContent(const char *expr, int indx){
+
+  const char *arg = &expr[indx];
+  bool concat_mode = false;
+  int offset = 0;
+
+  switch (arg[0]){
+  case '(':
+  case ')':
+    break;
+  default:
+    if ( checkOperator(arg[0]) ){
+
+      offset = 1;
+
+      // comparisons of two characters
+      if ( arg[1] == '=' && ( arg[0] == '<' || arg[0] == '>' || arg[0] == '=' || arg[0] == '!' ) )
+	offset = 2;
+
+    } else
+      for ( ; arg[offset]; offset++ ){
+
+	if ( arg[offset] == '_' )
+	  concat_mode = true;
+
+	if ( !(checkLetter(arg[offset]) || (concat_mode && checkDigit(arg[offset]))) )
+	  break;
+
+      }
+    break;
+  }
+
+  abs_pos += offset;
+
+  return offset;
+
+}
+
+MathExpression *MathExpression::parse(Source &source, int begin, int end, VariableList& locals)
+  throw (ParseException,ExceptionBase){
+
+  int e_indx, offset;
+  Part part(source,end);
+  const char *expr = source.text;
+  MathExpression *TopNode=0, *ActualNode=0, *PrevNode=0, *actn=0, *prevn;
+
+  if ( !expr[begin] )
+    return 0;
+
+  for ( e_indx = begin; expr[e_indx]; ){
+
+    // check for blanks
+    if ( isABlank(expr[e_indx]) == true ){
+
+      offset = skipBlanks(expr,e_indx);
+
+      e_indx+=offset;
+      abs_pos+=offset;
+
+      // leave loop in case of end of string
+      if ( expr[e_indx] == '\0' )
+	break;
+
+    }
+
+    if ( expr[e_indx] == ')' ){
+
+      delete TopNode;
+      throw ParseException(abs_pos, "invalid syntax!");
+
+    }
+
+    if ( expr[e_indx] == '(' ){
+
+      if ( PrevNode ){
+	if ( PrevNode->isOperator() ){
+	  if ( PrevNode->pred ){
+	    if ( PrevNode->getRight() ){
+	      /* hier handelt es sich um Ausdruecke der Form
+		 "1+sin2(...), also um eine implizite Multipikation,
+		 es muss also ein "*" in den Baum eingefuegt werden*/
+
+	      if ( !(ActualNode = new MathExpression(abs_pos,varlist,functionlist)) ){
+
+		delete TopNode;
+		throw OutOfMemException();
+
+	      }
+
+	      ActualNode->setETOperator("*");
+	      ActualNode->setOTOperation();
+
+	    } else{      /* Prev hat kein ->right */
+	      
+	      if ( (offset = skipBracketContent(source,e_indx,'(')) == -1 ){
+		
+		delete TopNode;
+		throw ParseException(abs_pos, "missing bracket!");
+
+	      }	      
+
+	      e_indx+=offset;
+	      abs_pos-=offset-1;
+
+	      // if nothing's in the brackets, we connect an empty element
+	      if ( !(ActualNode = this->parse(source,e_indx-offset+1,e_indx-1,locals)) )
+		ActualNode = new MathExpression(abs_pos,varlist,functionlist);
+
+	      abs_pos++;
+
+	    }
+	  } else{          /* PrevNode has no predecessor */
+
+	    if ( PrevNode->getRight() ){
+
+	      if ( !(ActualNode = new MathExpression(abs_pos,varlist,functionlist)) ){
+
+		delete TopNode;
+		throw OutOfMemException();
+
+	      }
+
+	      ActualNode->setETOperator("*");
+	      ActualNode->setOTOperation();
+
+	    } else{      /* Prev hat kein ->right */
+
+	      if ( (offset = skipBracketContent(source,e_indx,'(')) == -1 ){
+
+		delete TopNode;
+		throw ParseException(abs_pos, "missing bracket!");
+
+	      }
+
+	      e_indx+=offset;
+	      abs_pos-=offset-1;
+
+	      if ( !(ActualNode=this->parse(source,e_indx-offset+1,e_indx-1,locals)) )
+		ActualNode = new MathExpression(abs_pos,varlist,functionlist);
+
+	      abs_pos++;
+
+	    }
+	  }
+	} else{  /* Prev no operator -> digit or variable */
+	  if ( PrevNode->isVariable() ){
+
+	    if ( !varlist->isMember(PrevNode->getVariable() )
+		 && !locals.isMember(PrevNode->getVariable())){
+	      // a functioncall/-definition is following, thus variable
+	      // must be operator
+
+	      PrevNode->setETOperator(PrevNode->getVariable());
+	      PrevNode->setOTFunction();
+	      continue;
+
+	    }
+
+	  }
+
+	  if (!(ActualNode = new MathExpression(abs_pos,varlist,functionlist))){
+
+	    delete TopNode;
+	    throw OutOfMemException();
+
+	  }
+
+	  ActualNode->setETOperator("*");
+	  ActualNode->setOTOperation();
+
+	}
+      } else{ /* kein Prev vorhanden */
+
+	if ( (offset = skipBracketContent(source,e_indx,'(')) == -1 ){
+
+	  delete TopNode;
+	  throw ParseException(abs_pos, "missing bracket!");
+	  
+	}
+	
+	e_indx+=offset;
+	abs_pos-=offset-1;
+
+	if ( !(ActualNode=this->parse(source,e_indx-offset+1,e_indx-1,locals)) )
+	  ActualNode = new MathExpression(abs_pos,varlist,functionlist);
+
+	abs_pos++;
+
+      }
+
+      // if a parameterlist is contained within braces, it is a tuple normally ->
+      // but only, if it is not preceeded by a functionname ( in f(x,y) x,y does not
+      // define a tuple but a parameterlist )
+      if ( ActualNode and ActualNode->isOperator() and ActualNode->isOTParameter() )
+	if ( !PrevNode or !PrevNode->isOperator() or !PrevNode->isOTFunction() )
+	  ActualNode->setOTTuple();
+      
+    } else if( expr[e_indx]=='[' ){
+
+      if ( !PrevNode ){
+
+	delete TopNode;
+	throw ParseException(abs_pos, "invalid operator \"[\"!");
+
+      }
+      if ( !PrevNode->isOperator() ){
+
+	delete TopNode;
+	throw ParseException(abs_pos, "invalid operator \"[\"!");
+
+      }
+      
+      if ( !strcmp(PrevNode->getOperator(),"log")
+	   || !strcmp(PrevNode->getOperator(),SUM)
+	   || !strcmp(PrevNode->getOperator(),PROD) ){
+
+	if ( PrevNode->getLeft() ){
+
+	  delete TopNode;
+	  throw ParseException(abs_pos, "invalid syntax!");
+
+	}
+
+	if ( (offset = skipBracketContent(source,e_indx,'[')) == -1 ){
+
+	  delete TopNode;
+	  throw ParseException(abs_pos, "missing bracket!");
+
+	}
+
+	e_indx+=offset;
+	abs_pos-=offset-1;
+
+	if ( !(ActualNode=this->parse(source,e_indx-offset+1,e_indx-1,locals)) )
+	  ActualNode = new MathExpression(abs_pos,varlist,functionlist);
+
+	abs_pos++;
+
+	// variables defined in Sum or Prod must be added to local Scope
+	ActualNode->addVariablesToList(&locals);
+
+	PrevNode->setLeft(ActualNode);
+	ActualNode->pred=PrevNode;
+
+	continue;
+
+      } else{
+
+	delete TopNode;
+	throw ParseException(abs_pos, "invalid operator \"[\"!");
+
+      }
+    } else{        /* kein Bracket */
+
+      if ( !(ActualNode = new MathExpression(abs_pos,varlist,functionlist)) ){
+
+	delete TopNode;
+	throw OutOfMemException();
+
+      }
+
+      if ( checkDigit(expr[e_indx]) ){
+	if ( PrevNode ){
+	  if ( PrevNode->isOperator() ){
+	    if ( PrevNode->getRight() ){
+
+	      ActualNode->setETOperator("*");
+	      ActualNode->setOTOperation();
+
+	    } else{ /* Prev hat kein right */
+
+	      offset = skipFloatContent(expr,e_indx);
+	      ActualNode->setETValue(new Complex(source.number(e_indx,offset)));
+	      e_indx+=offset;
+
+	    }
+	  } else{  /* Prev kein operator
+		      ( Actual=Zahl, Prev=Zahl => Prev->pred=ln o.a") */
+	    ActualNode->setETOperator("*");
+	    ActualNode->setOTOperation();
+
+	  }
+
+	} else{ /* kein Prev */
+
+	  offset = skipFloatContent(expr,e_indx);
+	  ActualNode->setETValue(new Complex(source.number(e_indx,offset)));
+	  e_indx+=offset;
+
+	}
+
+      } else{               /* keine Zahl */
+	if ( PrevNode ){
+	  if ( checkLetter(expr[e_indx]) ){
+	    if ( PrevNode->isOperator() ){
+	      if ( PrevNode->pred ){
+		if ( PrevNode->getRight() ){
+
+		  ActualNode->setETOperator("*");
+		  ActualNode->setOTOperation();
+
+		} else{      /* Prev hat kein ->right */
+
+		  e_indx = determineAndSetOperatorOrVariable(source,e_indx,ActualNode,functionlist);
+
+		}
+	      } else{          /* Prev hat kein ->pred */ // TODO!!! same as if-branch!!!
+
+		if ( PrevNode->getRight() ){
+
+		  ActualNode->setETOperator("*");
+		  ActualNode->setOTOperation();
+
+		} else{      /* Prev hat kein ->right */
+
+		  e_indx = determineAndSetOperatorOrVariable(source,e_indx,ActualNode,functionlist);
+
+		}
+	      }
+	    } else{  /* Prev kein operator also Zahl */
+
+	      ActualNode->setETOperator("*");
+	      ActualNode->setOTOperation();
+
+	    }
+
+	  } else{ /* Arithmetischer Operator */
+
+	    if ( PrevNode->isOperator() ){
+	      /* behandelt werden sollen Ausdruecke der Form: "sin^2(...)": */
+	      /* ist das  aktuelle Zeichen ein "^" und der PrevNode ein
+		 Operator, handelt es sich um die Form wie z.B. "sin^2",
+		 allerdings nur, wenn der PrevNode noch keinen rechten
+		 Unterast hat, denn dann muss es sich um eine Form wie
+		 "(sin2)^3" handeln */
+	      if ( expr[e_indx]=='^'
+		   && ( priCompare(&expr[e_indx],PrevNode->getOperator()) == POT_PRI-SIN_PRI )
+		   && !PrevNode->getRight() ){
+		ActualNode->setETOperator("^");
+		ActualNode->setOTOperation();
+		/* im Folgenden wird geprueft, ob eine fehlerhafte Eingabe
+		   der Form "sin^^ ..." gemacht wurde. Dann ist der PrevNode
+		   (immer noch der sin) schon der linke Unterast eines
+		   "^"-Operators. Nun wird absichtlich ein fehlerhafter Baum
+		   aufgebaut, indem der ActualNode einfach als linker Unterast
+		   an den "sin"-Node gehaengt wird. Dies wird beim checken
+		   automatisch zu einem Syntaxfehler fuehren. */
+		if ( PrevNode->pred ){
+		  if ( PrevNode == PrevNode->pred->getLeft() ){
+
+		    prevn=PrevNode;
+
+		    while ( prevn->getLeft() )
+		      prevn=prevn->getLeft();
+
+		    prevn->setLeft(ActualNode);
+		    ActualNode->pred=prevn;
+		    e_indx++;
+		    abs_pos++;
+
+		    continue;
+
+		  }
+		}
+		/* hier ist alles ok (es handelt sich also um das erste "^"),
+		   der "sin"-Node muss also zum linken Unterast des ActualNode
+		   werden */
+		ActualNode->setLeft(PrevNode);
+		/* hat der "sin"-Node einen Vorgaenger, muss diese Verbindung
+		   auch verbogen werden */
+		if ( PrevNode->pred){
+
+		  ActualNode->pred=PrevNode->pred;
+		  PrevNode->pred->setRight(ActualNode);
+
+		} else
+		  TopNode=ActualNode;
+
+		PrevNode->pred=ActualNode;
+		e_indx++;
+		abs_pos++;
+
+		/* Auswertung der Potenz: handelt es sich um einen
+		   Klammerausdruck? ... */
+		if ( !expr[e_indx] )
+		  continue;
+
+		else if ( expr[e_indx]=='(' ){
+
+		  if ( (offset = skipBracketContent(source,e_indx,'(')) == -1 ){
+
+		    delete TopNode;
+		    throw ParseException(abs_pos, "missing bracket!");
+
+		  }
+		  
+		  e_indx+=offset;
+		  abs_pos-=offset-1;
+		  
+		  if ( !(actn = this->parse(source,e_indx-offset+1,e_indx-1,locals)) )
+		    actn = new MathExpression(abs_pos,varlist,functionlist);
+
+		  abs_pos++;
+
+		  if ( actn->isOperator() and actn->isOTParameter() )
+		    actn->setOTTuple();
+
+		} else if ( checkDigit(expr[e_indx]) ){ /* zahl? */
+
+		  if ( !(actn = new MathExpression(abs_pos,varlist,functionlist)) ){
+
+		    delete TopNode;
+		    throw OutOfMemException();
+
+		  }
+
+		  offset = skipFloatContent(expr,e_indx);
+		  actn->setETValue(new Complex(source.number(e_indx,offset)));
+		  e_indx+=offset;
+
+		} else if ( checkLetter(expr[e_indx]) ){ /* identifier? */
+		  // only variable makes sense
+
+		  if ( !(actn = new MathExpression(abs_pos,varlist,functionlist)) ){
+
+		    delete TopNode;
+		    throw OutOfMemException();
+
+		  }
+
+		  e_indx = parseVariable(source,e_indx,actn);
+
+		}
+
+		actn->pred=ActualNode;
+		ActualNode->setRight(actn);
+		actn=PrevNode->pred;
+		continue;
+
+	      } else {
+		
+		// "!=" is the comparison, but "x!==y" compares the faculty
+		if ( expr[e_indx] == '!' && ( expr[e_indx+1] != '=' || expr[e_indx+2] == '=' ) ){
+		  
+		  if ( !(actn = new MathExpression(abs_pos,varlist,functionlist)) ){
+		    
+		    delete TopNode;
+		    throw OutOfMemException();
+		    
+		  }
+		  
+		  actn->setETOperator("!");
+		  actn->setOTOperation();
+		  e_indx++;
+		  abs_pos++;
+		  
+		  if ( PrevNode->pred ){
+		    
+		    PrevNode->pred->setRight(actn);
+		    actn->pred=PrevNode->pred;
+		    
+		  }  else
+		    TopNode=actn;
+		  
+		  actn->setRight(PrevNode);
+		  PrevNode->pred=actn;
+		  continue;
+		  
+		} else if ( expr[e_indx] == ',' ){
+		  // Tuple-Operator
+
+		  e_indx = parseCommaOperator(source,e_indx,ActualNode,PrevNode,TopNode,locals);
+		  
+		  continue;
+		  
+		} else if ( expr[e_indx] == '=' && expr[e_indx+1] != '=' ){
+		  
+		  // it's a functiondefinition
+		  // to build a correct tree, the local vars must be remembered
+		  if ( PrevNode )
+		    PrevNode->addVariablesToList(&locals);
+		  
+		}
+
+		e_indx = determineAndSetOperatorOrVariable(source,e_indx,ActualNode,functionlist);
+		
+	      }
+	    } else{ /* der Vorgaenger ist kein Operator, also "normale"
+		       Verhaeltnisse */
+	      if ( expr[e_indx] == '!' && ( expr[e_indx+1] != '=' || expr[e_indx+2] == '=' ) ){
+		
+		if ( !(actn = new MathExpression(abs_pos,varlist,functionlist)) ){
+		  
+		  delete TopNode;
+		  throw OutOfMemException();
+		  
+		}
+
+		actn->setETOperator("!");
+		actn->setOTOperation();
+		e_indx++;
+		abs_pos++;
+		
+		if ( PrevNode->pred ){
+
+		  PrevNode->pred->setRight(actn);
+		  actn->pred=PrevNode->pred;
+
+		} else
+		  TopNode=actn;
+
+		actn->setRight(PrevNode);
+		PrevNode->pred=actn;
+		continue;
+		  
+	      } else if ( expr[e_indx] == ',' ){
+		// Tuple-Operator
+
+		e_indx = parseCommaOperator(source,e_indx,ActualNode,PrevNode,TopNode,locals);
+		
+		continue;
+		
+	      } else if ( expr[e_indx] == '=' && expr[e_indx+1] != '=' ){
+
+		// it's a functiondefinition
+		// to build a correct tree, the local vars must be remembered
+		if ( PrevNode )
+		  PrevNode->addVariablesToList(&locals);
+
+	      }
+
+	      e_indx = determineAndSetOperatorOrVariable(source,e_indx,ActualNode,functionlist);
+
+	    }
+	  }
+	} else{ /* kein PrevNode */
+
+	  e_indx = determineAndSetOperatorOrVariable(source,e_indx,ActualNode,functionlist);
+
+	}
+      }
+    }
+
+    if ( PrevNode ){
+      if ( ActualNode->isOperator() ){
+	if ( PrevNode->isOperator() ){
+
+	  if ( (ActualNode->oprtr[0] == '-' || ActualNode->oprtr[0] == '+')
+	       && !ActualNode->getLeft() && !PrevNode->getRight() ){
+
+	    /* falls unaerer minus- oder plusoperator */
+	    /* wird eine Mult. mit - bzw. +1 in den Baum eingefuegt */
+	    if ( ActualNode->oprtr[0] == '-' )         
+	      ActualNode->setETValue(new Complex(-1));
+	    else                                   
+	      ActualNode->setETValue(new Complex(1));
+
+	    prevn=ActualNode;
+
+	    if ( !(ActualNode = new MathExpression(abs_pos,varlist,functionlist)) ){
+
+	      delete TopNode;
+	      throw OutOfMemException();
+
+	    }
+
+	    ActualNode->setETOperator("*");
+	    ActualNode->setOTOperation();
+	    ActualNode->setLeft(prevn);
+	    prevn->pred=ActualNode;
+
+	    PrevNode->setRight(ActualNode);
+	    ActualNode->pred = PrevNode;
+
+	  } else if ( PrevNode->getRight() ){
+
+	    searchAndSetLowerPriNode(ActualNode,PrevNode,TopNode);
+
+	  } else{   /* Prev hat keinen rechten Unterbaum, also wird hier neuer
+		       Ast angefuegt */
+	    // z.B "3+sin2"
+	    // 	    if (priCompare(ActualNode->oprtr,PrevNode->oprtr)){
+	    PrevNode->setRight(ActualNode);
+	    ActualNode->pred = PrevNode;
+	    // 	    }
+	  }
+	} else{      /* Prev ist Zahl */
+
+	  searchAndSetLowerPriNode(ActualNode,PrevNode,TopNode);
+
+	}
+      } else{        /* Act ist Zahl */
+
+	PrevNode->setRight(ActualNode);
+	ActualNode->pred=PrevNode;
+
+      }
+
+      PrevNode=ActualNode;
+
+    } else{               /* erstes Zeichen */
+
+      if ( (ActualNode->oprtr[0] == '-' || ActualNode->oprtr[0] == '+')
+	   && !ActualNode->getLeft() ){
+
+	/* falls unaerer minus- oder plusoperator */
+	/* wird eine Mult. mit - bzw. +1 in den Baum eingefuegt */
+	if ( ActualNode->oprtr[0] == '-' )         
+	  ActualNode->setETValue(new Complex(-1));
+	else                                   
+	  ActualNode->setETValue(new Complex(1));
+
+	prevn=ActualNode;
+
+	if ( !(ActualNode = new MathExpression(abs_pos,varlist,functionlist)) ){
+
+	  delete TopNode;
+	  throw OutOfMemException();
+
+	}
+
+	ActualNode->setETOperator("*");
+	ActualNode->setOTOperation();
+	ActualNode->setLeft(prevn);
+	prevn->pred=ActualNode;
+
+      }
+
+      PrevNode=ActualNode;
+      TopNode=ActualNode;
+
+    }
+  }
+
+  return TopNode;
+}
+
+int MathExpression::parseCommaOperator(Source &source, int e_indx, MathExpression * & ActualNode, MathExpression * & PrevNode,
+				       MathExpression * & TopNode, VariableList & locals) throw (ParseException, ExceptionBase){
+
+  int offset;
+  const char *expr = source.text;
+		  
+  ActualNode->setETOperator(",");
+  ActualNode->setOTParameter();
+
+  searchAndSetLowerPriNode(ActualNode,PrevNode,TopNode);
+  
+  // add all further elements of comma to its list
+  while ( expr[e_indx] == ',' ){
+    
+    ++e_indx,++abs_pos;
+    offset = skipCommaContent(source,e_indx);
+    
+    if ( offset == 0 )
+      throw ParseException(abs_pos,"missing operand for comma-operator!");
+    
+    abs_pos-=offset;
+    e_indx+=offset;
+    
+    ActualNode->addElement(parse(source,e_indx-offset,e_indx,locals));
+    ActualNode->elements.back()->pred = ActualNode;
+    
+  }
+  
+  return e_indx;
+  
+}
+
+void MathExpression::searchAndSetLowerPriNode(MathExpression * & ActualNode, MathExpression * & PrevNode, MathExpression * & TopNode){
+
+  MathExpression *actn=0, *prevn=0;
+  int priority;
+  
+  if (PrevNode->pred  ){
+  
+    actn = ActualNode, prevn=PrevNode->pred;
+    
+    // search for node with lower priority in hierarchy
+    while ( (priority = priCompare(actn->getOperator(),prevn->getOperator())) <= 0
+	    && prevn->pred )
+      prevn = prevn->pred;
+    
+    if ( priority <= 0 ){  /* hier muss prevn Top sein */
+      
+      actn->setLeft(prevn);
+      prevn->pred = actn;
+      TopNode = actn;
+      
+    } else{               /* actn hat hoehere Prioritaet */
+      
+      actn->setLeft(prevn->getRight());
+      actn->pred = prevn;
+      prevn->setRight(actn);
+      
+    }
+  } else{    /* Prev ist Top */
+    
+    ActualNode->setLeft(PrevNode);
+    PrevNode->pred = ActualNode;
+    TopNode = ActualNode;
+  }
+  
+}
+
+int MathExpression::determineAndSetOperatorOrVariable(Source &source, int e_indx, MathExpression * & ActualNode, const FunctionList *functionlist){
+
+  int offset = skipOperatorContent(source.text,e_indx);
+  Part part(source,e_indx+offset);
+  const char *name = &source.text[e_indx];
+  
+  bool is_builtin = false;
+  if ( (is_builtin = isBuiltinFunction(name)) || checkOperator(name[0]) ){
+    
+    ActualNode->setETOperator(name);
+    
+    if ( is_builtin == true )
+      ActualNode->setOTFunction();
+    else
+      ActualNode->setOTOperation();
+    
+  } else if ( functionlist ){
+    
+    if ( functionlist->isMember(name) ){
+      
+      ActualNode->setETOperator(name);
+      ActualNode->setOTFunction();
+      
+    } else
+      ActualNode->setETVariable(name);
+    
+  } else
+    ActualNode->setETVariable(name);
+  
+  return e_indx+offset;
+
+}
+
+int MathExpression::parseVariable(Source &source, int e_indx, MathExpression *node){
+
+  int offset = skipOperatorContent(source.text,e_indx);
+  Part part(source,e_indx+offset);
+
+  node->setETVariable(&source.text[e_indx]);
+
+  return e_indx+offset;
+
+}
+
+inline bool MathExpression::checkOperator(char x){ 
+  return (((unsigned char)(x) >= 1 && (unsigned char)(x) <= '/')
+	  || ((unsigned char)(x) >= ':' && (unsigned char)(x) <= '@')
+	  || ((unsigned char)(x) >= '[' && (unsigned char)(x) <= '^')
+	  || ((unsigned char)(x) == '`')
+	  || ((unsigned char)(x) >= '{') );
+}
+
+inline bool MathExpression::checkDigit(char x){
+  return (((unsigned char)(x) >= '0' && (unsigned char)(x) <= '9')
+	  || (unsigned char)(x) == '.');
+}
+ 
+inline bool MathExpression::checkLetter(char x){
+  return (((unsigned char)(x) >= 'A' && (unsigned char)(x) <= 'Z')
+	  || ((unsigned char)(x) >= 'a' && (unsigned char)(x) <= 'z')
+	  || ((unsigned char)(x) == '_'));
+}
+
+bool MathExpression::isBuiltinFunction(const char *strname){
+
+  const char *flist[]={FLIST};
+
+  for (unsigned int i=0;i<sizeof(flist)/sizeof(char *);i++)
+    if (!strcmp(strname,flist[i]))
+      return true;
+  return false;
+}
+
+unsigned char MathExpression::resolveOperator(const char *name){
+
+  static const char *names[] = {"+","-","*","/","\\","%","^","!","@","=",",",
+				"sin","cos","tan","asin","acos","atan","sinh","cosh","tanh",
+				"asinh","acosh","atanh","ln","ld","log","exp","sgn","tst",SUM,PROD,
+				"<","<=",">",">=","==","!=","cond","matrix","transp","det","solve"};
+  static const unsigned char ids[] = {OI_ADD,OI_SUB,OI_MUL,OI_DIV,OI_IDIV,OI_MOD,OI_POW,OI_FAC,OI_CHOOSE,OI_ASSIGN,OI_COMMA,
+				      OI_SIN,OI_COS,OI_TAN,OI_ASIN,OI_ACOS,OI_ATAN,OI_SINH,OI_COSH,OI_TANH,
+				      OI_ASINH,OI_ACOSH,OI_ATANH,OI_LN,OI_LD,OI_LOG,OI_EXP,OI_SGN,OI_TST,OI_SUM,OI_PROD,
+				      OI_LT,OI_LE,OI_GT,OI_GE,OI_EQ,OI_NE,OI_COND,OI_MATRIX,OI_TRANSP,OI_DET,OI_SOLVE};
+
+  for ( unsigned int i = 0; i < sizeof(names)/sizeof(char *); i++ )
+    if ( !strcmp(name,names[i]) )
+      return ids[i];
+
+  // user-defined function or unknown
+  return OI_USER;
+
+}
+
+void MathExpression::setETOperator(const char *name){
+
+  setETOperator(name,resolveOperator(name));
+
+}
+
+void MathExpression::setETOperator(const char *name, unsigned char id){
+
+  oprtr = string(name);
+  operator_id = id;
+  function = 0;
+
+  if ( value )
+    delete value;
+  value=0;
+  variable = string("");
+  type=ET_OP;
+
+}
+
+void MathExpression::setETVariable(const char *name){
+
+  variable = string(name);
+
+  oprtr = string("");
+  operator_id = OI_USER;
+  function = 0;
+  setOType(OT_EMPTY);
+
+  if ( value )
+    delete value;
+  value = 0;
+
+  type = ET_VAR;
+
+}
+  
+void MathExpression::setETValue(Value *value){
+    
+  if ( this->value )
+    delete this->value;
+
+  this->value = value;
+
+  oprtr = string("");
+  operator_id = OI_USER;
+  function = 0;
+  setOType(OT_EMPTY);
+
+  variable = string("");
+
+  type=ET_VAL;
+    
+}
+
+void MathExpression::setValue(Value *value){
+    
+  if ( this->value )
+    delete this->value;
+
+  this->value = value;
+
+}
+
+bool MathExpression::isABlank(char c){
+
+  return ( c == ' ' || c == '\t' );
+
+}
+
+int MathExpression::skipBlanks(const char *expr, int indx){
+
+  int offset = 0;
+
+  while ( isABlank(expr[indx++]) == true )
+    offset++;
+
+  return offset;
+
+}
+
+void MathExpression::addVariablesToList(VariableList *varlist){
+
+  if ( isVariable() )
+    varlist->insert(getVariable(),new Complex(0));
+
+  if ( getRight() )
+    getRight()->addVariablesToList(varlist);
+  if ( getLeft() )
+    getLeft()->addVariablesToList(varlist);
+}
+ 
+bool MathExpression::isBuiltinOperator(char op){
+
+  char oplist[]={OPLIST};
+  const char *complist[]={COMPLIST};
+
+  for (unsigned int i=0;i<sizeof(oplist)/sizeof(char);i++)
+    if (op==oplist[i])
+      return true;
+  for (unsigned int i=0;i<sizeof(complist)/sizeof(char *);i++)
+    if (op==complist[i][0])
+      return true;
+  return false;
+}
+
+bool MathExpression::isOpenBrace(char c){
+  return ( c == '(' || c == '[' );
+}
+
+bool MathExpression::isCloseBrace(char c){
+  return ( c == ')' || c == ']' );
+}
+
+int MathExpression::copyCommaContent(char * & exprstring, const char *arg){
+
+  int br_cnt = 0, indx=0;
+  DynamicBuffer<char> buffer(BUFSIZE);
+
+  exprstring = 0;
+
+  while ( (br_cnt || (arg[indx] != ',' && !isCloseBrace(arg[indx]))) && arg[indx] ){
+
+    if ( isOpenBrace(arg[indx]) )
+      br_cnt++;
+    else if ( isCloseBrace(arg[indx]) )
+      br_cnt--;
+
+    buffer.put(arg[indx++]);
+    abs_pos++;
+
+  } 
+
+  buffer.put('\0');
+
+  exprstring = buffer.merge();
+
+  return indx;
+
+}
+
+int MathExpression::copyBracketContent( char * & exprstring, const char *arg, char open,
+					char close){
+
+  int br_cnt=0, indx=0;
+  DynamicBuffer<char> buffer(BUFSIZE);
+
+  exprstring = 0;
+
+  if ( open && (arg[indx] != open) )
+    return (-1);
+
+  do{
+
+    if ( arg[indx] == open || ( !open && !indx) ){  // auch moeglich: alles bis ...
+
+      if ( br_cnt )
+	buffer.put(arg[indx]);
+      else if ( !open && !indx )
+	buffer.put(arg[0]);
+
+      br_cnt++;
+
+    } else if (arg[indx] == close ){
+
+      br_cnt--; 
+
+      if ( br_cnt )
+	buffer.put(arg[indx]);
+
+    } else
+      buffer.put(arg[indx]);
+
+    indx++;
+    abs_pos++;
+
+  } while ( br_cnt && arg[indx] );
+
+  buffer.put('\0');
+
+  if ( br_cnt )
+    return (-1);
+
+  exprstring = buffer.merge();
+
+  return(indx);
+
+}
+  
+int MathExpression::copyFloatContent(char * & exprstring, const char *arg){
+
+  DynamicBuffer<char> buffer(BUFSIZE);
+
+  int indx=0;
+  while (checkDigit(arg[indx])){ 
+
+    buffer.put(arg[indx]);
+    indx++;
+    abs_pos++;
+
+  }
+
+  buffer.put('\0');
+
+  exprstring = buffer.merge();
+
+  return(indx);
+}
+
+int MathExpression::copyOperatorContent(char * & exprstring, const char *arg){
+
+  DynamicBuffer<char> buffer(BUFSIZE);
+  bool concat_mode = false;
+
+  int indx=0;
+
+  exprstring = 0;
+
+  switch (arg[indx]){
+  case '(':
+  case ')':
+    break;
+  default:
+    if ( checkOperator(arg[indx]) ){
+
+      buffer.put(arg[indx]);
+      indx++;
+      abs_pos++;
+
+    } else{
+ 
+      while ( arg[indx] ){ 
+
+	if ( arg[indx] == '_' )
+	  concat_mode = true;
+
+	if ( !(checkLetter(arg[indx]) || (concat_mode && checkDigit(arg[indx]))) )
+	  break;
+
+	buffer.put(arg[indx]);
+	indx++;
+	abs_pos++;
+
+      }
+    }
+
+    break;
+  }
+
+  buffer.put('\0');
+
+  exprstring = buffer.merge();
+
+  return(indx);
+}
+
+void MathExpression::clearString(char *exprstring){
+  while (*exprstring)
+    *exprstring++=0;
+}
+
+int MathExpression::priCompare(const char *c0, const char *c1){
+
+  int p[2],i;
+  const char *c[2]={ &c0[0], &c1[0] };
+
+  for ( i = 0; i < 2; i++ ){
+    switch( *c[i] ){
+    case ';':
+      p[i] = SEMICOLON_PRI;
+      break;
+    case ',':
+      p[i] = KOMMA_PRI;
+      break;
+    case '=':
+      p[i] = ( c[i][1] == '=' ? COMPARE_PRI : EQUAL_PRI );
+      break;
+    case '<':
+    case '>':
+      p[i] = COMPARE_PRI;
+      break;
+    case '+':
+    case '-':
+      p[i] = ADDSUB_PRI;
+      break;
+    case '*':
+    case '/':
+    case '\\':
+    case '%':
+      p[i] = MULTDIV_PRI;
+      break;
+    case '^':
+      p[i] = POT_PRI;
+      break;
+    case '!':
+      p[i] = ( c[i][1] == '=' ? COMPARE_PRI : FAC_PRI );
+      break;
+    case '@':
+      p[i] = BINOM_PRI;
+      break;
+    default :
+      if ( !strcmp(c[i],SUM) ){
+	p[i] = ADDSUB_PRI;
+	break;
+      } else if ( !strcmp(c[i],PROD) ){
+	p[i] = MULTDIV_PRI;
+	break;
+      } else{
+	p[i] = SIN_PRI;
+	break;
+      }
+    }
+  }
+  return ( p[0] - p[1] );
+}
+
+bool MathExpression::isPureOperator(unsigned char id){
+
+  // operators and builtin functions without side-effects
+  return ( ( id >= OI_ADD && id <= OI_CHOOSE ) || ( id >= OI_SIN && id <= OI_TST ) || ( id >= OI_LT && id <= OI_NE )
+	   || ( id >= OI_MATRIX && id <= OI_SOLVE ) );
+
+}
+
+const Complex *MathExpression::getConstant() const{
+
+  if ( isValue() || cache == CS_CONSTANT )
+    return dynamic_cast<const Complex *>(value);
+
+  return 0;
+
+}
+
+void MathExpression::foldConstant(){
+
+  if ( !isOperator() || !isPureOperator(operator_id) )
+    return;
+
+  for ( list<MathExpression *>::iterator it = elements.begin(); it != elements.end(); it++ )
+    if ( !(*it)->isValue() && (*it)->cache != CS_CONSTANT )
+      return;
+
+  // the subtree is kept for toString(), only the value is stored
+  try{
+    eval();
+  } catch (ExceptionBase &e){
+    // will be reported on evaluation
+    return;
+  }
+
+  cache = CS_CONSTANT;
+  real_path = RP_UNKNOWN;
+
+}
+
+static bool isNumber(const Complex *cmplx, cmplx_tp number){
+
+  return ( cmplx && cmplx->getRe() == number && cmplx->getIm() == 0 );
+
+}
+
+bool MathExpression::isScalar() const{
+
+  // no Integer: an identity like x*1 could make it inexact
+  if ( isValue() || cache == CS_CONSTANT ){
+
+    const Complex *constant = getConstant();
+
+    return ( constant && !constant->isExact() );
+
+  }
+
+  if ( !isOperator() )
+    return false;
+
+  switch ( operator_id ){
+
+  case OI_ADD:
+  case OI_SUB:
+  case OI_MUL:
+  case OI_DIV:
+  case OI_POW:
+    return ( getLeft() && getRight() && getLeft()->isScalar() && getRight()->isScalar() );
+  default:
+    // the builtin functions of a number and the comparisons throw for anything else
+    return ( ( operator_id >= OI_SIN && operator_id <= OI_TST ) || ( operator_id >= OI_LT && operator_id <= OI_NE ) );
+
+  }
+
+}
+
+MathExpression *MathExpression::getIdentityOperand() const{
+
+  if ( !isOperator() || cache == CS_CONSTANT || !getLeft() || !getRight() )
+    return 0;
+
+  const Complex *left = getLeft()->getConstant();
+  const Complex *right = getRight()->getConstant();
+  MathExpression *operand = 0;
+
+  // x+0 and x/1 aren't identities for x=-0: the sum is +0, the complex quotient as well
+  switch ( operator_id ){
+
+  case OI_MUL:
+    if ( isNumber(right,1) )
+      operand = getLeft();
+    else if ( isNumber(left,1) )
+      operand = getRight();
+    break;
+  case OI_SUB:
+    if ( isNumber(right,0) )
+      operand = getLeft();
+    break;
+  case OI_POW:
+    if ( isNumber(right,1) )
+      operand = getLeft();
+    break;
+  default:
+    break;
+
+  }
+
+  // tuples and matrices don't support all of these operations with a number
+  return ( operand && operand->isScalar() ? operand : 0 );
+
+}
+
+bool MathExpression::markInvariants(const char *index){
+
+  if ( isValue() || cache == CS_CONSTANT )
+    return true;
+
+  if ( isVariable() )
+    return ( strcmp(getVariable(),index) != 0 );
+
+  // a nested Sum/Prod has been processed for its own index
+  if ( !isOperator() || operator_id == OI_SUM || operator_id == OI_PROD )
+    return false;
+
+  bool invariant = isPureOperator(operator_id);
+  vector<MathExpression *> candidates;
+
+  for ( list<MathExpression *>::iterator it = elements.begin(); it != elements.end(); it++ ){
+
+    if ( (*it)->markInvariants(index) ){
+
+      if ( (*it)->isOperator() && (*it)->cache == CS_NONE )
+	candidates.push_back(*it);
+
+    } else
+      invariant = false;
+
+  }
+
+  if ( invariant )
+    return true;
+
+  // only the largest invariant subtrees are marked
+  for ( vector<MathExpression *>::iterator it = candidates.begin(); it != candidates.end(); it++ )
+    (*it)->cache = CS_INVARIANT;
+
+  return false;
+
+}
+
+bool MathExpression::checkSyntaxAndOptimize(void) throw (ParseException){
+
+  if (this->isOperator()){
+    if (checkOperator(this->oprtr[0])){
+      if (this->operator_id == OI_ASSIGN){
+	
+	if (this->getLeft() && this->getRight())
+	  if (!this->getLeft()->isEmpty() && !this->getRight()->isEmpty()){
+	    if (this->getLeft()->isVariable()){
+	      if (!this->getLeft()->getLeft() && !this->getLeft()->getRight())
+		if (this->getRight()->checkSyntaxAndOptimize())
+		  return(true);
+	    } else if (this->getLeft()->isOperator()){
+	      if (!this->getLeft()->getLeft() && this->getLeft()->getRight()){
+		
+		// 		// we have a function-defintion and we have to set the operator-type of the
+		// 		// parameter-list as  "OT_PARAMETER"
+		// 		this->getLeft()->getRight()->setOTParameter();
+
+		if (this->getRight()->checkSyntaxAndOptimize())
+		  return true;
+	      
+	      }
+	    }
+	    throw ParseException(abs_pos, "invalid syntax for assignment!");
+	  }
+      
+      } else if (this->operator_id == OI_FAC){
+	if (!this->getLeft() && this->getRight())
+	  if (!this->getRight()->isEmpty()){
+	    this->foldConstant();
+	    return (true);
+	  }
+      } else if ( this->oprtr[0] == ',' ){
+
+	if ( !this->elements.size() )
+	  throw ParseException(abs_pos, "invalid syntax: comma-operator has no arguments!");
+	for ( list<MathExpression *>::iterator it = this->elements.begin(); it != this->elements.end(); it++ )
+	  if ( (*it)->checkSyntaxAndOptimize() == false )
+	    throw ParseException(abs_pos,"invalid syntax in parameter-list!");
+
+	return true;
+	  
+      } else if (this->getLeft() && this->getRight()){
+	
+	if (!this->getLeft()->isEmpty() && !this->getRight()->isEmpty())
+	  if (this->getLeft()->checkSyntaxAndOptimize() && this->getRight()->checkSyntaxAndOptimize()){
+	    
+	    // optimization: reduction  of "({-,+}1)*({-,+}1)" to "{-,+}1"
+	    if ( this->oprtr[0] == '*' )
+	      if ( this->getLeft()->isValue() == true && this->getRight()->isValue() == true )
+		if ( Complex *left = dynamic_cast<Complex *>(this->getLeft()->getValue()) ){
+		  if ( Complex *right = dynamic_cast<Complex *>(this->getRight()->getValue()) ){
+		  
+		    if ( left->getIm() == 0 && right->getIm() == 0 ){
+		    
+		      if ( abs(left->getRe()) == 1 && abs(right->getRe()) == 1 ){
+		      
+			this->setETValue(new Complex(sgn(left->getRe()) * right->getRe()));
+		      
+			delete this->getLeft();
+			delete this->getRight();
+			this->setLeft(0);
+			this->setRight(0);
+			
+		      }
+		    }
+		  }
+		  
+		}
+
+	    this->foldConstant();
+	    
+	    return(true);
+	    
+	  }
+      }
+      
+      throw ParseException(abs_pos, "invalid syntax for binary operator!");
+
+    } else{
+
+      // so far, it was difficult to determine if a (...)-expression is a tuple or a parameterlist;
+      // that's why we decide and set it here properly
+      //       if ( this->getRight() )
+      // 	this->getRight()->setOTParameter();
+
+      if (!strcmp(this->getOperator(),"log")){
+	if (this->getLeft() && this->getRight())
+	  if (!this->getLeft()->isEmpty() && !this->getRight()->isEmpty())
+	    if (this->getLeft()->checkSyntaxAndOptimize() && this->getRight()->checkSyntaxAndOptimize()){
+	      this->foldConstant();
+	      return true;
+	    }
+	throw ParseException(abs_pos, "invalid syntax in function log!");
+      } else if (!strcmp(this->getOperator(),SUM)
+		 || !strcmp(this->getOperator(),PROD)){
+	if (this->getLeft() && this->getRight())
+	  if (!this->getLeft()->isEmpty() && !this->getRight()->isEmpty())
+	    if (this->getLeft()->oprtr[0] == ';')
+	      if (this->getLeft()->getLeft() && this->getLeft()->getRight())
+		if (!this->getLeft()->getLeft()->isEmpty() && !this->getLeft()->getRight()->isEmpty())
+		  if (this->getLeft()->getLeft()->operator_id == OI_ASSIGN){
+		    try{
+		      if (this->getLeft()->getLeft()->checkSyntaxAndOptimize())
+			if (this->getLeft()->getRight()->checkSyntaxAndOptimize())
+			  if (this->getRight()->checkSyntaxAndOptimize()){
+
+			    // subtrees not depending on the index are evaluated only once per evaluation of the Sum/Prod,
+			    // as long as the body doesn't modify any variables
+			    MathExpression *body = this->getRight();
+
+			    if ( !body->containsAssignment()
+				 && body->markInvariants(this->getLeft()->getLeft()->getLeft()->getVariable())
+				 && body->isOperator() && body->cache == CS_NONE )
+			      body->cache = CS_INVARIANT;
+
+			    return true;
+			  }
+		    } catch (ParseException &pe){
+		      throw ParseException(abs_pos, pe.getMsg() + "invalid syntax in function Sum/Prod!");
+		    }
+		  }
+	throw ParseException(abs_pos, "invalid syntax in function Sum/Prod!");
+      } else if ( this->operator_id == OI_COND ){
+	// only the chosen branch is evaluated, so cond() is never folded as a whole
+	if ( !this->getLeft() && this->getRight() )
+	  if ( this->getRight()->operator_id == OI_COMMA && this->getRight()->elements.size() == 3 )
+	    if ( this->getRight()->checkSyntaxAndOptimize() )
+	      return true;
+	throw ParseException(abs_pos, "invalid syntax in function cond: three arguments expected!");
+      } else if ( this->operator_id >= OI_MATRIX && this->operator_id <= OI_DET ){
+	// matrix((1,2),(3,4)): the arguments are the rows
+	if ( !this->getLeft() && this->getRight() )
+	  if ( this->getRight()->isEmpty() == false ){
+	    if ( this->getRight()->operator_id == OI_COMMA )
+	      this->getRight()->setOTTuple();
+	    if ( this->getRight()->checkSyntaxAndOptimize() )
+	      return true;
+	  }
+	throw ParseException(abs_pos, "invalid syntax for builtin-function!");
+      } else if ( this->operator_id == OI_SOLVE ){
+	if ( !this->getLeft() && this->getRight() )
+	  if ( this->getRight()->operator_id == OI_COMMA && this->getRight()->elements.size() == 2 )
+	    if ( this->getRight()->checkSyntaxAndOptimize() )
+	      return true;
+	throw ParseException(abs_pos, "invalid syntax in function solve: two arguments expected!");
+      } else if ( isBuiltinFunction(this->getOperator()) ){
+	if ( !this->getLeft() && this->getRight() )
+	  if ( this->getRight()->isEmpty() == false )
+	    if ( this->getRight()->checkSyntaxAndOptimize() ){
+	      this->foldConstant();
+	      return(true);
+	    }
+	throw ParseException(abs_pos, "invalid syntax for builtin-function!");
+      } else if ( bindFunction() ){
+	if ( !this->getLeft() && this->getRight() ){
+	  if ( this->getRight()->checkSyntaxAndOptimize() ){
+	    return true;
+
+	  } else
+
+	    throw ParseException(abs_pos,"invalid syntax for user-defined function: checkSyntax for right operand failed!");
+
+	} else
+	  throw ParseException(abs_pos,"invalid syntax for user-defined function: left or no right operand!");
+
+	throw ParseException(abs_pos, "invalid syntax for user-defined function!");
+
+      } else
+	return true;
+    }
+  }
+  return true;
+}
+
+void MathExpression::print(streamsize precision) const{
+  cout << toString(precision);
+}
+
+string MathExpression::toString(streamsize precision) const throw (Exception<MathExpression>,ExceptionBase){
+
+  ostringstream exp;
+
+  exp << "(";
+  if ( !this->isEmpty() ){
+    if ( this->isOperator() ){
+      if ( this->operator_id == OI_FAC ){
+
+	if (this->getRight())
+	  exp << this->getRight()->toString(precision);
+
+	exp << this->getOperator();
+
+      } else if ( this->oprtr[0] == ',' ){
+
+	for ( list<MathExpression *>::const_iterator it = elements.begin(); it != elements.end(); it++ )
+	  exp << ( it == elements.begin() ? "" : this->getOperator() ) << (*it)->toString(precision);
+
+      } else if (!strcmp(this->getOperator(),"log")
+		 || !strcmp(this->getOperator(),SUM)
+		 || !strcmp(this->getOperator(),PROD)){
+
+	exp << this->getOperator();
+	exp << "[" << this->getLeft()->toString(precision) << "]";
+	exp << this->getRight()->toString(precision);
+
+      } else{
+
+	if (this->getLeft())
+	  exp << this->getLeft()->toString(precision);
+
+	exp << this->getOperator();
+
+	if (this->getRight())
+	  exp << this->getRight()->toString(precision);
+
+      }
+    } else if (this->isVariable())
+      exp << this->getVariable();
+    else if ( this->isValue() ){
+
+      exp << this->getValue()->toString(precision);
+
+    } else
+      throw Exception<MathExpression>("internal error in MathExpression::toString()!");
+  }
+  exp << ")";
+
+  return exp.str();
+
+}
+
+string MathExpression::builtinsToString(){
+
+  ostringstream builtins;
+  
+  const char oplist[]={OPLIST};
+  const char *complist[]={COMPLIST};
+  const char *flist[]={FLIST};
+
+  for (unsigned int i=0;i<sizeof(oplist)/sizeof(char);i++)
+    builtins << oplist[i] << endl;
+
+  for (unsigned int i=0;i<sizeof(complist)/sizeof(char *);i++)
+    builtins << complist[i] << endl;
+
+  for (unsigned int i=0;i<sizeof(flist)/sizeof(char *);i++)
+    builtins << flist[i] << endl;
+
+  return builtins.str();
+
+}
+
+
+Value *MathExpression::eval() throw (ExceptionBase,FunctionDefinition){
+
+  if ( cache == CS_CONSTANT || cached )
+    return value;
+
+  // calls of user-defined functions are recorded by the program executing them
+  Profiler::Scope profiled(( Profiler::isEnabled() && isOperator() && operator_id != OI_USER ) ? getOperator() : 0);
+
+  if ( real_fastpath && isOperator() && isRealCandidate() ){
+
+    cmplx_tp re, im;
+
+    if ( evalRealOperation(re,im) ){
+
+      real_evaluations++;
+      this->setValue(new Complex(re,im));
+      cached = ( cache == CS_INVARIANT );
+      return value;
+
+    }
+
+  }
+
+  //   double result;
+  if ( isOperator() ){
+
+    switch ( operator_id ){
+
+    case OI_ADD:
+
+      this->setValue(getLeft()->eval()->operator+(getRight()->eval()));
+      break;
+
+    case OI_SUB:
+
+      this->setValue(getLeft()->eval()->operator-(getRight()->eval()));
+      break;
+
+    case OI_MUL:
+
+      this->setValue(getLeft()->eval()->operator*(getRight()->eval()));
+      break;
+
+    case OI_DIV:
+
+      this->setValue(getLeft()->eval()->operator/(getRight()->eval()));
+      break;
+
+    case OI_IDIV:
+
+      this->setValue(getLeft()->eval()->integerDivision(getRight()->eval()));
+      break;
+
+    case OI_MOD:
+
+      this->setValue(getLeft()->eval()->operator%(getRight()->eval()));
+      break;
+
+    case OI_POW:
+
+      this->setValue(getLeft()->eval()->pow(getRight()->eval()));
+      break;
+
+    case OI_FAC:
+
+      this->setValue(getRight()->eval()->faculty());
+      break;
+
+    case OI_CHOOSE:
+
+      //       return (faculty(getLeft()->eval())/(faculty(getRight()->eval())
+      // 				     *faculty(getLeft()->eval() - getRight()->eval())));
+      this->setValue(getLeft()->eval()->choose(getRight()->eval()));
+      break;
+
+    case OI_ASSIGN:
+
+      if (!getLeft() || !getRight())
+	throw EvalException("invalid use of assignment!");
+
+      if (getLeft()->isVariable()){
+
+	this->setValue(assignValue());
+	break;
+
+      } else if (getLeft()->isOperator()){
+
+	defineFunction();
+	throw FunctionDefinition(getLeft()->getOperator());
+	break;
+
+      }
+
+      throw EvalException("invalid use of assignment!");
+      break;
+
+    case OI_COMMA:
+
+      if ( this->isOTTuple() == true )
+	this->setValue(evalTupleExpression());
+      else if ( this->isOTParameter() == true )
+	throw EvalException("parameterlist can't be evaluated!");
+      else
+	throw EvalException("internal error: getOType() == OT_EMPTY!");
+	
+      break;
+
+    case OI_SIN:
+
+      this->setValue(getRight()->eval()->sin());
+      break;
+
+    case OI_COS:
+
+      this->setValue(getRight()->eval()->cos());
+      break;
+
+    case OI_TAN:
+
+      this->setValue(getRight()->eval()->tan());
+      break;
+
+    case OI_ASIN:
+
+      this->setValue(getRight()->eval()->asin());
+      break;
+
+    case OI_ACOS:
+
+      this->setValue(getRight()->eval()->acos());
+      break;
+
+    case OI_ATAN:
+
+      this->setValue(getRight()->eval()->atan());
+      break;
+
+    case OI_SINH:
+
+      this->setValue(getRight()->eval()->sinh());
+      break;
+
+    case OI_COSH:
+
+      this->setValue(getRight()->eval()->cosh());
+      break;
+
+    case OI_TANH:
+
+      this->setValue(getRight()->eval()->tanh());
+      break;
+
+    case OI_ASINH:
+
+      this->setValue(getRight()->eval()->asinh());
+      break;
+
+    case OI_ACOSH:
+
+      this->setValue(getRight()->eval()->acosh());
+      break;
+
+    case OI_ATANH:
+
+      this->setValue(getRight()->eval()->atanh());
+      break;
+
+    case OI_LN:
+
+      this->setValue(getRight()->eval()->ln());
+      break;
+
+    case OI_LD:
+
+      this->setValue(getRight()->eval()->ld());
+      break;
+
+    case OI_LOG:
+
+      this->setValue(getRight()->eval()->log(getLeft()->eval()));
+      break;
+
+    case OI_EXP:
+
+      this->setValue(getRight()->eval()->exp());
+      break;
+
+    case OI_SUM:
+    case OI_PROD:
+
+      this->setValue(sumProd());
+      break;
+
+    case OI_SGN:
+
+      this->setValue(getRight()->eval()->sgn());
+      break;
+
+    case OI_TST:
+
+      this->setValue(getRight()->eval()->tst());
+      break;
+
+    case OI_LT:
+
+      this->setValue(getLeft()->eval()->lessThan(getRight()->eval()));
+      break;
+
+    case OI_LE:
+
+      this->setValue(getLeft()->eval()->lessEqual(getRight()->eval()));
+      break;
+
+    case OI_GT:
+
+      this->setValue(getLeft()->eval()->greaterThan(getRight()->eval()));
+      break;
+
+    case OI_GE:
+
+      this->setValue(getLeft()->eval()->greaterEqual(getRight()->eval()));
+      break;
+
+    case OI_EQ:
+
+      this->setValue(getLeft()->eval()->equal(getRight()->eval()));
+      break;
+
+    case OI_NE:
+
+      this->setValue(getLeft()->eval()->notEqual(getRight()->eval()));
+      break;
+
+    case OI_COND:
+
+      this->setValue(conditional());
+      break;
+
+    case OI_MATRIX:
+
+      this->setValue(getRight()->eval()->toMatrix());
+      break;
+
+    case OI_TRANSP:
+
+      this->setValue(getRight()->eval()->transpose());
+      break;
+
+    case OI_DET:
+
+      this->setValue(getRight()->eval()->det());
+      break;
+
+    case OI_SOLVE:
+
+      this->setValue(getRight()->elements.front()->eval()->solve(getRight()->elements.back()->eval()));
+      break;
+
+    default:  // user defined function
+
+      if ( bindFunction() ){
+
+	this->setValue(evalCall());
+	break;
+
+      }
+
+      throw EvalException("unknown operator/function!",getOperator());
+
+    }
+
+  } else if ( isVariable() ){
+
+    if ( varlist )
+      this->setValue(varlist->getValue(getVariable()));
+    else
+      throw EvalException("unauthorized use of variables!");
+  }
+
+  cached = ( cache == CS_INVARIANT );
+
+  return value;
+
+}
+
+Function *MathExpression::bindFunction(){
+
+  if ( !functionlist )
+    return 0;
+
+  // the binding is renewed only if the functionlist has been modified
+  if ( !function || function_version != functionlist->getVersion() ){
+
+    function = functionlist->get(getOperator());
+    function_version = functionlist->getVersion();
+
+  }
+
+  return function;
+
+}
+
+unsigned long MathExpression::evalBatch(const vector<string> &names, const vector<const cmplx_tp *> &columns,
+					unsigned long count, cmplx_tp *re, cmplx_tp *im) throw (ExceptionBase,FunctionDefinition){
+
+  Batch batch(this,names,columns);
+
+  return batch.run(count,re,im);
+
+}
+
+void MathExpression::compile() throw (ExceptionBase){
+
+  Program *compiled = new Program(this);
+
+  delete this->program;
+  this->program = compiled;
+
+}
+
+Value *MathExpression::evalCompiled() throw (ExceptionBase,FunctionDefinition){
+
+  if ( !program || !program->isValid() )
+    compile();
+
+  this->setValue(program->run());
+
+  return value;
+
+}
+
+Value *MathExpression::evalCall() throw (ExceptionBase,FunctionDefinition){
+
+  // the call is executed by its compiled form: the functions run on frames on the heap instead of the native
+  // stack, calls in tail-position replace the frame of the caller and the bodies aren't copied per call; the
+  // depth of the calls and the calls in tail-position are limited by the Machine (see setMaxCallDepth() and
+  // setMaxTailCalls())
+  if ( !program || !program->isValid() )
+    compile();
+
+  return program->run();
+
+}
+
+Value * MathExpression::evalTupleExpression(){
+
+  Tuple *value = new Tuple(elements.size());
+
+  for ( list<MathExpression *>::const_iterator it = elements.begin(); it != elements.end(); it++ ){
+
+    Value *element = (*it)->eval();
+
+    // the result of an operator which isn't cached is computed again by the next evaluation: taken over, not copied
+    if ( (*it)->isOperator() && (*it)->cache == CS_NONE ){
+
+      (*it)->value = 0;
+      value->addElement(element);
+
+    } else
+      value->addElement(element->clone());
+
+  }
+
+  return value;
+
+}
+
+double MathExpression::sgn(double value){
+
+  if ( value < 0 )
+    return -1;
+  else
+    return 1;
+
+}
+
+double MathExpression::abs(double value){
+  return sgn(value) * value;
+}
+
+string MathExpression::skipTrailingZeros(string value){
+
+  int stop = 0;
+  int pos = 0;
+  bool pflag = false;
+
+  for ( string::iterator it = value.begin(); it != value.end(); it++, pos++ ){
+
+    if ( *it == '.' ){
+
+      pflag = true;
+      stop = pos;
+
+    } else if ( ( pflag == false ) || ( *it != '0' && pflag == true ) )
+      stop = pos+1;
+
+  }
+  
+  return value.substr(0,stop);
+
+}
+
+double MathExpression::faculty(double fac) throw (ExceptionBase){
+  
+  if ( fac != (double)((int)(fac)) || fac < 0 )
+    throw EvalException("Argument of Faculty not a natural number or negative!");
+
+  if ( fac == 0 )
+    return 1;
+
+  for ( unsigned long i = (unsigned long)fac-1; i > 0; i-- )
+    fac *= i;
+
+  return fac;
+
+}
+
+Value *MathExpression::sumProd(void) throw (ExceptionBase){
+
+  // lokaler Scope auf dem umgebenden Scope; eine Kopie ist nur noetig, wenn der Startwert Seiteneffekte hat,
+  // da er nach dem Anlegen des lokalen Scopes im umgebenden Scope ausgewertet wird
+  auto_ptr<VariableList> snapshot(this->left->left->right->containsAssignment() ? new VariableList(*this->varlist) : 0);
+  VariableList vl(snapshot.get() ? snapshot.get() : this->varlist,false);
+  MathExpression me(this,&vl,this->functionlist,abs_pos);
+  Variable *currve;
+  double from, to;
+  Value *value;
+  Complex *c_from,*c_to;
+  char p = 0;
+  
+  if ( operator_id == OI_PROD )
+    p = 1;
+  
+  // Indexvariable zum lokalen Scope hinzufuegen
+  vl.insert(this->left->left->left->getVariable(),
+	    this->left->left->right->eval()->clone());
+
+  //Zaehlbereich
+  c_from = Complex::assertNatural(vl.getValue(me.left->left->left->getVariable()));
+  c_to = Complex::assertNatural(me.left->right->eval()->clone());
+
+  from = c_from->getRe();
+  to = c_to->getRe();
+
+  delete c_from;
+  delete c_to;
+
+  if ( from != (int)from || from < 0 || to != (int)to )
+    throw EvalException("indices in Sum/Prod not natural or negative!");
+
+  if ( to < from )
+    return new Complex(0);
+
+  if ( !p )
+    value = me.right->eval()->neutralAddition();
+  else
+    value = me.right->eval()->neutralMultiplikation();
+
+  // grosse Zaehlbereiche werden parallel ausgewertet
+  if ( !sumProdParallel(value,snapshot.get() ? snapshot.get() : this->varlist,(unsigned long)from,(unsigned long)to,p) ){
+
+    for ( unsigned long i = (unsigned long)from; i <= (unsigned long)to; ){
+
+      Value::accumulate(value,me.right->eval(),p);
+
+      i++;
+
+      // neuen Wert der Zaehlvariablen eintragen
+      vl.insert(this->left->left->left->getVariable(),new Complex((cmplx_tp)i));
+
+    }
+
+  }
+
+  // neu definierte Variablen in den umgebenden Scope eintragen
+  // (bei einer Kopie alle sichtbaren Variablen)
+  auto_ptr<VariableList> visible(snapshot.get() ? new VariableList(vl) : 0);
+
+  currve = ( visible.get() ? visible->first : vl.first );
+  while ( currve ){
+
+    if ( strcmp(currve->getName(),this->left->left->left->getVariable())
+	&& !currve->getProtect() )
+      this->varlist->insert(currve->getName(),currve->getValue()->clone());
+
+    currve = currve->getNext();
+
+  }
+
+  return value;
+}
+
+// the number of partitions doesn't depend on the number of threads: the result is reproducible
+static const unsigned long SUMPROD_PARTITIONS = 64;
+
+bool MathExpression::isPartitioned(unsigned long count){
+
+  return ( parallel_threshold && count >= parallel_threshold );
+
+}
+
+unsigned long MathExpression::partitionStart(unsigned long from, unsigned long count, unsigned long partition){
+
+  unsigned long size = count/SUMPROD_PARTITIONS, rest = count%SUMPROD_PARTITIONS;
+
+  if ( partition > SUMPROD_PARTITIONS )
+    partition = SUMPROD_PARTITIONS;
+
+  return from + partition*size + ( partition < rest ? partition : rest );
+
+}
+
+/**
+   @brief evaluates the partitions of a Sum/Prod, each in a scope of its own
+   @internal
+*/
+class MathExpression::SumProdJob : public ThreadPool::Job{
+
+public:
+
+  MathExpression *body;
+  const VariableList *scope;
+  FunctionList *functionlist;
+  const char *index;
+  unsigned long from;
+  unsigned long count;
+  bool product;
+  int abs_pos;
+
+  vector<Value *> partials;
+  vector<char> failed;
+
+  SumProdJob(MathExpression *body, const VariableList *scope, FunctionList *functionlist, const char *index,
+	     unsigned long from, unsigned long to, bool product, int abs_pos)
+    : body(body), scope(scope), functionlist(functionlist), index(index), from(from), count(to - from + 1),
+      product(product), abs_pos(abs_pos), partials(SUMPROD_PARTITIONS,(Value *)0), failed(SUMPROD_PARTITIONS,0){}
+
+  ~SumProdJob(){
+
+    for ( vector<Value *>::iterator it = partials.begin(); it != partials.end(); it++ )
+      delete *it;
+
+  }
+
+  void run(unsigned long partition){
+
+    unsigned long i = partitionStart(from,count,partition), end = partitionStart(from,count,partition+1);
+    Value *partial = 0;
+
+    if ( i == end )
+      return;
+
+    try{
+
+      VariableList vl(scope,false);
+      MathExpression me(body,&vl,functionlist,abs_pos);
+
+      vl.insert(index,new Complex((cmplx_tp)i));
+
+      partial = me.eval()->clone();
+
+      for ( i++; i < end; i++ ){
+
+	vl.insert(index,new Complex((cmplx_tp)i));
+	Value::accumulate(partial,me.eval(),product);
+
+      }
+
+      partials[partition] = partial;
+
+    } catch (...){
+
+      delete partial;
+      failed[partition] = 1;
+
+    }
+
+  }
+
+};
+
+/**
+   The pool is created on first use and replaced if the number of threads has changed; a replaced pool is deleted
+   by its last user. ThreadPool::run() serializes the jobs of several threads.
+   @brief the pool for parallel evaluations while it is used
+   @internal
+*/
+class MathExpression::SharedPool{
+
+private:
+
+  ThreadPool *pool;
+
+  // copyconstructor: not for use
+  SharedPool(const SharedPool &){}
+
+public:
+
+  // no pool if only one thread is to be used
+  SharedPool(bool wanted) : pool(0){
+
+    if ( !wanted || parallel_threads < 2 || ThreadPool::isActive() )
+      return;
+
+    pthread_mutex_lock(&threadpool_lock);
+
+    if ( threadpool && threadpool->getThreads() != parallel_threads ){
+
+      if ( !threadpool_users[threadpool] ){
+
+	threadpool_users.erase(threadpool);
+	delete threadpool;
+
+      }
+
+      threadpool = 0;
+
+    }
+
+    if ( !threadpool )
+      threadpool = new ThreadPool(parallel_threads);
+
+    pool = threadpool;
+    threadpool_users[pool]++;
+
+    pthread_mutex_unlock(&threadpool_lock);
+
+  }
+
+  ~SharedPool(){
+
+    if ( !pool )
+      return;
+
+    pthread_mutex_lock(&threadpool_lock);
+
+    if ( !--threadpool_users[pool] && pool != threadpool ){
+
+      threadpool_users.erase(pool);
+      delete pool;
+
+    }
+
+    pthread_mutex_unlock(&threadpool_lock);
+
+  }
+
+  ThreadPool *get() const { return pool; }
+
+};
+
+unsigned long MathExpression::parallel_threshold = 10000;
+unsigned int MathExpression::parallel_threads = ThreadPool::getProcessors();
+ThreadPool *MathExpression::threadpool = 0;
+pthread_mutex_t MathExpression::threadpool_lock = PTHREAD_MUTEX_INITIALIZER;
+map<ThreadPool *,unsigned long> MathExpression::threadpool_users;
+unsigned long MathExpression::max_calldepth = 1000000;
+unsigned long MathExpression::max_tailcalls = 10000000;
+
+bool MathExpression::sumProdParallel(Value *&value, const VariableList *scope, unsigned long from, unsigned long to,
+				     bool product){
+
+  if ( !isPartitioned(to - from + 1) )
+    return false;
+
+  // assignments and the cache of memoized functions would be shared by the partitions
+  if ( this->right->containsAssignment() || ( functionlist && functionlist->isMemoization() ) )
+    return false;
+
+  SharedPool shared(true);
+  ThreadPool *pool = shared.get();
+  SumProdJob job(this->right,scope,functionlist,this->left->left->left->getVariable(),from,to,product,abs_pos);
+
+  // without a pool the partitions are evaluated one after the other, the result is the same
+  if ( pool )
+    pool->run(job,SUMPROD_PARTITIONS);
+  else
+    for ( unsigned long partition = 0; partition < SUMPROD_PARTITIONS; partition++ )
+      job.run(partition);
+
+  for ( vector<char>::iterator it = job.failed.begin(); it != job.failed.end(); it++ )
+    if ( *it )
+      return false;
+
+  // combining in the order of the partitions
+  for ( vector<Value *>::iterator it = job.partials.begin(); it != job.partials.end(); it++ ){
+
+    if ( *it )
+      Value::accumulate(value,*it,product);
+
+  }
+
+  return true;
+
+}
+
+unsigned long MathExpression::tabulate(const char *name, const Grid &grid, TableWriter &writer) throw (ExceptionBase){
+
+  // fails e.g. for protected variables
+  VariableList probe(varlist,false);
+
+  probe.insert(name,new Complex(0));
+
+  Program program(this);
+  Tabulation tabulation(program,varlist,name,grid,containsAssignment());
+  unsigned long tiles = ( grid.getSize() + Tabulation::TILESIZE - 1 ) / Tabulation::TILESIZE;
+  SharedPool shared(tiles > 1);
+  ThreadPool *pool = shared.get();
+  unsigned long failures = 0;
+
+  writer.begin(grid,name);
+
+  for ( unsigned long first = 0, count; first < tiles; first += count ){
+
+    count = ( tiles - first < Tabulation::TILES ? tiles - first : Tabulation::TILES );
 
-    case '%':
+    failures += tabulation.evaluate(pool,first,count);
+    tabulation.write(writer,count);
 
-      this->setValue(getLeft()->eval()->operator%(getRight()->eval()));
-      break;
+  }
 
-    case '^':
+  writer.end();
 
-      this->setValue(getLeft()->eval()->pow(getRight()->eval()));
-      break;
+  return failures;
 
-    case '!':
+}
 
-      this->setValue(getRight()->eval()->faculty());
-      break;
+Value *MathExpression::conditional(void) throw (ExceptionBase){
 
-    case '@':
+  list<MathExpression *>::iterator it = this->getRight()->elements.begin();
 
-      //       return (faculty(getLeft()->eval())/(faculty(getRight()->eval())
-      // 				     *faculty(getLeft()->eval() - getRight()->eval())));
-      this->setValue(getLeft()->eval()->choose(getRight()->eval()));
-      break;
+  // only the chosen branch is evaluated
+  if ( !Complex::isTrue((*it)->eval()) )
+    it++;
 
-    case '=':
+  return (*(++it))->eval()->clone();
 
-      if (getLeft()->isVariable()){
+}
 
-	this->setValue(assignValue());
-	break;
+Value *MathExpression::assignValue(void) throw (ExceptionBase){
 
-      } else if (getLeft()->isOperator()){
+  Value *result;
 
-	defineFunction();
-	throw FunctionDefinition(getLeft()->getOperator());
-	break;
+  result = getRight()->eval()->clone();
 
-      }
+  if ( functionlist )
+    if ( functionlist->isMember(getLeft()->getOperator()) )
+      throw EvalException ("variable already defined as function");
 
-      throw EvalException("invalid use of assignment!");
-      break;
+  if ( varlist ){
 
-    case ',':
+    try{
 
-      if ( this->isOTTuple() == true )
-	this->setValue(evalTupleExpression());
-      else if ( this->isOTParameter() == true )
-	throw EvalException("parameterlist can't be evaluated!");
-      else
-	throw EvalException("internal error: getOType() == OT_EMPTY!");
-	
-      break;
+      varlist->insert(getLeft()->getVariable(),result);
 
-    default:
-      if (!strcmp("sin",getOperator()))
-        this->setValue(getRight()->eval()->sin());
-      else if (!strcmp("cos",getOperator()))
-	this->setValue(getRight()->eval()->cos());
-      else if (!strcmp("tan",getOperator()))
-	this->setValue(getRight()->eval()->tan());
-      else if (!strcmp("asin",getOperator()))
-	this->setValue(getRight()->eval()->asin());
-      else if (!strcmp("acos",getOperator()))
-	this->setValue(getRight()->eval()->acos());
-      else if (!strcmp("atan",getOperator()))
-	this->setValue(getRight()->eval()->atan());
-      else if (!strcmp("sinh",getOperator()))
-	this->setValue(getRight()->eval()->sinh());
-      else if (!strcmp("cosh",getOperator()))
-	this->setValue(getRight()->eval()->cosh());
-      else if (!strcmp("tanh",getOperator()))
-	this->setValue(getRight()->eval()->tanh());
-      else if (!strcmp("asinh",getOperator()))
-	this->setValue(getRight()->eval()->asinh());
-      else if (!strcmp("acosh",getOperator()))
-	this->setValue(getRight()->eval()->acosh());
-      else if (!strcmp("atanh",getOperator()))
-	this->setValue(getRight()->eval()->atanh());
-      else if (!strcmp("ln",getOperator())){
+    }catch ( OutOfMemException &oome ){
 
-	this->setValue(getRight()->eval()->ln());
+      delete varlist;
+      throw OutOfMemException();
 
-      } else if (!strcmp("ld",getOperator())){
+    }
 
-	this->setValue(getRight()->eval()->ld());
+    varlist->setModified(true);
+    return result->clone();
 
-      } else if (!strcmp("log",getOperator())){
+  }
 
-	this->setValue(getRight()->eval()->log(getLeft()->eval()));
+  throw EvalException("invalid use of assignment!");
 
-      } else if (!strcmp("exp",getOperator()))
+}
 
-	this->setValue(getRight()->eval()->exp());
+bool MathExpression::real_fastpath = true;
+__thread unsigned long MathExpression::real_evaluations = 0;
 
-      else if (!strcmp(SUM,getOperator()) || !strcmp(PROD,getOperator())){
+bool MathExpression::isRealOperation() const {
 
-	this->setValue(sumProd());
+  if ( !isOperator() )
+    return false;
 
-      } else if (!strcmp("sgn",getOperator())){
+  switch ( operator_id ){
+
+  case OI_ADD:
+  case OI_SUB:
+  case OI_MUL:
+  case OI_DIV:
+  case OI_IDIV:
+  case OI_MOD:
+  case OI_POW:
+  case OI_CHOOSE:
+  case OI_LOG:
+  case OI_LT:
+  case OI_LE:
+  case OI_GT:
+  case OI_GE:
+  case OI_EQ:
+  case OI_NE:
+
+    return ( getLeft() && getRight() );
+
+  case OI_FAC:
+  case OI_SIN:
+  case OI_COS:
+  case OI_TAN:
+  case OI_ASIN:
+  case OI_ACOS:
+  case OI_ATAN:
+  case OI_SINH:
+  case OI_COSH:
+  case OI_TANH:
+  case OI_ASINH:
+  case OI_ACOSH:
+  case OI_ATANH:
+  case OI_LN:
+  case OI_LD:
+  case OI_EXP:
+  case OI_SGN:
+  case OI_TST:
+
+    return ( !getLeft() && getRight() );
 
-	this->setValue(getRight()->eval()->sgn());
+  default:
+    // assignments, tuples, Sum/Prod and user-defined functions
+    return false;
 
-      } else if (!strcmp("tst",getOperator())){
+  }
 
-	this->setValue(getRight()->eval()->tst());
+}
 
-      } else{  // user defined function
+bool MathExpression::isRealCandidate(){
 
-	if (functionlist){
-	  if (functionlist->isMember(getOperator())){
+  // the tree doesn't change after parsing: the state is determined once
+  if ( real_path != RP_UNKNOWN )
+    return ( real_path == RP_CANDIDATE );
 
-	    this->setValue(evalFunction());
-	    break;
+  real_path = RP_NONE;
 
-	  }
-	}
+  if ( isVariable() ){
 
-	throw EvalException("unknown operator/function!",getOperator());
+    // checked on evaluation
+    real_path = RP_CANDIDATE;
 
-      }
+  } else if ( isValue() || cache == CS_CONSTANT ){
 
-      break;
+    const Complex *cmplx = getConstant();
 
-    }
+    if ( cmplx && cmplx->isReal() && !cmplx->isExact() )
+      real_path = RP_CANDIDATE;
 
-  } else if ( isVariable() ){
+  } else if ( isRealOperation() && ( !getLeft() || getLeft()->isRealCandidate() ) && getRight()->isRealCandidate() ){
+
+    real_path = RP_CANDIDATE;
 
-    if ( varlist )
-      this->setValue(varlist->getValue(getVariable()));
-    else
-      throw EvalException("unauthorized use of variables!");
   }
 
-  return value;
+  return ( real_path == RP_CANDIDATE );
 
 }
 
-Value * MathExpression::evalTupleExpression(){
+bool MathExpression::evalReal(cmplx_tp &re, cmplx_tp &im){
 
-  Tuple *value = new Tuple();
+  // The operations are carried out with the same formulas as by the methods of Complex. Apart from the real part
+  // the imaginary part is kept, it is always (signed) zero. Returns false if a subtree is not real-valued or if the
+  // generic evaluation would throw an exception.
 
-  for ( list<MathExpression *>::const_iterator it = elements.begin(); it != elements.end(); it++ )
-    value->addElement((*it)->eval()->clone());
+  if ( isValue() || cache == CS_CONSTANT ){
 
-  return value;
+    const Complex *cmplx = getConstant();
 
-}
+    re = cmplx->getRe();
+    im = cmplx->getIm();
+    return true;
 
-double MathExpression::sgn(double value){
+  }
 
-  if ( value < 0 )
-    return -1;
-  else
-    return 1;
+  // evaluated only once per Sum/Prod
+  if ( cache == CS_INVARIANT ){
 
-}
+    const Complex *cmplx;
 
-double MathExpression::abs(double value){
-  return sgn(value) * value;
-}
+    try{
+      cmplx = dynamic_cast<const Complex *>(eval());
+    } catch (ExceptionBase &e){
+      return false;
+    }
 
-string MathExpression::skipTrailingZeros(string value){
+    if ( !cmplx || !cmplx->isReal() || cmplx->isExact() )
+      return false;
 
-  int stop = 0;
-  int pos = 0;
-  bool pflag = false;
+    re = cmplx->getRe();
+    im = cmplx->getIm();
+    return true;
 
-  for ( string::iterator it = value.begin(); it != value.end(); it++, pos++ ){
+  }
 
-    if ( *it == '.' ){
+  if ( isVariable() ){
 
-      pflag = true;
-      stop = pos;
+    const Variable *ve = ( varlist ? varlist->isMember(getVariable()) : 0 );
+    const Complex *cmplx = ( ve ? dynamic_cast<const Complex *>(ve->getValue()) : 0 );
 
-    } else if ( ( pflag == false ) || ( *it != '0' && pflag == true ) )
-      stop = pos+1;
+    if ( !cmplx || !cmplx->isReal() || cmplx->isExact() )
+      return false;
+
+    re = cmplx->getRe();
+    im = cmplx->getIm();
+    return true;
 
   }
-  
-  return value.substr(0,stop);
+
+  return evalRealOperation(re,im);
 
 }
 
-double MathExpression::faculty(double fac) throw (ExceptionBase){
-  
-  if ( fac != (double)((int)(fac)) || fac < 0 )
-    throw EvalException("Argument of Faculty not a natural number or negative!");
+bool MathExpression::evalRealOperation(cmplx_tp &re, cmplx_tp &im){
 
-  if ( fac == 0 )
-    return 1;
+  cmplx_tp lre = 0, lim = 0, rre, rim;
 
-  for ( unsigned long i = (unsigned long)fac-1; i > 0; i-- )
-    fac *= i;
+  if ( getLeft() && !getLeft()->evalReal(lre,lim) )
+    return false;
 
-  return fac;
+  if ( !getRight()->evalReal(rre,rim) )
+    return false;
+
+  return realOperation(operator_id,lre,lim,rre,rim,re,im);
 
 }
 
-Value *MathExpression::sumProd(void) throw (ExceptionBase){
+bool MathExpression::realOperation(unsigned char id, cmplx_tp lre, cmplx_tp lim, cmplx_tp rre, cmplx_tp rim,
+				   cmplx_tp &re, cmplx_tp &im){
 
-  VariableList vl = *this->varlist;  // lokaler Scope: Kopie der globalen Varlist
-  MathExpression me(this,&vl,this->functionlist,abs_pos);
-  Variable *currve;
-  double from, to;
-  Value *value;
-  Complex *c_from,*c_to;
-  char p = 0;
-  
-  if ( !strcmp(PROD,this->getOperator()) )
-    p = 1;
-  
-  // Indexvariable zum lokalen Scope hinzufuegen
-  vl.insert(this->left->left->left->getVariable(),
-	    this->left->left->right->eval()->clone());
+  cmplx_tp divisor, fac;
+  complex<cmplx_tp> result;
+  complex<cmplx_tp> arg(rre,rim);
 
-  //Zaehlbereich
-  c_from = Complex::assertNatural(vl.getValue(me.left->left->left->getVariable()));
-  c_to = Complex::assertNatural(me.left->right->eval()->clone());
+  switch ( id ){
 
-  from = c_from->getRe();
-  to = c_to->getRe();
+  case OI_ADD:
+    result = complex<cmplx_tp>(lre + rre,lim + rim);
+    break;
+  case OI_SUB:
+    result = complex<cmplx_tp>(lre - rre,lim - rim);
+    break;
+  case OI_MUL:
+    result = complex<cmplx_tp>(lre*rre - lim*rim,lre*rim + lim*rre);
+    break;
+  case OI_DIV:
+  case OI_IDIV:
+  case OI_MOD:
 
-  if ( from != (int)from || from < 0 || to != (int)to )
-    throw EvalException("indices in Sum/Prod not natural or negative!");
+    if ( (divisor = ::pow(rre,2) + ::pow(rim,2)) == 0 )
+      return false;
 
-  if ( to < from )
-    return 0;
+    result = complex<cmplx_tp>((lre*rre + lim*rim)/divisor,(lim*rre - lre*rim)/divisor);
 
-  if ( !p )
-    value = me.right->eval()->neutralAddition();
-  else
-    value = me.right->eval()->neutralMultiplikation();
+    if ( id != OI_DIV )
+      result = complex<cmplx_tp>(::floor(result.real()),::floor(result.imag()));
 
-  for ( unsigned long i = (unsigned long)from; i <= (unsigned long)to; ){
+    // this - right*quotient
+    if ( id == OI_MOD )
+      result = complex<cmplx_tp>(lre - (rre*result.real() - rim*result.imag()),lim - (rre*result.imag() + rim*result.real()));
 
-    if ( !p )
-      (*value) += me.right->eval();  // Summe
-    else
-      (*value) *= me.right->eval();  // Produkt
+    break;
+  case OI_POW:
+    if ( !Complex::multiplyPower(complex<cmplx_tp>(lre,lim),arg,result) )
+      result = std::pow(complex<cmplx_tp>(lre,lim),arg);
+    break;
+  case OI_FAC:
 
-    i++;
+    // larger faculties are exact integers
+    if ( !isNatural(rre) || rre > Integer::MAX_DOUBLE_FACULTY )
+      return false;
 
-    // neuen Wert der Zaehlvariablen eintragen
-    vl.insert(this->left->left->left->getVariable(),new Complex((cmplx_tp)i));
+    fac = ( rre == 0 ? 1 : rre );
 
-  }
+    for ( unsigned long i = (unsigned long)fac-1; i > 0; i-- )
+      fac *= (cmplx_tp)i;
 
-  // neu definierte Variablen in globale Varlist eintragen
-  currve = vl.first;
-  while ( currve ){
+    result = fac;
+    break;
+  case OI_CHOOSE:
 
-    if ( strcmp(currve->getName(),this->left->left->left->getVariable())
-	&& !currve->getProtect() )
-      this->varlist->insert(currve->getName(),currve->getValue()->clone());
+    // faculty() throws for negative arguments
+    if ( !isNatural(lre) || !isNatural(rre) || rre > lre || lre > Integer::MAX_DOUBLE_FACULTY )
+      return false;
 
-    currve = currve->getNext();
+    result = faculty(lre) / ( faculty(rre) * faculty(lre - rre) );
+    break;
+  case OI_SIN:
+    result = std::sin(arg);
+    break;
+  case OI_COS:
+    result = std::cos(arg);
+    break;
+  case OI_TAN:
+    result = std::tan(arg);
+    break;
+  case OI_SINH:
+    result = std::sinh(arg);
+    break;
+  case OI_COSH:
+    result = std::cosh(arg);
+    break;
+  case OI_TANH:
+    result = std::tanh(arg);
+    break;
+  case OI_EXP:
+    result = std::exp(arg);
+    break;
+  case OI_LN:
+    result = std::log(arg);
+    break;
+  case OI_LD:
+    result = std::log(arg)/std::log((cmplx_tp)2.0);
+    break;
+  case OI_LOG:
+    result = std::log(arg)/std::log(complex<cmplx_tp>(lre,lim));
+    break;
+  case OI_ASIN:
+    result = ::asin(rre);
+    break;
+  case OI_ACOS:
+    result = ::acos(rre);
+    break;
+  case OI_ATAN:
+    result = ::atan(rre);
+    break;
+  case OI_ASINH:
+    result = ::asinh(rre);
+    break;
+  case OI_ACOSH:
+    result = ::acosh(rre);
+    break;
+  case OI_ATANH:
+    result = ::atanh(rre);
+    break;
+  case OI_SGN:
+    result = ( rre < 0 ? -1 : 1 );
+    break;
+  case OI_TST:
+    result = ( rre != 0 or rim != 0 );
+    break;
+  case OI_LT:
+  case OI_LE:
+  case OI_GT:
+  case OI_GE:
+
+    // complex numbers can't be ordered: Complex throws
+    if ( lim != 0 || rim != 0 )
+      return false;
+
+    if ( id == OI_LT )
+      result = ( lre < rre );
+    else if ( id == OI_LE )
+      result = ( lre <= rre );
+    else if ( id == OI_GT )
+      result = ( lre > rre );
+    else
+      result = ( lre >= rre );
 
+    break;
+  case OI_EQ:
+    result = ( lre == rre and lim == rim );
+    break;
+  case OI_NE:
+    result = ( lre != rre or lim != rim );
+    break;
+  default:
+    return false;
   }
 
-  return value;
+  re = result.real();
+  im = result.imag();
+
+  return ( im == 0 );
+
 }
 
-Value *MathExpression::assignValue(void) throw (ExceptionBase){
+bool MathExpression::appendKey(string &key, const Value *value){
 
-  Value *result;
+  // the approximation of an Integer is ambiguous
+  if ( const Integer *integer = dynamic_cast<const Integer *>(value) ){
 
-  result = getRight()->eval()->clone();
+    size_t size = integer->getDigits().size();
 
-  if ( functionlist )
-    if ( functionlist->isMember(getLeft()->getOperator()) )
-      throw EvalException ("variable already defined as function");
+    key += ( integer->isNegative() ? 'Z' : 'z' );
+    key.append((const char *)&size,sizeof(size));
 
-  if ( varlist ){
+    if ( size )
+      key.append((const char *)&integer->getDigits()[0],size*sizeof(uint32_t));
 
-    try{
+    return true;
 
-      varlist->insert(getLeft()->getVariable(),result);
+  }
 
-    }catch ( OutOfMemException &oome ){
+  if ( const Complex *cmplx = dynamic_cast<const Complex *>(value) ){
 
-      delete varlist;
-      throw OutOfMemException();
+    cmplx_tp number[2] = { cmplx->getRe(), cmplx->getIm() };
 
-    }
+    key += 'c';
+    key.append((const char *)number,sizeof(number));
+    return true;
 
-    varlist->setModified(true);
-    return result->clone();
+  }
+
+  if ( const Tuple *tuple = dynamic_cast<const Tuple *>(value) ){
+
+    key += '(';
+
+    for ( vector<Value *>::const_iterator it = tuple->elements.begin(); it != tuple->elements.end(); it++ )
+      if ( !appendKey(key,*it) )
+	return false;
+
+    key += ')';
+    return true;
 
   }
 
-  throw EvalException("invalid use of assignment!");
+  return false;
 
 }
 
-Value *MathExpression::evalFunction(void) throw (ExceptionBase){
+const vector<string> &MathExpression::getFreeVariables(Function *function, const FunctionList *fl){
+
+  if ( !function->free_known ){
 
-  VariableList vl = *this->varlist; // local scope
-  Function *function = functionlist->get(this->getOperator());
+    set<string> names;
 
-  vl.unprotect();  // remove protection-status for all variables
+    function->collecting = true;
+    collectFreeVariables(function->getBody(),function,fl,names);
+    function->collecting = false;
 
-  // assign values to all variables occuring in function-head and add them to local scope
-  if ( this->getRight()->isOperator() and this->getRight()->isOTParameter() )
-    // parameterlist
-    assignVariablesInFunctionhead(vl,function->getParameterList(),this->getRight());
-  else // all others
-    assignVariablesInFunctionhead(vl,function->getParameterList(),this->getRight()->eval());
+    function->freevariables.assign(names.begin(),names.end());
+    function->free_known = true;
 
-  // build an instance of the function-template
-  MathExpression functioncall(function->getBody(),&vl,functionlist,abs_pos);
+  }
 
-  // eval the function
-  return functioncall.eval()->clone();
+  return function->freevariables;
 
 }
 
-void MathExpression::assignVariablesInFunctionhead(VariableList & vl, MathExpression * parameter, Value * argument) throw (ExceptionBase){
+bool MathExpression::isBoundIn(const string &name, Function *function){
 
-  // if it's a variable it can be assigned directly
-  if ( parameter->isVariable() )
-    vl.insert(parameter->getVariable(), argument->clone());
+  return ( ( function->paramlist && function->paramlist->isVariableInTree(name.c_str()) )
+	   || function->locals.find(name) != function->locals.end() );
 
-  else{
-    // a tuple of variables
-    
-    Tuple * arguments = Tuple::assertTuple(argument);
+}
 
-    list<MathExpression *>::iterator pit;
-    list<Value *>::iterator ait;
+void MathExpression::collectFreeVariables(const MathExpression *node, Function *function, const FunctionList *fl,
+					  set<string> &names){
 
-    for ( pit = parameter->elements.begin(), ait = arguments->elements.begin();
-	  pit != parameter->elements.end();
-	  pit++, ait++ ){
-      
-      if ( ait == arguments->elements.end() )
-	throw EvalException(string("no matching argument to parameter: ") + (*pit)->toString(Value::DFLT_PRECISION) + "!");
+  if ( node->isVariable() ){
 
-      // recursive assigment
-      assignVariablesInFunctionhead(vl,(*pit),(*ait));
+    if ( !isBoundIn(node->getVariable(),function) )
+      names.insert(node->getVariable());
 
-    }
+  } else if ( node->isOperator() ){
 
-    if ( ait != arguments->elements.end() )
-      throw EvalException("too many arguments for function!");
-  }
+    // a called function reads its free variables from the scope of the body
+    Function *callee = fl->get(node->getOperator());
 
-}
+    if ( callee && !callee->collecting ){
 
-void MathExpression::assignVariablesInFunctionhead(VariableList & vl, MathExpression * parameters, MathExpression * arguments) throw (ExceptionBase){
+      const vector<string> &calleevariables = getFreeVariables(callee,fl);
+
+      for ( vector<string>::const_iterator it = calleevariables.begin(); it != calleevariables.end(); it++ )
+	if ( !isBoundIn(*it,function) )
+	  names.insert(*it);
 
-  // if it's a variable it can be assigned directly
-  if ( parameters->isVariable() and ( not arguments->isOperator() or not arguments->isOTParameter()) )
-    vl.insert(parameters->getVariable(), arguments->eval()->clone());
-  
-  else {
-    
-    list<MathExpression *>::iterator pit;
-    list<MathExpression *>::iterator ait;
-    
-    for ( pit = parameters->elements.begin(), ait = arguments->elements.begin();
-	  pit != parameters->elements.end();
-	  pit++, ait++ ){
-      
-      if ( ait == arguments->elements.end() )
-	throw EvalException(string("no matching argument to parameter: ") + (*pit)->toString(Value::DFLT_PRECISION) + "!");
-      
-      // recursive assigment
-      assignVariablesInFunctionhead(vl,(*pit),(*ait));
-      
     }
-    
-    if ( ait != arguments->elements.end() )
-      throw EvalException("too many arguments for function!");
-    
+
   }
-  
+
+  for ( list<MathExpression *>::const_iterator it = node->elements.begin(); it != node->elements.end(); it++ )
+    collectFreeVariables(*it,function,fl,names);
+
 }
 
 void MathExpression::defineFunction(void) throw (EvalException,ParseException){
@@ -2643,6 +5998,7 @@ void MathExpression::defineFunction(void) throw (EvalException,ParseException){
   MathExpression *paramlist=0, *body=0;
   Function *fe=0;
   VariableList locals;
+  bool pure=true;
 
   functionname = this->getLeft()->getOperator();
   
@@ -2681,7 +6037,7 @@ void MathExpression::defineFunction(void) throw (EvalException,ParseException){
   try{
     
     // body must only contain defined variables/functions/operators
-    checkBody(body,paramlist,&locals);
+    checkBody(body,paramlist,&locals,pure);
     
   } catch (EvalException e){
     
@@ -2693,18 +6049,26 @@ void MathExpression::defineFunction(void) throw (EvalException,ParseException){
   
   // build functionelement
   fe = new Function(functionname,paramlist,body);
+
+  fe->pure = pure;
+  for ( VariableList::iterator it = locals.begin(); it != locals.end(); it++ )
+    fe->locals.insert((*it).getName());
   
   functionlist->insert(fe); // insert in functionlist;
 
+  // parameters are resolved to slots once, calls only bind the arguments
+  fe->program = new Program(fe,functionlist);
+
   functionlist->setModified(true);
   
 }
 
 void MathExpression::checkBody(MathExpression *body, MathExpression *pl,
-			       VariableList *lvl) const throw(EvalException){
+			       VariableList *lvl, bool &pure) const throw(EvalException){
 
   // pl: parameterTree
   // lvl: local VariableList
+  // pure: set to false if a global variable is assigned
 
   bool inparam=false;
   
@@ -2712,10 +6076,12 @@ void MathExpression::checkBody(MathExpression *body, MathExpression *pl,
     return;
 
   if (*(body->getOperator())){
+    // the function being defined may call itself
     if (!(isBuiltinOperator(*(body->getOperator()))))
       if (!(isBuiltinFunction(body->getOperator())))
 	if (!(functionlist->isMember(body->getOperator())))
-	  throw EvalException("undefined operator:",body->getOperator());
+	  if (strcmp(body->getOperator(),this->getLeft()->getOperator()))
+	    throw EvalException("undefined operator:",body->getOperator());
   } else if (*(body->getVariable())){
     if (pl)
       if (pl->isVariableInTree(body->getVariable()))
@@ -2726,23 +6092,37 @@ void MathExpression::checkBody(MathExpression *body, MathExpression *pl,
 	  if (!body->getPred())
 	    throw EvalException("variable undefined:",body->getVariable());
 	  else{
-	    if ( (body->getPred()->getOperator())[0] != '=' )
+	    if ( body->getPred()->operator_id != OI_ASSIGN )
 	      throw EvalException("variable undefined:",body->getVariable());
 	    else
 	      lvl->insert(body->getVariable(),new Complex(0));
 	  }
 	}
-      }
+      } else if ( body->getPred() && body->getPred()->operator_id == OI_ASSIGN && body->getPred()->getLeft() == body
+		  && !isSumProdIndex(body) )
+	pure = false;
     }
   }
 
   for ( list<MathExpression *>::const_iterator it = body->elements.begin(); it != body->elements.end(); it++ )
-    checkBody(*it,pl,lvl);
+    checkBody(*it,pl,lvl,pure);
   
   return;
   
 }
 
+bool MathExpression::isSumProdIndex(const MathExpression *variable){
+
+  // Sum/Prod[<index>=<from>;<to>](<body>)
+  const MathExpression *assignment = variable->getPred();
+  const MathExpression *range = ( assignment ? assignment->getPred() : 0 );
+  const MathExpression *sumprod = ( range ? range->getPred() : 0 );
+
+  return ( sumprod && sumprod->isOperator() && ( sumprod->operator_id == OI_SUM || sumprod->operator_id == OI_PROD )
+	   && sumprod->getLeft() == range && range->getLeft() == assignment && assignment->getLeft() == variable );
+
+}
+
 bool MathExpression::checkForVariableTree() const {
 
   set< string,less<string> > variableset;
@@ -2789,6 +6169,19 @@ bool MathExpression::isVariableInTree(const char *name) const {
 
 }
     
+bool MathExpression::containsAssignment() const {
+
+  if ( isOperator() && operator_id == OI_ASSIGN )
+    return true;
+
+  for ( list<MathExpression *>::const_iterator it = elements.begin(); it != elements.end(); it++ )
+    if ( (*it)->containsAssignment() )
+      return true;
+
+  return false;
+
+}
+
 unsigned int MathExpression::countArgs(void){
 
   if ( this->isEmpty() )
@@ -39,9 +39,16 @@
 #include <math.h>
 #include <string>
 #include <list>
+#include <vector>
+#include <memory>
 #include <set>
+#include <map>
+#include <algorithm>
 #include <functional>
 #include <complex>
+#include <typeinfo>
+#include <pthread.h>
+#include <stdint.h>
 #include <fztooltempl/exception.hpp>
 #include <fztooltempl/datastructures.hpp>
 
@@ -58,6 +65,12 @@ namespace mexp{
   class Value;
   class Tuple;
   class Complex;
+  class Integer;
+  class Program;
+  class Machine;
+  class ThreadPool;
+  class Grid;
+  class TableWriter;
 
   class FunctionDefinition {
 
@@ -137,12 +150,98 @@ namespace mexp{
     }
   };
 
+  /**
+     Values and variables are allocated from free-lists of a few size-classes. Once the pools are filled an
+     evaluation doesn't need the general-purpose heap for its intermediate values anymore. Every thread has pools
+     and counters of its own, memory may be released by another thread than the allocating one.
+     @brief pool-allocator for values and variables
+     @since V2.1
+  */
+  class Pool{
+
+  private:
+
+    static const size_t GRANULARITY = 16;
+    static const size_t CLASSES = 8;
+
+    static bool enabled;
+    static __thread unsigned long requests;
+    static __thread unsigned long heap_allocations;
+
+    static __thread ds::FixedSizePool *pools[CLASSES];
+
+    // the pools of all threads, for releasing memory while disabled
+    static pthread_mutex_t registry_lock;
+    static std::vector<ds::FixedSizePool *> *registry;
+
+    // the pools of exited threads, taken over by the next threads instead of creating new ones
+    static std::vector<ds::FixedSizePool *> *orphans;
+    static pthread_once_t exit_once;
+    static pthread_key_t exit_key;
+
+    static void createExitKey();
+    static void orphan(void *threadpools);
+    static ds::FixedSizePool *create(size_t sizeclass);
+    static ds::FixedSizePool *owner(void *memory, size_t sizeclass);
+
+  public:
+
+    /**
+       Sizes larger than the biggest size-class are taken from the heap.
+       @brief allocates memory
+       @param size the size in bytes
+       @return the memory
+    */
+    static void *allocate(size_t size);
+
+    /**
+       @brief gives memory back
+       @param memory the memory
+       @param size the size that has been requested by allocate()
+    */
+    static void release(void *memory, size_t size);
+
+    /**
+       If disabled, all memory is taken from the heap.
+       @brief enables or disables the pools
+       @param enabled true for enabling
+    */
+    static void setEnabled(bool enabled){ Pool::enabled = enabled; }
+
+    /**
+       @brief returns true if the pools are enabled
+       @return true if enabled
+    */
+    static bool isEnabled(){ return enabled; }
+
+    /**
+       @brief returns the number of allocations of the calling thread since the last resetStatistics()
+       @return the number of allocations
+    */
+    static unsigned long getRequests(){ return requests; }
+
+    /**
+       @brief returns the number of allocations of the calling thread which needed the heap since the last resetStatistics()
+       @return the number of heap-allocations
+    */
+    static unsigned long getHeapAllocations(){ return heap_allocations; }
+
+    /**
+       @brief resets the counters of the calling thread
+    */
+    static void resetStatistics(){ requests = 0; heap_allocations = 0; }
+
+  };
+
   class Value{
 
   public:
 
     static const std::streamsize DFLT_PRECISION = 6;
 
+    static void *operator new(size_t size){ return Pool::allocate(size); }
+    static void operator delete(void *memory, size_t size){ Pool::release(memory,size); }
+
   protected:
     
     Value *notSupported() const throw (exc::ExceptionBase) { throw EvalException("not supported!"); }
@@ -151,6 +250,17 @@ namespace mexp{
 
     virtual ~Value(){}
 
+    /**
+       The accumulator is combined with the value in place if both are of the same type, otherwise it is replaced
+       by the sum or product, e.g. when a Sum of numbers grows into an exact integer.
+       @brief adds or multiplies a value to the accumulator of a Sum/Prod
+       @param accumulator the accumulator
+       @param value the value
+       @param product true for multiplying
+       @exception ExceptionBase
+    */
+    static void accumulate(Value *&accumulator, Value *value, bool product) throw (exc::ExceptionBase);
+
     virtual std::string toString(std::streamsize precision) const = 0;
     std::string toString() const { return toString(DFLT_PRECISION); }
 
@@ -188,15 +298,31 @@ namespace mexp{
     virtual Value *exp() throw (exc::ExceptionBase){ return notSupported(); }
     virtual Value *sgn() throw (exc::ExceptionBase){ return notSupported(); }
     virtual Value *tst() throw (exc::ExceptionBase){ return notSupported(); }
+    virtual Value *lessThan(Value *right) throw (exc::ExceptionBase){ return notSupported(); }
+    virtual Value *lessEqual(Value *right) throw (exc::ExceptionBase){ return notSupported(); }
+    virtual Value *greaterThan(Value *right) throw (exc::ExceptionBase){ return notSupported(); }
+    virtual Value *greaterEqual(Value *right) throw (exc::ExceptionBase){ return notSupported(); }
+    virtual Value *equal(Value *right) throw (exc::ExceptionBase){ return notSupported(); }
+    virtual Value *notEqual(Value *right) throw (exc::ExceptionBase){ return notSupported(); }
+    virtual Value *toMatrix() throw (exc::ExceptionBase){ return notSupported(); }
+    virtual Value *transpose() throw (exc::ExceptionBase){ return notSupported(); }
+    virtual Value *det() throw (exc::ExceptionBase){ return notSupported(); }
+    virtual Value *solve(Value *right) throw (exc::ExceptionBase){ return notSupported(); }
 
   };
 
+  /**
+     The elements are kept in one contiguous array and are owned by the tuple.
+     @brief a tuple of values
+  */
   class Tuple : public Value{
 
   public:
 
-    std::list<Value *> elements;
+    std::vector<Value *> elements;
 
+    Tuple(){}
+    explicit Tuple(size_t size){ elements.reserve(size); }
     ~Tuple();
 
     static Tuple *assertTuple(Value *value) throw(EvalException);
@@ -210,6 +336,12 @@ namespace mexp{
 
     Value *operator+(Value *right) throw (exc::ExceptionBase);
 
+    // by the matrix built from the tuple
+    Value *toMatrix() throw (exc::ExceptionBase);
+    Value *transpose() throw (exc::ExceptionBase);
+    Value *det() throw (exc::ExceptionBase);
+    Value *solve(Value *right) throw (exc::ExceptionBase);
+
   };
 
   typedef double cmplx_tp;
@@ -217,6 +349,7 @@ namespace mexp{
   class Complex : public Value, public std::complex<cmplx_tp>{
 
     friend class MathExpression;
+    friend class Machine;
 
   private:
 
@@ -224,6 +357,25 @@ namespace mexp{
     static Complex *assertReal(Value *value) throw(EvalException,exc::ExceptionBase);
     static Complex *assertInteger(Value *value) throw(EvalException,exc::ExceptionBase);
     static Complex *assertNatural(Value *value) throw(EvalException,exc::ExceptionBase);
+
+    // the truth-value of a condition: true if the value is not 0
+    static bool isTrue(Value *value) throw(EvalException,exc::ExceptionBase);
+
+    // true if the operation with <right> is carried out by an Integer
+    bool isExactWith(const Complex *right) const { return ( right->isExact() && !isExact() && isIntegral() ); }
+
+    // the largest exponent for which a power is calculated by multiplications
+    static const int MAX_MULTIPLIED_EXPONENT = 64;
+
+    // the number as mantissa*2^exponent, an Integer beyond the range of a double keeps its magnitude
+    virtual std::complex<cmplx_tp> getScaled(int &exponent) const { exponent = 0; return *this; }
+
+    // left*right or left/right with an Integer as operand, the result under- or overflows as a double would
+    static Value *scaledOperation(const Complex *left, const Complex *right, bool divide) throw (EvalException);
+
+    // base^exponent for real integer exponents from 1 to MAX_MULTIPLIED_EXPONENT by multiplications
+    static bool multiplyPower(const std::complex<cmplx_tp> &base, const std::complex<cmplx_tp> &exponent,
+			      std::complex<cmplx_tp> &result);
     
   public:
     
@@ -244,6 +396,10 @@ namespace mexp{
     cmplx_tp getRe() const { return std::complex<cmplx_tp>::real(); }
     cmplx_tp getIm() const { return std::complex<cmplx_tp>::imag(); }
     bool isReal() const { return ( getIm() == 0 ); }
+    bool isIntegral() const { return ( isReal() && getRe() == ::floor(getRe()) && getRe() - getRe() == 0 ); }
+
+    // true for an Integer: the complex part is only an approximation then
+    virtual bool isExact() const { return false; }
 
     Value *operator+(Value *right) throw (exc::ExceptionBase);
     Value *operator-(Value *right) throw (exc::ExceptionBase);
@@ -274,6 +430,208 @@ namespace mexp{
     Value *exp() throw (exc::ExceptionBase);
     Value *sgn() throw (exc::ExceptionBase);
     Value *tst() throw (exc::ExceptionBase);
+    Value *lessThan(Value *right) throw (exc::ExceptionBase);
+    Value *lessEqual(Value *right) throw (exc::ExceptionBase);
+    Value *greaterThan(Value *right) throw (exc::ExceptionBase);
+    Value *greaterEqual(Value *right) throw (exc::ExceptionBase);
+    Value *equal(Value *right) throw (exc::ExceptionBase);
+    Value *notEqual(Value *right) throw (exc::ExceptionBase);
+    Value *toMatrix() throw (exc::ExceptionBase);
+
+  };
+
+  /**
+     The magnitude is stored in limbs of nine decimal digits, the least significant first, the inherited complex
+     part holds an approximation (or infinity) for the operations without an exact counterpart; products and
+     quotients with other numbers are computed from mantissa and exponent, so 1/200! underflows to 0 instead of
+     becoming nan. Faculties and
+     binomial coefficients beyond the precision of a double are computed as Integer, with the product of their
+     prime powers by binary splitting and large products by Karatsuba-multiplication. Results fitting into the
+     mantissa of a double are returned as Complex.
+     @brief an exact integer of arbitrary size
+  */
+  class Integer : public Complex{
+
+  public:
+
+    typedef std::vector<uint32_t> Digits;
+
+    // the base of a limb
+    static const uint32_t BASE = 1000000000;
+
+    // the largest argument whose faculty is exact as a double
+    static const unsigned long MAX_DOUBLE_FACULTY = 18;
+
+    // the largest argument of a faculty
+    static const unsigned long MAX_FACULTY = 1000000;
+
+  private:
+
+    bool negative;
+    Digits digits;
+
+    // recalculates the approximation
+    void update();
+
+    std::complex<cmplx_tp> getScaled(int &exponent) const;
+
+    // the operand as an integer, <buffer> holds a converted Complex; 0 if not integral
+    static const Integer *operand(Value *value, Integer &buffer);
+
+    // the number as an Integer or, if fitting into the mantissa of a double, as a Complex
+    static Value *create(bool negative, Digits &digits);
+
+    static int compare(const Integer *left, const Integer *right);
+
+    // the sum of left and right with the sign of right inverted for subtraction
+    static Value *add(const Integer *left, const Integer *right, bool subtract);
+
+    // floor-division and the remainder with the sign of the divisor
+    static void divide(const Integer *left, const Integer *right, Integer &quotient, Integer &remainder)
+      throw (EvalException);
+
+  public:
+
+    Integer() : negative(false){}
+
+    /**
+       @brief converts a finite integral number
+       @param number the number
+    */
+    explicit Integer(cmplx_tp number);
+
+    /**
+       @brief builds an integer from its limbs
+       @param negative the sign
+       @param digits the limbs, the least significant first
+    */
+    Integer(bool negative, const Digits &digits);
+
+    ~Integer(){}
+
+    /**
+       @brief the faculty computed from the prime factorization
+       @param n the argument
+       @return the faculty
+       @exception EvalException if n exceeds MAX_FACULTY
+    */
+    static Value *factorial(unsigned long n) throw (EvalException);
+
+    /**
+       @brief the binomial coefficient
+       @param n the upper argument
+       @param k the lower argument, not larger than n
+       @return the binomial coefficient
+       @exception EvalException if n and k are too large
+    */
+    static Value *binomial(unsigned long n, unsigned long k) throw (EvalException);
+
+    bool isExact() const { return true; }
+    bool isNegative() const { return negative; }
+    const Digits &getDigits() const { return digits; }
+
+    std::string toString(std::streamsize precision) const;
+
+    Value *clone() const { return new Integer(*this); }
+
+    Value *operator+(Value *right) throw (exc::ExceptionBase);
+    Value *operator-(Value *right) throw (exc::ExceptionBase);
+    Value *operator*(Value *right) throw (exc::ExceptionBase);
+    Value *operator/(Value *right) throw (exc::ExceptionBase);
+    void operator+=(Value *right) throw (exc::ExceptionBase);
+    void operator*=(Value *right) throw (exc::ExceptionBase);
+    Value *integerDivision(Value *right) throw (exc::ExceptionBase);
+    Value *operator%(Value *right) throw (exc::ExceptionBase);
+    Value *pow(Value *right) throw (exc::ExceptionBase);
+    Value *faculty() throw (exc::ExceptionBase);
+    Value *choose(Value *right) throw (exc::ExceptionBase);
+    Value *sgn() throw (exc::ExceptionBase);
+    Value *lessThan(Value *right) throw (exc::ExceptionBase);
+    Value *lessEqual(Value *right) throw (exc::ExceptionBase);
+    Value *greaterThan(Value *right) throw (exc::ExceptionBase);
+    Value *greaterEqual(Value *right) throw (exc::ExceptionBase);
+    Value *equal(Value *right) throw (exc::ExceptionBase);
+    Value *notEqual(Value *right) throw (exc::ExceptionBase);
+
+  };
+
+  /**
+     The entries are stored row by row, the real and the imaginary parts in arrays of their own, so the loops of
+     the kernels can be vectorized by the compiler. Products are computed in blocks fitting into the cache, large
+     products by getParallelThreads() threads (see MathExpression::setParallelThreads()). A matrix is built from
+     a tuple of rows or, as a column, from a tuple of numbers and printed as a tuple of rows.
+     @brief a dense matrix of complex numbers
+  */
+  class Matrix : public Value{
+
+  private:
+
+    size_t rows;
+    size_t columns;
+    std::vector<cmplx_tp> re;
+    std::vector<cmplx_tp> im;
+
+    // the edge of the square blocks of a product
+    static const size_t BLOCK = 64;
+
+    // the minimal number of multiplications of a product computed in parallel
+    static const size_t PARALLEL_WORK = 1 << 21;
+
+    class Stripe;
+
+    static void *multiplyStripe(void *stripe);
+
+    bool isReal() const;
+    void assertSize(const Matrix *right, const char *operation) const throw (EvalException);
+    void assertSquare(const char *operation) const throw (EvalException);
+
+    // LU-decomposition with partial pivoting in place, returns the sign of the permutation or 0 if singular
+    static int decompose(std::vector< std::complex<cmplx_tp> > &lu, std::vector<size_t> &permutation, size_t n);
+
+    Matrix *multiply(const Matrix *right) const;
+    Matrix *scale(const std::complex<cmplx_tp> &factor) const;
+
+  public:
+
+    Matrix(size_t rows, size_t columns) : rows(rows), columns(columns), re(rows*columns,0), im(rows*columns,0){}
+    ~Matrix(){}
+
+    static Matrix *assertMatrix(Value *value) throw (EvalException);
+
+    /**
+       @brief builds a matrix from a tuple of rows of equal length or a column from a tuple of numbers
+       @param tuple the tuple
+       @return the matrix
+       @exception EvalException
+    */
+    static Matrix *fromTuple(const Tuple *tuple) throw (EvalException);
+
+    size_t getRows() const { return rows; }
+    size_t getColumns() const { return columns; }
+    std::complex<cmplx_tp> get(size_t row, size_t column) const {
+      return std::complex<cmplx_tp>(re[row*columns+column],im[row*columns+column]);
+    }
+    void set(size_t row, size_t column, const std::complex<cmplx_tp> &entry){
+      re[row*columns+column] = entry.real();
+      im[row*columns+column] = entry.imag();
+    }
+
+    std::string toString(std::streamsize precision) const;
+
+    Value *clone() const { return new Matrix(*this); }
+
+    Value *neutralAddition() const;
+    Value *neutralMultiplikation() const;
+
+    Value *operator+(Value *right) throw (exc::ExceptionBase);
+    Value *operator-(Value *right) throw (exc::ExceptionBase);
+    Value *operator*(Value *right) throw (exc::ExceptionBase);
+    void operator+=(Value *right) throw (exc::ExceptionBase);
+    void operator*=(Value *right) throw (exc::ExceptionBase);
+    Value *toMatrix() throw (exc::ExceptionBase){ return clone(); }
+    Value *transpose() throw (exc::ExceptionBase);
+    Value *det() throw (exc::ExceptionBase);
+    Value *solve(Value *right) throw (exc::ExceptionBase);
 
   };
  
@@ -281,6 +639,12 @@ namespace mexp{
      @brief for evaluating easy-to-write mathematical expressions
   */
   class MathExpression {
+
+    friend class Program;
+    friend class Machine;
+    friend class Batch;
+    friend class Spreadsheet;
+    friend class Snapshot;
     
   public:
     
@@ -293,6 +657,7 @@ namespace mexp{
     static const int SEMICOLON_PRI = 1;
     static const int EQUAL_PRI = 2;
     static const int KOMMA_PRI = 5;
+    static const int COMPARE_PRI = 7;
     static const int ADDSUB_PRI = 10;
     static const int MULTDIV_PRI = 15;
     static const int SIN_PRI = 20;
@@ -312,8 +677,77 @@ namespace mexp{
     static const unsigned char OT_OPERATION = 2;
     static const unsigned char OT_PARAMETER = 3;
     static const unsigned char OT_TUPLE = 4;
+
+    // operator-ids: resolved once by setETOperator(), eval() dispatches on them
+    static const unsigned char OI_USER = 0;
+    static const unsigned char OI_ADD = 1;
+    static const unsigned char OI_SUB = 2;
+    static const unsigned char OI_MUL = 3;
+    static const unsigned char OI_DIV = 4;
+    static const unsigned char OI_IDIV = 5;
+    static const unsigned char OI_MOD = 6;
+    static const unsigned char OI_POW = 7;
+    static const unsigned char OI_FAC = 8;
+    static const unsigned char OI_CHOOSE = 9;
+    static const unsigned char OI_ASSIGN = 10;
+    static const unsigned char OI_COMMA = 11;
+    static const unsigned char OI_SIN = 12;
+    static const unsigned char OI_COS = 13;
+    static const unsigned char OI_TAN = 14;
+    static const unsigned char OI_ASIN = 15;
+    static const unsigned char OI_ACOS = 16;
+    static const unsigned char OI_ATAN = 17;
+    static const unsigned char OI_SINH = 18;
+    static const unsigned char OI_COSH = 19;
+    static const unsigned char OI_TANH = 20;
+    static const unsigned char OI_ASINH = 21;
+    static const unsigned char OI_ACOSH = 22;
+    static const unsigned char OI_ATANH = 23;
+    static const unsigned char OI_LN = 24;
+    static const unsigned char OI_LD = 25;
+    static const unsigned char OI_LOG = 26;
+    static const unsigned char OI_EXP = 27;
+    static const unsigned char OI_SGN = 28;
+    static const unsigned char OI_TST = 29;
+    static const unsigned char OI_SUM = 30;
+    static const unsigned char OI_PROD = 31;
+    static const unsigned char OI_LT = 32;
+    static const unsigned char OI_LE = 33;
+    static const unsigned char OI_GT = 34;
+    static const unsigned char OI_GE = 35;
+    static const unsigned char OI_EQ = 36;
+    static const unsigned char OI_NE = 37;
+    static const unsigned char OI_COND = 38;
+    static const unsigned char OI_MATRIX = 39;
+    static const unsigned char OI_TRANSP = 40;
+    static const unsigned char OI_DET = 41;
+    static const unsigned char OI_SOLVE = 42;
+
+    // states of the real-valued fast path (see isRealCandidate())
+    static const char RP_UNKNOWN = 0;
+    static const char RP_CANDIDATE = 1;
+    static const char RP_NONE = 2;
+
+    // cached results (see checkSyntaxAndOptimize())
+    static const char CS_NONE = 0;
+    static const char CS_CONSTANT = 1;
+    static const char CS_INVARIANT = 2;
     
   private:
+
+    static bool real_fastpath;
+    static __thread unsigned long real_evaluations;
+
+    static unsigned long parallel_threshold;
+    static unsigned int parallel_threads;
+    static ThreadPool *threadpool;
+    static pthread_mutex_t threadpool_lock;
+    static std::map<ThreadPool *,unsigned long> threadpool_users;
+
+    static unsigned long max_calldepth;
+    static unsigned long max_tailcalls;
+
+    class SumProdJob;
     
     // ###################################################
     // # instantiated with defaults in constructor-calls #
@@ -342,6 +776,15 @@ namespace mexp{
     */
     unsigned char operator_type;
 
+    /**
+       @brief id of the operator (if expression is an operator)
+    */
+    unsigned char operator_id;
+
+    // the user-defined function bound to the operator, valid while function_version equals the version of functionlist
+    Function *function;
+    unsigned long function_version;
+
     // absolute position in expression-string
     int abs_pos;
 
@@ -350,6 +793,17 @@ namespace mexp{
     // if set no pointer will be destroyed on destructor-call
     bool delete_flat;
 
+    // the compiled form of the expression (see compile())
+    Program *program;
+
+    // whether the subtree may be evaluated by evalReal()
+    char real_path;
+
+    // constant subtrees keep the value computed while parsing, loop-invariant subtrees of a Sum/Prod keep it
+    // while the Sum/Prod is evaluated
+    char cache;
+    bool cached;
+
     //                                                    #
     //                                                    #
     // ####################################################
@@ -360,12 +814,23 @@ namespace mexp{
     // for n-ary operators (like ',')
     std::list<MathExpression *> elements;
     
-    MathExpression *parse(const char *expr, VariableList& locals) throw (ParseException,exc::ExceptionBase);
+    class Source;
+    class Part;
+
+    // parses the part [begin,end) of the source
+    MathExpression *parse(Source &source, int begin, int end, VariableList& locals) throw (ParseException,exc::ExceptionBase);
 
-    int parseCommaOperator(const char *expr, int e_indx, MathExpression * & ActualNode, MathExpression * & PrevNode,
+    int parseCommaOperator(Source &source, int e_indx, MathExpression * & ActualNode, MathExpression * & PrevNode,
 			   MathExpression * & TopNode, VariableList & locals) throw (ParseException, exc::ExceptionBase);
     void searchAndSetLowerPriNode(MathExpression * & ActualNode, MathExpression * & PrevNode, MathExpression * & TopNode);
-    int determineAndSetOperatorOrVariable(const char *expr, int e_indx, MathExpression * & ActualNode, const FunctionList *functionlist);
+    int determineAndSetOperatorOrVariable(Source &source, int e_indx, MathExpression * & ActualNode, const FunctionList *functionlist);
+    int parseVariable(Source &source, int e_indx, MathExpression *node);
+
+    // skip...Content() return the length of the content at indx (like copy...Content()), -1 if a bracket is missing
+    int skipBracketContent(const Source &source, int indx, char open);
+    int skipCommaContent(const Source &source, int indx);
+    int skipFloatContent(const char *expr, int indx);
+    int skipOperatorContent(const char *expr, int indx);
     
     // erases the elements of a n-ary operator
     void eraseElements();
@@ -375,12 +840,44 @@ namespace mexp{
     static int priCompare(const char *c0, const char *c1);
     bool checkSyntaxAndOptimize(void) throw (ParseException);
     Value *sumProd(void) throw (exc::ExceptionBase);
+    bool sumProdParallel(Value *&value, const VariableList *scope, unsigned long from, unsigned long to, bool product);
+
+    // a Sum/Prod over <count> indices is accumulated in partitions (also by the compiled program)
+    static bool isPartitioned(unsigned long count);
+
+    // the first index of a partition, the end of the range for the partitions after the last one
+    static unsigned long partitionStart(unsigned long from, unsigned long count, unsigned long partition);
+
+    // the pool for parallel evaluations while it is used
+    class SharedPool;
     Value *assignValue(void) throw (exc::ExceptionBase);
-    Value *evalFunction(void) throw (exc::ExceptionBase);
+    Value *conditional(void) throw (exc::ExceptionBase);
+    Value *evalCall(void) throw (exc::ExceptionBase,FunctionDefinition);
+    bool isRealOperation() const;
+    bool isRealCandidate();
+    bool evalReal(cmplx_tp &re, cmplx_tp &im);
+    bool evalRealOperation(cmplx_tp &re, cmplx_tp &im);
+    static bool realOperation(unsigned char id, cmplx_tp lre, cmplx_tp lim, cmplx_tp rre, cmplx_tp rim,
+			      cmplx_tp &re, cmplx_tp &im);
+    static bool isPureOperator(unsigned char id);
+    const Complex *getConstant() const;
+    void foldConstant();
+    bool isScalar() const;
+    MathExpression *getIdentityOperand() const;
+    bool markInvariants(const char *index);
+    static bool isNatural(cmplx_tp number){ return ( number == (double)((int)number) && number >= 0 ); }
+    Function *bindFunction();
     void defineFunction(void) throw (EvalException,ParseException);
-    void checkBody(MathExpression *body, MathExpression *pl, VariableList *lvl) const throw(EvalException);
+    void checkBody(MathExpression *body, MathExpression *pl, VariableList *lvl, bool &pure) const throw(EvalException);
+    static bool isSumProdIndex(const MathExpression *variable);
+    static const std::vector<std::string> &getFreeVariables(Function *function, const FunctionList *fl);
+    static bool isBoundIn(const std::string &name, Function *function);
+    static void collectFreeVariables(const MathExpression *node, Function *function, const FunctionList *fl,
+				     std::set<std::string> &names);
+    static bool appendKey(std::string &key, const Value *value);
     bool isEmpty(void) const { return ( getEType() == ET_EMPTY ); }
     void setETOperator(const char *name);
+    void setETOperator(const char *name, unsigned char id);
     void setETVariable(const char *name);
     void setETValue(Value *value);
     
@@ -399,6 +896,15 @@ namespace mexp{
     */
     unsigned char getOType() const { return operator_type; }
 
+    /**
+       @brief returns the operator-id
+       @return the operator-id
+    */
+    unsigned char getOperatorId() const { return operator_id; }
+
+    // returns the id of an operator- or function-name
+    static unsigned char resolveOperator(const char *name);
+
     /**
        @brief sets the expression-type
     */
@@ -447,13 +953,13 @@ namespace mexp{
     
     // isVariableInTree checks, if a given variable-name is defined as variable in tree
     bool isVariableInTree(const char *name) const;
+
+    // checks if an assignment occurs in the tree
+    bool containsAssignment() const;
     
     // countArgs functions only with a correct (syntax!) tree!
     unsigned int countArgs(void);
 
-    void assignVariablesInFunctionhead(VariableList & vl, MathExpression * parameter, Value * argument) throw (exc::ExceptionBase);
-    void assignVariablesInFunctionhead(VariableList & vl, MathExpression * parameters, MathExpression * arguments) throw (exc::ExceptionBase);
-    
     // private constructor:
     MathExpression(int abs_pos, VariableList *vl = 0, FunctionList *fl = 0);
     // private copyconstructor: not for use
@@ -519,6 +1025,150 @@ namespace mexp{
     */
     Value *eval() throw (exc::ExceptionBase,FunctionDefinition);
 
+    /**
+       The expression and all user-defined functions called from it are lowered into a flat bytecode-program.
+       @brief compiles the expression
+       @exception ExceptionBase
+       @see evalCompiled()
+    */
+    void compile() throw (exc::ExceptionBase);
+
+    /**
+       Executes the compiled form of the expression. The expression will be (re-)compiled if it has not been compiled
+       yet or if the FunctionList has been modified since. The result is the same as the result of eval().
+       @brief evaluates the compiled expression
+       @return the result
+       @exception EvalException
+       @exception OutOfMemException
+    */
+    Value *evalCompiled() throw (exc::ExceptionBase,FunctionDefinition);
+
+    /**
+       Evaluates the expression once for each element of the columns: the i-th evaluation binds the variable names[j]
+       to columns[j][i]. Instead of walking the tree for every element, the tree is walked once per block of
+       elements and every node operates on the whole block. The results are the same as the results of eval();
+       assignments within the expression only affect the evaluation of the same element, the VariableList is not
+       modified.
+       @brief evaluates the expression for many values of some variables
+       @param names the names of the variables
+       @param columns the values of the variables, one array of at least <count> values per name
+       @param count the number of evaluations
+       @param re receives the real parts of the results
+       @param im receives the imaginary parts of the results, may be 0 if all results are real
+       @return the number of elements which couldn't be evaluated blockwise (e.g. as they aren't real-valued)
+       @exception EvalException if an evaluation fails, if a result is a tuple or if im is 0 and a result is not real
+    */
+    unsigned long evalBatch(const std::vector<std::string> &names, const std::vector<const cmplx_tp *> &columns,
+			    unsigned long count, cmplx_tp *re, cmplx_tp *im = 0) throw (exc::ExceptionBase,FunctionDefinition);
+
+    /**
+       Evaluates the compiled expression at every point of the grid, the variable name being bound to the point
+       in a local scope of its own. The points are evaluated in tiles of consecutive points by getParallelThreads()
+       threads; only a bounded number of tiles is held at the same time, the results are passed to the writer in the
+       order of the grid. The VariableList is not modified. Several threads may tabulate at the same time, their
+       tiles are evaluated one job after the other by the shared pool of threads.
+       @brief evaluates the expression over a range or a rectangle of the complex plane
+       @param name the name of the variable
+       @param grid the points
+       @param writer receives the results
+       @return the number of points which couldn't be evaluated or whose result is a tuple (result nan)
+       @exception EvalException if the variable can't be defined or the writer fails
+    */
+    unsigned long tabulate(const char *name, const Grid &grid, TableWriter &writer) throw (exc::ExceptionBase);
+
+    /**
+       @brief returns the compiled form of the expression
+       @return the program or 0 if not compiled
+    */
+    const Program *getProgram() const { return program; }
+
+    /**
+       If enabled, eval() computes subtrees of arithmetic operators and builtin functions on plain numbers without
+       allocating intermediate values, as long as all operands and results are real. Otherwise, e.g. for ln(-1),
+       the subtree is evaluated as usual. The results are the same in both modes.
+       @brief enables or disables the real-valued fast path
+       @param enabled true for enabling (default)
+    */
+    static void setRealFastPath(bool enabled){ real_fastpath = enabled; }
+
+    /**
+       @brief returns true if the real-valued fast path is enabled
+       @return true if enabled
+    */
+    static bool isRealFastPath(){ return real_fastpath; }
+
+    /**
+       @brief returns the number of subtrees evaluated by the real-valued fast path in the calling thread since the last resetStatistics()
+       @return the number of evaluations
+    */
+    static unsigned long getRealEvaluations(){ return real_evaluations; }
+
+    /**
+       @brief resets the counter of the real-valued fast path
+    */
+    static void resetStatistics(){ real_evaluations = 0; }
+
+    /**
+       Sum/Prod over at least <threshold> indices are split into a fixed number of partitions, which are
+       evaluated in parallel, each in a scope of its own. The partial results are combined in the order of the
+       partitions, so the result doesn't depend on the number of threads: with one thread, within a parallel
+       evaluation and in compiled programs the partitions are accumulated in the same way one after the other. As
+       the order of the operations differs from a sequential evaluation, the result may differ in the last digits
+       for non-integral values.
+       Bodies containing assignments and evaluations with memoization enabled are evaluated sequentially. If the
+       evaluation of a partition fails, the Sum/Prod is evaluated sequentially again to raise the same exception.
+       @brief sets the minimal number of indices for evaluating Sum/Prod in parallel
+       @param threshold the number of indices, 0 disables parallel evaluation
+    */
+    static void setParallelThreshold(unsigned long threshold){ parallel_threshold = threshold; }
+
+    /**
+       @brief returns the minimal number of indices for evaluating Sum/Prod in parallel
+       @return the number of indices, 0 if disabled
+    */
+    static unsigned long getParallelThreshold(){ return parallel_threshold; }
+
+    /**
+       @brief sets the number of threads for evaluating Sum/Prod in parallel
+       @param threads the number of threads including the evaluating thread, default is the number of processors
+    */
+    static void setParallelThreads(unsigned int threads){ parallel_threads = threads; }
+
+    /**
+       @brief returns the number of threads for evaluating Sum/Prod in parallel
+       @return the number of threads
+    */
+    static unsigned int getParallelThreads(){ return parallel_threads; }
+
+    /**
+       A recursion without a base case, e.g. "f(x)=f(x-1)+1", is stopped by an EvalException "recursion too deep!"
+       instead of using up the memory. Calls in tail-position replace the frame of the caller and don't count (see
+       setMaxTailCalls()), a Sum/Prod being evaluated counts as a call.
+       @brief sets the maximal number of nested function-calls of an evaluation
+       @param depth the number of calls, default is 1000000
+    */
+    static void setMaxCallDepth(unsigned long depth){ max_calldepth = depth; }
+
+    /**
+       @brief returns the maximal number of nested function-calls of an evaluation
+       @return the number of calls
+    */
+    static unsigned long getMaxCallDepth(){ return max_calldepth; }
+
+    /**
+       A recursion in tail-position without a base case, e.g. "f(x)=f(x+1)", doesn't grow and is stopped by an
+       EvalException "too many calls in tail-position!" instead of running forever.
+       @brief sets the maximal number of calls in tail-position of an evaluation
+       @param calls the number of calls, default is 10000000
+    */
+    static void setMaxTailCalls(unsigned long calls){ max_tailcalls = calls; }
+
+    /**
+       @brief returns the maximal number of calls in tail-position of an evaluation
+       @return the number of calls
+    */
+    static unsigned long getMaxTailCalls(){ return max_tailcalls; }
+
     /**
        @brief returns the signum of the value
        @param value the value
@@ -646,11 +1296,16 @@ namespace mexp{
     char *name;
     char protect;
     Variable *next;
+    unsigned long hash;
     
     // copyconstructor: not for use
     Variable(const Variable&){}
     
   public:
+
+    static void *operator new(size_t size){ return Pool::allocate(size); }
+    static void operator delete(void *memory, size_t size){ Pool::release(memory,size); }
+
     // constructor:
     /**
        @exception OutOfMemException
@@ -665,6 +1320,19 @@ namespace mexp{
     void setProtect(char protect){ this->protect = protect; }
 
     char *getName() const { return name; }
+
+    /**
+       @brief returns the hash-value of the name
+       @return the hash-value
+    */
+    unsigned long getHash() const { return hash; }
+
+    /**
+       @brief computes the hash-value of a name
+       @param name the name
+       @return the hash-value
+    */
+    static unsigned long hashName(const char *name);
     
     /**
        @brief returns a pointer to the value
@@ -690,6 +1358,29 @@ namespace mexp{
     Variable *last;
 
     bool modified;
+
+    // open-addressing hash-index (linear probing) over the list, built when the list becomes larger than
+    // INDEX_THRESHOLD; the capacity is always a power of 2
+    Variable **index;
+    unsigned long capacity;
+    unsigned long count;
+
+    // the enclosing scope if the list is a local scope
+    const VariableList *parent;
+    bool unprotecting;
+    unsigned long depth;
+
+    static const unsigned long INDEX_THRESHOLD = 8;
+
+    // statistics, counted per thread
+    static __thread unsigned long allocations;
+    static __thread unsigned long max_depth;
+
+    void append(const char *name, Value *value, char protect) throw (exc::ExceptionBase);
+    void addToIndex(Variable *ve);
+    void rebuildIndex(unsigned long capacity);
+    Variable *find(const char *name) const;
+    char visibleProtection(const char *name) const;
     
     
   public:
@@ -720,10 +1411,22 @@ namespace mexp{
     };
     
     // constructor:
-    VariableList() : first(0), last(0), modified(false){}
+    VariableList() : first(0), last(0), modified(false), index(0), capacity(0), count(0),
+		     parent(0), unprotecting(false), depth(0){}
+
+    /**
+       Creates a local scope on top of an enclosing scope. All variables of the enclosing scopes are visible,
+       but they will never be modified: an assignment creates a local variable. Only the local variables are
+       iterated and printed.
+       @brief creates a local scope
+       @param parent the enclosing scope
+       @param unprotect if true, the protected variables of the enclosing scopes can be redefined locally
+    */
+    VariableList(const VariableList *parent, bool unprotect);
 
     // copyconstructor:
     /**
+       A local scope is copied with all visible variables of its enclosing scopes.
        @exception EvalException
        @exception OutOfMemException
     */
@@ -747,6 +1450,36 @@ namespace mexp{
     */
     Value *getValue(const char *name) const throw (exc::ExceptionBase);
     Variable *isMember(const char *name) const;
+
+    /**
+       @brief returns the number of variables
+       @return the number of (local) variables
+    */
+    unsigned long size() const { return count; }
+
+    /**
+       @brief returns the nesting-depth of a local scope
+       @return the number of enclosing scopes
+    */
+    unsigned long getDepth() const { return depth; }
+
+    /**
+       @brief returns the number of variables allocated by all lists of the calling thread since the last resetStatistics()
+       @return the number of allocations
+    */
+    static unsigned long getAllocations(){ return allocations; }
+
+    /**
+       @brief returns the maximal nesting-depth of local scopes of the calling thread since the last resetStatistics()
+       @return the maximal depth
+    */
+    static unsigned long getMaxDepth(){ return max_depth; }
+
+    /**
+       @brief resets the allocation- and depth-counters
+    */
+    static void resetStatistics(){ allocations = 0; max_depth = 0; }
+
     void unprotect(const char *name=0);
     void print(std::streamsize precision) const;    
     std::string toString(const bool include_protected, std::streamsize precision) const;
@@ -775,15 +1508,38 @@ namespace mexp{
   class Function{
     
     friend class FunctionList;
+    friend class MathExpression;
+    friend class Program;
+    friend class Machine;
+    friend class Snapshot;
     
   private:
     char *name;
     MathExpression *paramlist;
     MathExpression *body;
     Function *next;
+
+    // the body compiled at definition-time, linked into the programs calling the function
+    Program *program;
+
+    // memoization: the results are kept in least-recently-used order, the key consists of the arguments and
+    // the values of the free variables, which are read from the calling scope
+    bool pure;
+    std::set<std::string> locals;
+    std::vector<std::string> freevariables;
+    bool free_known;
+    bool collecting;
+    std::list< std::pair<std::string,Value *> > results;
+    std::map< std::string,std::list< std::pair<std::string,Value *> >::iterator > memo;
+    unsigned long hits;
+    unsigned long misses;
     
     // copyconstructor: not for use
     Function(const Function& fe){}
+
+    Value *lookup(const std::string &key);
+    void store(const std::string &key, Value *result, unsigned long limit);
+    void forget();
     
   public:
     // constructor:
@@ -794,6 +1550,31 @@ namespace mexp{
     char *getName(void) const{ return name; }
     MathExpression *getParameterList(void){ return paramlist; }
     MathExpression *getBody(void){ return body; }
+
+    /**
+       A function is pure if its body doesn't assign global variables. Only pure functions are memoized.
+       @brief tests if the function is pure
+       @return true, if pure
+    */
+    bool isPure() const { return pure; }
+
+    /**
+       @brief returns the number of calls answered from the memo
+       @return the number of hits
+    */
+    unsigned long getHits() const { return hits; }
+
+    /**
+       @brief returns the number of memoized calls which had to be evaluated
+       @return the number of misses
+    */
+    unsigned long getMisses() const { return misses; }
+
+    /**
+       @brief returns the number of memoized results
+       @return the number of results
+    */
+    unsigned long getMemoSize() const { return results.size(); }
   };
   
   /**
@@ -802,20 +1583,37 @@ namespace mexp{
      @internal
   */
   class FunctionList{
+
+    friend class Snapshot;
     
   private:
     Function *first;
     Function *last;
 
+    // the functions by name, for get() and isMember() not to walk the list
+    std::map<std::string,Function *> byname;
+
     bool modified;
+
+    unsigned long version;
+
+    bool memoization;
+    unsigned long memo_limit;
     
     // copyconstructor: not for use
     FunctionList(const FunctionList& fl){}
+
+    void forget();
+
+    // links functions known not to be members, dropping the results only once
+    void append(const std::vector<Function *> &functions);
     
   public:
+
+    static const unsigned long DFLT_MEMO_LIMIT = 256;
     
     // constructor:
-    FunctionList(): first(0), last(0), modified(false){}
+    FunctionList(): first(0), last(0), modified(false), version(0), memoization(false), memo_limit(DFLT_MEMO_LIMIT){}
     
     // destructor:
     ~FunctionList();
@@ -868,6 +1666,52 @@ namespace mexp{
        @return modified-status
     */
     bool isModified(){ return modified; }
+
+    /**
+       The version is incremented on every insertion or removal of a function.
+       @brief returns the version of the list
+       @return the version
+    */
+    unsigned long getVersion() const { return version; }
+
+    /**
+       If enabled, the results of calls to pure functions are cached per function, keyed on the arguments and
+       the values of the variables the function reads from the calling scope. All results are dropped
+       when a function is inserted or removed. Only MathExpression::eval() makes use of the cache.
+       @brief enables or disables memoization (default: disabled)
+       @param value true for enabling
+    */
+    void setMemoization(bool value);
+
+    /**
+       @brief tests if memoization is enabled
+       @return true, if enabled
+    */
+    bool isMemoization() const { return memoization; }
+
+    /**
+       If a function has cached the given number of results, the least recently used result is evicted.
+       @brief sets the maximal number of results cached per function
+       @param limit the maximal number of results, at least 1
+    */
+    void setMemoLimit(unsigned long limit);
+
+    /**
+       @brief returns the maximal number of results cached per function
+       @return the limit
+    */
+    unsigned long getMemoLimit() const { return memo_limit; }
+
+    /**
+       @brief resets the hit- and miss-counters of all functions
+    */
+    void resetMemoStatistics();
+
+    /**
+       @brief returns the hits, misses and hit-rates of all functions represented as a string
+       @return the string representing the statistics
+    */
+    std::string memoStatisticsToString() const;
     
   };
   
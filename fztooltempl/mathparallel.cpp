@@ -0,0 +1,149 @@
+/*
+  Copyright (C) 1999-2008 Friedemann Zintel
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  For any questions, contact me at
+  friezi@cs.tu-berlin.de
+*/
+
+
+#include <unistd.h>
+#include <fztooltempl/mathparallel.hpp>
+
+using namespace std;
+using namespace mexp;
+
+__thread bool ThreadPool::active = false;
+
+ThreadPool::ThreadPool(unsigned int threads) : job(0), parts(0), next(0), finished(0), shutdown(false){
+
+  pthread_mutex_init(&lock,0);
+  pthread_mutex_init(&running,0);
+  pthread_cond_init(&wakeup,0);
+  pthread_cond_init(&done,0);
+
+  for ( unsigned int i = 1; i < threads; i++ ){
+
+    pthread_t thread;
+
+    if ( pthread_create(&thread,0,work,this) )
+      break;
+
+    workers.push_back(thread);
+
+  }
+
+}
+
+ThreadPool::~ThreadPool(){
+
+  pthread_mutex_lock(&lock);
+  shutdown = true;
+  pthread_cond_broadcast(&wakeup);
+  pthread_mutex_unlock(&lock);
+
+  for ( vector<pthread_t>::iterator it = workers.begin(); it != workers.end(); it++ )
+    pthread_join(*it,0);
+
+  pthread_cond_destroy(&done);
+  pthread_cond_destroy(&wakeup);
+  pthread_mutex_destroy(&running);
+  pthread_mutex_destroy(&lock);
+
+}
+
+void *ThreadPool::work(void *pool){
+
+  ThreadPool *threadpool = static_cast<ThreadPool *>(pool);
+
+  pthread_mutex_lock(&threadpool->lock);
+
+  for (;;){
+
+    while ( !threadpool->shutdown && !( threadpool->job && threadpool->next < threadpool->parts ) )
+      pthread_cond_wait(&threadpool->wakeup,&threadpool->lock);
+
+    if ( threadpool->shutdown )
+      break;
+
+    threadpool->runParts();
+
+  }
+
+  pthread_mutex_unlock(&threadpool->lock);
+
+  return 0;
+
+}
+
+void ThreadPool::runParts(){
+
+  Job *current = job;
+
+  while ( next < parts ){
+
+    unsigned long part = next++;
+
+    pthread_mutex_unlock(&lock);
+
+    active = true;
+    current->run(part);
+    active = false;
+
+    pthread_mutex_lock(&lock);
+
+    if ( ++finished == parts )
+      pthread_cond_signal(&done);
+
+  }
+
+}
+
+void ThreadPool::run(Job &job, unsigned long parts){
+
+  pthread_mutex_lock(&running);
+  pthread_mutex_lock(&lock);
+
+  this->job = &job;
+  this->parts = parts;
+  next = 0;
+  finished = 0;
+
+  pthread_cond_broadcast(&wakeup);
+
+  runParts();
+
+  while ( finished < parts )
+    pthread_cond_wait(&done,&lock);
+
+  this->job = 0;
+
+  pthread_mutex_unlock(&lock);
+  pthread_mutex_unlock(&running);
+
+}
+
+unsigned int ThreadPool::getProcessors(){
+
+  long processors = sysconf(_SC_NPROCESSORS_ONLN);
+
+  return ( processors > 1 ? (unsigned int)processors : 1 );
+
+}
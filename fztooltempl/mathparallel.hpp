@@ -0,0 +1,140 @@
+/*
+  Copyright (C) 1999-2008 Friedemann Zintel
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  For any questions, contact me at
+  friezi@cs.tu-berlin.de
+*/
+
+/**
+   @file mathparallel.hpp
+   @author Friedemann Zintel
+*/
+
+#ifndef FZTOOLTEMPL_MATHPARALLEL_HPP
+#define FZTOOLTEMPL_MATHPARALLEL_HPP
+
+#include <vector>
+#include <pthread.h>
+
+namespace mexp{
+
+  /**
+     A ThreadPool runs the parts of a Job on a fixed number of threads, the calling thread being one of them.
+     Which thread runs which part is not determined, so a Job has to combine the results of its parts in the
+     order of the parts to get reproducible results.
+     @brief a pool of threads for evaluating in parallel
+     @see MathExpression::setParallelThreshold()
+     @internal
+  */
+  class ThreadPool{
+
+  public:
+
+    /**
+       @brief a job consisting of a number of independent parts
+       @internal
+    */
+    class Job{
+
+    public:
+
+      virtual ~Job(){}
+
+      /**
+	 The method is called concurrently for different parts and must not throw.
+	 @brief runs a part of the job
+	 @param part the number of the part
+      */
+      virtual void run(unsigned long part) = 0;
+
+    };
+
+  private:
+
+    std::vector<pthread_t> workers;
+
+    pthread_mutex_t lock;
+    pthread_cond_t wakeup;
+    pthread_cond_t done;
+
+    // serializes calls of run()
+    pthread_mutex_t running;
+
+    // the current job
+    Job *job;
+    unsigned long parts;
+    unsigned long next;
+    unsigned long finished;
+
+    bool shutdown;
+
+    // true while the thread is running a part
+    static __thread bool active;
+
+    // copyconstructor: not for use
+    ThreadPool(const ThreadPool &){}
+
+    static void *work(void *pool);
+
+    // runs parts of the current job until all parts have been taken; lock must be held
+    void runParts();
+
+  public:
+
+    /**
+       If a thread can't be started the pool gets fewer threads.
+       @param threads the number of threads including the calling thread
+    */
+    ThreadPool(unsigned int threads);
+
+    ~ThreadPool();
+
+    /**
+       @brief returns the number of threads including the calling thread
+       @return the number of threads
+    */
+    unsigned int getThreads() const { return (unsigned int)workers.size() + 1; }
+
+    /**
+       Blocks until all parts have been run. Must not be called from within a part.
+       @brief runs the parts 0..parts-1 of the job
+       @param job the job
+       @param parts the number of parts
+    */
+    void run(Job &job, unsigned long parts);
+
+    /**
+       @brief returns true if the calling thread is running a part of a job
+       @return true if running a part
+    */
+    static bool isActive(){ return active; }
+
+    /**
+       @brief returns the number of online processors
+       @return the number of processors, at least 1
+    */
+    static unsigned int getProcessors();
+
+  };
+
+}
+
+#endif
@@ -0,0 +1,239 @@
+/*
+  Copyright (C) 1999-2008 Friedemann Zintel
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  For any questions, contact me at
+  friezi@cs.tu-berlin.de
+*/
+
+#include <algorithm>
+#include <sstream>
+#include <iomanip>
+#include <time.h>
+#include <fztooltempl/mathexpression.hpp>
+#include <fztooltempl/mathprofile.hpp>
+
+using namespace std;
+using namespace mexp;
+
+bool Profiler::enabled = false;
+pthread_t Profiler::owner;
+map<string,Profiler::Entry> Profiler::entries;
+Profiler::Node *Profiler::root = 0;
+vector<Profiler::Activation> Profiler::active;
+
+static bool moreExpensive(const Profiler::Entry &a, const Profiler::Entry &b){
+
+  return a.exclusive > b.exclusive;
+
+}
+
+double Profiler::now(){
+
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+
+  return (double)ts.tv_sec + 1e-9*(double)ts.tv_nsec;
+
+}
+
+void Profiler::clearNodes(){
+
+  if ( !root )
+    return;
+
+  // the paths may be as deep as a recursion: not deleted recursively
+  vector<Node *> pending(1,root);
+
+  while ( !pending.empty() ){
+
+    Node *node = pending.back();
+    pending.pop_back();
+
+    for ( map<string,Node *>::iterator it = node->children.begin(); it != node->children.end(); it++ )
+      pending.push_back(it->second);
+
+    delete node;
+
+  }
+
+  root = 0;
+
+}
+
+void Profiler::setEnabled(bool enabled){
+
+  if ( enabled )
+    owner = pthread_self();
+
+  Profiler::enabled = enabled;
+
+}
+
+void Profiler::enter(const char *name){
+
+  if ( !root )
+    root = new Node(0,0);
+
+  Node *parent = ( active.empty() ? root : active.back().node );
+  Node *&node = parent->children[name];
+
+  if ( !node ){
+
+    Entry &entry = entries[name];
+
+    entry.name = name;
+    node = new Node(&entry,parent);
+
+  }
+
+  Activation activation;
+
+  activation.node = node;
+  activation.outermost = ( node->entry->active++ == 0 );
+  activation.nested = 0;
+  activation.nested_requests = 0;
+  activation.requests = Pool::getRequests();
+  activation.start = now();
+
+  active.push_back(activation);
+
+}
+
+void Profiler::leave(){
+
+  if ( active.empty() )
+    return;
+
+  double elapsed = now() - active.back().start;
+  unsigned long requests = Pool::getRequests() - active.back().requests;
+  Activation activation = active.back();
+  Node *node = activation.node;
+  Entry *entry = node->entry;
+
+  active.pop_back();
+
+  node->calls++;
+  node->exclusive += elapsed - activation.nested;
+
+  entry->calls++;
+  entry->exclusive += elapsed - activation.nested;
+  entry->allocations += requests - activation.nested_requests;
+  entry->active--;
+
+  if ( activation.outermost ){
+    entry->inclusive += elapsed;
+    entry->inclusive_allocations += requests;
+  }
+
+  if ( !active.empty() ){
+    active.back().nested += elapsed;
+    active.back().nested_requests += requests;
+  }
+
+}
+
+void Profiler::unwind(size_t depth){
+
+  while ( active.size() > depth )
+    leave();
+
+}
+
+void Profiler::reset(){
+
+  active.clear();
+  clearNodes();
+  entries.clear();
+
+}
+
+vector<Profiler::Entry> Profiler::getEntries(){
+
+  vector<Entry> sorted;
+
+  for ( map<string,Entry>::const_iterator it = entries.begin(); it != entries.end(); it++ )
+    if ( it->second.calls )
+      sorted.push_back(it->second);
+
+  stable_sort(sorted.begin(),sorted.end(),moreExpensive);
+
+  return sorted;
+
+}
+
+string Profiler::toString(){
+
+  vector<Entry> sorted = getEntries();
+  double total = 0;
+  ostringstream report;
+
+  for ( vector<Entry>::iterator it = sorted.begin(); it != sorted.end(); it++ )
+    total += it->exclusive;
+
+  report << "profiling: " << ( enabled ? "on" : "off" ) << endl;
+  report << setw(16) << left << "name" << right << setw(12) << "calls" << setw(14) << "incl. [ms]"
+	 << setw(14) << "excl. [ms]" << setw(8) << "excl.%" << setw(14) << "incl. allocs" << setw(14) << "excl. allocs"
+	 << endl;
+
+  report << fixed;
+
+  for ( vector<Entry>::iterator it = sorted.begin(); it != sorted.end(); it++ )
+    report << setw(16) << left << it->name << right << setw(12) << it->calls
+	   << setw(14) << setprecision(3) << 1e3*it->inclusive << setw(14) << 1e3*it->exclusive
+	   << setw(8) << setprecision(1) << ( total > 0 ? 100*it->exclusive/total : 0.0 )
+	   << setw(14) << it->inclusive_allocations << setw(14) << it->allocations << endl;
+
+  return report.str();
+
+}
+
+void Profiler::writeFolded(ostream &out){
+
+  if ( !root )
+    return;
+
+  // depth-first, the path of each node is built from the path of its parent
+  vector< pair<Node *,string> > pending;
+
+  for ( map<string,Node *>::iterator it = root->children.begin(); it != root->children.end(); it++ )
+    pending.push_back(make_pair(it->second,it->first));
+
+  while ( !pending.empty() ){
+
+    Node *node = pending.back().first;
+    string path = pending.back().second;
+
+    pending.pop_back();
+
+    unsigned long microseconds = (unsigned long)(1e6*node->exclusive + 0.5);
+
+    if ( microseconds )
+      out << path << " " << microseconds << '\n';
+
+    for ( map<string,Node *>::iterator it = node->children.begin(); it != node->children.end(); it++ )
+      pending.push_back(make_pair(it->second,path + ";" + it->first));
+
+  }
+
+  out.flush();
+
+}
@@ -0,0 +1,219 @@
+/*
+  Copyright (C) 1999-2008 Friedemann Zintel
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  For any questions, contact me at
+  friezi@cs.tu-berlin.de
+*/
+
+/**
+   @file mathprofile.hpp
+   @author Friedemann Zintel
+*/
+
+#ifndef FZTOOLTEMPL_MATHPROFILE_HPP
+#define FZTOOLTEMPL_MATHPROFILE_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <iostream>
+#include <pthread.h>
+
+namespace mexp{
+
+  /**
+     While enabled, MathExpression::eval() and the programs run by it record each call of a user-defined function
+     and each builtin operator: the number of calls, the time spent with and without the calls made from it and
+     the values allocated (see Pool::getRequests()). The records are kept per call-path, e.g. "f;g;+", from which
+     the report by name and the folded stacks (the input of flamegraph.pl) are derived.\n
+     Only the thread which enabled the profiler is recorded, parallel evaluations (Sum/Prod, tabulate) are not.
+     Subexpressions evaluated in one go by the real fast-path are accounted to their topmost operator. The times
+     include the cost of measuring them, which is noticeable for cheap operators.
+     @brief opt-in profiler of evaluations
+  */
+  class Profiler{
+
+  public:
+
+    /**
+       A recursive function is accounted inclusive only by its outermost calls.
+       @brief the record of a user-defined function or a builtin operator
+    */
+    class Entry{
+
+    public:
+
+      std::string name;
+      unsigned long calls;
+      double inclusive;
+      double exclusive;
+      unsigned long allocations;
+      unsigned long inclusive_allocations;
+
+      // the calls currently active, for accounting recursive calls only once
+      unsigned long active;
+
+      Entry() : calls(0), inclusive(0), exclusive(0), allocations(0), inclusive_allocations(0), active(0){}
+
+    };
+
+  private:
+
+    // a call-path: the name called from the path of the parent
+    class Node{
+
+    public:
+
+      Entry *entry;
+      Node *parent;
+      std::map<std::string,Node *> children;
+      unsigned long calls;
+      double exclusive;
+
+      Node(Entry *entry, Node *parent) : entry(entry), parent(parent), calls(0), exclusive(0){}
+
+    };
+
+    // a call not yet returned
+    class Activation{
+
+    public:
+
+      Node *node;
+      bool outermost;
+      double start;
+      unsigned long requests;
+      double nested;
+      unsigned long nested_requests;
+
+    };
+
+    static bool enabled;
+    static pthread_t owner;
+    static std::map<std::string,Entry> entries;
+    static Node *root;
+    static std::vector<Activation> active;
+
+    static double now();
+    static void clearNodes();
+
+  public:
+
+    /**
+       Records a builtin operator for the lifetime of the object, also if an exception is thrown.
+       @brief scope of an operator
+    */
+    class Scope{
+
+    private:
+
+      bool recording;
+
+    public:
+
+      /**
+       @param name the name of the operator, 0 if nothing is to be recorded
+      */
+      Scope(const char *name) : recording(false){
+
+	if ( name && isRecording() ){
+	  enter(name);
+	  recording = true;
+	}
+
+      }
+
+      ~Scope(){ if ( recording ) leave(); }
+
+    };
+
+    /**
+       Enabling makes the calling thread the recorded one, the records are kept until reset().
+       @brief enables or disables the profiler
+       @param enabled true for enabling
+    */
+    static void setEnabled(bool enabled);
+
+    /**
+       @brief returns true if the profiler is enabled
+       @return true if enabled
+    */
+    static bool isEnabled(){ return enabled; }
+
+    /**
+       @brief returns true if the profiler is enabled and the calling thread is the recorded one
+       @return true if recording
+    */
+    static bool isRecording(){ return enabled && pthread_equal(owner,pthread_self()); }
+
+    /**
+       @brief records the beginning of a call
+       @param name the name of the function or operator
+    */
+    static void enter(const char *name);
+
+    /**
+       @brief records the end of the innermost call
+    */
+    static void leave();
+
+    /**
+       @brief returns the number of calls which haven't returned yet
+       @return the depth
+    */
+    static size_t getDepth(){ return active.size(); }
+
+    /**
+       Used when an exception is passed through calls which don't return.
+       @brief records the end of the innermost calls up to a depth
+       @param depth the depth as returned by getDepth()
+    */
+    static void unwind(size_t depth);
+
+    /**
+       @brief discards all records
+    */
+    static void reset();
+
+    /**
+       @brief returns the records, the most expensive (exclusive) first
+       @return the records
+    */
+    static std::vector<Entry> getEntries();
+
+    /**
+       @brief returns a table of the records, the most expensive (exclusive) first
+       @return the report
+    */
+    static std::string toString();
+
+    /**
+       Each line consists of a call-path, its names separated by ';', and the exclusive time in microseconds.
+       @brief writes the folded stacks
+       @param out the stream
+    */
+    static void writeFolded(std::ostream &out);
+
+  };
+
+}
+
+#endif
@@ -0,0 +1,1607 @@
+/*
+  Copyright (C) 1999-2008 Friedemann Zintel
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  For any questions, contact me at
+  friezi@cs.tu-berlin.de
+*/
+
+#include <cstring>
+#include <sstream>
+#include <iomanip>
+#include <fztooltempl/mathprogram.hpp>
+
+using namespace std;
+using namespace exc;
+using namespace mexp;
+
+Program::Pattern::~Pattern(){
+
+  for ( vector<Pattern *>::iterator it = elements.begin(); it != elements.end(); it++ )
+    delete *it;
+
+}
+
+int Program::Routine::slotOf(const string &name) const {
+
+  for ( size_t i = 0; i < params.size(); i++ )
+    if ( params[i] == name )
+      return (int)i;
+
+  return -1;
+
+}
+
+Program::Program(MathExpression *me) throw (ExceptionBase)
+  : varlist(me->varlist), functionlist(me->functionlist), fl_version(me->functionlist ? me->functionlist->getVersion() : 0){
+
+  compileNode(me,0,0);
+  emit(OP_RET);
+
+  // the bodies of all called functions are appended to the code; linking a body may add further routines
+  for ( size_t i = 0; i < routines.size(); i++ ){
+
+    routines[i]->entry = (int)code.size();
+
+    if ( !link(routines[i]) ){
+
+      compileNode(routines[i]->function->getBody(),routines[i],0);
+      emit(OP_RET);
+
+    }
+
+    markTailCalls(routines[i],routines[i]->entry);
+
+  }
+
+}
+
+Program::Program(Function *function, FunctionList *functionlist) throw (ExceptionBase)
+  : varlist(0), functionlist(functionlist), fl_version(functionlist->getVersion()){
+
+  // the function itself is the first routine, the routines of the callees have no code of their own
+  Routine *routine = routines[routineFor(function)];
+
+  routine->entry = 0;
+  compileNode(function->getBody(),routine,0);
+  emit(OP_RET);
+
+}
+
+Program::~Program(){
+
+  for ( vector<Value *>::iterator it = constants.begin(); it != constants.end(); it++ )
+    delete *it;
+
+  for ( vector<Routine *>::iterator it = routines.begin(); it != routines.end(); it++ )
+    delete *it;
+
+}
+
+bool Program::isValid() const {
+
+  return ( !functionlist || functionlist->getVersion() == fl_version );
+
+}
+
+Value *Program::run() const throw (ExceptionBase,FunctionDefinition){
+
+  Machine machine(*this,varlist,false);
+
+  return machine.run();
+
+}
+
+Value *Program::run(VariableList *context) const throw (ExceptionBase){
+
+  if ( !isValid() )
+    throw EvalException("program has been invalidated by a modification of the functions!");
+
+  Machine machine(*this,context,true);
+
+  return machine.run();
+
+}
+
+int Program::addName(const string &name){
+
+  for ( size_t i = 0; i < names.size(); i++ )
+    if ( names[i] == name )
+      return (int)i;
+
+  names.push_back(name);
+
+  return (int)names.size() - 1;
+
+}
+
+int Program::addMessage(const string &text, const string &objname){
+
+  messages.push_back(Message(text,objname));
+
+  return (int)messages.size() - 1;
+
+}
+
+int Program::routineFor(Function *function){
+
+  map<const Function *,int>::iterator it = routine_index.find(function);
+
+  if ( it != routine_index.end() )
+    return it->second;
+
+  Routine *routine = new Routine(function);
+  routine->pattern = buildPattern(function->getParameterList(),routine);
+
+  routines.push_back(routine);
+
+  return ( routine_index[function] = (int)routines.size() - 1 );
+
+}
+
+Program::Pattern *Program::buildPattern(MathExpression *parameter, Routine *routine){
+
+  Pattern *pattern = new Pattern();
+
+  pattern->text = parameter->toString(Value::DFLT_PRECISION);
+
+  if ( parameter->isVariable() ){
+
+    pattern->slot = (int)routine->params.size();
+    routine->params.push_back(parameter->getVariable());
+
+  } else {
+
+    for ( list<MathExpression *>::iterator it = parameter->elements.begin(); it != parameter->elements.end(); it++ )
+      pattern->elements.push_back(buildPattern(*it,routine));
+
+  }
+
+  return pattern;
+
+}
+
+bool Program::isSumProd(const MathExpression *me){
+
+  return ( me->getOperatorId() == MathExpression::OI_SUM || me->getOperatorId() == MathExpression::OI_PROD );
+
+}
+
+int Program::definitionPosition(MathExpression *me){
+
+  int position = me->abs_pos;
+
+  // eval() evaluates the upper bound and the body of a Sum/Prod as a copy carrying the position of the Sum/Prod:
+  // Sum/Prod[<index>=<from>;<to>](<body>)
+  for ( MathExpression *node = me; node->getPred(); node = node->getPred() ){
+
+    MathExpression *pred = node->getPred();
+
+    if ( pred->getRight() != node )
+      continue;
+
+    if ( isSumProd(pred) )
+      position = pred->abs_pos;
+    else if ( pred->getPred() && pred->getPred()->getLeft() == pred && isSumProd(pred->getPred()) )
+      position = pred->getPred()->abs_pos;
+
+  }
+
+  return position;
+
+}
+
+unsigned char Program::builtinOpcode(unsigned char id){
+
+  switch ( id ){
+  case MathExpression::OI_ADD: return OP_ADD;
+  case MathExpression::OI_SUB: return OP_SUB;
+  case MathExpression::OI_MUL: return OP_MUL;
+  case MathExpression::OI_DIV: return OP_DIV;
+  case MathExpression::OI_IDIV: return OP_IDIV;
+  case MathExpression::OI_MOD: return OP_MOD;
+  case MathExpression::OI_POW: return OP_POW;
+  case MathExpression::OI_CHOOSE: return OP_CHOOSE;
+  case MathExpression::OI_FAC: return OP_FAC;
+  case MathExpression::OI_SIN: return OP_SIN;
+  case MathExpression::OI_COS: return OP_COS;
+  case MathExpression::OI_TAN: return OP_TAN;
+  case MathExpression::OI_ASIN: return OP_ASIN;
+  case MathExpression::OI_ACOS: return OP_ACOS;
+  case MathExpression::OI_ATAN: return OP_ATAN;
+  case MathExpression::OI_SINH: return OP_SINH;
+  case MathExpression::OI_COSH: return OP_COSH;
+  case MathExpression::OI_TANH: return OP_TANH;
+  case MathExpression::OI_ASINH: return OP_ASINH;
+  case MathExpression::OI_ACOSH: return OP_ACOSH;
+  case MathExpression::OI_ATANH: return OP_ATANH;
+  case MathExpression::OI_LN: return OP_LN;
+  case MathExpression::OI_LD: return OP_LD;
+  case MathExpression::OI_LOG: return OP_LOG;
+  case MathExpression::OI_EXP: return OP_EXP;
+  case MathExpression::OI_SGN: return OP_SGN;
+  case MathExpression::OI_TST: return OP_TST;
+  case MathExpression::OI_MATRIX: return OP_MATRIX;
+  case MathExpression::OI_TRANSP: return OP_TRANSP;
+  case MathExpression::OI_DET: return OP_DET;
+  case MathExpression::OI_SOLVE: return OP_SOLVE;
+  case MathExpression::OI_LT: return OP_LT;
+  case MathExpression::OI_LE: return OP_LE;
+  case MathExpression::OI_GT: return OP_GT;
+  case MathExpression::OI_GE: return OP_GE;
+  case MathExpression::OI_EQ: return OP_EQ;
+  case MathExpression::OI_NE: return OP_NE;
+  default: return OP_NOP;
+  }
+
+}
+
+void Program::compileNode(MathExpression *me, const Routine *routine, int spdepth) throw (ExceptionBase){
+
+  if ( !me || me->isEmpty() ){
+
+    emit(OP_EMPTY);
+    return;
+
+  }
+
+  if ( me->isValue() || me->cache == MathExpression::CS_CONSTANT ){
+
+    constants.push_back(me->getValue()->clone());
+    emit(OP_CONST,(int)constants.size() - 1);
+    return;
+
+  }
+
+  if ( me->isVariable() ){
+
+    int slot;
+
+    // parameters can only be addressed directly outside of Sum/Prod, which open a scope of their own
+    if ( routine && spdepth == 0 && (slot = routine->slotOf(me->getVariable())) >= 0 )
+      emit(OP_PARAM,slot);
+    else
+      emit(OP_LOAD,addName(me->getVariable()));
+
+    return;
+
+  }
+
+  // identities like x*1 are left out if x can only be a number
+  if ( MathExpression *operand = me->getIdentityOperand() ){
+
+    compileNode(operand,routine,spdepth);
+    return;
+
+  }
+
+  switch ( me->getOperatorId() ){
+
+  case MathExpression::OI_ADD:
+  case MathExpression::OI_SUB:
+  case MathExpression::OI_MUL:
+  case MathExpression::OI_DIV:
+  case MathExpression::OI_IDIV:
+  case MathExpression::OI_MOD:
+  case MathExpression::OI_POW:
+  case MathExpression::OI_CHOOSE:
+  case MathExpression::OI_LT:
+  case MathExpression::OI_LE:
+  case MathExpression::OI_GT:
+  case MathExpression::OI_GE:
+  case MathExpression::OI_EQ:
+  case MathExpression::OI_NE:
+
+    compileNode(me->getLeft(),routine,spdepth);
+    compileNode(me->getRight(),routine,spdepth);
+    emit(builtinOpcode(me->getOperatorId()));
+    break;
+
+  case MathExpression::OI_LOG:
+
+    // the argument is evaluated before the base
+    compileNode(me->getRight(),routine,spdepth);
+    compileNode(me->getLeft(),routine,spdepth);
+    emit(OP_LOG);
+    break;
+
+  case MathExpression::OI_ASSIGN:
+
+    // the operand of a faculty isn't checked by the parser, e.g. "(x=)!"
+    if ( !me->getLeft() || !me->getRight() )
+      emit(OP_THROW,addMessage("invalid use of assignment!"));
+    else if ( me->getLeft()->isVariable() ){
+
+      compileNode(me->getRight(),routine,spdepth);
+      emit(OP_STORE,addName(me->getLeft()->getVariable()));
+
+    } else if ( me->getLeft()->isOperator() ){
+
+      definitions.push_back(Definition(me,definitionPosition(me)));
+      emit(OP_DEFINE,(int)definitions.size() - 1);
+
+    } else
+      emit(OP_THROW,addMessage("invalid use of assignment!"));
+
+    break;
+
+  case MathExpression::OI_COMMA:
+
+    if ( me->isOTTuple() == true ){
+
+      for ( list<MathExpression *>::iterator it = me->elements.begin(); it != me->elements.end(); it++ )
+	compileNode(*it,routine,spdepth);
+
+      emit(OP_TUPLE,(int)me->elements.size());
+
+    } else if ( me->isOTParameter() == true )
+      emit(OP_THROW,addMessage("parameterlist can't be evaluated!"));
+    else
+      emit(OP_THROW,addMessage("internal error: getOType() == OT_EMPTY!"));
+
+    break;
+
+  case MathExpression::OI_SUM:
+  case MathExpression::OI_PROD:
+
+    compileSumProd(me,routine,spdepth);
+    break;
+
+  case MathExpression::OI_COND:
+
+    compileConditional(me,routine,spdepth);
+    break;
+
+  case MathExpression::OI_SOLVE:
+
+    compileNode(me->getRight()->elements.front(),routine,spdepth);
+    compileNode(me->getRight()->elements.back(),routine,spdepth);
+    emit(OP_SOLVE);
+    break;
+
+  case MathExpression::OI_USER:
+
+    if ( functionlist && functionlist->isMember(me->getOperator()) )
+      compileCall(me,routine,spdepth);
+    else {
+
+      unresolved.push_back(me->getOperator());
+      emit(OP_THROW,addMessage("unknown operator/function!",me->getOperator()));
+
+    }
+
+    break;
+
+  default:
+
+    // unary operators and builtin functions
+    compileNode(me->getRight(),routine,spdepth);
+    emit(builtinOpcode(me->getOperatorId()));
+    break;
+
+  }
+
+}
+
+void Program::compileSumProd(MathExpression *me, const Routine *routine, int spdepth) throw (ExceptionBase){
+
+  MathExpression *definition = me->getLeft()->getLeft();
+  unsigned char flags = 0;
+
+  if ( me->getOperatorId() == MathExpression::OI_PROD )
+    flags |= FL_PRODUCT;
+
+  // MathExpression::sumProd() copies the scope before the start-value is evaluated: if the start-value
+  // has side-effects the scope of the Sum/Prod must be a snapshot taken before
+  if ( definition->getRight()->containsAssignment() ){
+
+    flags |= FL_SNAPSHOT;
+    emit(OP_SNAPSHOT);
+
+  }
+
+  // the start-value belongs to the outer scope, the upper bound and the body to the inner scope
+  compileNode(definition->getRight(),routine,spdepth);
+  emit(OP_SPBEGIN,addName(definition->getLeft()->getVariable()),flags);
+
+  compileNode(me->getLeft()->getRight(),routine,spdepth+1);
+
+  // the partitions are evaluated in scopes of their own by MathExpression::sumProd()
+  int range = (int)code.size();
+  emit(OP_SPRANGE,0,( me->getRight()->containsAssignment() ? 0 : FL_PARTITION ));
+
+  int loop = (int)code.size();
+  compileNode(me->getRight(),routine,spdepth+1);
+  emit(OP_SPSTEP,loop);
+  emit(OP_SPEND);
+
+  code[range].arg = (int)code.size();
+
+}
+
+void Program::compileConditional(MathExpression *me, const Routine *routine, int spdepth) throw (ExceptionBase){
+
+  list<MathExpression *>::iterator it = me->getRight()->elements.begin();
+
+  // only the chosen branch is executed
+  compileNode(*it++,routine,spdepth);
+
+  int branch = (int)code.size();
+  emit(OP_BRANCH);
+
+  compileNode(*it++,routine,spdepth);
+
+  int jump = (int)code.size();
+  emit(OP_JUMP);
+
+  code[branch].arg = (int)code.size();
+  compileNode(*it,routine,spdepth);
+
+  code[jump].arg = (int)code.size();
+
+}
+
+void Program::markTailCalls(const Routine *routine, int from){
+
+  // a call is in tail-position if only jumps lead from it to the return of the routine; the frame of the caller
+  // may only be replaced if the callee hides all parameters of the caller
+  for ( size_t pc = from; pc < code.size(); pc++ ){
+
+    if ( code[pc].opcode != OP_CALL )
+      continue;
+
+    size_t next = pc + 1;
+
+    while ( code[next].opcode == OP_JUMP )
+      next = code[next].arg;
+
+    if ( code[next].opcode != OP_RET )
+      continue;
+
+    const Routine *callee = routines[code[pc].arg];
+    bool hidden = true;
+
+    for ( size_t i = 0; hidden && i < routine->params.size(); i++ )
+      hidden = ( callee->slotOf(routine->params[i]) >= 0 );
+
+    if ( hidden )
+      code[pc].flags |= FL_TAIL;
+
+  }
+
+}
+
+bool Program::link(const Routine *routine){
+
+  const Program *compiled = routine->function->program;
+
+  if ( !compiled )
+    return false;
+
+  // the code depends on the parameters of the callees and on the functions being undefined
+  for ( vector<string>::const_iterator it = compiled->unresolved.begin(); it != compiled->unresolved.end(); it++ )
+    if ( functionlist->isMember(it->c_str()) )
+      return false;
+
+  vector<Function *> callees;
+
+  for ( vector<Routine *>::const_iterator it = compiled->routines.begin(); it != compiled->routines.end(); it++ ){
+
+    Function *function = functionlist->get((*it)->name.c_str());
+
+    if ( !function || function->getParameterList()->toString(Value::DFLT_PRECISION) != (*it)->pattern->text )
+      return false;
+
+    callees.push_back(function);
+
+  }
+
+  int offset = (int)code.size();
+
+  for ( vector<Instruction>::const_iterator it = compiled->code.begin(); it != compiled->code.end(); it++ ){
+
+    Instruction instruction = *it;
+
+    switch ( instruction.opcode ){
+    case OP_CONST:
+      constants.push_back(compiled->constants[instruction.arg]->clone());
+      instruction.arg = (int)constants.size() - 1;
+      break;
+    case OP_LOAD:
+    case OP_STORE:
+    case OP_SPBEGIN:
+      instruction.arg = addName(compiled->names[instruction.arg]);
+      break;
+    case OP_SPRANGE:
+    case OP_SPSTEP:
+    case OP_BRANCH:
+    case OP_JUMP:
+      instruction.arg += offset;
+      break;
+    case OP_ARGS:
+    case OP_CALL:
+      instruction.arg = routineFor(callees[instruction.arg]);
+      break;
+    case OP_DEFINE:
+      definitions.push_back(compiled->definitions[instruction.arg]);
+      instruction.arg = (int)definitions.size() - 1;
+      break;
+    case OP_THROW:
+      instruction.arg = addMessage(compiled->messages[instruction.arg].text,compiled->messages[instruction.arg].objname);
+      break;
+    default:
+      break;
+    }
+
+    code.push_back(instruction);
+
+  }
+
+  return true;
+
+}
+
+void Program::compileCall(MathExpression *me, const Routine *routine, int spdepth) throw (ExceptionBase){
+
+  Function *function = functionlist->get(me->getOperator());
+  MathExpression *arguments = me->getRight();
+  int callee = routineFor(function);
+
+  // see compileSumProd(): the arguments are evaluated after the scope of the function has been copied
+  emit(OP_ARGS,callee,( arguments->containsAssignment() ? FL_SNAPSHOT : 0 ));
+
+  if ( arguments->isOperator() and arguments->isOTParameter() )
+    compileBinding(function->getParameterList(),arguments,routine,routines[callee],spdepth);
+  else {
+
+    compileNode(arguments,routine,spdepth);
+    emit(OP_BINDV);
+
+  }
+
+  emit(OP_CALL,callee);
+
+}
+
+void Program::compileBinding(MathExpression *parameters, MathExpression *arguments, const Routine *routine,
+			     const Routine *callee, int spdepth) throw (ExceptionBase){
+
+  // same structure as Machine::bind(), arguments in brackets are bound one by one
+  if ( parameters->isVariable() and ( not arguments->isOperator() or not arguments->isOTParameter()) ){
+
+    compileNode(arguments,routine,spdepth);
+    emit(OP_BIND,callee->slotOf(parameters->getVariable()));
+    return;
+
+  }
+
+  list<MathExpression *>::iterator pit;
+  list<MathExpression *>::iterator ait;
+
+  for ( pit = parameters->elements.begin(), ait = arguments->elements.begin();
+	pit != parameters->elements.end();
+	pit++, ait++ ){
+
+    if ( ait == arguments->elements.end() ){
+
+      emit(OP_THROW,addMessage(string("no matching argument to parameter: ") + (*pit)->toString(Value::DFLT_PRECISION) + "!"));
+      return;
+
+    }
+
+    compileBinding(*pit,*ait,routine,callee,spdepth);
+
+  }
+
+  if ( ait != arguments->elements.end() )
+    emit(OP_THROW,addMessage("too many arguments for function!"));
+
+}
+
+string Program::opcodeName(unsigned char opcode){
+
+  switch ( opcode ){
+  case OP_NOP: return "NOP";
+  case OP_EMPTY: return "EMPTY";
+  case OP_CONST: return "CONST";
+  case OP_LOAD: return "LOAD";
+  case OP_PARAM: return "PARAM";
+  case OP_STORE: return "STORE";
+  case OP_ADD: return "ADD";
+  case OP_SUB: return "SUB";
+  case OP_MUL: return "MUL";
+  case OP_DIV: return "DIV";
+  case OP_IDIV: return "IDIV";
+  case OP_MOD: return "MOD";
+  case OP_POW: return "POW";
+  case OP_CHOOSE: return "CHOOSE";
+  case OP_FAC: return "FAC";
+  case OP_SIN: return "SIN";
+  case OP_COS: return "COS";
+  case OP_TAN: return "TAN";
+  case OP_ASIN: return "ASIN";
+  case OP_ACOS: return "ACOS";
+  case OP_ATAN: return "ATAN";
+  case OP_SINH: return "SINH";
+  case OP_COSH: return "COSH";
+  case OP_TANH: return "TANH";
+  case OP_ASINH: return "ASINH";
+  case OP_ACOSH: return "ACOSH";
+  case OP_ATANH: return "ATANH";
+  case OP_LN: return "LN";
+  case OP_LD: return "LD";
+  case OP_LOG: return "LOG";
+  case OP_EXP: return "EXP";
+  case OP_SGN: return "SGN";
+  case OP_TST: return "TST";
+  case OP_TUPLE: return "TUPLE";
+  case OP_ARGS: return "ARGS";
+  case OP_BIND: return "BIND";
+  case OP_BINDV: return "BINDV";
+  case OP_CALL: return "CALL";
+  case OP_SNAPSHOT: return "SNAPSHOT";
+  case OP_SPBEGIN: return "SPBEGIN";
+  case OP_SPRANGE: return "SPRANGE";
+  case OP_SPSTEP: return "SPSTEP";
+  case OP_SPEND: return "SPEND";
+  case OP_DEFINE: return "DEFINE";
+  case OP_THROW: return "THROW";
+  case OP_RET: return "RET";
+  case OP_LT: return "LT";
+  case OP_LE: return "LE";
+  case OP_GT: return "GT";
+  case OP_GE: return "GE";
+  case OP_EQ: return "EQ";
+  case OP_NE: return "NE";
+  case OP_BRANCH: return "BRANCH";
+  case OP_JUMP: return "JUMP";
+  case OP_MATRIX: return "MATRIX";
+  case OP_TRANSP: return "TRANSP";
+  case OP_DET: return "DET";
+  case OP_SOLVE: return "SOLVE";
+  default: return "?";
+  }
+
+}
+
+const char *Program::operatorName(unsigned char opcode){
+
+  switch ( opcode ){
+  case OP_STORE: return "=";
+  case OP_ADD: return "+";
+  case OP_SUB: return "-";
+  case OP_MUL: return "*";
+  case OP_DIV: return "/";
+  case OP_IDIV: return "\\";
+  case OP_MOD: return "%";
+  case OP_POW: return "^";
+  case OP_CHOOSE: return "@";
+  case OP_FAC: return "!";
+  case OP_SIN: return "sin";
+  case OP_COS: return "cos";
+  case OP_TAN: return "tan";
+  case OP_ASIN: return "asin";
+  case OP_ACOS: return "acos";
+  case OP_ATAN: return "atan";
+  case OP_SINH: return "sinh";
+  case OP_COSH: return "cosh";
+  case OP_TANH: return "tanh";
+  case OP_ASINH: return "asinh";
+  case OP_ACOSH: return "acosh";
+  case OP_ATANH: return "atanh";
+  case OP_LN: return "ln";
+  case OP_LD: return "ld";
+  case OP_LOG: return "log";
+  case OP_EXP: return "exp";
+  case OP_SGN: return "sgn";
+  case OP_TST: return "tst";
+  case OP_TUPLE: return ",";
+  case OP_LT: return "<";
+  case OP_LE: return "<=";
+  case OP_GT: return ">";
+  case OP_GE: return ">=";
+  case OP_EQ: return "==";
+  case OP_NE: return "!=";
+  case OP_MATRIX: return "matrix";
+  case OP_TRANSP: return "transp";
+  case OP_DET: return "det";
+  case OP_SOLVE: return "solve";
+  default: return 0;
+  }
+
+}
+
+string Program::toString() const {
+
+  ostringstream listing;
+
+  for ( size_t pc = 0; pc < code.size(); pc++ ){
+
+    for ( size_t r = 0; r < routines.size(); r++ )
+      if ( routines[r]->entry == (int)pc )
+	listing << routines[r]->function->getName() << ":" << endl;
+
+    const Instruction &instruction = code[pc];
+
+    listing << setw(6) << pc << "  " << opcodeName(instruction.opcode);
+
+    switch ( instruction.opcode ){
+    case OP_CONST:
+      listing << " " << constants[instruction.arg]->toString();
+      break;
+    case OP_LOAD:
+    case OP_STORE:
+    case OP_SPBEGIN:
+      listing << " " << names[instruction.arg];
+      break;
+    case OP_PARAM:
+    case OP_BIND:
+    case OP_TUPLE:
+    case OP_SPRANGE:
+    case OP_SPSTEP:
+    case OP_BRANCH:
+    case OP_JUMP:
+      listing << " " << instruction.arg;
+      break;
+    case OP_ARGS:
+    case OP_CALL:
+      listing << " " << routines[instruction.arg]->function->getName();
+      break;
+    case OP_THROW:
+      listing << " \"" << messages[instruction.arg].text << "\"";
+      break;
+    default:
+      break;
+    }
+
+    if ( instruction.flags & FL_PRODUCT )
+      listing << " product";
+    if ( instruction.flags & FL_SNAPSHOT )
+      listing << " snapshot";
+    if ( instruction.flags & FL_TAIL )
+      listing << " tail";
+    if ( instruction.flags & FL_PARTITION )
+      listing << " partition";
+
+    listing << endl;
+
+  }
+
+  return listing.str();
+
+}
+
+Machine::Frame::Frame(const Program::Routine *routine)
+  : routine(routine), locals(0), parent(0), snapshot(0), terminal(false), caller(0), ret(0), memoize(false),
+    index(-1), product(false), started(false), counter(0), to(0), accumulator(0), partitioned(false), from(0),
+    partition(0), partial(0){
+
+  if ( routine )
+    slots.resize(routine->params.size(),0);
+
+}
+
+Machine::Frame::~Frame(){
+
+  for ( vector<Value *>::iterator it = slots.begin(); it != slots.end(); it++ )
+    delete *it;
+
+  delete locals;
+  delete snapshot;
+  delete accumulator;
+  delete partial;
+
+}
+
+Machine::~Machine(){
+
+  for ( vector<Entry>::iterator it = stack.begin(); it != stack.end(); it++ )
+    release(*it);
+
+  for ( vector<Frame *>::iterator it = frames.begin(); it != frames.end(); it++ )
+    delete *it;
+
+  for ( vector<Frame *>::iterator it = pending.begin(); it != pending.end(); it++ )
+    delete *it;
+
+  for ( vector<VariableList *>::iterator it = snapshots.begin(); it != snapshots.end(); it++ )
+    delete *it;
+
+}
+
+Value *Machine::run() throw (ExceptionBase,FunctionDefinition){
+
+  if ( !profiling )
+    return execute();
+
+  // the calls left by an exception are closed
+  size_t depth = Profiler::getDepth();
+
+  try{
+
+    return execute();
+
+  } catch (ExceptionBase &e){
+    Profiler::unwind(depth);
+    throw;
+  } catch (FunctionDefinition &fd){
+    Profiler::unwind(depth);
+    throw;
+  }
+
+}
+
+Value *Machine::take(){
+
+  Entry entry = stack.back();
+
+  stack.pop_back();
+
+  if ( entry.owned || !entry.value )
+    return entry.value;
+
+  return entry.value->clone();
+
+}
+
+void Machine::unary(Value *(Value::*operation)()) throw (ExceptionBase){
+
+  Entry &operand = stack.back();
+
+  Value *result = (operand.value->*operation)();
+
+  release(operand);
+  operand = Entry(result,true);
+
+}
+
+void Machine::binary(Value *(Value::*operation)(Value *)) throw (ExceptionBase){
+
+  Entry &left = stack[stack.size()-2];
+  Entry &right = stack[stack.size()-1];
+
+  Value *result = (left.value->*operation)(right.value);
+
+  release(right);
+  release(left);
+  stack.pop_back();
+  stack.back() = Entry(result,true);
+
+}
+
+Value *Machine::lookup(const string &name) const throw (ExceptionBase){
+
+  for ( const Frame *f = frame; f; f = f->parent ){
+
+    if ( f->routine ){
+
+      int slot = f->routine->slotOf(name);
+
+      if ( slot >= 0 && f->slots[slot] )
+	return f->slots[slot]->clone();
+
+    }
+
+    if ( f->locals )
+      if ( Variable *variable = f->locals->isMember(name.c_str()) )
+	return variable->getValue()->clone();
+
+    if ( f->terminal )
+      throw EvalException("unknown variable!",name.c_str());
+
+  }
+
+  if ( !globals )
+    throw EvalException("unauthorized use of variables!");
+
+  return globals->getValue(name.c_str());
+
+}
+
+const Value *Machine::visible(const Frame *start, const string &name) const {
+
+  for ( const Frame *f = start; f; f = f->parent ){
+
+    if ( f->routine ){
+
+      int slot = f->routine->slotOf(name);
+
+      if ( slot >= 0 && f->slots[slot] )
+	return f->slots[slot];
+
+    }
+
+    if ( f->locals )
+      if ( Variable *variable = f->locals->isMember(name.c_str()) )
+	return variable->getValue();
+
+    if ( f->terminal )
+      return 0;
+
+  }
+
+  if ( globals )
+    if ( Variable *variable = globals->isMember(name.c_str()) )
+      return variable->getValue();
+
+  return 0;
+
+}
+
+void Machine::assign(const string &name, Value *value) throw (ExceptionBase){
+
+  assignTo(frame,name.c_str(),value);
+
+  // only a direct assignment to a global variable modifies the list (see MathExpression::assignValue())
+  if ( !frame )
+    globals->setModified(true);
+
+}
+
+void Machine::assignTo(Frame *target, const char *name, Value *value) throw (ExceptionBase){
+
+  try{
+
+    if ( !target ){
+
+      if ( !globals )
+	throw EvalException("invalid use of assignment!");
+
+      globals->insert(name,value);
+      return;
+
+    }
+
+    if ( target->routine ){
+
+      int slot = target->routine->slotOf(name);
+
+      if ( slot >= 0 ){
+
+	delete target->slots[slot];
+	target->slots[slot] = value;
+	return;
+
+      }
+
+    } else if ( !target->terminal && !( target->locals && target->locals->isMember(name) ) )
+      checkWritable(target,name);
+
+    if ( !target->locals )
+      target->locals = new VariableList();
+
+    target->locals->insert(name,value);
+
+  } catch (ExceptionBase &e){
+
+    delete value;
+    throw;
+
+  }
+
+}
+
+void Machine::checkWritable(const Frame *sumframe, const char *name) const throw (ExceptionBase){
+
+  // the scope of a Sum/Prod inherits the protection-status of the variables unless it's part of a function-call
+  for ( const Frame *f = sumframe->parent; f; f = f->parent ){
+
+    if ( f->routine )
+      return;
+
+    if ( f->locals )
+      if ( Variable *variable = f->locals->isMember(name) ){
+
+	if ( variable->getProtect() )
+	  throw EvalException("redefinition not possible!",variable->getName());
+
+	return;
+
+      }
+
+    if ( f->terminal )
+      return;
+
+  }
+
+  if ( globals )
+    if ( Variable *variable = globals->isMember(name) )
+      if ( variable->getProtect() )
+	throw EvalException("redefinition not possible!",variable->getName());
+
+}
+
+VariableList *Machine::flatten() const throw (ExceptionBase){
+
+  vector<const Frame *> chain;
+  const Frame *f;
+  bool unprotect = false;
+
+  for ( f = frame; f; f = f->parent ){
+
+    if ( f->terminal )
+      break;
+
+    chain.push_back(f);
+
+    if ( f->routine )
+      unprotect = true;
+
+  }
+
+  VariableList *scope;
+
+  if ( f )
+    scope = new VariableList(*f->locals);
+  else if ( globals )
+    scope = new VariableList(*globals);
+  else
+    scope = new VariableList();
+
+  if ( unprotect )
+    scope->unprotect();
+
+  for ( vector<const Frame *>::reverse_iterator it = chain.rbegin(); it != chain.rend(); it++ ){
+
+    if ( (*it)->routine )
+      for ( size_t slot = 0; slot < (*it)->slots.size(); slot++ )
+	scope->insert((*it)->routine->params[slot].c_str(),(*it)->slots[slot]->clone());
+
+    if ( (*it)->locals )
+      for ( VariableList::iterator vit = (*it)->locals->begin(); vit != (*it)->locals->end(); vit++ )
+	scope->insert((*vit).getName(),(*vit).getValue()->clone());
+
+  }
+
+  return scope;
+
+}
+
+void Machine::bind(Frame *callee, const Program::Pattern *pattern, Value *argument) throw (ExceptionBase){
+
+  // a variable is bound directly, a tuple of variables to the elements of a tuple; the values are moved
+  // into the slots, an emptied tuple is deleted
+  if ( pattern->slot >= 0 ){
+
+    callee->slots[pattern->slot] = argument;
+    return;
+
+  }
+
+  try{
+
+    Tuple *arguments = Tuple::assertTuple(argument);
+
+    size_t i;
+
+    for ( i = 0; i < pattern->elements.size(); i++ ){
+
+      if ( i == arguments->elements.size() )
+	throw EvalException(string("no matching argument to parameter: ") + pattern->elements[i]->text + "!");
+
+      Value *element = arguments->elements[i];
+
+      arguments->elements[i] = 0;
+      bind(callee,pattern->elements[i],element);
+
+    }
+
+    if ( i != arguments->elements.size() )
+      throw EvalException("too many arguments for function!");
+
+  } catch (ExceptionBase &e){
+    delete argument;
+    throw;
+  }
+
+  delete argument;
+
+}
+
+void Machine::closeFrame(){
+
+  Frame *closed = frame;
+
+  frame = closed->parent;
+  frames.pop_back();
+  delete closed;
+
+}
+
+bool Machine::memoized(Frame *callee) throw (ExceptionBase){
+
+  Function *function = callee->routine->function;
+
+  // the memoized results are not shared between threads
+  if ( shared || !program.functionlist || !program.functionlist->isMemoization() || !function->isPure() )
+    return false;
+
+  // the key consists of the arguments and the values of the free variables as seen by the body
+  callee->memoize = true;
+
+  for ( size_t slot = 0; callee->memoize && slot < callee->slots.size(); slot++ )
+    callee->memoize = MathExpression::appendKey(callee->key,callee->slots[slot]);
+
+  const vector<string> &freevariables = MathExpression::getFreeVariables(function,program.functionlist);
+
+  for ( vector<string>::const_iterator it = freevariables.begin(); callee->memoize && it != freevariables.end(); it++ ){
+
+    if ( const Value *value = visible(callee,*it) )
+      callee->memoize = MathExpression::appendKey(callee->key,value);
+    else
+      callee->key += 'u';
+
+  }
+
+  if ( callee->memoize )
+    if ( Value *result = function->lookup(callee->key) ){
+
+      callee->memoize = false;
+      push(result->clone());
+      return true;
+
+    }
+
+  return false;
+
+}
+
+void Machine::call(Frame *callee, int ret, bool tail){
+
+  if ( tail ){
+
+    // the callee returns directly to the caller of the replaced frame and sees the same scopes
+    Frame *replaced = frame;
+
+    callee->caller = replaced->caller;
+    callee->ret = replaced->ret;
+
+    if ( !callee->snapshot ){
+
+      callee->parent = replaced->parent;
+      callee->snapshot = replaced->snapshot;
+      replaced->snapshot = 0;
+
+    }
+
+    frames.back() = callee;
+    delete replaced;
+
+  } else {
+
+    callee->caller = frame;
+    callee->ret = ret;
+    frames.push_back(callee);
+
+  }
+
+  frame = callee;
+
+}
+
+int Machine::leave(){
+
+  Frame *callee = frame;
+  int ret = callee->ret;
+
+  frame = callee->caller;
+  frames.pop_back();
+  delete callee;
+
+  return ret;
+
+}
+
+Value *Machine::execute() throw (ExceptionBase,FunctionDefinition){
+
+  const vector<Instruction> &code = program.code;
+  int pc = 0;
+  unsigned long tailcalls = 0;
+
+  for (;;){
+
+    const Instruction &instruction = code[pc++];
+    const char *builtin = ( profiling ? Program::operatorName(instruction.opcode) : 0 );
+
+    if ( builtin )
+      Profiler::enter(builtin);
+
+    switch ( instruction.opcode ){
+
+    case Program::OP_NOP:
+      break;
+
+    case Program::OP_EMPTY:
+      push(0,false);
+      break;
+
+    case Program::OP_CONST:
+      push(program.constants[instruction.arg],false);
+      break;
+
+    case Program::OP_LOAD:
+      push(lookup(program.names[instruction.arg]));
+      break;
+
+    case Program::OP_PARAM:
+      push(frame->slots[instruction.arg]->clone());
+      break;
+
+    case Program::OP_STORE: {
+
+      Value *value = take();
+      Value *result = value->clone();
+
+      try{
+	assign(program.names[instruction.arg],value);
+      } catch (ExceptionBase &e){
+	delete result;
+	throw;
+      }
+
+      push(result);
+      break;
+
+    }
+
+    case Program::OP_ADD: binary(&Value::operator+); break;
+    case Program::OP_SUB: binary(&Value::operator-); break;
+    case Program::OP_MUL: binary(&Value::operator*); break;
+    case Program::OP_DIV: binary(&Value::operator/); break;
+    case Program::OP_IDIV: binary(&Value::integerDivision); break;
+    case Program::OP_MOD: binary(&Value::operator%); break;
+    case Program::OP_POW: binary(&Value::pow); break;
+    case Program::OP_CHOOSE: binary(&Value::choose); break;
+    case Program::OP_LOG: binary(&Value::log); break;
+    case Program::OP_FAC: unary(&Value::faculty); break;
+    case Program::OP_SIN: unary(&Value::sin); break;
+    case Program::OP_COS: unary(&Value::cos); break;
+    case Program::OP_TAN: unary(&Value::tan); break;
+    case Program::OP_ASIN: unary(&Value::asin); break;
+    case Program::OP_ACOS: unary(&Value::acos); break;
+    case Program::OP_ATAN: unary(&Value::atan); break;
+    case Program::OP_SINH: unary(&Value::sinh); break;
+    case Program::OP_COSH: unary(&Value::cosh); break;
+    case Program::OP_TANH: unary(&Value::tanh); break;
+    case Program::OP_ASINH: unary(&Value::asinh); break;
+    case Program::OP_ACOSH: unary(&Value::acosh); break;
+    case Program::OP_ATANH: unary(&Value::atanh); break;
+    case Program::OP_LN: unary(&Value::ln); break;
+    case Program::OP_LD: unary(&Value::ld); break;
+    case Program::OP_EXP: unary(&Value::exp); break;
+    case Program::OP_SGN: unary(&Value::sgn); break;
+    case Program::OP_TST: unary(&Value::tst); break;
+    case Program::OP_LT: binary(&Value::lessThan); break;
+    case Program::OP_LE: binary(&Value::lessEqual); break;
+    case Program::OP_GT: binary(&Value::greaterThan); break;
+    case Program::OP_GE: binary(&Value::greaterEqual); break;
+    case Program::OP_EQ: binary(&Value::equal); break;
+    case Program::OP_NE: binary(&Value::notEqual); break;
+    case Program::OP_MATRIX: unary(&Value::toMatrix); break;
+    case Program::OP_TRANSP: unary(&Value::transpose); break;
+    case Program::OP_DET: unary(&Value::det); break;
+    case Program::OP_SOLVE: binary(&Value::solve); break;
+
+    case Program::OP_BRANCH: {
+
+      Entry &condition = stack.back();
+      bool truth = Complex::isTrue(condition.value);
+
+      release(condition);
+      stack.pop_back();
+
+      if ( !truth )
+	pc = instruction.arg;
+
+      break;
+
+    }
+
+    case Program::OP_JUMP:
+      pc = instruction.arg;
+      break;
+
+    case Program::OP_TUPLE: {
+
+      Tuple *tuple = new Tuple(instruction.arg);
+      size_t base = stack.size() - instruction.arg;
+
+      for ( size_t i = base; i < stack.size(); i++ )
+	tuple->addElement(stack[i].owned ? stack[i].value : stack[i].value->clone());
+
+      stack.erase(stack.begin() + base,stack.end());
+      push(tuple);
+      break;
+
+    }
+
+    case Program::OP_ARGS: {
+
+      Frame *callee = new Frame(program.routines[instruction.arg]);
+
+      pending.push_back(callee);
+
+      if ( instruction.flags & Program::FL_SNAPSHOT ){
+
+	callee->snapshot = new Frame(0);
+	callee->snapshot->terminal = true;
+	callee->snapshot->locals = flatten();
+
+      }
+
+      break;
+
+    }
+
+    case Program::OP_BIND:
+      pending.back()->slots[instruction.arg] = take();
+      break;
+
+    case Program::OP_BINDV: {
+
+      bind(pending.back(),pending.back()->routine->pattern,take());
+      break;
+
+    }
+
+    case Program::OP_CALL: {
+
+      Frame *callee = pending.back();
+
+      // the caller may be replaced if it isn't seen by the callee in any way
+      bool tail = ( ( instruction.flags & Program::FL_TAIL ) && frame && frames.back() == frame && !frame->memoize
+		    && !( frame->locals && frame->locals->size() ) );
+
+      // the frames of the calls and Sum/Prod are counted, the callee is still released as pending
+      if ( !tail && frames.size() >= MathExpression::getMaxCallDepth() )
+	throw EvalException("recursion too deep!");
+
+      // a replaced frame doesn't grow, only the number of replacements ends a recursion without a base case
+      if ( tail && ++tailcalls > MathExpression::getMaxTailCalls() )
+	throw EvalException("too many calls in tail-position!");
+
+      pending.pop_back();
+      callee->parent = ( callee->snapshot ? callee->snapshot : frame );
+      call(callee,pc,tail);
+
+      // a call in tail-position ends the call of the replaced function
+      if ( profiling ){
+
+	if ( tail )
+	  Profiler::leave();
+
+	Profiler::enter(callee->routine->name.c_str());
+
+      }
+
+      if ( memoized(callee) ){
+
+	pc = leave();
+
+	if ( profiling )
+	  Profiler::leave();
+
+      } else
+	pc = callee->routine->entry;
+
+      break;
+
+    }
+
+    case Program::OP_SNAPSHOT:
+      snapshots.push_back(flatten());
+      break;
+
+    case Program::OP_SPBEGIN: {
+
+      Value *start = take();
+      Frame *sumframe = new Frame(0);
+
+      sumframe->index = instruction.arg;
+      sumframe->product = ( instruction.flags & Program::FL_PRODUCT );
+      sumframe->parent = frame;
+
+      if ( instruction.flags & Program::FL_SNAPSHOT ){
+
+	sumframe->locals = snapshots.back();
+	sumframe->terminal = true;
+	snapshots.pop_back();
+
+      }
+
+      frames.push_back(sumframe);
+      frame = sumframe;
+
+      if ( profiling )
+	Profiler::enter(sumframe->product ? "Prod" : "Sum");
+
+      const char *index = program.names[instruction.arg].c_str();
+
+      assignTo(sumframe,index,start);
+
+      sumframe->counter = (unsigned long)Complex::assertNatural(sumframe->locals->isMember(index)->getValue())->getRe();
+      break;
+
+    }
+
+    case Program::OP_SPRANGE: {
+
+      Value *upper = take();
+
+      try{
+	frame->to = (unsigned long)Complex::assertNatural(upper)->getRe();
+      } catch (ExceptionBase &e){
+	delete upper;
+	throw;
+      }
+
+      delete upper;
+
+      if ( frame->to < frame->counter ){
+
+	closeFrame();
+	push(new Complex(0));
+	pc = instruction.arg;
+
+	if ( profiling )
+	  Profiler::leave();
+
+      } else {
+
+	frame->partitioned = ( ( instruction.flags & Program::FL_PARTITION )
+			       && MathExpression::isPartitioned(frame->to - frame->counter + 1)
+			       && !( program.functionlist && program.functionlist->isMemoization() ) );
+	frame->from = frame->counter;
+
+      }
+
+      break;
+
+    }
+
+    case Program::OP_SPSTEP: {
+
+      Frame *sumframe = frame;
+      Entry &body = stack.back();
+
+      if ( !sumframe->started ){
+
+	// the first evaluation of the body only determines the neutral element (see MathExpression::sumProd())
+	if ( sumframe->product )
+	  sumframe->accumulator = body.value->neutralMultiplikation();
+	else
+	  sumframe->accumulator = body.value->neutralAddition();
+
+	sumframe->started = true;
+
+      } else {
+
+	// in partitions the result is the same as by MathExpression::sumProdParallel() with any number of threads
+	if ( !sumframe->partitioned )
+	  Value::accumulate(sumframe->accumulator,body.value,sumframe->product);
+	else if ( sumframe->partial )
+	  Value::accumulate(sumframe->partial,body.value,sumframe->product);
+	else
+	  sumframe->partial = body.value->clone();
+
+	sumframe->counter++;
+
+	if ( sumframe->partitioned
+	     && sumframe->counter == MathExpression::partitionStart(sumframe->from,sumframe->to - sumframe->from + 1,
+								     sumframe->partition + 1) ){
+
+	  Value::accumulate(sumframe->accumulator,sumframe->partial,sumframe->product);
+	  delete sumframe->partial;
+	  sumframe->partial = 0;
+	  sumframe->partition++;
+
+	}
+
+	assignTo(sumframe,program.names[sumframe->index].c_str(),new Complex((cmplx_tp)sumframe->counter));
+
+      }
+
+      release(stack.back());
+      stack.pop_back();
+
+      if ( sumframe->counter <= sumframe->to )
+	pc = instruction.arg;
+
+      break;
+
+    }
+
+    case Program::OP_SPEND: {
+
+      Frame *sumframe = frame;
+      const char *index = program.names[sumframe->index].c_str();
+
+      push(sumframe->accumulator);
+      sumframe->accumulator = 0;
+
+      // newly defined variables are passed to the outer scope
+      if ( sumframe->locals )
+	for ( VariableList::iterator it = sumframe->locals->begin(); it != sumframe->locals->end(); it++ )
+	  if ( strcmp((*it).getName(),index) && !(*it).getProtect() )
+	    assignTo(sumframe->parent,(*it).getName(),(*it).getValue()->clone());
+
+      closeFrame();
+
+      if ( profiling )
+	Profiler::leave();
+
+      break;
+
+    }
+
+    case Program::OP_DEFINE: {
+
+      if ( shared )
+	throw EvalException("function-definition not possible in a shared evaluation!");
+
+      const Program::Definition &definition = program.definitions[instruction.arg];
+
+      try{
+	definition.expression->defineFunction();
+      } catch (ParseException &pe){
+	throw ParseException(definition.position,pe.getMsg());
+      }
+
+      throw FunctionDefinition(definition.expression->getLeft()->getOperator());
+
+    }
+
+    case Program::OP_THROW: {
+
+      const Program::Message &message = program.messages[instruction.arg];
+
+      throw EvalException(message.text.c_str(),( message.objname.empty() ? 0 : message.objname.c_str() ));
+
+    }
+
+    case Program::OP_RET: {
+
+      // the result of the main-routine is passed to the caller, the result of a function stays on the stack
+      if ( !frame )
+	return take();
+
+      if ( frame->memoize && stack.back().value )
+	frame->routine->function->store(frame->key,stack.back().value->clone(),program.functionlist->getMemoLimit());
+
+      pc = leave();
+
+      if ( profiling )
+	Profiler::leave();
+
+      break;
+
+    }
+
+    default:
+      throw EvalException("internal error: invalid opcode!");
+
+    }
+
+    if ( builtin )
+      Profiler::leave();
+
+  }
+
+}
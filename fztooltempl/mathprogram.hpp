@@ -0,0 +1,437 @@
+/*
+  Copyright (C) 1999-2008 Friedemann Zintel
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  For any questions, contact me at
+  friezi@cs.tu-berlin.de
+*/
+
+/**
+   @file mathprogram.hpp
+   @author Friedemann Zintel
+*/
+
+#ifndef FZTOOLTEMPL_MATHPROGRAM_HPP
+#define FZTOOLTEMPL_MATHPROGRAM_HPP
+
+#include <string>
+#include <vector>
+#include <map>
+#include <fztooltempl/exception.hpp>
+#include <fztooltempl/mathexpression.hpp>
+#include <fztooltempl/mathprofile.hpp>
+
+namespace mexp{
+
+  class Machine;
+
+  /**
+     @brief a single instruction of a Program
+     @internal
+  */
+  class Instruction{
+
+  public:
+
+    unsigned char opcode;
+    unsigned char flags;
+    int arg;
+
+    Instruction(unsigned char opcode, int arg = 0, unsigned char flags = 0) : opcode(opcode), flags(flags), arg(arg){}
+
+  };
+
+  /**
+     A Program is the compiled form of a MathExpression. The expression-tree and all user-defined functions
+     called from it are lowered into one contiguous array of instructions which is executed by a stack-machine.
+     The results are the same as the results of MathExpression::eval().
+     @brief compiled form of a MathExpression
+     @see MathExpression::compile()
+  */
+  class Program{
+
+    friend class Machine;
+
+  public:
+
+    // opcodes
+    static const unsigned char OP_NOP = 0;
+    static const unsigned char OP_EMPTY = 1;
+    static const unsigned char OP_CONST = 2;
+    static const unsigned char OP_LOAD = 3;
+    static const unsigned char OP_PARAM = 4;
+    static const unsigned char OP_STORE = 5;
+    static const unsigned char OP_ADD = 10;
+    static const unsigned char OP_SUB = 11;
+    static const unsigned char OP_MUL = 12;
+    static const unsigned char OP_DIV = 13;
+    static const unsigned char OP_IDIV = 14;
+    static const unsigned char OP_MOD = 15;
+    static const unsigned char OP_POW = 16;
+    static const unsigned char OP_CHOOSE = 17;
+    static const unsigned char OP_FAC = 18;
+    static const unsigned char OP_SIN = 20;
+    static const unsigned char OP_COS = 21;
+    static const unsigned char OP_TAN = 22;
+    static const unsigned char OP_ASIN = 23;
+    static const unsigned char OP_ACOS = 24;
+    static const unsigned char OP_ATAN = 25;
+    static const unsigned char OP_SINH = 26;
+    static const unsigned char OP_COSH = 27;
+    static const unsigned char OP_TANH = 28;
+    static const unsigned char OP_ASINH = 29;
+    static const unsigned char OP_ACOSH = 30;
+    static const unsigned char OP_ATANH = 31;
+    static const unsigned char OP_LN = 32;
+    static const unsigned char OP_LD = 33;
+    static const unsigned char OP_LOG = 34;
+    static const unsigned char OP_EXP = 35;
+    static const unsigned char OP_SGN = 36;
+    static const unsigned char OP_TST = 37;
+    static const unsigned char OP_TUPLE = 40;
+    static const unsigned char OP_ARGS = 41;
+    static const unsigned char OP_BIND = 42;
+    static const unsigned char OP_BINDV = 43;
+    static const unsigned char OP_CALL = 44;
+    static const unsigned char OP_SNAPSHOT = 45;
+    static const unsigned char OP_SPBEGIN = 46;
+    static const unsigned char OP_SPRANGE = 47;
+    static const unsigned char OP_SPSTEP = 48;
+    static const unsigned char OP_SPEND = 49;
+    static const unsigned char OP_DEFINE = 50;
+    static const unsigned char OP_THROW = 51;
+    static const unsigned char OP_RET = 52;
+    static const unsigned char OP_LT = 53;
+    static const unsigned char OP_LE = 54;
+    static const unsigned char OP_GT = 55;
+    static const unsigned char OP_GE = 56;
+    static const unsigned char OP_EQ = 57;
+    static const unsigned char OP_NE = 58;
+    static const unsigned char OP_BRANCH = 59;
+    static const unsigned char OP_JUMP = 60;
+    static const unsigned char OP_MATRIX = 61;
+    static const unsigned char OP_TRANSP = 62;
+    static const unsigned char OP_DET = 63;
+    static const unsigned char OP_SOLVE = 64;
+
+    // instruction-flags
+    static const unsigned char FL_PRODUCT = 1;
+    static const unsigned char FL_SNAPSHOT = 2;
+    static const unsigned char FL_TAIL = 4;
+    static const unsigned char FL_PARTITION = 8;
+
+  private:
+
+    /**
+       @brief the parameter-tree of a user-defined function, used for binding a single argument-value
+       @internal
+    */
+    class Pattern{
+
+    public:
+
+      int slot;
+      std::string text;
+      std::vector<Pattern *> elements;
+
+      Pattern() : slot(-1){}
+      ~Pattern();
+
+    };
+
+    /**
+       @brief a compiled user-defined function
+       @internal
+    */
+    class Routine{
+
+    public:
+
+      Function *function;
+      std::string name;
+      int entry;
+      std::vector<std::string> params;
+      Pattern *pattern;
+
+      Routine(Function *function) : function(function), name(function->getName()), entry(-1), pattern(0){}
+      ~Routine(){ delete pattern; }
+
+      int slotOf(const std::string &name) const;
+
+    };
+
+    /**
+       @brief the text and the object of an EvalException thrown by OP_THROW
+       @internal
+    */
+    class Message{
+
+    public:
+
+      std::string text;
+      std::string objname;
+
+      Message(const std::string &text, const std::string &objname) : text(text), objname(objname){}
+
+    };
+
+    /**
+       @brief a function-definition executed by OP_DEFINE and the position its ParseExceptions are reported at
+       @internal
+    */
+    class Definition{
+
+    public:
+
+      MathExpression *expression;
+      int position;
+
+      Definition(MathExpression *expression, int position) : expression(expression), position(position){}
+
+    };
+
+    std::vector<Instruction> code;
+    std::vector<Value *> constants;
+    std::vector<std::string> names;
+    std::vector<Message> messages;
+    std::vector<Routine *> routines;
+    std::vector<Definition> definitions;
+    std::map<const Function *,int> routine_index;
+    std::vector<std::string> unresolved;
+
+    VariableList *varlist;
+    FunctionList *functionlist;
+    unsigned long fl_version;
+
+    // copyconstructor: not for use
+    Program(const Program &){}
+
+    void emit(unsigned char opcode, int arg = 0, unsigned char flags = 0){ code.push_back(Instruction(opcode,arg,flags)); }
+    int addName(const std::string &name);
+    int addMessage(const std::string &text, const std::string &objname = "");
+    int routineFor(Function *function);
+    Pattern *buildPattern(MathExpression *parameter, Routine *routine);
+
+    void compileNode(MathExpression *me, const Routine *routine, int spdepth) throw (exc::ExceptionBase);
+    void compileSumProd(MathExpression *me, const Routine *routine, int spdepth) throw (exc::ExceptionBase);
+    void compileConditional(MathExpression *me, const Routine *routine, int spdepth) throw (exc::ExceptionBase);
+    void markTailCalls(const Routine *routine, int from);
+    bool link(const Routine *routine);
+    void compileCall(MathExpression *me, const Routine *routine, int spdepth) throw (exc::ExceptionBase);
+    void compileBinding(MathExpression *parameters, MathExpression *arguments, const Routine *routine, const Routine *callee,
+			int spdepth) throw (exc::ExceptionBase);
+
+    static bool isSumProd(const MathExpression *me);
+    static int definitionPosition(MathExpression *me);
+    static unsigned char builtinOpcode(unsigned char id);
+    static std::string opcodeName(unsigned char opcode);
+
+    // the name of the operator of a builtin opcode as written in expressions, 0 for other opcodes
+    static const char *operatorName(unsigned char opcode);
+
+  public:
+
+    /**
+       @brief compiles the expression
+       @param me the expression to be compiled
+       @exception ExceptionBase
+    */
+    Program(MathExpression *me) throw (exc::ExceptionBase);
+
+    /**
+       The body of a user-defined function is compiled on its own when the function is defined, its parameters
+       are resolved to the slots of the frame. Programs calling the function copy this code instead of compiling
+       the body again, as long as the functions called from the body haven't been redefined meanwhile.
+       @brief compiles the body of a function
+       @param function the function
+       @param functionlist the FunctionList the function has been inserted into
+       @exception ExceptionBase
+    */
+    Program(Function *function, FunctionList *functionlist) throw (exc::ExceptionBase);
+
+    ~Program();
+
+    /**
+       A Program becomes invalid if the FunctionList it was compiled against has been modified.
+       @brief checks whether the program is still valid
+       @return true, if valid
+    */
+    bool isValid() const;
+
+    /**
+       @brief executes the program
+       @return the result, owned by the caller
+       @exception EvalException
+       @exception FunctionDefinition
+    */
+    Value *run() const throw (exc::ExceptionBase,FunctionDefinition);
+
+    /**
+       Executes the program with the global variables of context instead of the VariableList it was compiled
+       against; usually context is a local scope on top of that list holding the bindings of one thread (see
+       VariableList(const VariableList *, bool)). Assignments only modify context, function-definitions are not
+       possible. The program is never modified by run(), so several threads may run it at the same time, each with
+       its own context, as long as nobody modifies the FunctionList or the enclosing scopes of the contexts
+       meanwhile. The values are allocated from pools of the running thread, which are passed on to later threads
+       when it exits.
+       @brief executes the program with its own global variables
+       @param context the global variables
+       @return the result, owned by the caller
+       @exception EvalException
+    */
+    Value *run(VariableList *context) const throw (exc::ExceptionBase);
+
+    /**
+       @brief returns the number of instructions
+       @return the number of instructions
+    */
+    size_t size() const { return code.size(); }
+
+    /**
+       @brief returns a listing of the instructions
+       @return the listing
+    */
+    std::string toString() const;
+
+  };
+
+  /**
+     The frames of the function-calls are kept on the heap together with their return-addresses, the depth of a
+     recursion is bounded by MathExpression::getMaxCallDepth(). A call in tail-position replaces the frame of the
+     calling function, the number of replacements is bounded by MathExpression::getMaxTailCalls().
+     @brief the stack-machine executing a Program
+     @internal
+  */
+  class Machine{
+
+  private:
+
+    /**
+       @brief a scope-frame for a function-call or a Sum/Prod
+       @internal
+    */
+    class Frame{
+
+    public:
+
+      const Program::Routine *routine;
+      std::vector<Value *> slots;
+      VariableList *locals;
+      Frame *parent;
+      Frame *snapshot;
+      bool terminal;
+
+      // function-call: the frame and the instruction to return to, the key of a memoized call
+      Frame *caller;
+      int ret;
+      bool memoize;
+      std::string key;
+
+      // Sum/Prod
+      int index;
+      bool product;
+      bool started;
+      unsigned long counter;
+      unsigned long to;
+      Value *accumulator;
+
+      // accumulation in partitions (see MathExpression::isPartitioned())
+      bool partitioned;
+      unsigned long from;
+      unsigned long partition;
+      Value *partial;
+
+      Frame(const Program::Routine *routine);
+      ~Frame();
+
+    };
+
+    /**
+       @brief an element of the value-stack, constants are only borrowed
+       @internal
+    */
+    class Entry{
+
+    public:
+
+      Value *value;
+      bool owned;
+
+      Entry(Value *value, bool owned) : value(value), owned(owned){}
+
+    };
+
+    const Program &program;
+    VariableList *globals;
+    bool shared;
+    std::vector<Entry> stack;
+    std::vector<Frame *> frames;
+    std::vector<Frame *> pending;
+    std::vector<VariableList *> snapshots;
+    Frame *frame;
+
+    // the calls and builtin operators are recorded by the Profiler
+    bool profiling;
+
+    // copyconstructor: not for use
+    Machine(const Machine &m) : program(m.program){}
+
+    void push(Value *value, bool owned = true){ stack.push_back(Entry(value,owned)); }
+    Value *take();
+    void release(Entry &entry){ if ( entry.owned ) delete entry.value; }
+    void unary(Value *(Value::*operation)()) throw (exc::ExceptionBase);
+    void binary(Value *(Value::*operation)(Value *)) throw (exc::ExceptionBase);
+
+    Value *lookup(const std::string &name) const throw (exc::ExceptionBase);
+    const Value *visible(const Frame *start, const std::string &name) const;
+    void assign(const std::string &name, Value *value) throw (exc::ExceptionBase);
+    void assignTo(Frame *target, const char *name, Value *value) throw (exc::ExceptionBase);
+    void checkWritable(const Frame *sumframe, const char *name) const throw (exc::ExceptionBase);
+    VariableList *flatten() const throw (exc::ExceptionBase);
+    void bind(Frame *callee, const Program::Pattern *pattern, Value *argument) throw (exc::ExceptionBase);
+    void closeFrame();
+    bool memoized(Frame *callee) throw (exc::ExceptionBase);
+    void call(Frame *callee, int ret, bool tail);
+    int leave();
+
+    Value *execute() throw (exc::ExceptionBase,FunctionDefinition);
+
+  public:
+
+    /**
+       @param program the program to be executed
+       @param globals the global variables
+       @param shared if true, function-definitions are refused
+    */
+    Machine(const Program &program, VariableList *globals, bool shared)
+      : program(program), globals(globals), shared(shared), frame(0), profiling(!shared && Profiler::isRecording()){}
+    ~Machine();
+
+    /**
+       @brief executes the main-routine of the program
+       @return the result, owned by the caller
+    */
+    Value *run() throw (exc::ExceptionBase,FunctionDefinition);
+
+  };
+
+}
+
+#endif
@@ -0,0 +1,480 @@
+/*
+  Copyright (C) 1999-2008 Friedemann Zintel
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  For any questions, contact me at
+  friezi@cs.tu-berlin.de
+*/
+
+#include <algorithm>
+#include <sstream>
+#include <fztooltempl/graph.hpp>
+#include <fztooltempl/mathsheet.hpp>
+
+using namespace std;
+using namespace exc;
+using namespace mexp;
+
+// the formulas as nodes, the formulas of the variables they read as neighbours
+class Spreadsheet::Graph : public graph::Graphable<Formula *>{
+
+private:
+
+  class Iterator : public graph::abstract_node_iterator<Formula *>{
+
+  private:
+
+    vector<Formula *>::iterator it;
+
+  public:
+
+    Iterator(vector<Formula *>::iterator it) : it(it){}
+
+    Formula * operator*() throw(ExceptionBase){ return *it; }
+
+    void operator++(int) throw(ExceptionBase){ it++; }
+
+    bool operator==(const graph::abstract_node_iterator<Formula *> *it_rval) throw(ExceptionBase){
+      return it == static_cast<const Iterator *>(it_rval)->it;
+    }
+
+  };
+
+  vector<Formula *> &nodes;
+
+public:
+
+  Graph(vector<Formula *> &nodes) : nodes(nodes){}
+
+  graph::abstract_node_iterator<Formula *> * beginNodesPtr(){ return new Iterator(nodes.begin()); }
+
+  graph::abstract_node_iterator<Formula *> * endNodesPtr(){ return new Iterator(nodes.end()); }
+
+  graph::abstract_node_iterator<Formula *> * beginNeighboursPtr(Formula *formula){
+    return new Iterator(formula->neighbours.begin());
+  }
+
+  graph::abstract_node_iterator<Formula *> * endNeighboursPtr(Formula *formula){
+    return new Iterator(formula->neighbours.end());
+  }
+
+  size_t maxNodes(){ return nodes.size(); }
+
+};
+
+// collects the components, each completed after the components it depends on
+class Spreadsheet::Ordering : public graph::SCCProcessor<Formula *>{
+
+public:
+
+  vector< vector<Formula *> > components;
+
+  Ordering(Graph *graph) : graph::SCCProcessor<Formula *>(graph){}
+
+protected:
+
+  void prepareFind() throw (ExceptionBase){ components.clear(); }
+
+  void processComponent() throw (ExceptionBase){ components.push_back(vector<Formula *>()); }
+
+  void processComponentNode(Formula *formula) throw (ExceptionBase){ components.back().push_back(formula); }
+
+};
+
+Spreadsheet::~Spreadsheet(){
+
+  clear();
+
+}
+
+void Spreadsheet::scan(const MathExpression *node, set<string> bound, set<string> &reads, set<string> &writes,
+		       set<string> &calls){
+
+  if ( node->isVariable() ){
+
+    if ( bound.find(node->getVariable()) == bound.end() )
+      reads.insert(node->getVariable());
+
+    return;
+
+  }
+
+  if ( !node->isOperator() )
+    return;
+
+  switch ( node->operator_id ){
+
+  case MathExpression::OI_USER:
+    calls.insert(node->getOperator());
+    break;
+
+  case MathExpression::OI_SUM:
+  case MathExpression::OI_PROD:
+    // Sum/Prod[<index>=<from>;<to>](<body>): the index is bound within the whole Sum/Prod
+    if ( node->getLeft() && node->getLeft()->getLeft() && node->getLeft()->getLeft()->getLeft() ){
+
+      const MathExpression *range = node->getLeft();
+      const MathExpression *assignment = range->getLeft();
+
+      bound.insert(assignment->getLeft()->getVariable());
+
+      const MathExpression *parts[] = { assignment->getRight(), range->getRight(), node->getRight() };
+
+      for ( unsigned int i = 0; i < sizeof(parts)/sizeof(MathExpression *); i++ )
+	if ( parts[i] )
+	  scan(parts[i],bound,reads,writes,calls);
+
+      return;
+
+    }
+    break;
+
+  case MathExpression::OI_ASSIGN:
+    if ( node->getLeft() && node->getLeft()->isVariable() ){
+
+      writes.insert(node->getLeft()->getVariable());
+
+      if ( node->getRight() )
+	scan(node->getRight(),bound,reads,writes,calls);
+
+      return;
+
+    }
+    break;
+
+  }
+
+  for ( list<MathExpression *>::const_iterator it = node->elements.begin(); it != node->elements.end(); it++ )
+    scan(*it,bound,reads,writes,calls);
+
+}
+
+void Spreadsheet::expand(set<string> &reads, set<string> &calls) const {
+
+  vector<string> pending(calls.begin(),calls.end());
+
+  while ( !pending.empty() ){
+
+    Function *function = functionlist->get(pending.back().c_str());
+    pending.pop_back();
+
+    // an undefined function stays in calls: its definition or update() recomputes the formulas calling it
+    if ( !function )
+      continue;
+
+    const vector<string> &freevariables = MathExpression::getFreeVariables(function,functionlist);
+    reads.insert(freevariables.begin(),freevariables.end());
+
+    set<string> bodyreads, bodywrites, bodycalls;
+    scan(function->getBody(),set<string>(),bodyreads,bodywrites,bodycalls);
+
+    for ( set<string>::iterator it = bodycalls.begin(); it != bodycalls.end(); it++ )
+      if ( calls.insert(*it).second )
+	pending.push_back(*it);
+
+  }
+
+}
+
+vector<Spreadsheet::Formula *> Spreadsheet::order() throw (ExceptionBase){
+
+  vector<Formula *> nodes;
+  map<string,Formula *> writers;
+
+  for ( map<string,Formula *>::iterator it = formulas.begin(); it != formulas.end(); it++ ){
+
+    nodes.push_back(it->second);
+
+    for ( set<string>::iterator wit = it->second->writes.begin(); wit != it->second->writes.end(); wit++ )
+      writers[*wit] = it->second;
+
+  }
+
+  for ( map<string,Formula *>::iterator it = formulas.begin(); it != formulas.end(); it++ )
+    writers[it->first] = it->second;
+
+  for ( vector<Formula *>::iterator it = nodes.begin(); it != nodes.end(); it++ ){
+
+    set<string> reads = (*it)->reads, calls = (*it)->calls;
+    expand(reads,calls);
+
+    (*it)->neighbours.clear();
+
+    for ( set<string>::iterator rit = reads.begin(); rit != reads.end(); rit++ ){
+
+      map<string,Formula *>::iterator writer = writers.find(*rit);
+
+      if ( writer != writers.end() )
+	(*it)->neighbours.push_back(writer->second);
+
+    }
+
+  }
+
+  Graph graph(nodes);
+  Ordering ordering(&graph);
+  ordering.find_scc();
+
+  vector<Formula *> ordered;
+
+  for ( vector< vector<Formula *> >::iterator it = ordering.components.begin(); it != ordering.components.end(); it++ ){
+
+    Formula *formula = it->front();
+
+    if ( it->size() > 1 || find(formula->neighbours.begin(),formula->neighbours.end(),formula) != formula->neighbours.end() ){
+
+      string names;
+
+      for ( vector<Formula *>::iterator cit = it->begin(); cit != it->end(); cit++ )
+	names += ( cit == it->begin() ? "" : "," ) + (*cit)->name;
+
+      throw EvalException("cyclic dependency of variables!",names.c_str());
+
+    }
+
+    ordered.push_back(formula);
+
+  }
+
+  return ordered;
+
+}
+
+void Spreadsheet::recompute(set<string> variables, const set<string> &functions, const Formula *skip)
+  throw (ExceptionBase){
+
+  vector<Formula *> ordered = order();
+
+  for ( vector<Formula *>::iterator it = ordered.begin(); it != ordered.end(); it++ ){
+
+    Formula *formula = *it;
+
+    if ( formula == skip )
+      continue;
+
+    set<string> reads = formula->reads, calls = formula->calls;
+    expand(reads,calls);
+
+    bool affected = false;
+
+    for ( set<string>::iterator rit = reads.begin(); !affected && rit != reads.end(); rit++ )
+      affected = ( variables.find(*rit) != variables.end() );
+
+    for ( set<string>::iterator cit = calls.begin(); !affected && cit != calls.end(); cit++ )
+      affected = ( functions.find(*cit) != functions.end() );
+
+    if ( !affected )
+      continue;
+
+    try{
+
+      formula->expression->eval();
+
+    } catch ( EvalException &ee ){
+
+      throw EvalException(ee.getMsg().c_str(),formula->name.c_str());
+
+    }
+
+    recomputed.push_back(formula->name);
+    variables.insert(formula->name);
+    variables.insert(formula->writes.begin(),formula->writes.end());
+
+  }
+
+}
+
+void Spreadsheet::forget(const string &name){
+
+  map<string,Formula *>::iterator it = formulas.find(name);
+
+  if ( it != formulas.end() ){
+
+    delete it->second;
+    formulas.erase(it);
+
+  }
+
+}
+
+Value *Spreadsheet::evaluate(const char *expression) throw (ParseException,ExceptionBase,FunctionDefinition){
+
+  recomputed.clear();
+  last.reset();
+
+  auto_ptr<MathExpression> tree(new MathExpression(expression,varlist,functionlist));
+
+  set<string> reads, writes, calls;
+  scan(tree.get(),set<string>(),reads,writes,calls);
+
+  // "<variable>=<expression>" not reading <variable> becomes a formula
+  string name;
+
+  if ( tree->isOperator() && tree->operator_id == MathExpression::OI_ASSIGN
+       && tree->getLeft() && tree->getLeft()->isVariable() ){
+
+    set<string> expandedreads = reads, expandedcalls = calls;
+    expand(expandedreads,expandedcalls);
+
+    if ( expandedreads.find(tree->getLeft()->getVariable()) == expandedreads.end() )
+      name = tree->getLeft()->getVariable();
+
+  }
+
+  Formula *candidate = 0;
+  Formula *previous = 0;
+
+  if ( name != "" ){
+
+    writes.erase(name);
+
+    candidate = new Formula(name,expression,tree.release());
+    candidate->reads = reads;
+    candidate->writes = writes;
+    candidate->calls = calls;
+
+    map<string,Formula *>::iterator it = formulas.find(name);
+
+    if ( it != formulas.end() )
+      previous = it->second;
+
+    formulas[name] = candidate;
+
+    try{
+
+      order();
+
+    } catch ( ExceptionBase & ){
+
+      if ( previous )
+	formulas[name] = previous;
+      else
+	formulas.erase(name);
+
+      delete candidate;
+      throw;
+
+    }
+
+    writes.insert(name);
+
+  }
+
+  Value *value;
+
+  try{
+
+    value = ( candidate ? candidate->expression : tree.get() )->eval();
+
+  } catch ( FunctionDefinition &fd ){
+
+    set<string> functions;
+    functions.insert(fd.getName());
+    recompute(set<string>(),functions,0);
+    throw;
+
+  } catch ( ExceptionBase & ){
+
+    if ( candidate ){
+
+      if ( previous )
+	formulas[name] = previous;
+      else
+	formulas.erase(name);
+
+      delete candidate;
+
+    }
+
+    throw;
+
+  }
+
+  delete previous;
+
+  // other variables assigned are plain values now
+  for ( set<string>::iterator it = writes.begin(); it != writes.end(); it++ )
+    if ( *it != name )
+      forget(*it);
+
+  if ( !candidate )
+    last = tree;
+
+  recompute(writes,set<string>(),candidate);
+
+  return value;
+
+}
+
+void Spreadsheet::update(const string &name) throw (ExceptionBase){
+
+  recomputed.clear();
+
+  set<string> names;
+  names.insert(name);
+
+  recompute(names,names,0);
+
+}
+
+void Spreadsheet::remove(const string &name){
+
+  forget(name);
+
+}
+
+void Spreadsheet::clear(){
+
+  for ( map<string,Formula *>::iterator it = formulas.begin(); it != formulas.end(); it++ )
+    delete it->second;
+
+  formulas.clear();
+  last.reset();
+  recomputed.clear();
+
+}
+
+string Spreadsheet::toString() const {
+
+  ostringstream os;
+
+  for ( map<string,Formula *>::const_iterator it = formulas.begin(); it != formulas.end(); it++ ){
+
+    os << it->second->text;
+
+    set<string> reads = it->second->reads, calls = it->second->calls;
+    expand(reads,calls);
+
+    string depends;
+
+    for ( set<string>::iterator rit = reads.begin(); rit != reads.end(); rit++ )
+      if ( formulas.find(*rit) != formulas.end() )
+	depends += ( depends == "" ? "" : "," ) + *rit;
+
+    if ( depends != "" )
+      os << "  <- " << depends;
+
+    os << endl;
+
+  }
+
+  return os.str();
+
+}
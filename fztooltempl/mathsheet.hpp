@@ -0,0 +1,180 @@
+/*
+  Copyright (C) 1999-2008 Friedemann Zintel
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  For any questions, contact me at
+  friezi@cs.tu-berlin.de
+*/
+
+/**
+   @file mathsheet.hpp
+   @author Friedemann Zintel
+*/
+
+#ifndef FZTOOLTEMPL_MATHSHEET_HPP
+#define FZTOOLTEMPL_MATHSHEET_HPP
+
+#include <string>
+#include <vector>
+#include <set>
+#include <map>
+#include <memory>
+#include <fztooltempl/exception.hpp>
+#include <fztooltempl/mathexpression.hpp>
+
+namespace mexp{
+
+  /**
+     A Spreadsheet evaluates expressions for a VariableList and a FunctionList like a spreadsheet its cells: an
+     assignment "<variable>=<expression>" on the top-level is kept as the formula of the variable. Whenever a
+     variable is assigned, the formulas reading it, directly or by the functions they call, are evaluated again,
+     and so on for the variables assigned by them. Defining a function recomputes the formulas calling it, as
+     does update() after the function was undefined, which then fails with the name of the formula.\n
+     The formulas and the variables they read form the dependency-graph; its strongly connected components give
+     the order of the recomputation and reveal cycles. A formula closing a cycle is rejected. An assignment
+     reading the variable itself (e.g. "x=x+1") is an update of the value and removes the formula, as does any
+     other assignment to the variable.
+     @brief incremental recomputation of the variables depending on a modified variable
+  */
+  class Spreadsheet{
+
+  private:
+
+    /**
+       @brief the formula of a variable
+       @internal
+    */
+    class Formula{
+
+    public:
+
+      std::string name;
+      std::string text;
+      MathExpression *expression;
+
+      // the variables read, the variables assigned besides <name> and the functions called by the expression
+      std::set<std::string> reads;
+      std::set<std::string> writes;
+      std::set<std::string> calls;
+
+      // the formulas of the variables read, directly or by the called functions
+      std::vector<Formula *> neighbours;
+
+      Formula(const std::string &name, const char *text, MathExpression *expression)
+	: name(name), text(text), expression(expression){}
+      ~Formula(){ delete expression; }
+
+    };
+
+    class Graph;
+    class Ordering;
+
+    VariableList *varlist;
+    FunctionList *functionlist;
+
+    std::map<std::string,Formula *> formulas;
+
+    // an expression which is no formula, kept until the next evaluation
+    std::auto_ptr<MathExpression> last;
+
+    std::vector<std::string> recomputed;
+
+    // copyconstructor: not for use
+    Spreadsheet(const Spreadsheet &){}
+
+    static void scan(const MathExpression *node, std::set<std::string> bound, std::set<std::string> &reads,
+		     std::set<std::string> &writes, std::set<std::string> &calls);
+
+    // the variables read and the functions called by the functions in <calls>, recursively
+    void expand(std::set<std::string> &reads, std::set<std::string> &calls) const;
+
+    // the formulas, dependencies first; throws if there is a cycle
+    std::vector<Formula *> order() throw (exc::ExceptionBase);
+
+    void recompute(std::set<std::string> variables, const std::set<std::string> &functions, const Formula *skip)
+      throw (exc::ExceptionBase);
+
+    void forget(const std::string &name);
+
+  public:
+
+    /**
+       @param vl the VariableList
+       @param fl the FunctionList
+    */
+    Spreadsheet(VariableList *vl, FunctionList *fl) : varlist(vl), functionlist(fl){}
+
+    ~Spreadsheet();
+
+    /**
+       The formulas depending on the variables assigned (resp. the function defined) are recomputed afterwards,
+       their names are available by getRecomputed(). A formula closing a cycle isn't evaluated at all.
+       @brief evaluates an expression and recomputes the dependent formulas
+       @param expression the expression-string
+       @return the value, valid until the next call of evaluate()
+       @exception ParseException
+       @exception EvalException if the evaluation or a recomputation fails, or on a cycle of formulas
+       @exception FunctionDefinition if a function has been defined
+    */
+    Value *evaluate(const char *expression) throw (ParseException,exc::ExceptionBase,FunctionDefinition);
+
+    /**
+       @brief recomputes the formulas depending on a variable or function modified outside of the sheet
+       @param name the name of the variable or function
+       @exception EvalException if a recomputation fails, e.g. of a formula calling an undefined function, or
+       on a cycle of formulas
+    */
+    void update(const std::string &name) throw (exc::ExceptionBase);
+
+    /**
+       The value of the variable stays as it is.
+       @brief removes the formula of a variable
+       @param name the name of the variable
+    */
+    void remove(const std::string &name);
+
+    /**
+       @brief removes all formulas
+    */
+    void clear();
+
+    /**
+       @brief returns the number of formulas
+       @return the number of formulas
+    */
+    unsigned long getSize() const { return formulas.size(); }
+
+    /**
+       @brief returns the names of the variables recomputed by the last evaluate() or update(), in their order
+       @return the names
+    */
+    const std::vector<std::string> &getRecomputed() const { return recomputed; }
+
+    /**
+       @brief returns the formulas, one per line, with the variables they depend on
+       @return the string representing the formulas
+    */
+    std::string toString() const;
+
+  };
+
+}
+
+#endif
@@ -0,0 +1,655 @@
+/*
+  Copyright (C) 1999-2008 Friedemann Zintel
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  For any questions, contact me at
+  friezi@cs.tu-berlin.de
+*/
+
+#include <fstream>
+#include <memory>
+#include <set>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fztooltempl/mathprogram.hpp>
+#include <fztooltempl/mathsnapshot.hpp>
+
+using namespace std;
+using namespace exc;
+using namespace mexp;
+
+const char Snapshot::MAGIC[8] = {'F','Z','S','N','A','P','\r','\n'};
+
+// written to the header for recognizing an other byte-order
+static const uint32_t ORDER_MARK = 0x01020304;
+
+// tags of the values
+static const char VT_COMPLEX = 'c';
+static const char VT_INTEGER = 'z';
+static const char VT_TUPLE = 't';
+static const char VT_MATRIX = 'm';
+
+class Snapshot::Writer{
+
+private:
+
+  ofstream file;
+
+public:
+
+  Writer(const char *filename) : file(filename,ios::out | ios::binary | ios::trunc){}
+
+  bool good() const { return file.good(); }
+
+  void bytes(const void *data, size_t size){ file.write((const char *)data,(streamsize)size); }
+
+  template<typename T> void put(T value){ bytes(&value,sizeof(T)); }
+
+  void put(const string &text){
+
+    put((uint32_t)text.size());
+    bytes(text.data(),text.size());
+
+  }
+
+};
+
+// reads the mapped file, every read is checked against its end
+class Snapshot::Reader{
+
+private:
+
+  const char *data;
+  size_t size;
+  size_t position;
+
+public:
+
+  Reader(const char *data, size_t size) : data(data), size(size), position(0){}
+
+  bool atEnd() const { return ( position == size ); }
+
+  const char *bytes(size_t count) throw (Exception<Snapshot>){
+
+    if ( count > size - position )
+      throw Exception<Snapshot>("corrupt snapshot!");
+
+    const char *current = data + position;
+    position += count;
+
+    return current;
+
+  }
+
+  template<typename T> T get() throw (Exception<Snapshot>){
+
+    T value;
+    memcpy(&value,bytes(sizeof(T)),sizeof(T));
+
+    return value;
+
+  }
+
+  string getString() throw (Exception<Snapshot>){
+
+    uint32_t length = get<uint32_t>();
+
+    return string(bytes(length),length);
+
+  }
+
+};
+
+// the file mapped read-only into memory
+class SnapshotMapping{
+
+private:
+
+  int descriptor;
+  void *data;
+  size_t size;
+
+public:
+
+  SnapshotMapping(const char *filename) : descriptor(open(filename,O_RDONLY)), data(MAP_FAILED), size(0){
+
+    struct stat status;
+
+    if ( descriptor < 0 || fstat(descriptor,&status) || status.st_size == 0 )
+      return;
+
+    size = (size_t)status.st_size;
+    data = mmap(0,size,PROT_READ,MAP_PRIVATE,descriptor,0);
+
+  }
+
+  ~SnapshotMapping(){
+
+    if ( data != MAP_FAILED )
+      munmap(data,size);
+
+    if ( descriptor >= 0 )
+      close(descriptor);
+
+  }
+
+  bool valid() const { return ( data != MAP_FAILED ); }
+  const char *getData() const { return (const char *)data; }
+  size_t getSize() const { return size; }
+
+};
+
+void Snapshot::writeValue(Writer &writer, const Value *value) throw (ExceptionBase){
+
+  if ( const Integer *integer = dynamic_cast<const Integer *>(value) ){
+
+    writer.put(VT_INTEGER);
+    writer.put((char)integer->isNegative());
+    writer.put((uint32_t)integer->getDigits().size());
+
+    if ( !integer->getDigits().empty() )
+      writer.bytes(&integer->getDigits()[0],integer->getDigits().size()*sizeof(uint32_t));
+
+  } else if ( const Complex *cmplx = dynamic_cast<const Complex *>(value) ){
+
+    writer.put(VT_COMPLEX);
+    writer.put(cmplx->getRe());
+    writer.put(cmplx->getIm());
+
+  } else if ( const Tuple *tuple = dynamic_cast<const Tuple *>(value) ){
+
+    writer.put(VT_TUPLE);
+    writer.put((uint32_t)tuple->elements.size());
+
+    for ( vector<Value *>::const_iterator it = tuple->elements.begin(); it != tuple->elements.end(); it++ )
+      writeValue(writer,*it);
+
+  } else if ( const Matrix *matrix = dynamic_cast<const Matrix *>(value) ){
+
+    writer.put(VT_MATRIX);
+    writer.put((uint64_t)matrix->getRows());
+    writer.put((uint64_t)matrix->getColumns());
+
+    for ( size_t row = 0; row < matrix->getRows(); row++ )
+      for ( size_t column = 0; column < matrix->getColumns(); column++ ){
+
+	writer.put(matrix->get(row,column).real());
+	writer.put(matrix->get(row,column).imag());
+
+      }
+
+  } else
+    throw Exception<Snapshot>("value not supported!");
+
+}
+
+Value *Snapshot::readValue(Reader &reader) throw (ExceptionBase){
+
+  char tag = reader.get<char>();
+
+  if ( tag == VT_COMPLEX ){
+
+    cmplx_tp re = reader.get<cmplx_tp>();
+
+    return new Complex(re,reader.get<cmplx_tp>());
+
+  } else if ( tag == VT_INTEGER ){
+
+    bool negative = ( reader.get<char>() != 0 );
+    uint32_t count = reader.get<uint32_t>();
+    const char *limbs = reader.bytes((size_t)count*sizeof(uint32_t));
+
+    Integer::Digits digits(count);
+
+    if ( count )
+      memcpy(&digits[0],limbs,(size_t)count*sizeof(uint32_t));
+
+    return new Integer(negative,digits);
+
+  } else if ( tag == VT_TUPLE ){
+
+    uint32_t count = reader.get<uint32_t>();
+    auto_ptr<Tuple> tuple(new Tuple());
+
+    for ( uint32_t i = 0; i < count; i++ )
+      tuple->addElement(readValue(reader));
+
+    return tuple.release();
+
+  } else if ( tag == VT_MATRIX ){
+
+    uint64_t rows = reader.get<uint64_t>();
+    uint64_t columns = reader.get<uint64_t>();
+
+    // the entries must be present before the matrix is allocated
+    if ( columns && rows > ( (uint64_t)-1 / 2 / sizeof(cmplx_tp) ) / columns )
+      throw Exception<Snapshot>("corrupt snapshot!");
+
+    const char *entries = reader.bytes((size_t)(rows*columns*2*sizeof(cmplx_tp)));
+    auto_ptr<Matrix> matrix(new Matrix((size_t)rows,(size_t)columns));
+    cmplx_tp entry[2];
+
+    for ( size_t row = 0; row < rows; row++ )
+      for ( size_t column = 0; column < columns; column++, entries += sizeof(entry) ){
+
+	memcpy(entry,entries,sizeof(entry));
+	matrix->set(row,column,complex<cmplx_tp>(entry[0],entry[1]));
+
+      }
+
+    return matrix.release();
+
+  }
+
+  throw Exception<Snapshot>("corrupt snapshot!");
+
+}
+
+// a node followed by its children: the elements if there is a left child, otherwise the right child if any
+void Snapshot::writeTree(Writer &writer, const MathExpression *node) throw (ExceptionBase){
+
+  writer.put(node->getEType());
+  writer.put(node->getOType());
+  writer.put((int32_t)node->abs_pos);
+  writer.put(node->getImaginaryUnit());
+  writer.put(node->cache);
+
+  if ( node->isOperator() )
+    writer.put(node->oprtr);
+  else if ( node->isVariable() )
+    writer.put(node->variable);
+
+  if ( node->isValue() || ( node->isOperator() && node->cache == MathExpression::CS_CONSTANT ) )
+    writeValue(writer,node->getValue());
+
+  if ( node->getLeft() ){
+
+    writer.put((uint32_t)node->elements.size());
+
+    for ( list<MathExpression *>::const_iterator it = node->elements.begin(); it != node->elements.end(); it++ )
+      writeTree(writer,*it);
+
+    writer.put((char)0);
+
+  } else{
+
+    writer.put((uint32_t)0);
+    writer.put((char)( node->getRight() != 0 ));
+
+    if ( node->getRight() )
+      writeTree(writer,node->getRight());
+
+  }
+
+}
+
+MathExpression *Snapshot::readTree(Reader &reader, VariableList *vl, FunctionList *fl) throw (ExceptionBase){
+
+  char type = reader.get<char>();
+  unsigned char otype = reader.get<unsigned char>();
+  int32_t abs_pos = reader.get<int32_t>();
+  char imaginary_unit = reader.get<char>();
+  char cache = reader.get<char>();
+
+  auto_ptr<MathExpression> node(new MathExpression(abs_pos,vl,fl));
+
+  node->setImaginaryUnit(imaginary_unit);
+
+  switch ( type ){
+
+  case MathExpression::ET_OP:
+    // the operator-id is resolved again, it isn't part of the format
+    node->setETOperator(reader.getString().c_str());
+    node->setOType(otype);
+    if ( cache == MathExpression::CS_CONSTANT )
+      node->value = readValue(reader);
+    break;
+
+  case MathExpression::ET_VAR:
+    node->setETVariable(reader.getString().c_str());
+    break;
+
+  case MathExpression::ET_VAL:
+    node->setETValue(readValue(reader));
+    break;
+
+  case MathExpression::ET_EMPTY:
+    node->setEType(type);
+    break;
+
+  default:
+    throw Exception<Snapshot>("corrupt snapshot!");
+
+  }
+
+  node->cache = cache;
+
+  uint32_t count = reader.get<uint32_t>();
+
+  for ( uint32_t i = 0; i < count; i++ ){
+
+    MathExpression *element = readTree(reader,vl,fl);
+
+    node->addElement(element);
+    element->pred = node.get();
+
+  }
+
+  // the only child is the right one, setRight() would drop the last element
+  if ( reader.get<char>() ){
+
+    if ( count )
+      throw Exception<Snapshot>("corrupt snapshot!");
+
+    MathExpression *right = readTree(reader,vl,fl);
+
+    node->setRight(right);
+    right->pred = node.get();
+
+  }
+
+  return node.release();
+
+}
+
+// the shapes MathExpression::checkSyntaxAndOptimize() lets pass, the compiler and eval() rely on them
+bool Snapshot::isWellFormed(const MathExpression *node){
+
+  const MathExpression *left = node->getLeft();
+  const MathExpression *right = node->getRight();
+  size_t count = node->elements.size();
+
+  if ( node->isValue() || node->isVariable() )
+    return ( !count && node->cache == MathExpression::CS_NONE && ( node->isValue() || !node->variable.empty() ) );
+
+  if ( !node->isOperator() || node->oprtr.empty() )
+    return false;
+
+  if ( node->cache != MathExpression::CS_NONE && node->cache != MathExpression::CS_CONSTANT
+       && node->cache != MathExpression::CS_INVARIANT )
+    return false;
+
+  switch ( node->operator_id ){
+
+  case MathExpression::OI_ADD:
+  case MathExpression::OI_SUB:
+  case MathExpression::OI_MUL:
+  case MathExpression::OI_DIV:
+  case MathExpression::OI_IDIV:
+  case MathExpression::OI_MOD:
+  case MathExpression::OI_POW:
+  case MathExpression::OI_CHOOSE:
+  case MathExpression::OI_LT:
+  case MathExpression::OI_LE:
+  case MathExpression::OI_GT:
+  case MathExpression::OI_GE:
+  case MathExpression::OI_EQ:
+  case MathExpression::OI_NE:
+  case MathExpression::OI_LOG:
+
+    return ( count == 2 && isWellFormed(left) && isWellFormed(right) );
+
+  case MathExpression::OI_ASSIGN:
+
+    // an operand may be missing below a faculty, e.g. "(x=)!", compiler and eval() throw then
+    if ( right && !isWellFormed(right) )
+      return false;
+
+    if ( !left )
+      return ( count == 1 );
+
+    if ( count > 2 )
+      return false;
+
+    if ( left->isVariable() )
+      return isWellFormed(left);
+
+    // the head of a function-definition
+    return ( left->isOperator() && left->operator_id == MathExpression::OI_USER && !left->getLeft()
+	     && left->getRight() && left->getRight()->checkForVariableTree() );
+
+  case MathExpression::OI_COMMA:
+
+    if ( !count
+	 || ( node->getOType() != MathExpression::OT_TUPLE && node->getOType() != MathExpression::OT_PARAMETER ) )
+      return false;
+
+    for ( list<MathExpression *>::const_iterator it = node->elements.begin(); it != node->elements.end(); it++ )
+      if ( !isWellFormed(*it) )
+	return false;
+
+    return true;
+
+  case MathExpression::OI_SUM:
+  case MathExpression::OI_PROD:
+
+    // Sum[k=start;end](body)
+    return ( count == 2 && left->oprtr == ";" && left->elements.size() == 2
+	     && left->getLeft()->operator_id == MathExpression::OI_ASSIGN && left->getLeft()->isOperator()
+	     && left->getLeft()->elements.size() == 2 && left->getLeft()->getLeft()->isVariable()
+	     && isWellFormed(left->getLeft()) && isWellFormed(left->getRight()) && isWellFormed(right) );
+
+  case MathExpression::OI_COND:
+  case MathExpression::OI_SOLVE:
+
+    return ( !left && right && right->operator_id == MathExpression::OI_COMMA && right->isOperator()
+	     && right->elements.size() == ( node->operator_id == MathExpression::OI_COND ? 3 : 2 )
+	     && isWellFormed(right) );
+
+  case MathExpression::OI_USER:
+
+    // a call of a user-defined function, "f()" has an empty argument
+    return ( node->oprtr != ";" && node->getOType() == MathExpression::OT_FUNCTION && !left && right
+	     && ( ( right->isEmpty() && right->elements.empty() ) || isWellFormed(right) ) );
+
+  default:
+
+    // faculty, unary operators and builtin functions
+    return ( !left && right && isWellFormed(right) );
+
+  }
+
+}
+
+void Snapshot::save(const char *filename, VariableList *vl, FunctionList *fl) throw (ExceptionBase){
+
+  Writer writer(filename);
+
+  if ( !writer.good() )
+    throw Exception<Snapshot>("can't write file!");
+
+  writer.bytes(MAGIC,sizeof(MAGIC));
+  writer.put(VERSION);
+  writer.put(ORDER_MARK);
+  writer.put((uint32_t)sizeof(cmplx_tp));
+
+  uint32_t variables = 0;
+
+  for ( VariableList::iterator it = vl->begin(); it != vl->end(); it++ )
+    if ( !(*it).getProtect() )
+      variables++;
+
+  writer.put(variables);
+
+  for ( VariableList::iterator it = vl->begin(); it != vl->end(); it++ )
+    if ( !(*it).getProtect() ){
+
+      writer.put(string((*it).getName()));
+      writeValue(writer,(*it).getValue());
+
+    }
+
+  uint32_t functions = 0;
+
+  for ( Function *function = fl->first; function; function = function->next )
+    functions++;
+
+  writer.put(functions);
+
+  for ( Function *function = fl->first; function; function = function->next ){
+
+    writer.put(string(function->getName()));
+    writeTree(writer,function->getParameterList());
+    writeTree(writer,function->getBody());
+    writer.put((char)function->pure);
+    writer.put((uint32_t)function->locals.size());
+
+    for ( set<string>::const_iterator it = function->locals.begin(); it != function->locals.end(); it++ )
+      writer.put(*it);
+
+  }
+
+  if ( !writer.good() )
+    throw Exception<Snapshot>("can't write file!");
+
+}
+
+bool Snapshot::isSnapshot(const char *filename){
+
+  ifstream file(filename,ios::in | ios::binary);
+  char magic[sizeof(MAGIC)];
+
+  return ( file.read(magic,sizeof(magic)) && !memcmp(magic,MAGIC,sizeof(MAGIC)) );
+
+}
+
+vector<string> Snapshot::load(const char *filename, VariableList *vl, FunctionList *fl) throw (ExceptionBase){
+
+  SnapshotMapping mapping(filename);
+
+  if ( !mapping.valid() )
+    throw Exception<Snapshot>("can't read file!");
+
+  Reader reader(mapping.getData(),mapping.getSize());
+
+  if ( memcmp(reader.bytes(sizeof(MAGIC)),MAGIC,sizeof(MAGIC)) )
+    throw Exception<Snapshot>("no snapshot!");
+
+  if ( reader.get<uint32_t>() != VERSION )
+    throw Exception<Snapshot>("unsupported version of snapshot!");
+
+  if ( reader.get<uint32_t>() != ORDER_MARK || reader.get<uint32_t>() != sizeof(cmplx_tp) )
+    throw Exception<Snapshot>("snapshot written on an incompatible machine!");
+
+  // everything is read before the lists are modified
+  vector< pair<string,Value *> > variables;
+  vector<Function *> functions;
+  vector<string> skipped;
+
+  try{
+
+    for ( uint32_t count = reader.get<uint32_t>(); count; count-- ){
+
+      string name = reader.getString();
+
+      variables.push_back(make_pair(name,readValue(reader)));
+
+    }
+
+    for ( uint32_t count = reader.get<uint32_t>(); count; count-- ){
+
+      string name = reader.getString();
+      auto_ptr<MathExpression> paramlist(readTree(reader,vl,fl));
+      auto_ptr<MathExpression> body(readTree(reader,vl,fl));
+
+      if ( name.empty() || MathExpression::isBuiltinFunction(name.c_str()) || !paramlist->checkForVariableTree()
+	   || !isWellFormed(body.get()) )
+	throw Exception<Snapshot>("corrupt snapshot!");
+
+      Function *function = new Function(name.c_str(),paramlist.release(),body.release());
+      functions.push_back(function);
+
+      function->pure = ( reader.get<char>() != 0 );
+
+      for ( uint32_t locals = reader.get<uint32_t>(); locals; locals-- )
+	function->locals.insert(reader.getString());
+
+    }
+
+    if ( !reader.atEnd() )
+      throw Exception<Snapshot>("corrupt snapshot!");
+
+  } catch ( ExceptionBase & ){
+
+    for ( vector< pair<string,Value *> >::iterator it = variables.begin(); it != variables.end(); it++ )
+      delete it->second;
+
+    for ( vector<Function *>::iterator it = functions.begin(); it != functions.end(); it++ )
+      delete *it;
+
+    throw;
+
+  }
+
+  for ( vector< pair<string,Value *> >::iterator it = variables.begin(); it != variables.end(); it++ ){
+
+    try{
+
+      vl->insert(it->first.c_str(),it->second);
+
+    } catch ( EvalException & ){
+
+      delete it->second;
+      skipped.push_back(it->first);
+
+    }
+
+  }
+
+  // the functions are linked at once, not one by one like FunctionList::insert() does
+  set<string> defined;
+  vector<Function *> inserted;
+
+  for ( Function *function = fl->first; function; function = function->next )
+    defined.insert(function->getName());
+
+  for ( vector<Function *>::iterator it = functions.begin(); it != functions.end(); it++ ){
+
+    if ( defined.insert((*it)->getName()).second )
+      inserted.push_back(*it);
+    else{
+
+      skipped.push_back((*it)->getName());
+      delete *it;
+
+    }
+
+  }
+
+  fl->append(inserted);
+
+  for ( vector<Function *>::iterator it = inserted.begin(); it != inserted.end(); it++ ){
+
+    try{
+      (*it)->program = new Program(*it,fl);
+    } catch ( ExceptionBase & ){
+      // compiled on the first call
+    }
+
+  }
+
+  if ( !inserted.empty() )
+    fl->setModified(true);
+
+  return skipped;
+
+}
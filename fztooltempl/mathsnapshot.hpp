@@ -0,0 +1,114 @@
+/*
+  Copyright (C) 1999-2008 Friedemann Zintel
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  For any questions, contact me at
+  friezi@cs.tu-berlin.de
+*/
+
+/**
+   @file mathsnapshot.hpp
+   @author Friedemann Zintel
+*/
+
+#ifndef FZTOOLTEMPL_MATHSNAPSHOT_HPP
+#define FZTOOLTEMPL_MATHSNAPSHOT_HPP
+
+#include <string>
+#include <vector>
+#include <fztooltempl/exception.hpp>
+#include <fztooltempl/mathexpression.hpp>
+
+namespace mexp{
+
+  /**
+     A snapshot holds the unprotected variables and the functions of a VariableList and a FunctionList in binary
+     form: numbers are stored bit by bit (integers with all their limbs, tuples and matrices with all their
+     entries), functions as their parsed parameter-lists and bodies. Loading parses nothing, the file is mapped
+     into memory and the trees are rebuilt node by node.\n
+     The file starts with MAGIC and VERSION; it is only readable on machines with the same byte-order and the same
+     representation of doubles. The text-format (VariableList::toString(), FunctionList::toString()) remains the
+     portable one.\n
+     Every tree is checked like the parser would: known operators with the operands they take, the range of a
+     Sum/Prod, the arguments of cond() and solve() and the parameter-list of a function; a file failing any check
+     is rejected as a whole.
+     @brief binary save and load of variables and functions
+  */
+  class Snapshot{
+
+  private:
+
+    class Writer;
+    class Reader;
+
+    static void writeValue(Writer &writer, const Value *value) throw (exc::ExceptionBase);
+    static Value *readValue(Reader &reader) throw (exc::ExceptionBase);
+
+    static void writeTree(Writer &writer, const MathExpression *node) throw (exc::ExceptionBase);
+    static MathExpression *readTree(Reader &reader, VariableList *vl, FunctionList *fl) throw (exc::ExceptionBase);
+    static bool isWellFormed(const MathExpression *node);
+
+  public:
+
+    /**
+       @brief the first bytes of a snapshot
+    */
+    static const char MAGIC[8];
+
+    /**
+       Incremented whenever the layout changes, older snapshots are rejected.
+       @brief the version of the format
+    */
+    static const uint32_t VERSION = 1;
+
+    /**
+       @brief writes the unprotected variables and the functions to a file
+       @param filename the name of the file
+       @param vl the VariableList
+       @param fl the FunctionList
+       @exception Exception<Snapshot> if the file can't be written
+    */
+    static void save(const char *filename, VariableList *vl, FunctionList *fl) throw (exc::ExceptionBase);
+
+    /**
+       @brief tests if a file starts like a snapshot
+       @param filename the name of the file
+       @return true, if the file starts with MAGIC
+    */
+    static bool isSnapshot(const char *filename);
+
+    /**
+       The whole file is read before any variable or function is inserted. Variables are overwritten, functions
+       already defined are kept.
+       @brief inserts the variables and functions of a snapshot
+       @param filename the name of the file
+       @param vl the VariableList
+       @param fl the FunctionList
+       @return the names of the protected variables and of the functions already defined, which haven't been loaded
+       @exception Exception<Snapshot> if the file can't be read, is no snapshot, has an other version or is corrupt
+    */
+    static std::vector<std::string> load(const char *filename, VariableList *vl, FunctionList *fl)
+      throw (exc::ExceptionBase);
+
+  };
+
+}
+
+#endif
@@ -0,0 +1,227 @@
+/*
+  Copyright (C) 1999-2008 Friedemann Zintel
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  For any questions, contact me at
+  friezi@cs.tu-berlin.de
+*/
+
+#include <cmath>
+#include <limits>
+#include <memory>
+#include <fztooltempl/mathprogram.hpp>
+#include <fztooltempl/mathtable.hpp>
+
+using namespace std;
+using namespace exc;
+using namespace mexp;
+
+unsigned long Grid::steps(cmplx_tp from, cmplx_tp to, cmplx_tp step) throw (ExceptionBase){
+
+  if ( !(step > 0) )
+    throw EvalException("the step of a tabulation must be positive!");
+
+  if ( to < from )
+    throw EvalException("the end of a tabulation is less than its start!");
+
+  // tolerating rounding-errors of the bound
+  cmplx_tp count = floor((to - from)/step*(1+1e-12) + 1e-9) + 1;
+
+  if ( count > (cmplx_tp)numeric_limits<long>::max() )
+    throw EvalException("too many points for a tabulation!");
+
+  return (unsigned long)count;
+
+}
+
+Grid::Grid(cmplx_tp from, cmplx_tp to, cmplx_tp step) throw (ExceptionBase)
+  : re_from(from), re_step(step), im_from(0), im_step(0), columns(steps(from,to,step)), rows(1){}
+
+Grid::Grid(cmplx_tp re_from, cmplx_tp re_to, cmplx_tp re_step, cmplx_tp im_from, cmplx_tp im_to, cmplx_tp im_step)
+  throw (ExceptionBase)
+  : re_from(re_from), re_step(re_step), im_from(im_from), im_step(im_step), columns(steps(re_from,re_to,re_step)),
+    rows(steps(im_from,im_to,im_step)){
+
+  if ( (cmplx_tp)columns*(cmplx_tp)rows > (cmplx_tp)numeric_limits<long>::max() )
+    throw EvalException("too many points for a tabulation!");
+
+}
+
+void CsvWriter::begin(const Grid &grid, const char *name) throw (ExceptionBase){
+
+  saved = out.precision(precision);
+
+  if ( grid.isPlane() )
+    out << "re(" << name << "),im(" << name << "),re,im\n";
+  else
+    out << name << ",re,im\n";
+
+}
+
+void CsvWriter::write(const Grid &grid, unsigned long first, unsigned long count, const cmplx_tp *re, const cmplx_tp *im)
+  throw (ExceptionBase){
+
+  cmplx_tp x, y;
+
+  for ( unsigned long i = 0; i < count; i++ ){
+
+    grid.point(first+i,x,y);
+
+    out << x << ',';
+
+    if ( grid.isPlane() )
+      out << y << ',';
+
+    out << re[i] << ',' << im[i] << '\n';
+
+  }
+
+  if ( out.fail() )
+    throw EvalException("writing the table failed!");
+
+}
+
+void CsvWriter::end() throw (ExceptionBase){
+
+  out.precision(saved);
+  out.flush();
+
+}
+
+void BinaryWriter::write(const Grid &grid, unsigned long first, unsigned long count, const cmplx_tp *re, const cmplx_tp *im)
+  throw (ExceptionBase){
+
+  buffer.resize(2*count);
+
+  for ( unsigned long i = 0; i < count; i++ ){
+
+    buffer[2*i] = (double)re[i];
+    buffer[2*i+1] = (double)im[i];
+
+  }
+
+  out.write((const char *)&buffer[0],(streamsize)(buffer.size()*sizeof(double)));
+
+  if ( out.fail() )
+    throw EvalException("writing the table failed!");
+
+}
+
+void BinaryWriter::end() throw (ExceptionBase){
+
+  out.flush();
+
+}
+
+Tabulation::Tabulation(const Program &program, const VariableList *varlist, const char *name, const Grid &grid,
+		       bool assigns)
+  : program(program), varlist(varlist), name(name), grid(grid), assigns(assigns), first(0){
+
+  unsigned long size = ( grid.getSize() < TILES*TILESIZE ? grid.getSize() : TILES*TILESIZE );
+
+  re.resize(size);
+  im.resize(size);
+
+}
+
+unsigned long Tabulation::evaluate(ThreadPool *pool, unsigned long first, unsigned long count){
+
+  this->first = first;
+  failures.assign(count,0);
+
+  if ( pool )
+    pool->run(*this,count);
+  else
+    for ( unsigned long part = 0; part < count; part++ )
+      run(part);
+
+  unsigned long failed = 0;
+
+  for ( vector<unsigned long>::iterator it = failures.begin(); it != failures.end(); it++ )
+    failed += *it;
+
+  return failed;
+
+}
+
+void Tabulation::write(TableWriter &writer, unsigned long count) throw (ExceptionBase){
+
+  for ( unsigned long part = 0; part < count; part++ ){
+
+    unsigned long begin = (first+part)*TILESIZE;
+    unsigned long length = ( grid.getSize() - begin < TILESIZE ? grid.getSize() - begin : TILESIZE );
+
+    writer.write(grid,begin,length,&re[part*TILESIZE],&im[part*TILESIZE]);
+
+  }
+
+}
+
+void Tabulation::run(unsigned long part){
+
+  unsigned long begin = (first+part)*TILESIZE;
+  unsigned long end = ( grid.getSize() - begin < TILESIZE ? grid.getSize() : begin+TILESIZE );
+  cmplx_tp *tile_re = &re[part*TILESIZE];
+  cmplx_tp *tile_im = &im[part*TILESIZE];
+  auto_ptr<VariableList> context;
+
+  for ( unsigned long i = begin; i < end; i++ ){
+
+    cmplx_tp x, y;
+    cmplx_tp &result_re = tile_re[i-begin];
+    cmplx_tp &result_im = tile_im[i-begin];
+
+    grid.point(i,x,y);
+
+    try{
+
+      // assignments must not be visible to the following points
+      if ( !context.get() || assigns )
+	context.reset(new VariableList(varlist,false));
+
+      context->insert(name,new Complex(x,y));
+
+      Value *value = program.run(context.get());
+      const Complex *cmplx = dynamic_cast<const Complex *>(value);
+
+      if ( cmplx ){
+
+	result_re = cmplx->getRe();
+	result_im = cmplx->getIm();
+
+      } else{
+
+	result_re = result_im = numeric_limits<cmplx_tp>::quiet_NaN();
+	failures[part]++;
+
+      }
+
+      delete value;
+
+    } catch (ExceptionBase &e){
+
+      result_re = result_im = numeric_limits<cmplx_tp>::quiet_NaN();
+      failures[part]++;
+
+    }
+
+  }
+
+}
@@ -0,0 +1,269 @@
+/*
+  Copyright (C) 1999-2008 Friedemann Zintel
+
+  This library is free software; you can redistribute it and/or
+  modify it under the terms of the GNU Lesser General Public
+  License as published by the Free Software Foundation; either
+  version 2.1 of the License, or (at your option) any later version.
+
+  This library is distributed in the hope that it will be useful,
+  but WITHOUT ANY WARRANTY; without even the implied warranty of
+  MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+  Lesser General Public License for more details.
+
+  You should have received a copy of the GNU Lesser General Public
+  License along with this library; if not, write to the Free Software
+  Foundation, Inc., 59 Temple Place, Suite 330, Boston, MA 02111-1307  USA
+  This program is free software; you can redistribute it and/or modify
+  it under the terms of the GNU General Public License as published by
+  the Free Software Foundation; either version 2 of the License, or
+  (at your option) any later version.
+
+  For any questions, contact me at
+  friezi@cs.tu-berlin.de
+*/
+
+/**
+   @file mathtable.hpp
+   @author Friedemann Zintel
+*/
+
+#ifndef FZTOOLTEMPL_MATHTABLE_HPP
+#define FZTOOLTEMPL_MATHTABLE_HPP
+
+#include <iostream>
+#include <vector>
+#include <fztooltempl/exception.hpp>
+#include <fztooltempl/mathexpression.hpp>
+#include <fztooltempl/mathparallel.hpp>
+
+namespace mexp{
+
+  /**
+     A Grid consists of the points from+k*step of a range of real numbers or of the points of a rectangle of the
+     complex plane, ordered row by row: the real part varies within a row, the imaginary part from row to row.
+     The bounds are included if they are reached by the steps.
+     @brief the points of a tabulation
+     @see MathExpression::tabulate()
+  */
+  class Grid{
+
+  private:
+
+    cmplx_tp re_from;
+    cmplx_tp re_step;
+    cmplx_tp im_from;
+    cmplx_tp im_step;
+    unsigned long columns;
+    unsigned long rows;
+
+    static unsigned long steps(cmplx_tp from, cmplx_tp to, cmplx_tp step) throw (exc::ExceptionBase);
+
+  public:
+
+    /**
+       @brief a range of real numbers
+       @param from the first point
+       @param to the last point
+       @param step the distance of the points, positive
+       @exception EvalException if the step is not positive or to is less than from
+    */
+    Grid(cmplx_tp from, cmplx_tp to, cmplx_tp step) throw (exc::ExceptionBase);
+
+    /**
+       @brief a rectangle of the complex plane
+       @param re_from the real part of the first point of a row
+       @param re_to the real part of the last point of a row
+       @param re_step the distance of the points of a row, positive
+       @param im_from the imaginary part of the first row
+       @param im_to the imaginary part of the last row
+       @param im_step the distance of the rows, positive
+       @exception EvalException if a step is not positive or a bound is less than its start
+    */
+    Grid(cmplx_tp re_from, cmplx_tp re_to, cmplx_tp re_step, cmplx_tp im_from, cmplx_tp im_to, cmplx_tp im_step)
+      throw (exc::ExceptionBase);
+
+    /**
+       @brief returns the number of points of a row
+       @return the number of columns
+    */
+    unsigned long getColumns() const { return columns; }
+
+    /**
+       @brief returns the number of rows, 1 for a range
+       @return the number of rows
+    */
+    unsigned long getRows() const { return rows; }
+
+    /**
+       @brief returns the number of points
+       @return the number of points
+    */
+    unsigned long getSize() const { return columns*rows; }
+
+    /**
+       @brief returns true if the grid is a rectangle of the complex plane
+       @return true for a rectangle, false for a range
+    */
+    bool isPlane() const { return im_step != 0; }
+
+    /**
+       @brief computes a point
+       @param index the index of the point, row by row
+       @param re receives the real part
+       @param im receives the imaginary part
+    */
+    void point(unsigned long index, cmplx_tp &re, cmplx_tp &im) const {
+      re = re_from + (cmplx_tp)(index % columns)*re_step;
+      im = im_from + (cmplx_tp)(index / columns)*im_step;
+    }
+
+  };
+
+  /**
+     A TableWriter receives the results of a tabulation in consecutive blocks of points in the order of the grid.
+     Points which couldn't be evaluated or whose result is a tuple have the result nan.
+     @brief the output of a tabulation
+     @see MathExpression::tabulate()
+  */
+  class TableWriter{
+
+  public:
+
+    virtual ~TableWriter(){}
+
+    /**
+       @brief called before the first block
+       @param grid the grid
+       @param name the name of the variable
+    */
+    virtual void begin(const Grid &grid, const char *name) throw (exc::ExceptionBase){}
+
+    /**
+       @brief receives the results of the points first..first+count-1
+       @param grid the grid
+       @param first the index of the first point
+       @param count the number of points
+       @param re the real parts of the results
+       @param im the imaginary parts of the results
+    */
+    virtual void write(const Grid &grid, unsigned long first, unsigned long count, const cmplx_tp *re, const cmplx_tp *im)
+      throw (exc::ExceptionBase) = 0;
+
+    /**
+       @brief called after the last block
+    */
+    virtual void end() throw (exc::ExceptionBase){}
+
+  };
+
+  /**
+     One line per point: the point (real and imaginary part for a rectangle) and the real and imaginary part of
+     the result, preceded by a line naming the columns.
+     @brief writes a tabulation as comma separated values
+  */
+  class CsvWriter : public TableWriter{
+
+  private:
+
+    std::ostream &out;
+    std::streamsize precision;
+    std::streamsize saved;
+
+  public:
+
+    /**
+       @param out the output-stream
+       @param precision the number of significant digits
+    */
+    CsvWriter(std::ostream &out, std::streamsize precision = 6) : out(out), precision(precision), saved(0){}
+
+    void begin(const Grid &grid, const char *name) throw (exc::ExceptionBase);
+    void write(const Grid &grid, unsigned long first, unsigned long count, const cmplx_tp *re, const cmplx_tp *im)
+      throw (exc::ExceptionBase);
+    void end() throw (exc::ExceptionBase);
+
+  };
+
+  /**
+     Two doubles in native byte-order per point: the real and the imaginary part of the result, the points in the
+     order of the grid.
+     @brief writes a tabulation as binary numbers
+  */
+  class BinaryWriter : public TableWriter{
+
+  private:
+
+    std::ostream &out;
+    std::vector<double> buffer;
+
+  public:
+
+    /**
+       @param out the output-stream, opened in binary mode
+    */
+    BinaryWriter(std::ostream &out) : out(out){}
+
+    void write(const Grid &grid, unsigned long first, unsigned long count, const cmplx_tp *re, const cmplx_tp *im)
+      throw (exc::ExceptionBase);
+    void end() throw (exc::ExceptionBase);
+
+  };
+
+  /**
+     @brief evaluates tiles of a grid, each part one tile
+     @internal
+  */
+  class Tabulation : public ThreadPool::Job{
+
+  public:
+
+    // the number of points of a tile and the maximal number of tiles held at the same time
+    static const unsigned long TILESIZE = 4096;
+    static const unsigned long TILES = 64;
+
+  private:
+
+    const Program &program;
+    const VariableList *varlist;
+    const char *name;
+    const Grid &grid;
+    bool assigns;
+
+    unsigned long first;
+    std::vector<cmplx_tp> re;
+    std::vector<cmplx_tp> im;
+    std::vector<unsigned long> failures;
+
+    // copyconstructor: not for use
+    Tabulation(const Tabulation &t) : program(t.program), grid(t.grid){}
+
+  public:
+
+    /**
+       @param program the compiled expression
+       @param varlist the variables the points are bound on top of
+       @param name the name of the variable
+       @param grid the points
+       @param assigns true if the expression contains assignments: every point gets a scope of its own
+    */
+    Tabulation(const Program &program, const VariableList *varlist, const char *name, const Grid &grid, bool assigns);
+
+    /**
+       @brief evaluates the tiles first..first+count-1 by the pool or, without pool, by the calling thread
+       @return the number of points which couldn't be evaluated
+    */
+    unsigned long evaluate(ThreadPool *pool, unsigned long first, unsigned long count);
+
+    /**
+       @brief passes the results of the tiles evaluated last to the writer
+    */
+    void write(TableWriter &writer, unsigned long count) throw (exc::ExceptionBase);
+
+    void run(unsigned long part);
+
+  };
+
+}
+
+#endif
@@ -12,6 +12,7 @@ TestUnit * createMainTestUnit(){
   mainTestUnit->addTestCase(new ObserverTest(),"ObserverTest");
   mainTestUnit->addTestCase(new RingbufferTest(),"RingbufferTest");
   mainTestUnit->addTestCase(new UtilsTest(),"UtilsTest");
+  mainTestUnit->addTestCase(new MathExpressionTest(),"MathExpressionTest");
 
   return mainTestUnit;
 
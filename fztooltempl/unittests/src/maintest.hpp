@@ -8,5 +8,6 @@
 #include "testobserver.hpp"
 #include "testringbuffer.hpp"
 #include "testutils.hpp"
+#include "testmathexpression.hpp"
 
 #endif
@@ -0,0 +1,1448 @@
+#ifndef TEST_MATHEXPRESSION_HPP
+#define TEST_MATHEXPRESSION_HPP
+
+#include <cmath>
+#include <cstdio>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <sstream>
+#include <vector>
+
+#include <fztooltempl/exception.hpp>
+#include <fztooltempl/mathexpression.hpp>
+#include <fztooltempl/mathprogram.hpp>
+#include <fztooltempl/mathcache.hpp>
+#include <fztooltempl/mathparallel.hpp>
+#include <fztooltempl/mathtable.hpp>
+#include <fztooltempl/mathsheet.hpp>
+#include <fztooltempl/mathsnapshot.hpp>
+#include <fztooltempl/mathprofile.hpp>
+#include <fztooltempl/test.hpp>
+
+class MathExpressionTest : public test::TestCase<MathExpressionTest>{
+
+private:
+
+  static const std::streamsize PRECISION = 10;
+
+  class Scope{
+
+  public:
+
+    mexp::VariableList *varlist;
+    mexp::FunctionList *functionlist;
+
+    Scope(){
+
+      varlist = new mexp::VariableList();
+      varlist->insert("pi",new mexp::Complex(M_PI),true);
+      varlist->insert("e",new mexp::Complex(M_E),true);
+      varlist->insert("i",new mexp::Complex(0,1),true);
+
+      functionlist = new mexp::FunctionList();
+
+      define("ifelse((b,x),y)=tst(b)*x+tst(1-b)*y");
+      define("swap(x,y)=(y,x)");
+      define("mmul(((a,b),(c,d)),((e,f),(g,h)))=((a*e+b*g,a*f+b*h),(c*e+d*g,c*f+d*h))");
+      define("poisson(l,k)=l^k/k!*exp(-l)");
+      define("SumPoisson(l,k)=Sum[j=0;k](poisson(l,j))");
+      varlist->insert("x",new mexp::Complex(100));
+      define("inner(y)=x*y");
+      define("outer(x)=inner(2)");
+      define("side(x)=Sum[j=1;x](t=j)");
+
+    }
+
+    ~Scope(){
+
+      delete functionlist;
+      delete varlist;
+
+    }
+
+    void define(const char *definition){
+
+      try{
+	mexp::MathExpression(definition,varlist,functionlist).eval();
+      } catch (mexp::FunctionDefinition &fd){}
+
+    }
+
+  };
+
+  // runs a shared program once per part, the variable a is bound to the number of the part
+  class SharedRun : public mexp::ThreadPool::Job{
+
+  public:
+
+    const mexp::Program &program;
+    const mexp::VariableList *globals;
+    std::vector<std::string> results;
+
+    SharedRun(const mexp::Program &program, const mexp::VariableList *globals, unsigned long parts)
+      : program(program), globals(globals), results(parts){}
+
+    void run(unsigned long part){
+
+      try{
+
+	mexp::VariableList context(globals,false);
+
+	context.insert("a",new mexp::Complex((mexp::cmplx_tp)part));
+
+	mexp::Value *value = program.run(&context);
+
+	results[part] = value->toString(PRECISION);
+	delete value;
+
+      } catch (exc::ExceptionBase &e){
+	results[part] = e.getIdMsg();
+      }
+
+    }
+
+  };
+
+  // collects the results of a tabulation
+  class TableCollector : public mexp::TableWriter{
+
+  public:
+
+    std::vector<mexp::cmplx_tp> re;
+    std::vector<mexp::cmplx_tp> im;
+    bool ordered;
+
+    TableCollector() : ordered(true){}
+
+    void write(const mexp::Grid &grid, unsigned long first, unsigned long count, const mexp::cmplx_tp *re,
+	       const mexp::cmplx_tp *im) throw (exc::ExceptionBase){
+
+      ordered = ordered && first == this->re.size();
+      this->re.insert(this->re.end(),re,re+count);
+      this->im.insert(this->im.end(),im,im+count);
+
+    }
+
+  };
+
+  // evaluates the expression either by the expression-tree or by the compiled program
+  static std::string evaluate(const char *expression, Scope &scope, bool compiled, std::streamsize precision = PRECISION){
+
+    try{
+
+      mexp::MathExpression me(expression,scope.varlist,scope.functionlist);
+
+      mexp::Value *value = ( compiled ? me.evalCompiled() : me.eval() );
+
+      return value->toString(precision);
+
+    } catch (mexp::FunctionDefinition &fd){
+      return std::string("defined ") + fd.getName();
+    } catch (exc::ExceptionBase &e){
+      return e.getIdMsg();
+    }
+
+  }
+
+  void assertSameResult(const char *expression) throw (exc::ExceptionBase){
+
+    Scope tree;
+    Scope compiled;
+
+    std::string expected = evaluate(expression,tree,false);
+
+    assertEquals(expected,evaluate(expression,compiled,true),expression);
+    assertEquals(tree.varlist->toString(true,PRECISION),compiled.varlist->toString(true,PRECISION),expression);
+    assertEquals(tree.varlist->isModified(),compiled.varlist->isModified(),expression);
+
+  }
+
+  void assertSameRealResult(const char *expression) throw (exc::ExceptionBase){
+
+    Scope generic;
+    Scope fastpath;
+
+    mexp::MathExpression::setRealFastPath(false);
+    std::string expected = evaluate(expression,generic,false,17);
+
+    mexp::MathExpression::setRealFastPath(true);
+    assertEquals(expected,evaluate(expression,fastpath,false,17),expression);
+
+  }
+
+public:
+
+  MathExpressionTest() : test::TestCase<MathExpressionTest>(){
+
+    addTest(&MathExpressionTest::testCompiledArithmetic,"testCompiledArithmetic");
+    addTest(&MathExpressionTest::testCompiledAssignment,"testCompiledAssignment");
+    addTest(&MathExpressionTest::testCompiledSumProd,"testCompiledSumProd");
+    addTest(&MathExpressionTest::testCompiledFunctions,"testCompiledFunctions");
+    addTest(&MathExpressionTest::testCompiledErrors,"testCompiledErrors");
+    addTest(&MathExpressionTest::testRecompileOnRedefinition,"testRecompileOnRedefinition");
+    addTest(&MathExpressionTest::testRebindOnRedefinition,"testRebindOnRedefinition");
+    addTest(&MathExpressionTest::testVariableListIndex,"testVariableListIndex");
+    addTest(&MathExpressionTest::testLocalScopes,"testLocalScopes");
+    addTest(&MathExpressionTest::testPoolAllocation,"testPoolAllocation");
+    addTest(&MathExpressionTest::testRealFastPath,"testRealFastPath");
+    addTest(&MathExpressionTest::testOptimization,"testOptimization");
+    addTest(&MathExpressionTest::testMemoization,"testMemoization");
+    addTest(&MathExpressionTest::testBatchEvaluation,"testBatchEvaluation");
+    addTest(&MathExpressionTest::testParallelSumProd,"testParallelSumProd");
+    addTest(&MathExpressionTest::testParsePositions,"testParsePositions");
+    addTest(&MathExpressionTest::testExpressionCache,"testExpressionCache");
+    addTest(&MathExpressionTest::testSharedProgram,"testSharedProgram");
+    addTest(&MathExpressionTest::testTabulation,"testTabulation");
+    addTest(&MathExpressionTest::testConditional,"testConditional");
+    addTest(&MathExpressionTest::testDeepRecursion,"testDeepRecursion");
+    addTest(&MathExpressionTest::testPrecompiledBodies,"testPrecompiledBodies");
+    addTest(&MathExpressionTest::testTupleValues,"testTupleValues");
+    addTest(&MathExpressionTest::testMatrices,"testMatrices");
+    addTest(&MathExpressionTest::testBigIntegers,"testBigIntegers");
+    addTest(&MathExpressionTest::testSpreadsheet,"testSpreadsheet");
+    addTest(&MathExpressionTest::testSnapshot,"testSnapshot");
+    addTest(&MathExpressionTest::testProfiler,"testProfiler");
+
+  }
+
+  void testCompiledArithmetic() throw (exc::ExceptionBase){
+
+    assertSameResult("1+2*3");
+    assertSameResult("2^3^2-7\\2+7%3");
+    assertSameResult("sin(pi/2)+ln(e)+log(2,8)+ld(16)");
+    assertSameResult("5!+10@3");
+    assertSameResult("ln(-1)");
+    assertSameResult("(1,2)+(3,4)");
+    assertSameResult("2*((1,2),3)");
+    assertSameResult("sgn(-2)+tst(0)+tst(3)");
+
+  }
+
+  void testCompiledAssignment() throw (exc::ExceptionBase){
+
+    assertSameResult("a=(b=2)+1");
+    assertSameResult("x=3");
+    assertSameResult("pi=3");
+    assertSameResult("(a=1,b=a+1)");
+
+  }
+
+  void testCompiledSumProd() throw (exc::ExceptionBase){
+
+    assertSameResult("Sum[k=1;100](k^2)");
+    assertSameResult("Prod[k=1;10](k)");
+    assertSameResult("Sum[k=3;1](k)");
+    assertSameResult("Sum[k=1;3](Prod[j=1;k](j))");
+    assertSameResult("Sum[k=1;4](s=k)+s");
+    assertSameResult("Sum[k=(a=2);4](k*a)+a");
+    assertSameResult("Sum[k=1;3]((k,1))");
+    assertSameResult("Sum[pi=1;3](pi)");
+    assertSameResult("Sum[k=1;3](e=k)");
+    assertSameResult("Sum[k=0.5;3](k)");
+
+  }
+
+  void testCompiledFunctions() throw (exc::ExceptionBase){
+
+    assertSameResult("Sum[k=1;5](ifelse((k%2,k),-k))");
+    assertSameResult("swap(1,2)");
+    assertSameResult("swap((1,2))");
+    assertSameResult("mmul(((1,2),(3,4)),((5,6),(7,8)))");
+    assertSameResult("SumPoisson(3,10)");
+    assertSameResult("outer(4)");
+    assertSameResult("side(3)");
+    assertSameResult("side(b=2)+b");
+    assertSameResult("f(x)=x^2");
+
+  }
+
+  void testCompiledErrors() throw (exc::ExceptionBase){
+
+    assertSameResult("unknown+1");
+    assertSameResult("swap(1)");
+    assertSameResult("swap(1,2,3)");
+    assertSameResult("swap(5)");
+    assertSameResult("inner(2)");
+    assertSameResult("Sum[k=-1;3](k)");
+    assertSameResult("Sum[k=1;2.5](k)");
+    assertSameResult("p0i*=!");
+    assertSameResult("f((2.;5))*(tst=())!");
+    assertSameResult("(x=)!");
+    assertSameResult("2*(=3)!");
+
+  }
+
+  void testRecompileOnRedefinition() throw (exc::ExceptionBase){
+
+    Scope scope;
+
+    scope.define("g(x)=x+1");
+
+    mexp::MathExpression me("g(2)",scope.varlist,scope.functionlist);
+
+    assertEquals(std::string("3"),me.evalCompiled()->toString(PRECISION));
+
+    scope.define("h(x)=x");
+    assertFalse(me.getProgram()->isValid());
+
+    scope.functionlist->remove("g");
+    scope.define("g(x)=x*10");
+    assertEquals(std::string("20"),me.evalCompiled()->toString(PRECISION));
+
+  }
+
+  void testRebindOnRedefinition() throw (exc::ExceptionBase){
+
+    Scope scope;
+
+    scope.define("g(x)=x+1");
+
+    mexp::MathExpression me("g(2)+sin(0)",scope.varlist,scope.functionlist);
+
+    assertEquals(std::string("3"),me.eval()->toString(PRECISION));
+
+    scope.functionlist->remove("g");
+    try{
+      me.eval();
+      assertTrue(false);
+    } catch (mexp::EvalException &e){}
+
+    scope.define("g(x)=x*10");
+    assertEquals(std::string("20"),me.eval()->toString(PRECISION));
+
+  }
+
+  void testVariableListIndex() throw (exc::ExceptionBase){
+
+    mexp::VariableList vl;
+    std::string expected;
+
+    for ( int i = 0; i < 100; i++ ){
+
+      std::ostringstream name;
+      name << "v" << i;
+
+      vl.insert(name.str().c_str(),new mexp::Complex(i),( i % 10 == 0 ));
+
+      if ( i != 42 ){
+	std::ostringstream line;
+	line << name.str() << "=" << ( i == 7 ? 70 : i ) << std::endl;
+	expected += line.str();
+      }
+
+    }
+
+    vl.insert("v7",new mexp::Complex(70));
+    vl.remove("v42");
+
+    assertEquals(99UL,vl.size());
+    assertEquals(expected,vl.toString(true,PRECISION));
+    assertTrue(vl.isMember("v42") == 0);
+    assertTrue(vl.isMember("v99") != 0);
+
+    try{
+      vl.insert("v30",new mexp::Complex(0));
+      assertTrue(false);
+    } catch (mexp::EvalException &e){}
+
+    mexp::VariableList copy(vl);
+
+    assertEquals(expected,copy.toString(true,PRECISION));
+    assertEquals(std::string("55"),copy.getValue("v55")->toString(PRECISION));
+
+  }
+
+  void testLocalScopes() throw (exc::ExceptionBase){
+
+    Scope scope;
+
+    for ( int i = 0; i < 200; i++ ){
+      std::ostringstream name;
+      name << "global" << char('a' + i % 26) << char('a' + i / 26);
+      scope.varlist->insert(name.str().c_str(),new mexp::Complex(i));
+    }
+
+    scope.define("twice(y)=2*y");
+    scope.define("quad(z)=twice(twice(z))");
+
+    mexp::MathExpression call("quad(3)",scope.varlist,scope.functionlist);
+    mexp::MathExpression sum("Sum[k=1;10](twice(k))",scope.varlist,scope.functionlist);
+
+    mexp::VariableList::resetStatistics();
+
+    assertEquals(std::string("12"),call.eval()->toString(PRECISION));
+
+    // the parameters are kept in the frames of the calls, the globals are not copied
+    assertEquals(0UL,mexp::VariableList::getAllocations());
+    assertEquals(0UL,mexp::VariableList::getMaxDepth());
+
+    mexp::VariableList::resetStatistics();
+
+    // only the scope of the Sum
+    assertEquals(std::string("110"),sum.eval()->toString(PRECISION));
+    assertEquals(1UL,mexp::VariableList::getAllocations());
+    assertEquals(1UL,mexp::VariableList::getMaxDepth());
+
+    // a local scope never modifies its enclosing scope
+    mexp::VariableList local(scope.varlist,false);
+
+    local.insert("x",new mexp::Complex(1));
+    assertEquals(std::string("1"),local.getValue("x")->toString(PRECISION));
+    assertEquals(std::string("100"),scope.varlist->getValue("x")->toString(PRECISION));
+    assertTrue(local.isMember("pi") != 0);
+
+    try{
+      local.insert("pi",new mexp::Complex(3));
+      assertTrue(false);
+    } catch (mexp::EvalException &e){}
+
+    mexp::VariableList unprotected(scope.varlist,true);
+
+    unprotected.insert("pi",new mexp::Complex(3));
+    assertEquals(std::string("3"),unprotected.getValue("pi")->toString(PRECISION));
+    assertEquals(1UL,unprotected.size());
+
+  }
+
+  void testPoolAllocation() throw (exc::ExceptionBase){
+
+    Scope scope;
+
+    mexp::MathExpression me("(Sum[k=1;100](2*k+k-k),1+2)",scope.varlist,scope.functionlist);
+
+    // intermediate values are only allocated by the generic path
+    mexp::MathExpression::setRealFastPath(false);
+
+    // warm up the pools
+    me.eval();
+
+    mexp::Pool::resetStatistics();
+
+    assertEquals(std::string("(10100,3)"),me.eval()->toString(PRECISION));
+    assertTrue(mexp::Pool::getRequests() > 500);
+    assertEquals(0UL,mexp::Pool::getHeapAllocations());
+
+    mexp::Pool::setEnabled(false);
+    mexp::Pool::resetStatistics();
+
+    assertEquals(std::string("(10100,3)"),me.eval()->toString(PRECISION));
+    assertEquals(mexp::Pool::getRequests(),mexp::Pool::getHeapAllocations());
+
+    mexp::Pool::setEnabled(true);
+    mexp::MathExpression::setRealFastPath(true);
+
+    // a thread takes over the pools of an exited thread with their free chunks
+    unsigned long first = 0, second = 0;
+    pthread_t thread;
+
+    pthread_create(&thread,0,allocateValue,&first);
+    pthread_join(thread,0);
+    pthread_create(&thread,0,allocateValue,&second);
+    pthread_join(thread,0);
+
+    assertEquals(0UL,second);
+
+  }
+
+  // allocates and deletes a value, stores the number of heap-allocations of the thread in heap_allocations
+  static void *allocateValue(void *heap_allocations){
+
+    delete new mexp::Complex(1);
+    *static_cast<unsigned long *>(heap_allocations) = mexp::Pool::getHeapAllocations();
+
+    return 0;
+
+  }
+
+  void testRealFastPath() throw (exc::ExceptionBase){
+
+    const char *expressions[] = { "1/3+2^0.5*sin(pi/7)-tan(1)\\3",
+				  "ln(2)+ld(10)+log(3,7)+exp(-1.5)+cosh(2)-tanh(0.3)",
+				  "asin(0.5)+acos(0.3)+atan(3)+asinh(1)+acosh(1.5)+atanh(0.2)",
+				  "acos(2)", "1-acosh(0.5)",
+				  "5!+10@3+sgn(-2)+tst(0)+7%3+(-7)%3",
+				  "ln(-1)+(-8)^(1/3)+ln((-1)*(-1)-2)",
+				  "1/0", "3.5!", "(-2)!", "200!", "2@5",
+				  "x*i+1", "Sum[k=1;20](k^2/(k+1))", "Sum[k=1;5](ln(k-3))",
+				  "outer(3)+ifelse((0,1),2)", 0 };
+
+    for ( int i = 0; expressions[i]; i++ )
+      assertSameRealResult(expressions[i]);
+
+    Scope scope;
+    mexp::MathExpression real("x^2+sin(x)",scope.varlist,scope.functionlist);
+    mexp::MathExpression cmplx("x^2+i",scope.varlist,scope.functionlist);
+
+    mexp::MathExpression::resetStatistics();
+    cmplx.eval();
+    assertEquals(1UL,mexp::MathExpression::getRealEvaluations());
+
+    mexp::MathExpression::resetStatistics();
+    real.eval();
+    assertEquals(1UL,mexp::MathExpression::getRealEvaluations());
+
+    // a complex value falls back to the generic path
+    scope.varlist->insert("x",new mexp::Complex(0,1));
+    mexp::MathExpression::resetStatistics();
+    real.eval();
+    assertEquals(0UL,mexp::MathExpression::getRealEvaluations());
+
+  }
+
+  void testOptimization() throw (exc::ExceptionBase){
+
+    Scope scope;
+
+    // constants are folded, but printed as written
+    mexp::MathExpression constant("x*((1+ln(5))/2)",scope.varlist,scope.functionlist);
+
+    assertEquals(std::string("((x)*(((1)+(ln(5)))/(2)))"),constant.toString(PRECISION));
+    assertEquals(std::string("130.4718956217"),constant.eval()->toString(PRECISION));
+
+    constant.compile();
+    // LOAD, CONST, MUL, RET
+    assertEquals(4UL,constant.getProgram()->size());
+
+    // identities of numbers are left out by the compiled program, the tree is printed as written
+    mexp::MathExpression identity("1*(sin(x))^1-0",scope.varlist,scope.functionlist);
+
+    assertEquals(std::string("(((1)*((sin(x))^(1)))-(0))"),identity.toString(PRECISION));
+    assertEquals(evaluate("sin(x)",scope,false),identity.evalCompiled()->toString(PRECISION));
+    // LOAD, SIN, RET
+    assertEquals(3UL,identity.getProgram()->size());
+
+    // tuples don't support them
+    assertSameResult("(1,2)+0");
+    assertSameResult("(1,2)*1");
+    assertSameResult("(1,2)^1");
+    assertSameResult("((1,2),(3,4))*1");
+    assertSameResult("x*1");
+
+    // the sign of zero is kept
+    assertSameResult("sin(z=0*(-1))+0");
+    assertSameResult("0+sin(z=0*(-1))");
+    assertSameResult("sin(z=0*(-1))-0");
+    assertSameResult("sin(z=0*(-1))/1");
+    assertEquals(std::string("-0"),evaluate("sin(z=0*(-1))*1",scope,true));
+
+    // integer powers are multiplied
+    assertEquals(std::string("9"),evaluate("3^2",scope,false,17));
+    assertEquals(std::string("-8"),evaluate("(-2)^3",scope,false,17));
+    assertEquals(std::string("-3+4i"),evaluate("(1+2*i)^2",scope,false,17));
+
+    // loop-invariant subtrees
+    assertSameResult("Sum[k=1;10](k*sin(x)+ln(x))");
+    assertSameResult("Sum[j=1;3](Sum[k=1;j](k*j+x^2))");
+    assertSameResult("Sum[k=1;3](y=k*x)+y");
+    assertSameResult("Sum[k=3;1](unknown*2)");
+    assertSameResult("Sum[k=1;3](unknown*2)");
+    assertSameResult("Sum[k=1;4](outer(k)+inner(x*2))");
+
+    mexp::MathExpression sum("Sum[k=1;10](k*sin(x))",scope.varlist,scope.functionlist);
+
+    mexp::MathExpression::resetStatistics();
+    sum.eval();
+    // the body and sin(x) once
+    assertEquals(12UL,mexp::MathExpression::getRealEvaluations());
+
+  }
+
+  void testMemoization() throw (exc::ExceptionBase){
+
+    Scope scope;
+
+    scope.define("ga(n)=n+1");
+    scope.define("gb(n)=ga(n)+ga(n)");
+    scope.define("gc(n)=gb(n)+gb(n)");
+    scope.define("gd(n)=gc(n)+gc(n)");
+    scope.define("set(y)=(x=y)*2");
+
+    scope.functionlist->setMemoization(true);
+
+    // every function is evaluated only once
+    assertEquals(std::string("16"),evaluate("gd(1)",scope,false));
+    assertEquals(1UL,scope.functionlist->get("ga")->getMisses());
+    assertEquals(1UL,scope.functionlist->get("ga")->getHits());
+    assertEquals(1UL,scope.functionlist->get("gc")->getHits());
+    assertEquals(std::string("16"),evaluate("gd(1)",scope,false));
+    assertEquals(1UL,scope.functionlist->get("gd")->getHits());
+
+    // the variables read from the calling scope are part of the key
+    assertEquals(std::string("200"),evaluate("inner(2)",scope,false));
+    evaluate("x=3",scope,false);
+    assertEquals(std::string("6"),evaluate("inner(2)",scope,false));
+    assertEquals(std::string("10"),evaluate("outer(5)",scope,false));
+    assertEquals(std::string("12"),evaluate("outer(6)",scope,false));
+    assertEquals(std::string("6"),evaluate("side(3)",scope,false));
+
+    // assignments to global variables disable the memoization
+    assertTrue(scope.functionlist->get("side")->isPure());
+    assertTrue(!scope.functionlist->get("set")->isPure());
+    assertEquals(std::string("8"),evaluate("set(4)",scope,false));
+    assertEquals(0UL,scope.functionlist->get("set")->getMisses());
+
+    // the least recently used results are evicted
+    scope.functionlist->setMemoLimit(2);
+    evaluate("inner(1)+inner(2)+inner(3)+inner(1)",scope,false);
+    assertEquals(2UL,scope.functionlist->get("inner")->getMemoSize());
+    assertEquals(0UL,scope.functionlist->get("inner")->getHits());
+
+    // redefinitions drop the results
+    scope.functionlist->remove("ga");
+    scope.define("ga(n)=n+2");
+    assertEquals(std::string("24"),evaluate("gd(1)",scope,false));
+
+    scope.functionlist->setMemoization(false);
+    assertEquals(0UL,scope.functionlist->get("gd")->getMemoSize());
+
+  }
+
+  // evaluates the expression for all values by evalBatch() and compares the results with eval()
+  unsigned long assertSameBatchResult(const char *expression, const std::vector<double> &values) throw (exc::ExceptionBase){
+
+    Scope scope;
+    std::vector<std::string> names(1,"t");
+    std::vector<const mexp::cmplx_tp *> columns(1,&values[0]);
+    std::vector<mexp::cmplx_tp> re(values.size()), im(values.size());
+
+    mexp::MathExpression me(expression,scope.varlist,scope.functionlist);
+    unsigned long fallbacks = me.evalBatch(names,columns,values.size(),&re[0],&im[0]);
+
+    for ( unsigned long i = 0; i < values.size(); i++ ){
+
+      scope.varlist->insert("t",new mexp::Complex(values[i]));
+      assertEquals(evaluate(expression,scope,false,17),mexp::Complex(re[i],im[i]).toString(17),expression);
+
+    }
+
+    return fallbacks;
+
+  }
+
+  void testBatchEvaluation() throw (exc::ExceptionBase){
+
+    std::vector<double> values;
+
+    // more than one block, not a multiple of the vector-length
+    for ( int i = 0; i < 601; i++ )
+      values.push_back((i - 300)/7.0);
+
+    assertEquals(0UL,assertSameBatchResult("t^2*sin(t)-3*t/(1+t^2)+cos(x)",values));
+    assertEquals(0UL,assertSameBatchResult("exp(t/100)*Sum[k=1;10](k)-t\\3+t%2",values));
+
+    // not real-valued or not blockwise
+    assertEquals(300UL,assertSameBatchResult("ln(t)",values));
+    assertEquals(601UL,assertSameBatchResult("inner(t)+(a=t)+a",values));
+
+    Scope scope;
+    std::vector<std::string> names(1,"t");
+    std::vector<const mexp::cmplx_tp *> columns(1,&values[0]);
+    std::vector<mexp::cmplx_tp> re(values.size());
+
+    mexp::MathExpression logarithm("ln(t)",scope.varlist,scope.functionlist);
+
+    try{
+      logarithm.evalBatch(names,columns,values.size(),&re[0]);
+      assertTrue(false);
+    } catch (mexp::EvalException &e){}
+
+    mexp::MathExpression division("1/t",scope.varlist,scope.functionlist);
+
+    try{
+      division.evalBatch(names,columns,values.size(),&re[0]);
+      assertTrue(false);
+    } catch (mexp::EvalException &e){
+      assertEquals(std::string("division by zero!"),e.getMsg());
+    }
+
+    mexp::MathExpression tuple("(a=t,1)",scope.varlist,scope.functionlist);
+
+    try{
+      tuple.evalBatch(names,columns,values.size(),&re[0]);
+      assertTrue(false);
+    } catch (mexp::EvalException &e){}
+
+    // protected variables can't be bound
+    names[0] = "pi";
+    try{
+      tuple.evalBatch(names,columns,values.size(),&re[0]);
+      assertTrue(false);
+    } catch (mexp::EvalException &e){}
+
+    // the VariableList is not modified
+    assertTrue(!scope.varlist->isMember("t"));
+    assertTrue(!scope.varlist->isMember("a"));
+
+  }
+
+  // evaluates the expression sequentially and in parallel by the given number of threads
+  std::string assertSameParallelResult(const char *expression, unsigned int threads) throw (exc::ExceptionBase){
+
+    Scope sequential;
+    Scope parallel;
+
+    mexp::MathExpression::setParallelThreshold(0);
+    std::string expected = evaluate(expression,sequential,false);
+
+    mexp::MathExpression::setParallelThreshold(100);
+    mexp::MathExpression::setParallelThreads(threads);
+    std::string result = evaluate(expression,parallel,false,17);
+
+    assertEquals(expected,evaluate(expression,parallel,false),expression);
+    assertEquals(sequential.varlist->toString(true,PRECISION),parallel.varlist->toString(true,PRECISION),expression);
+
+    return result;
+
+  }
+
+  void testParallelSumProd() throw (exc::ExceptionBase){
+
+    unsigned long threshold = mexp::MathExpression::getParallelThreshold();
+    unsigned int threads = mexp::MathExpression::getParallelThreads();
+
+    const char *expressions[] = { "Sum[k=1;10000](k)", "Prod[k=1;200](1+1/k)", "Sum[k=1;1000]((k,2*k))",
+				  "Sum[k=0;1000](poisson(3,k%20))", "Sum[k=1;500](Sum[j=1;k](j))",
+				  "Sum[k=1;1000](t=k)", "Sum[k=0;1000](1/(k-500))", "Sum[k=1;1000](ln(k-1))", 0 };
+
+    for ( int i = 0; expressions[i]; i++ )
+      assertSameParallelResult(expressions[i],4);
+
+    // the partial sums are combined in the same order for any number of threads
+    assertEquals(assertSameParallelResult("Sum[k=1;5000](1/k)",2),assertSameParallelResult("Sum[k=1;5000](1/k)",7));
+
+    // also with one thread, in compiled programs and in function-bodies
+    Scope scope;
+    const char *sum = "Sum[k=1;50000](sin(k)/k)";
+
+    scope.define("h(n)=Sum[k=1;n](sin(k)/k)");
+    mexp::MathExpression::setParallelThreshold(10000);
+    mexp::MathExpression::setParallelThreads(4);
+
+    std::string result = evaluate(sum,scope,false,17);
+
+    assertEquals(result,evaluate(sum,scope,true,17));
+    assertEquals(result,evaluate("h(50000)",scope,false,17));
+
+    mexp::MathExpression::setParallelThreads(1);
+    assertEquals(result,evaluate(sum,scope,false,17));
+    assertEquals(result,evaluate(sum,scope,true,17));
+    assertEquals(result,evaluate("Sum[j=1;1](Sum[k=1;50000](sin(k*j)/k))",scope,true,17));
+
+    mexp::MathExpression::setParallelThreshold(threshold);
+    mexp::MathExpression::setParallelThreads(threads);
+
+  }
+
+  // returns the position of the ParseException, 0 if none
+  static int parsePosition(const char *expression){
+
+    Scope scope;
+
+    try{
+      mexp::MathExpression me(expression,scope.varlist,scope.functionlist);
+    } catch (mexp::ParseException &pe){
+      return pe.getPos();
+    }
+
+    return 0;
+
+  }
+
+  // returns the position of the ParseException thrown by the evaluation, 0 if none
+  static int evalPosition(const char *expression, bool compiled){
+
+    Scope scope;
+
+    try{
+      mexp::MathExpression me(expression,scope.varlist,scope.functionlist);
+      compiled ? me.evalCompiled() : me.eval();
+    } catch (mexp::ParseException &pe){
+      return pe.getPos();
+    } catch (mexp::FunctionDefinition &fd){}
+
+    return 0;
+
+  }
+
+  void testParsePositions() throw (exc::ExceptionBase){
+
+    assertEquals(6,parsePosition("sin(x"));
+    assertEquals(11,parsePosition("2*(3+(4,5)"));
+    assertEquals(6,parsePosition("(1,2,)"));
+    assertEquals(4,parsePosition("x+1)"));
+    assertEquals(9,parsePosition("log[2(8)"));
+    assertEquals(13,parsePosition("(x+1)*((x-1)"));
+    assertEquals(17,parsePosition("Sum[k=1;3]((k,1)"));
+    assertEquals(9,parsePosition("(1,(2,3]),4)"));
+
+    // definitions are reported at the same position by the expression-tree and the compiled program
+    const char *definitions[] = { "(sgn(y))=x", "Prod[k=1;4]((sgn((y/y)))=x)", "2+Sum[k=1;(sin(y)=2)](k)",
+				  "2+Sum[k=(sin(y)=2);3](k)", "1+Sum[j=1;2](3*Sum[k=1;4]((sgn(y))=x))", 0 };
+
+    for ( int i = 0; definitions[i]; i++ ){
+
+      assertTrue(evalPosition(definitions[i],false) > 0,definitions[i]);
+      assertEquals(evalPosition(definitions[i],false),evalPosition(definitions[i],true),definitions[i]);
+
+    }
+
+    // deeply nested brackets and tuples
+    std::string nested = "x";
+    std::string tuple = "1";
+
+    for ( int i = 0; i < 1000; i++ ){
+
+      nested = "(" + nested + "+1)";
+      tuple = "(" + tuple + ",1)";
+
+    }
+
+    Scope scope;
+
+    assertEquals(std::string("1100"),evaluate(nested.c_str(),scope,false));
+    assertEquals(0,parsePosition(tuple.c_str()));
+    assertEquals(4002,parsePosition((nested + ")").c_str()));
+
+  }
+
+  void testExpressionCache() throw (exc::ExceptionBase){
+
+    Scope scope;
+    mexp::ExpressionCache cache(scope.varlist,scope.functionlist,3);
+
+    // trailing blanks don't matter
+    mexp::MathExpression *twice = cache.get("x*2");
+
+    assertEquals(std::string("200"),twice->eval()->toString(PRECISION));
+    assertTrue(twice == cache.get("x*2 \t"));
+    assertEquals(std::string("200"),twice->eval()->toString(PRECISION));
+    assertEquals(1UL,cache.getHits());
+    assertEquals(1UL,cache.getMisses());
+
+    // defining and undefining a function parses again
+    scope.define("v(y)=y^2");
+    assertEquals(std::string("4"),cache.get("v(2)")->eval()->toString(PRECISION));
+    scope.functionlist->remove("v");
+    scope.varlist->insert("v",new mexp::Complex(5));
+    assertEquals(std::string("10"),cache.get("v(2)")->eval()->toString(PRECISION));
+    assertEquals(1UL,cache.getInvalidations());
+    scope.varlist->remove("v");
+    scope.define("v(y)=y^3");
+    assertEquals(std::string("8"),cache.get("v(2)")->eval()->toString(PRECISION));
+    assertEquals(2UL,cache.getInvalidations());
+
+    // a name in front of a bracket is a function unless it's a variable
+    try{
+      cache.get("u(2)+1")->eval();
+      assertTrue(false);
+    } catch (mexp::EvalException &e){}
+
+    scope.varlist->insert("u",new mexp::Complex(4));
+    assertEquals(std::string("9"),cache.get("u(2)+1")->eval()->toString(PRECISION));
+    assertEquals(3UL,cache.getInvalidations());
+
+    // failing expressions are not cached, the least recently used are evicted
+    try{
+      cache.get("1+");
+      assertTrue(false);
+    } catch (mexp::ParseException &pe){}
+
+    assertEquals(3UL,cache.getSize());
+    cache.get("x*2");
+    cache.get("1+1");
+    assertEquals(3UL,cache.getSize());
+    cache.resetStatistics();
+    cache.get("x*2");
+    cache.get("v(2)");
+    assertEquals(1UL,cache.getHits());
+    assertEquals(1UL,cache.getMisses());
+
+  }
+
+  void testSharedProgram() throw (exc::ExceptionBase){
+
+    Scope scope;
+    const char *expressions[] = { "poisson(3,a%5)+inner(a)+Sum[k=1;a](k^2)", "(b=a)*x", "swap(a,ln(a))", "mmul(((a,1),(0,a)),((1,a),(a,1)))",
+				  "1/(a-7)", "f(y)=y", 0 };
+    mexp::ThreadPool pool(4);
+
+    for ( int i = 0; expressions[i]; i++ ){
+
+      mexp::MathExpression me(expressions[i],scope.varlist,scope.functionlist);
+      mexp::Program program(&me);
+      SharedRun job(program,scope.varlist,64);
+
+      pool.run(job,64);
+
+      for ( unsigned long part = 0; part < 64; part++ ){
+
+	Scope single;
+	std::ostringstream expression;
+
+	expression << "a=" << part;
+	single.define(expression.str().c_str());
+
+	std::string expected = evaluate(expressions[i],single,true);
+
+	if ( expected.find("defined") == 0 )
+	  assertTrue(job.results[part].find("function-definition not possible") != std::string::npos,expressions[i]);
+	else
+	  assertEquals(expected,job.results[part],expressions[i]);
+
+      }
+
+    }
+
+    // the bindings and assignments stay in the contexts
+    assertTrue(scope.varlist->isMember("a") == 0);
+    assertTrue(scope.varlist->isMember("b") == 0);
+    assertTrue(scope.functionlist->get("f") == 0);
+
+  }
+
+  void testTabulation() throw (exc::ExceptionBase){
+
+    Scope scope;
+    unsigned int threads = mexp::MathExpression::getParallelThreads();
+
+    mexp::MathExpression::setParallelThreads(4);
+
+    // more points than tiles held at the same time
+    mexp::Grid range(-1,600001,1);
+    mexp::MathExpression me("(t=x%7)+poisson(2,t)+ln(x)",scope.varlist,scope.functionlist);
+    TableCollector table;
+
+    assertEquals(0UL,me.tabulate("x",range,table));
+    assertEquals(600003UL,range.getSize());
+    assertEquals(range.getSize(),(unsigned long)table.re.size());
+    assertTrue(table.ordered);
+    assertTrue(scope.varlist->isMember("t") == 0);
+
+    for ( unsigned long i = 0; i < range.getSize(); i += 49999 ){
+
+      scope.varlist->insert("y",new mexp::Complex(-1 + (mexp::cmplx_tp)i));
+
+      mexp::MathExpression single("(t=y%7)+poisson(2,t)+ln(y)",scope.varlist,scope.functionlist);
+      const mexp::Complex *expected = dynamic_cast<const mexp::Complex *>(single.eval());
+
+      assertEquals(expected->getRe(),table.re[i]);
+      assertEquals(expected->getIm(),table.im[i]);
+
+    }
+
+
+    // rectangle of the complex plane, tuples can't be tabulated
+    mexp::Grid plane(-1,1,0.5,0,2,1);
+    TableCollector tuples;
+    std::ostringstream csv;
+    mexp::CsvWriter writer(csv,4);
+
+    assertEquals(15UL,plane.getSize());
+    assertEquals(15UL,mexp::MathExpression("swap(z,1)",scope.varlist,scope.functionlist).tabulate("z",plane,tuples));
+    assertEquals(0UL,mexp::MathExpression("z+1",scope.varlist,scope.functionlist).tabulate("z",plane,writer));
+    assertEquals(std::string("re(z),im(z),re,im\n-1,0,0,0\n-0.5,0,0.5,0\n"),csv.str().substr(0,40));
+    assertEquals(std::string("\n1,2,2,2\n"),csv.str().substr(csv.str().size()-9));
+
+    mexp::MathExpression::setParallelThreads(threads);
+
+  }
+
+  void testConditional() throw (exc::ExceptionBase){
+
+    assertSameResult("(1<2)+(2<=2)+(1>2)+(2>=3)");
+    assertSameResult("(2==2+0*i)+(i!=i)+((3!)==6)+(3!=6)");
+    assertSameResult("1+1==2");
+
+    // "!==" after an operand is the faculty compared by "=="
+    Scope scope;
+    mexp::MathExpression faculty("25!==25!",scope.varlist,scope.functionlist);
+
+    assertEquals(std::string("(((25)!)==((25)!))"),faculty.toString(PRECISION));
+    assertEquals(std::string("1"),evaluate("25!==25!",scope,false));
+    assertEquals(std::string("1"),evaluate("x!==x!",scope,true));
+    assertEquals(std::string("0"),evaluate("3!!=6",scope,false));
+    assertEquals(std::string("1"),evaluate("3!=6",scope,false));
+    assertSameResult("cond(x>=100,x,unknown)");
+    assertSameResult("cond(x-100,unknown,y=3)+y");
+    assertSameResult("cond(2*i,1,2)");
+    assertSameResult("i<1");
+    assertSameResult("(1,2)==(1,2)");
+    assertSameResult("cond((1,0),1,2)");
+    assertSameResult("cond(1,(1,2),3)");
+    assertSameResult("Sum[k=1;10](cond(k%2==0,k,-k))");
+    assertSameRealResult("cond(x>50,x<101,x)+(x==100)");
+
+    assertTrue(parsePosition("cond(1,2)") > 0);
+    assertTrue(parsePosition("cond(1,2,3,4)") > 0);
+    assertTrue(parsePosition("1<") > 0);
+
+    // the branch not taken is not evaluated: recursion terminates and runs in linear time
+    Scope tree;
+    Scope compiled;
+    const char *definitions[] = {"fac(n)=cond(n<2,1,n*fac(n-1))","fib(n)=cond(n<2,n,fib(n-1)+fib(n-2))",
+				 "s(n)=cond(n<1,0,n+s(n-1))"};
+
+    for ( int i = 0; i < 3; i++ ){
+      tree.define(definitions[i]);
+      compiled.define(definitions[i]);
+    }
+
+    assertEquals(std::string("6765"),evaluate("fib(20)",tree,false));
+    assertEquals(std::string("6765"),evaluate("fib(20)",compiled,true));
+    assertEquals(evaluate("20!",tree,false),evaluate("fac(20)",tree,false));
+    assertEquals(evaluate("20!",tree,false),evaluate("fac(20)",compiled,true));
+    assertEquals(std::string("500500"),evaluate("s(1000)",tree,false));
+    assertEquals(std::string("500500"),evaluate("s(1000)",compiled,true));
+
+  }
+
+  void testDeepRecursion() throw (exc::ExceptionBase){
+
+    Scope scope;
+
+    scope.define("acc(n,a)=cond(n<1,a,acc(n-1,a+n))");
+    scope.define("s(n)=cond(n<1,0,n+s(n-1))");
+    scope.define("fib(n)=cond(n<2,n,fib(n-1)+fib(n-2))");
+
+    // the frames are kept on the heap, a call in tail-position replaces the frame of the caller
+    assertEquals(std::string("500000500000"),evaluate("acc(1000000,0)",scope,false,12));
+    assertEquals(std::string("500000500000"),evaluate("acc(1000000,0)",scope,true,12));
+    assertEquals(std::string("20000100000"),evaluate("s(200000)",scope,false,12));
+    assertEquals(std::string("20000100000"),evaluate("s(200000)",scope,true,12));
+
+    mexp::MathExpression me("acc(3,0)",scope.varlist,scope.functionlist);
+    mexp::Program program(&me);
+
+    assertEquals(1,countOccurrences(program.toString(),"tail"));
+
+    // memoized calls within a recursion
+    scope.functionlist->setMemoization(true);
+    assertEquals(std::string("190392490709135"),evaluate("fib(70)",scope,false,15));
+    assertEquals(71UL,scope.functionlist->get("fib")->getMisses());
+    assertEquals(std::string("190392490709135"),evaluate("fib(70)",scope,true,15));
+    assertEquals(71UL,scope.functionlist->get("fib")->getMisses());
+    scope.functionlist->setMemoization(false);
+
+    // the parameters of the caller are visible to the callee: no replacement
+    scope.define("outerb(x)=inner(3)");
+    assertEquals(std::string("12"),evaluate("outerb(4)",scope,false));
+    assertEquals(std::string("12"),evaluate("outerb(4)",scope,true));
+
+    // a recursion without a base case is stopped
+    unsigned long depth = mexp::MathExpression::getMaxCallDepth();
+    std::string toodeep = mexp::EvalException("recursion too deep!").getIdMsg();
+
+    scope.define("endless(x)=endless(x-1)+1");
+    assertEquals(toodeep,evaluate("endless(1)",scope,false));
+    assertEquals(toodeep,evaluate("endless(1)",scope,true));
+
+    mexp::MathExpression::setMaxCallDepth(100);
+    assertEquals(std::string("4950"),evaluate("s(99)",scope,false));
+    assertEquals(toodeep,evaluate("s(100)",scope,false));
+    assertEquals(toodeep,evaluate("s(100)",scope,true));
+    assertEquals(std::string("500000500000"),evaluate("acc(1000000,0)",scope,true,12));
+    mexp::MathExpression::setMaxCallDepth(depth);
+
+    // in tail-position the number of calls is limited
+    unsigned long tailcalls = mexp::MathExpression::getMaxTailCalls();
+    std::string toomany = mexp::EvalException("too many calls in tail-position!").getIdMsg();
+
+    scope.define("inf(n)=inf(n+1)");
+    assertEquals(toomany,evaluate("inf(1)",scope,false));
+    assertEquals(toomany,evaluate("inf(1)",scope,true));
+
+    mexp::MathExpression::setMaxTailCalls(1000);
+    assertEquals(std::string("500500"),evaluate("acc(1000,0)",scope,true));
+    assertEquals(toomany,evaluate("acc(1001,0)",scope,false));
+    assertEquals(toomany,evaluate("acc(1001,0)",scope,true));
+    mexp::MathExpression::setMaxTailCalls(tailcalls);
+
+  }
+
+  void testPrecompiledBodies() throw (exc::ExceptionBase){
+
+    Scope scope;
+
+    scope.define("ha(x)=x+1");
+    scope.define("hb(x)=ha(x)*2+Sum[k=1;x](k)");
+
+    assertEquals(std::string("14"),evaluate("hb(3)",scope,false));
+    assertEquals(std::string("14"),evaluate("hb(3)",scope,true));
+
+    // the code of hb is linked against the new definition of the callee
+    scope.functionlist->remove("ha");
+    scope.define("ha(x)=x*10");
+    assertEquals(std::string("66"),evaluate("hb(3)",scope,false));
+    assertEquals(std::string("66"),evaluate("hb(3)",scope,true));
+
+    // other parameters: the body of hb is compiled again
+    scope.functionlist->remove("ha");
+    scope.define("ha(y)=y*y");
+    assertEquals(std::string("24"),evaluate("hb(3)",scope,false));
+    assertEquals(std::string("24"),evaluate("hb(3)",scope,true));
+
+    scope.functionlist->remove("ha");
+    assertTrue(evaluate("hb(3)",scope,false).find("unknown operator/function!") != std::string::npos);
+    assertTrue(evaluate("hb(3)",scope,true).find("unknown operator/function!") != std::string::npos);
+
+  }
+
+  void testTupleValues() throw (exc::ExceptionBase){
+
+    Scope scope;
+
+    scope.define("tp((a,b),c)=(c,(b,a))");
+
+    // the nested tuples are taken over by the enclosing tuple, the next evaluation builds them again
+    mexp::MathExpression me("((1,2),(3,(4,5)))",scope.varlist,scope.functionlist);
+
+    assertEquals(std::string("((1,2),(3,(4,5)))"),me.eval()->toString(PRECISION));
+    assertEquals(std::string("((1,2),(3,(4,5)))"),me.eval()->toString(PRECISION));
+
+    // the elements of an argument are moved into the slots
+    assertEquals(std::string("(3,(2,1))"),evaluate("tp((1,2),3)",scope,false));
+    assertEquals(std::string("(3,(2,1))"),evaluate("tp((1,2),3)",scope,true));
+    assertEquals(std::string("(3,(2,1))"),evaluate("tp(((1,2),3))",scope,true));
+    assertEquals(evaluate("tp((1,2,5),3)",scope,false),evaluate("tp(((1,2,5),3))",scope,true));
+
+  }
+
+  void testMatrices() throw (exc::ExceptionBase){
+
+    Scope scope;
+
+    assertEquals(std::string("((19,22),(43,50))"),evaluate("matrix((1,2),(3,4))*matrix((5,6),(7,8))",scope,false));
+    assertEquals(std::string("((1,3),(2,4))"),evaluate("transp((1,2),(3,4))",scope,false));
+    assertEquals(std::string("((1),(2),(3))"),evaluate("matrix(1,2,3)",scope,false));
+    assertEquals(std::string("((14))"),evaluate("transp(matrix(1,2,3))*matrix(1,2,3)",scope,false));
+    assertEquals(std::string("-2"),evaluate("det((1,2),(3,4))",scope,false));
+    assertEquals(std::string("((-4),(4.5))"),evaluate("solve(matrix((1,2),(3,4)),(5,6))",scope,false));
+    assertEquals(std::string("((i,2i),(3i,4i))"),evaluate("i*matrix((1,2),(3,4))",scope,false));
+
+    assertSameResult("a=matrix((1,2),(3,4));a*solve(a,matrix((5,6),(7,8)))-matrix((5,6),(7,8))");
+    assertSameResult("Prod[k=1;3](matrix((1,2),(3,4)))+Sum[k=1;3](k*matrix((1,0),(0,1)))");
+    assertSameResult("det(matrix((i,1),(1,i)))");
+    assertSameResult("solve(matrix((1,2),(2,4)),(1,1))");
+    assertSameResult("matrix((1,2),(3))");
+    assertSameResult("matrix((1,2),(3,4))*matrix(1,2,3)");
+    assertTrue(parsePosition("solve(1)") > 0);
+
+    // a product large enough to be computed in parallel equals the sequential one
+    mexp::Matrix a(160,150), b(150,170);
+
+    for ( size_t r = 0; r < 160; r++ )
+      for ( size_t c = 0; c < 150; c++ ){
+	a.set(r,c,std::complex<double>((double)((r*7+c)%13),(double)((r+c)%3)));
+	b.set(c,r%170,std::complex<double>((double)((r+3*c)%11),0));
+      }
+
+    unsigned int threads = mexp::MathExpression::getParallelThreads();
+
+    mexp::MathExpression::setParallelThreads(1);
+    std::auto_ptr<mexp::Value> sequential(a*(&b));
+    mexp::MathExpression::setParallelThreads(3);
+    std::auto_ptr<mexp::Value> parallel(a*(&b));
+    mexp::MathExpression::setParallelThreads(threads);
+
+    assertEquals(sequential->toString(PRECISION),parallel->toString(PRECISION));
+
+  }
+
+  void testBigIntegers() throw (exc::ExceptionBase){
+
+    Scope scope;
+
+    assertEquals(std::string("6402373705728000"),evaluate("18!",scope,false));
+    assertEquals(std::string("15511210043330985984000000"),evaluate("25!",scope,false));
+    assertEquals(std::string("100891344545564193334812497256"),evaluate("100@50",scope,false));
+    assertEquals(std::string("166666666666166666666667000000000000"),evaluate("1000000000000@3",scope,false));
+    assertEquals(std::string("26"),evaluate("(26!)\\(25!)",scope,false));
+    assertEquals(std::string("-6"),evaluate("(25!+1)%(-7)",scope,false));
+    assertEquals(std::string("1"),evaluate("(25!)<(25!+1)",scope,false));
+    assertEquals(std::string("274410818470142134209703780940313"),evaluate("Sum[k=1;30](k!)",scope,false));
+    assertEquals(std::string("310224200866619719680000000000"),evaluate("Sum[k=1;20000](25!)",scope,false));
+
+    // 100000! has 456574 digits
+    assertEquals(456574UL,(unsigned long)evaluate("100000!",scope,false).size());
+
+    assertSameResult("Sum[k=1;30](k!)+30@15");
+    assertSameResult("(25!)^3-24!*25");
+    assertSameResult("(25!+0.5)*2");
+    assertSameResult("(-3)!+2^53");
+
+    // an Integer beyond the range of a double is scaled: the result under- or overflows as a double would
+    assertEquals(evaluate("e",scope,false),evaluate("Sum[k=0;200](1/k!)",scope,false));
+    assertSameResult("Sum[k=0;200](1/k!)");
+    assertEquals(evaluate("e^1.5",scope,false),evaluate("Sum[k=0;1000](1.5^k/k!)",scope,false));
+    assertEquals(std::string("3.3679241642"),evaluate("3^200/200!*10^280",scope,false));
+    assertEquals(std::string("100.5"),evaluate("201!/(2*200!)",scope,false));
+    assertEquals(std::string("0"),evaluate("1/200!",scope,false));
+    assertEquals(std::string("-inf"),evaluate("(-200!)*0.5",scope,false));
+
+    // memoized functions distinguish integers with the same approximation
+    scope.define("inc(n)=n+1");
+    scope.functionlist->setMemoization(true);
+
+    assertEquals(std::string("15511210043330985984000001"),evaluate("inc(25!)",scope,false));
+    assertEquals(std::string("15511210043330985984000002"),evaluate("inc(25!+1)",scope,false));
+
+  }
+
+  void testSpreadsheet() throw (exc::ExceptionBase){
+
+    Scope scope;
+    mexp::Spreadsheet sheet(scope.varlist,scope.functionlist);
+
+    assertEquals(std::string("2"),sheet.evaluate("a=2")->toString(PRECISION));
+    sheet.evaluate("y=a*3");
+    sheet.evaluate("c=y+a");
+    sheet.evaluate("s=Sum[k=1;3](k*a)");
+
+    // only the dependent formulas are recomputed, dependencies first
+    sheet.evaluate("a=5");
+    assertEquals(3UL,(unsigned long)sheet.getRecomputed().size());
+    assertEquals(std::string("y"),sheet.getRecomputed()[0]);
+    assertEquals(std::string("c"),sheet.getRecomputed()[1]);
+    assertEquals(std::string("20"),evaluate("c",scope,false));
+    assertEquals(std::string("30"),evaluate("s",scope,false));
+
+    sheet.evaluate("z=1");
+    assertTrue(sheet.getRecomputed().empty());
+
+    // a formula closing a cycle is rejected and the previous one is kept
+    try{
+      sheet.evaluate("y=c");
+      assertTrue(false);
+    } catch (mexp::EvalException &e){
+      assertEquals(std::string("cyclic dependency of variables!"),e.getMsg());
+    }
+    assertEquals(std::string("15"),evaluate("y",scope,false));
+
+    // formulas calling a function depend on its free variables and are recomputed on its definition
+    sheet.evaluate("t=2");
+
+    try{
+      sheet.evaluate("f(x)=x*t");
+      assertTrue(false);
+    } catch (mexp::FunctionDefinition &fd){}
+
+    sheet.evaluate("d=f(a)+1");
+    sheet.evaluate("t=3");
+    assertEquals(std::string("16"),evaluate("d",scope,false));
+
+    scope.functionlist->remove("f");
+    try{
+      sheet.evaluate("f(x)=x-t");
+      assertTrue(false);
+    } catch (mexp::FunctionDefinition &fd){}
+    assertEquals(std::string("3"),evaluate("d",scope,false));
+
+    // undefining a function fails the recomputation of the formulas calling it
+    scope.functionlist->remove("f");
+    try{
+      sheet.update("f");
+      assertTrue(false);
+    } catch (mexp::EvalException &e){
+      assertEquals(std::string("d"),e.getObjName());
+    }
+
+    try{
+      sheet.evaluate("f(x)=x+t");
+      assertTrue(false);
+    } catch (mexp::FunctionDefinition &fd){}
+    assertEquals(std::string("9"),evaluate("d",scope,false));
+
+    // an assignment reading the variable itself updates the value and drops the formula
+    sheet.evaluate("a=a+1");
+    assertEquals(std::string("18"),evaluate("y",scope,false));
+    assertEquals(6UL,sheet.getSize());
+
+    sheet.evaluate("z=y");
+    sheet.evaluate("a=2");
+    assertEquals(std::string("6"),evaluate("z",scope,false));
+
+    scope.varlist->insert("a",new mexp::Complex(1));
+    sheet.update("a");
+    assertEquals(std::string("4"),evaluate("c",scope,false));
+
+  }
+
+  // saves a function, replaces the first occurrence of from by to and returns the message of the loading
+  static std::string loadCorrupted(const char *filename, const char *definition, const std::string &from,
+				   const std::string &to) throw (exc::ExceptionBase){
+
+    Scope source;
+
+    source.define(definition);
+    mexp::Snapshot::save(filename,source.varlist,source.functionlist);
+
+    std::ifstream in(filename,std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(in)),std::istreambuf_iterator<char>());
+    in.close();
+
+    content.replace(content.find(from),from.size(),to);
+
+    std::ofstream out(filename,std::ios::binary);
+    out.write(content.data(),(std::streamsize)content.size());
+    out.close();
+
+    Scope target;
+
+    try{
+      mexp::Snapshot::load(filename,target.varlist,target.functionlist);
+    } catch (exc::Exception<mexp::Snapshot> &e){
+
+      std::string name(definition,strchr(definition,'(') - definition);
+
+      return ( target.functionlist->isMember(name.c_str()) ? "inserted" : e.getMsg() );
+    }
+
+    return "";
+
+  }
+
+  void testSnapshot() throw (exc::ExceptionBase){
+
+    const char *filename = "/tmp/testmathexpression.snapshot";
+
+    Scope source;
+
+    evaluate("z=25!",source,false);
+    evaluate("u=(1,(2.5,-3i))",source,false);
+    evaluate("m=matrix((1,2),(3,4))",source,false);
+    evaluate("c=1.5+2i",source,false);
+    source.define("sq(x)=x^2");
+    source.define("g(n)=Sum[k=1;n](sq(k))*c+(n>2)");
+
+    mexp::Snapshot::save(filename,source.varlist,source.functionlist);
+    assertTrue(mexp::Snapshot::isSnapshot(filename));
+
+    // the functions of the scope are already defined, a protected variable isn't overwritten
+    Scope target;
+    target.varlist->insert("c",new mexp::Complex(7),true);
+
+    std::vector<std::string> skipped = mexp::Snapshot::load(filename,target.varlist,target.functionlist);
+
+    assertEquals(9UL,(unsigned long)skipped.size());
+    assertEquals(std::string("c"),skipped[0]);
+
+    assertEquals(std::string("15511210043330985984000000"),evaluate("z",target,false));
+    assertEquals(std::string("15511210043330985984000001"),evaluate("z+1",target,false));
+    assertEquals(std::string("(1,(2.5,-3i))"),evaluate("u",target,false));
+    assertEquals(std::string("-2"),evaluate("det(m)",target,false));
+    assertEquals(std::string("211"),evaluate("g(4)",target,false));
+    assertEquals(std::string("211"),evaluate("g(4)",target,true));
+    assertEquals(std::string("300"),evaluate("inner(3)",target,false));
+
+    // a truncated snapshot doesn't insert anything
+    std::ifstream in(filename,std::ios::binary);
+    std::string content((std::istreambuf_iterator<char>(in)),std::istreambuf_iterator<char>());
+    in.close();
+
+    std::ofstream out(filename,std::ios::binary);
+    out.write(content.data(),(std::streamsize)(content.size() - 5));
+    out.close();
+
+    Scope truncated;
+
+    try{
+      mexp::Snapshot::load(filename,truncated.varlist,truncated.functionlist);
+      assertTrue(false);
+    } catch (exc::Exception<mexp::Snapshot> &e){
+      assertEquals(std::string("corrupt snapshot!"),e.getMsg());
+    }
+    assertFalse(truncated.functionlist->isMember("sq"));
+
+    // the trees must have the shape the parser gives them
+    assertEquals(std::string("corrupt snapshot!"),loadCorrupted(filename,"h(x)=sin(x)","sin","Sum"));
+    assertEquals(std::string("corrupt snapshot!"),loadCorrupted(filename,"pair(ab,cd)=ab*cd","cd","ab"));
+    assertEquals(std::string(""),loadCorrupted(filename,"h(x)=sin(x)","sin","cos"));
+
+    out.open(filename);
+    out << source.functionlist->toString(PRECISION);
+    out.close();
+
+    assertFalse(mexp::Snapshot::isSnapshot(filename));
+
+    try{
+      mexp::Snapshot::load(filename,truncated.varlist,truncated.functionlist);
+      assertTrue(false);
+    } catch (exc::Exception<mexp::Snapshot> &e){
+      assertEquals(std::string("no snapshot!"),e.getMsg());
+    }
+
+    remove(filename);
+
+  }
+
+  static mexp::Profiler::Entry profiled(const std::string &name){
+
+    std::vector<mexp::Profiler::Entry> entries = mexp::Profiler::getEntries();
+
+    for ( std::vector<mexp::Profiler::Entry>::iterator it = entries.begin(); it != entries.end(); it++ )
+      if ( it->name == name )
+	return *it;
+
+    return mexp::Profiler::Entry();
+
+  }
+
+  void testProfiler() throw (exc::ExceptionBase){
+
+    Scope scope;
+
+    scope.define("fib(n)=cond(n<2,n,fib(n-1)+fib(n-2))");
+    scope.define("sq(x)=x^2");
+    scope.define("h(x)=sq(x)+det(matrix(1,x))");
+
+    mexp::Profiler::reset();
+    mexp::Profiler::setEnabled(true);
+
+    assertEquals(std::string("55"),evaluate("fib(10)",scope,false));
+    assertEquals(std::string("385"),evaluate("Sum[k=1;10](sq(k))",scope,true));
+    assertEquals(std::string("(4,4)"),evaluate("(sq(2),sq(-2))",scope,false));
+
+    // the calls left by an exception are closed
+    assertTrue(evaluate("h(1)",scope,false) != "1");
+    assertEquals(0UL,(unsigned long)mexp::Profiler::getDepth());
+
+    mexp::Profiler::setEnabled(false);
+    evaluate("fib(5)",scope,false);
+
+    assertEquals(177UL,profiled("fib").calls);
+    // the first evaluation of the body of a Sum only determines the neutral element
+    assertEquals(14UL,profiled("sq").calls);
+    assertEquals(1UL,profiled("Sum").calls);
+    assertEquals(1UL,profiled("h").calls);
+
+    // recursive calls are accounted inclusive only once
+    assertTrue(profiled("fib").inclusive >= profiled("fib").exclusive);
+    assertTrue(profiled("Sum").inclusive >= profiled("sq").inclusive);
+    assertTrue(profiled("Sum").inclusive_allocations >= profiled("Sum").allocations);
+
+    std::ostringstream folded;
+    mexp::Profiler::writeFolded(folded);
+
+    assertTrue(countOccurrences(folded.str(),"fib;fib;fib") > 0);
+    assertTrue(countOccurrences(folded.str(),"Sum;sq") > 0);
+
+    mexp::Profiler::reset();
+    assertTrue(mexp::Profiler::getEntries().empty());
+
+  }
+
+  static int countOccurrences(const std::string &text, const std::string &pattern){
+
+    int count = 0;
+
+    for ( size_t pos = text.find(pattern); pos != std::string::npos; pos = text.find(pattern,pos + 1) )
+      count++;
+
+    return count;
+
+  }
+
+};
+
+#endif
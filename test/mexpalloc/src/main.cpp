@@ -0,0 +1,83 @@
+#include "main.hpp"
+
+using namespace std;
+using namespace exc;
+using namespace mexp;
+
+// counts every allocation of the program
+static unsigned long allocations = 0;
+
+void *operator new(size_t size) throw (std::bad_alloc){
+
+  void *memory = malloc(size ? size : 1);
+
+  if ( !memory )
+    throw std::bad_alloc();
+
+  allocations++;
+
+  return memory;
+
+}
+
+void operator delete(void *memory) throw (){
+
+  free(memory);
+
+}
+
+static double allocationsPerEval(MathExpression &me, int runs){
+
+  unsigned long before = allocations;
+
+  for ( int i = 0; i < runs; i++ )
+    me.eval();
+
+  return (double)(allocations - before)/runs;
+
+}
+
+int main(int argc, char **argv){
+
+  const char *expressions[] = { "Sum[k=1;1000](k^2+sin(k))",
+				"Prod[k=1;50](1+1/k)",
+				"2*((1,2),(3,sin(1)))",
+				"f(3)+Sum[k=1;100](f(k))",
+				0 };
+
+  const int runs = argc > 1 ? atoi(argv[1]) : 100;
+
+  try{
+
+    VariableList varlist;
+    FunctionList functionlist;
+
+    try{
+      MathExpression("f(x)=x*x+1",&varlist,&functionlist).eval();
+    } catch (FunctionDefinition &fd){}
+
+    cout << "allocations per eval(), " << runs << " runs:" << endl;
+
+    for ( int i = 0; expressions[i]; i++ ){
+
+      MathExpression me(expressions[i],&varlist,&functionlist);
+
+      Pool::setEnabled(false);
+      double unpooled = allocationsPerEval(me,runs);
+
+      Pool::setEnabled(true);
+      // fill the pools
+      me.eval();
+      double pooled = allocationsPerEval(me,runs);
+
+      cout << expressions[i] << ": without pool: " << unpooled << " with pool: " << pooled << endl;
+
+    }
+
+  } catch (ExceptionBase &e){
+    e.show();
+  }
+
+  return 0;
+
+}
@@ -0,0 +1,10 @@
+#ifndef MAIN_HPP
+#define MAIN_HPP
+
+#include <iostream>
+#include <cstdlib>
+#include <new>
+#include <fztooltempl/mathexpression.hpp>
+#include <fztooltempl/exception.hpp>
+
+#endif
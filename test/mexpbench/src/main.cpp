@@ -0,0 +1,233 @@
+#include "main.hpp"
+
+using namespace std;
+using namespace exc;
+using namespace cmdl;
+using namespace mexp;
+
+// counts every allocation of the program
+static unsigned long allocations = 0;
+
+void *operator new(size_t size) throw (std::bad_alloc){
+
+  void *memory = malloc(size ? size : 1);
+
+  if ( !memory )
+    throw std::bad_alloc();
+
+  allocations++;
+
+  return memory;
+
+}
+
+void operator delete(void *memory) throw (){
+
+  free(memory);
+
+}
+
+// the functions defined in addition to the library: recursion and tuples
+static const char *definitions[] = { "fibr(n)=cond(n<2,n,fibr(n-1)+fibr(n-2))",
+				     "depth(n)=cond(n<1,0,1+depth(n-1))",
+				     "count(n,a)=cond(n<1,a,count(n-1,a+1))",
+				     "tr(((a,b),(c,d)))=a+d",
+				     0 };
+
+static const char *benchmarks[][2] = { { "poisson", "SumPoisson(3,50)" },
+				       { "epot", "ePot(1.5)" },
+				       { "kapital", "Kapital((1000,3.5),30)" },
+				       { "fib-closed", "fib(30)" },
+				       { "ifelse", "ifelse((1,2),3)+impl(2,3)+abs(-2)" },
+				       { "fib-recursive", "fibr(18)" },
+				       { "deep-recursion", "depth(20000)" },
+				       { "tail-recursion", "count(100000,0)" },
+				       { "sum-large", "Sum[k=1;100000](k^2+sin(k))" },
+				       { "prod-large", "Prod[k=1;100000](1+1/k^2)" },
+				       { "sum-nested", "Sum[j=1;100](Sum[k=1;100](j*k))" },
+				       { "tuple-mmul", "Sum[k=1;2000](tr(mmul(((k,1),(0,k)),((1,k),(k,1)))))" },
+				       { "tuple-swap", "Sum[k=1;5000](tr(swap((k,1),(2,k))))" },
+				       { "matrix", "det(matrix((1,2,3),(4,5,6),(7,8,10)))*solve(matrix((2,1),(1,3)),(1,2))" },
+				       { "integer", "Sum[k=1;100](k!+(2*k)@k)" },
+				       { 0, 0 } };
+
+class Result{
+
+public:
+
+  string name;
+  double parse;
+  unsigned long evals;
+  double eval;
+  double allocs;
+  double values;
+  string value;
+
+  Result(const string &name) : name(name), parse(0), evals(0), eval(0), allocs(0), values(0){}
+
+};
+
+static double now(){
+
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC,&ts);
+
+  return (double)ts.tv_sec + 1e-9*(double)ts.tv_nsec;
+
+}
+
+// mean time of parsing the expressions in microseconds
+static double parseTime(const vector<string> &expressions, VariableList *vl, FunctionList *fl, double budget)
+  throw (ExceptionBase){
+
+  unsigned long parsed = 0;
+  double start = now(), elapsed;
+
+  do{
+
+    for ( vector<string>::const_iterator it = expressions.begin(); it != expressions.end(); it++, parsed++ )
+      MathExpression me(it->c_str(),vl,fl);
+
+  } while ( (elapsed = now() - start) < budget );
+
+  return 1e6*elapsed/(double)parsed;
+
+}
+
+static void evalTime(Result &result, MathExpression &me, double budget) throw (ExceptionBase){
+
+  // fills the pools and compiles the called functions
+  result.value = me.eval()->toString(6);
+
+  unsigned long allocated = allocations;
+  unsigned long requests = Pool::getRequests();
+  double start = now(), elapsed;
+
+  do{
+
+    me.eval();
+    result.evals++;
+
+  } while ( (elapsed = now() - start) < budget );
+
+  result.eval = 1e9*elapsed/(double)result.evals;
+  result.allocs = (double)(allocations - allocated)/(double)result.evals;
+  result.values = (double)(Pool::getRequests() - requests)/(double)result.evals;
+
+}
+
+static vector<string> readLibrary(const string &filename) throw (ExceptionBase){
+
+  ifstream file(filename.c_str());
+
+  if ( !file )
+    throw Exception<MathExpression>("can't open library " + filename + "!");
+
+  vector<string> lines;
+  string line;
+
+  while ( getline(file,line) )
+    if ( line.find_first_not_of(" \t\r") != string::npos )
+      lines.push_back(line);
+
+  return lines;
+
+}
+
+static void define(const string &definition, VariableList *vl, FunctionList *fl) throw (ExceptionBase){
+
+  try{
+    MathExpression(definition.c_str(),vl,fl).eval();
+  } catch (FunctionDefinition &fd){}
+
+}
+
+int main(int argc, char **argv){
+
+  CmdlParser cmdlparser(argc,argv);
+
+  cmdlparser.addShortoption('h',"print help");
+  cmdlparser.addParameter("library","file","functions to be defined first (default: fizzcal/example_commands.fizzcal)");
+  cmdlparser.addParameter("time","ms","minimal time per measurement (default: 200)");
+
+  try{
+
+    cmdlparser.parse();
+
+    if ( cmdlparser.checkShortoption('h') == true ){
+
+      clog << "parses and evaluates a corpus of expressions, one line of csv per benchmark on standard-output:" << endl
+	   << "benchmark,parse_us,evals,eval_ns_per_op,allocs_per_op,values_per_op,result" << endl << endl
+	   << cmdlparser.infoUsage();
+      return 0;
+
+    }
+
+    string library = "../../fizzcal/example_commands.fizzcal";
+    double budget = 0.2;
+
+    if ( cmdlparser.checkParameter("library").first == true )
+      library = cmdlparser.checkParameter("library").second;
+
+    if ( cmdlparser.checkParameter("time").first == true )
+      budget = atof(cmdlparser.checkParameter("time").second.c_str())/1000;
+
+    VariableList varlist;
+    FunctionList functionlist;
+
+    varlist.insert("pi",new Complex(M_PI),true);
+    varlist.insert("e",new Complex(M_E),true);
+    varlist.insert("i",new Complex(0,1),true);
+
+    vector<string> corpus = readLibrary(library);
+
+    for ( int i = 0; definitions[i]; i++ )
+      corpus.push_back(definitions[i]);
+
+    for ( vector<string>::iterator it = corpus.begin(); it != corpus.end(); it++ )
+      define(*it,&varlist,&functionlist);
+
+    vector<Result> results;
+
+    // parsing only, the functions are already defined
+    results.push_back(Result("parse-library"));
+    results.back().parse = parseTime(corpus,&varlist,&functionlist,budget);
+
+    for ( int i = 0; benchmarks[i][0]; i++ ){
+
+      results.push_back(Result(benchmarks[i][0]));
+
+      results.back().parse = parseTime(vector<string>(1,benchmarks[i][1]),&varlist,&functionlist,budget/4);
+
+      MathExpression me(benchmarks[i][1],&varlist,&functionlist);
+
+      evalTime(results.back(),me,budget);
+
+    }
+
+    cout << "benchmark,parse_us,evals,eval_ns_per_op,allocs_per_op,values_per_op,result" << endl;
+
+    for ( vector<Result>::iterator it = results.begin(); it != results.end(); it++ )
+      cout << it->name << "," << it->parse << "," << it->evals << "," << it->eval << "," << it->allocs << ","
+	   << it->values << ",\"" << it->value << "\"" << endl;
+
+    clog << endl << setw(16) << left << "benchmark" << right << setw(12) << "parse [us]" << setw(10) << "evals"
+	 << setw(16) << "eval [ns/op]" << setw(14) << "allocs/op" << setw(14) << "values/op" << endl;
+
+    clog << fixed << setprecision(1);
+
+    for ( vector<Result>::iterator it = results.begin(); it != results.end(); it++ )
+      clog << setw(16) << left << it->name << right << setw(12) << it->parse << setw(10) << it->evals
+	   << setw(16) << it->eval << setw(14) << it->allocs << setw(14) << it->values << endl;
+
+  } catch (ExceptionBase &e){
+
+    e.show();
+    return 1;
+
+  }
+
+  return 0;
+
+}
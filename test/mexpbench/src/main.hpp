@@ -0,0 +1,18 @@
+#ifndef MAIN_HPP
+#define MAIN_HPP
+
+#include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <cstdlib>
+#include <new>
+#include <math.h>
+#include <time.h>
+#include <fztooltempl/mathexpression.hpp>
+#include <fztooltempl/cmdlparser.hpp>
+#include <fztooltempl/exception.hpp>
+
+#endif